@@ -0,0 +1,103 @@
+#include <functional>
+#include <string>
+#include "Sailor.h"
+#include "Tasks/Scheduler.h"
+#include "Tasks/ParallelFor.h"
+#include "Containers/Vector.h"
+#include "Containers/Set.h"
+#include "Containers/Map.h"
+#include "Containers/List.h"
+#include "Memory/Memory.h"
+#include "Core/SpinLock.h"
+
+using namespace Sailor;
+
+/* The headless application that is linked against SailorCore only.
+*  There is no window, renderer or asset registry, the only submodule is the scheduler,
+*  that is enough to run the benchmarks of Tasks, Memory and Containers.
+*/
+App* App::s_pInstance = nullptr;
+const char* App::ApplicationName = "SailorHeadless";
+const char* App::EngineName = "Sailor";
+
+void App::Initialize()
+{
+	SAILOR_PROFILE_FUNCTION();
+
+	if (s_pInstance != nullptr)
+	{
+		return;
+	}
+
+	s_pInstance = new App();
+	s_pInstance->AddSubmodule(TSubmodule<Tasks::Scheduler>::Make())->Initialize();
+
+	App::GetSubmodule<Tasks::Scheduler>()->WaitIdle(Tasks::EThreadType::Worker);
+}
+
+void App::Start(const char** commandLineArgs, int32_t num)
+{
+	TMap<std::string, std::function<void()>> consoleVars;
+	consoleVars["memory.benchmark"] = &Memory::RunMemoryBenchmark;
+	consoleVars["vector.benchmark"] = &Sailor::RunVectorBenchmark;
+	consoleVars["set.benchmark"] = &Sailor::RunSetBenchmark;
+	consoleVars["map.benchmark"] = &Sailor::RunMapBenchmark;
+	consoleVars["list.benchmark"] = &Sailor::RunListBenchmark;
+	consoleVars["spinlock.benchmark"] = &Sailor::RunSpinLockBenchmark;
+	consoleVars["spinlock.stats"] = &Sailor::DumpSpinLockStats;
+	consoleVars["scheduler.benchmark"] = &Sailor::Tasks::RunSchedulerBenchmark;
+	consoleVars["parallelfor.benchmark"] = &Sailor::Tasks::RunParallelForBenchmark;
+
+	// The same names as in the engine console, no arguments means all benchmarks
+	TVector<std::string> cmds;
+	for (int32_t i = 1; i < num; i++)
+	{
+		cmds.Add(commandLineArgs[i]);
+	}
+
+	if (cmds.IsEmpty())
+	{
+		cmds = { "memory.benchmark", "vector.benchmark", "set.benchmark", "map.benchmark",
+			"list.benchmark", "spinlock.benchmark", "scheduler.benchmark", "parallelfor.benchmark" };
+	}
+
+	for (const auto& cmd : cmds)
+	{
+		auto it = consoleVars.Find(cmd);
+		if (it != consoleVars.end())
+		{
+			it.Value()();
+		}
+		else
+		{
+			SAILOR_LOG_ERROR("Unknown command '%s'", cmd.c_str());
+		}
+	}
+}
+
+void App::Stop()
+{
+}
+
+void App::Shutdown()
+{
+	GetSubmodule<Tasks::Scheduler>()->ProcessJobsOnMainThread();
+	GetSubmodule<Tasks::Scheduler>()->WaitIdle(Tasks::EThreadType::Worker);
+	GetSubmodule<Tasks::Scheduler>()->WaitIdle(Tasks::EThreadType::RHI);
+	GetSubmodule<Tasks::Scheduler>()->WaitIdle(Tasks::EThreadType::Render);
+
+	RemoveSubmodule<Tasks::Scheduler>();
+
+	delete s_pInstance;
+	s_pInstance = nullptr;
+}
+
+int main(int argc, const char** argv)
+{
+	App::Initialize();
+	App::Start(argv, argc);
+	App::Stop();
+	App::Shutdown();
+
+	return 0;
+}
@@ -0,0 +1,122 @@
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb/stb_image.h"
+
+#include <string>
+#include <cstring>
+#include "Sailor.h"
+#include "Tasks/Scheduler.h"
+#include "Raytracing/PathTracer.h"
+
+using namespace Sailor;
+
+/* The command line path tracer that is linked against SailorCore and the Raytracing module only.
+*  There is no window, the image is written to the file and the result is returned by the exit code:
+*  0 - the image is rendered, 1 - the arguments are not valid, 2 - the scene or the image has failed,
+*  3 - the render is interrupted by --max-passes and should be resumed from the checkpoint.
+*/
+App* App::s_pInstance = nullptr;
+const char* App::ApplicationName = "SailorPathTracer";
+const char* App::EngineName = "Sailor";
+
+namespace
+{
+	enum EExitCode : int32_t
+	{
+		Success = 0,
+		InvalidArgs = 1,
+		RenderFailed = 2,
+		Interrupted = 3
+	};
+
+	// The scheduler is initialized before the params are parsed, so the threads are prescanned in main
+	uint32_t g_numWorkerThreads = 0;
+	int32_t g_exitCode = EExitCode::Success;
+}
+
+void App::Initialize()
+{
+	SAILOR_PROFILE_FUNCTION();
+
+	if (s_pInstance != nullptr)
+	{
+		return;
+	}
+
+	s_pInstance = new App();
+	s_pInstance->AddSubmodule(TSubmodule<Tasks::Scheduler>::Make())->Initialize(g_numWorkerThreads);
+
+	App::GetSubmodule<Tasks::Scheduler>()->WaitIdle(Tasks::EThreadType::Worker);
+}
+
+void App::Start(const char** commandLineArgs, int32_t num)
+{
+	for (int32_t i = 1; i < num; i++)
+	{
+		if (std::strcmp(commandLineArgs[i], "--help") == 0 || std::strcmp(commandLineArgs[i], "-h") == 0)
+		{
+			Raytracing::PathTracer::PrintUsage(commandLineArgs[0]);
+			return;
+		}
+	}
+
+	// The same defaults as in the engine
+	Raytracing::PathTracer::Params params{};
+	params.m_output = "output.png";
+	params.m_height = 768;
+	params.m_msaa = 16;
+	params.m_numSamples = 128;
+	params.m_numBounces = 3;
+
+	if (!Raytracing::PathTracer::ParseParamsFromCommandLineArgs(params, commandLineArgs, num) || params.m_pathToModel.empty())
+	{
+		Raytracing::PathTracer::PrintUsage(commandLineArgs[0]);
+		g_exitCode = EExitCode::InvalidArgs;
+		return;
+	}
+
+	Raytracing::PathTracer pathTracer;
+	if (!pathTracer.Run(params))
+	{
+		// The camera is checked only when the scene is imported, but that is the wrong argument as well
+		g_exitCode = pathTracer.GetStats().m_bIsCameraMissed ? EExitCode::InvalidArgs : EExitCode::RenderFailed;
+	}
+	else if (pathTracer.GetStats().m_bIsInterrupted)
+	{
+		g_exitCode = EExitCode::Interrupted;
+	}
+}
+
+void App::Stop()
+{
+}
+
+void App::Shutdown()
+{
+	GetSubmodule<Tasks::Scheduler>()->ProcessJobsOnMainThread();
+	GetSubmodule<Tasks::Scheduler>()->WaitIdle(Tasks::EThreadType::Worker);
+	GetSubmodule<Tasks::Scheduler>()->WaitIdle(Tasks::EThreadType::RHI);
+	GetSubmodule<Tasks::Scheduler>()->WaitIdle(Tasks::EThreadType::Render);
+
+	RemoveSubmodule<Tasks::Scheduler>();
+
+	delete s_pInstance;
+	s_pInstance = nullptr;
+}
+
+int main(int argc, const char** argv)
+{
+	for (int32_t i = 1; i + 1 < argc; i++)
+	{
+		if (std::strcmp(argv[i], "--threads") == 0)
+		{
+			g_numWorkerThreads = (uint32_t)std::max(0, atoi(argv[i + 1]));
+		}
+	}
+
+	App::Initialize();
+	App::Start(argv, argc);
+	App::Stop();
+	App::Shutdown();
+
+	return g_exitCode;
+}
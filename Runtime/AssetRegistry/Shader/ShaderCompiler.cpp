@@ -412,7 +412,7 @@ Tasks::TaskPtr<bool> ShaderCompiler::CompileAllPermutations(ShaderAssetInfoPtr a
 				m_shaderAssetsCache.Remove(assetInfo->GetFileId());
 
 				return true;
-			});
+			}, Tasks::EThreadType::Worker, Tasks::EPriority::Background);
 
 		for (uint32_t i = 0; i < permutationsToCompile.Num(); i++)
 		{
@@ -420,7 +420,7 @@ Tasks::TaskPtr<bool> ShaderCompiler::CompileAllPermutations(ShaderAssetInfoPtr a
 				{
 					SAILOR_LOG("Start compiling shader %d", permutationsToCompile[i]);
 					App::GetSubmodule<ShaderCompiler>()->ForceCompilePermutation(assetInfo, permutationsToCompile[i]);
-				});
+				}, Tasks::EThreadType::Worker, Tasks::EPriority::Background);
 
 			saveCacheJob->Join(job);
 			scheduler->Run(job);
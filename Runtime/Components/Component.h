@@ -38,6 +38,7 @@ namespace Sailor
 
 		friend class TObjectPtr<Component>;
 		friend class GameObject;
+		friend class World;
 	};
 }
 
@@ -0,0 +1,707 @@
+#pragma once
+#include <cstdint>
+#include <atomic>
+#include <thread>
+#include <new>
+#include <bit>
+#include <utility>
+#include <iterator>
+#include "Core/Defines.h"
+#include "Core/SpinLock.h"
+#include "Containers/Hash.h"
+#include "Containers/HashTable.h"
+#include "Platform/Platform.h"
+#include "Memory/Memory.h"
+#include "Memory/EpochReclamation.h"
+
+namespace Sailor::Internal
+{
+	/* Segmented hash table that backs TConcurrentSet and TConcurrentMap.
+	*  The number of segments is the power of two that scales with the hardware concurrency (and is not less than concurrencyLevel),
+	*  each segment has its own writer lock and keeps all the nodes in one list sorted by the bit reversed hash (split ordered list),
+	*  so the nodes of the bucket follow the bucket's dummy node and the bucket 'b + numBuckets' splits the chain of the bucket 'b'.
+	*  The segment grows by doubling the number of buckets only, the writers link a few new buckets into the list on each insertion (or on the first touch)
+	*  and the readers that meet the uninitialized bucket start from its parent, so the nodes never move and nobody waits for the resize.
+	*  The dummy nodes are stored in the chunks of the bucket directory, so the lookup starts from the bucket without the extra indirection.
+	*  Readers don't take locks and don't write the shared memory, they pin the epoch and walk the list published by the release stores.
+	*  The removed nodes are freed when no pinned reader could reach them, so the node is valid while the caller holds Memory::EpochGuard.
+	*/
+	template<typename TKeyType, typename TElementType, typename TGetKey, uint32_t concurrencyLevel, typename TAllocator>
+	class TConcurrentHashTable
+	{
+	public:
+
+		struct TListNode
+		{
+			TListNode(size_t orderKey) : m_orderKey(orderKey) {}
+
+			// The dummy nodes of the buckets have the lowest bit of the order key cleared
+			__forceinline bool IsDummy() const { return (m_orderKey & 1) == 0; }
+
+			std::atomic<TListNode*> m_pNext = nullptr;
+			size_t m_orderKey;
+		};
+
+		struct TNode : TListNode
+		{
+			template<typename... TArgs>
+			TNode(size_t hash, TArgs&& ... args) : TListNode(RegularOrderKey(hash)), m_element(std::forward<TArgs>(args)...), m_hash(hash) {}
+
+			TElementType m_element;
+			size_t m_hash;
+
+			TNode* m_pNextRetired = nullptr;
+			uint64_t m_retireEpoch = 0;
+		};
+
+		template<typename TDataType>
+		class TBaseIterator
+		{
+		public:
+
+			using iterator_category = std::forward_iterator_tag;
+			using value_type = TDataType;
+			using difference_type = int64_t;
+			using pointer = TDataType*;
+			using reference = TDataType&;
+
+			TBaseIterator() = default;
+			TBaseIterator(const TBaseIterator&) = default;
+			TBaseIterator(TBaseIterator&&) = default;
+			~TBaseIterator() = default;
+
+			TBaseIterator(const TConcurrentHashTable* pTable, size_t segment, TNode* pNode, Memory::EpochGuard guard) :
+				m_pTable(pTable), m_segment(segment), m_pNode(pNode), m_guard(std::move(guard)) {}
+
+			operator TBaseIterator<const TDataType>() const { return TBaseIterator<const TDataType>(m_pTable, m_segment, m_pNode, m_guard); }
+
+			TBaseIterator& operator=(const TBaseIterator& rhs) = default;
+			TBaseIterator& operator=(TBaseIterator&& rhs) = default;
+
+			bool operator==(const TBaseIterator& rhs) const { return m_pNode == rhs.m_pNode; }
+			bool operator!=(const TBaseIterator& rhs) const { return m_pNode != rhs.m_pNode; }
+
+			pointer operator->() const { return &m_pNode->m_element; }
+			reference operator*() const { return m_pNode->m_element; }
+
+			TBaseIterator& operator++()
+			{
+				m_pNode = m_pTable->FindNextNode(m_segment, m_pNode);
+				if (!m_pNode)
+				{
+					m_guard.Release();
+				}
+
+				return *this;
+			}
+
+		protected:
+
+			const TConcurrentHashTable* m_pTable = nullptr;
+			size_t m_segment = 0;
+			TNode* m_pNode = nullptr;
+
+			// The node the iterator points to is not freed even if it is removed
+			Memory::EpochGuard m_guard;
+		};
+
+		using TIterator = TBaseIterator<TElementType>;
+		using TConstIterator = TBaseIterator<const TElementType>;
+
+		TConcurrentHashTable(size_t desiredNumBuckets)
+		{
+			Initialize(desiredNumBuckets);
+		}
+
+		// The moved-from table stays empty and usable
+		TConcurrentHashTable(TConcurrentHashTable&& rhs) noexcept
+		{
+			Initialize(2);
+			Swap(*this, rhs);
+		}
+
+		TConcurrentHashTable& operator=(TConcurrentHashTable&& rhs) noexcept
+		{
+			if (this != &rhs)
+			{
+				Release();
+				Initialize(2);
+				Swap(*this, rhs);
+			}
+			return *this;
+		}
+
+		TConcurrentHashTable(const TConcurrentHashTable&) = delete;
+		TConcurrentHashTable& operator=(const TConcurrentHashTable&) = delete;
+
+		~TConcurrentHashTable() { Release(); }
+
+		static __forceinline size_t Hash(const TKeyType& key) { return MixHash(Sailor::GetHash(key)); }
+
+		// The sum over the segments, could be outdated immediately
+		size_t Num() const
+		{
+			size_t num = 0;
+			for (size_t i = 0; i < m_numSegments; i++)
+			{
+				num += m_pSegments[i].m_num.load(std::memory_order_relaxed);
+			}
+			return num;
+		}
+
+		// Lock free, returns nullptr if the key is missed, the node is valid while the guard is pinned
+		TNode* Find([[maybe_unused]] const Memory::EpochGuard& guard, const TKeyType& key, size_t hash) const
+		{
+			check(guard.IsPinned());
+
+			TDirectory* pDirectory = GetSegment(hash).m_pDirectory.load(std::memory_order_acquire);
+			if (!pDirectory)
+			{
+				return nullptr;
+			}
+
+			size_t bucket = hash & (pDirectory->m_numBuckets.load(std::memory_order_acquire) - 1);
+
+			// The bucket 0 is always initialized
+			TListNode* pNode = nullptr;
+			while (!(pNode = pDirectory->GetBucket(bucket)))
+			{
+				bucket = ParentBucket(bucket);
+			}
+
+			const size_t orderKey = RegularOrderKey(hash);
+			for (pNode = pNode->m_pNext.load(std::memory_order_acquire); pNode && pNode->m_orderKey <= orderKey; pNode = pNode->m_pNext.load(std::memory_order_acquire))
+			{
+				if (IsMatch(pNode, orderKey, key, hash))
+				{
+					return static_cast<TNode*>(pNode);
+				}
+			}
+
+			return nullptr;
+		}
+
+		// The node is constructed from the args only if the key is missed
+		template<typename... TArgs>
+		TNode* FindOrAdd(const TKeyType& key, size_t hash, bool& bOutInserted, TArgs&& ... args)
+		{
+			Segment& segment = GetSegment(hash);
+			LockSegment(segment);
+
+			TDirectory* pDirectory = GetOrAllocateDirectory(segment);
+			const size_t numBuckets = pDirectory->m_numBuckets.load(std::memory_order_relaxed);
+			const size_t orderKey = RegularOrderKey(hash);
+
+			TListNode* pPrev = InitializeBucket(*pDirectory, hash & (numBuckets - 1));
+			TListNode* pNext = nullptr;
+			while ((pNext = pPrev->m_pNext.load(std::memory_order_relaxed)) && pNext->m_orderKey <= orderKey)
+			{
+				if (IsMatch(pNext, orderKey, key, hash))
+				{
+					UnlockSegment(segment);
+
+					bOutInserted = false;
+					return static_cast<TNode*>(pNext);
+				}
+
+				pPrev = pNext;
+			}
+
+			TNode* pNode = new (m_allocator.Allocate(sizeof(TNode), alignof(TNode))) TNode(hash, std::forward<TArgs>(args)...);
+			pNode->m_pNext.store(pNext, std::memory_order_relaxed);
+			pPrev->m_pNext.store(pNode, std::memory_order_release);
+
+			const size_t num = segment.m_num.load(std::memory_order_relaxed) + 1;
+			segment.m_num.store(num, std::memory_order_relaxed);
+
+			// The new buckets are split from their parents lazily, so the resize doesn't touch the nodes
+			if (num > numBuckets && TDirectory::ChunkIndex(numBuckets * 2 - 1) < MaxChunks)
+			{
+				pDirectory->m_numBuckets.store(numBuckets * 2, std::memory_order_release);
+			}
+
+			InitializeNextBuckets(*pDirectory);
+
+			UnlockSegment(segment);
+
+			bOutInserted = true;
+			return pNode;
+		}
+
+		bool Remove(const TKeyType& key, size_t hash)
+		{
+			Segment& segment = GetSegment(hash);
+			LockSegment(segment);
+
+			bool bRemoved = false;
+			if (TDirectory* pDirectory = segment.m_pDirectory.load(std::memory_order_relaxed))
+			{
+				const size_t orderKey = RegularOrderKey(hash);
+
+				TListNode* pPrev = InitializeBucket(*pDirectory, hash & (pDirectory->m_numBuckets.load(std::memory_order_relaxed) - 1));
+				TListNode* pNext = nullptr;
+				while ((pNext = pPrev->m_pNext.load(std::memory_order_relaxed)) && pNext->m_orderKey <= orderKey)
+				{
+					if (IsMatch(pNext, orderKey, key, hash))
+					{
+						// The removed node still points to the rest of the list, so the readers on it are fine
+						pPrev->m_pNext.store(pNext->m_pNext.load(std::memory_order_relaxed), std::memory_order_release);
+						segment.m_num.store(segment.m_num.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+
+						Retire(segment, static_cast<TNode*>(pNext));
+
+						bRemoved = true;
+						break;
+					}
+
+					pPrev = pNext;
+				}
+			}
+
+			UnlockSegment(segment);
+
+			return bRemoved;
+		}
+
+		// The locks are reentrant for the owning thread
+		__forceinline void Lock(size_t hash) { LockSegment(GetSegment(hash)); }
+		__forceinline void Unlock(size_t hash) { UnlockSegment(GetSegment(hash)); }
+
+		void LockAll()
+		{
+			for (size_t i = 0; i < m_numSegments; i++)
+			{
+				LockSegment(m_pSegments[i]);
+			}
+		}
+
+		void UnlockAll()
+		{
+			for (size_t i = 0; i < m_numSegments; i++)
+			{
+				UnlockSegment(m_pSegments[i]);
+			}
+		}
+
+		// That is not thread safe against the readers
+		void Clear(size_t desiredNumBuckets)
+		{
+			LockAll();
+
+			for (size_t i = 0; i < m_numSegments; i++)
+			{
+				ClearSegment(m_pSegments[i]);
+			}
+
+			m_initialNumBuckets = InitialNumBuckets(desiredNumBuckets, m_numSegments);
+
+			UnlockAll();
+		}
+
+		TIterator begin()
+		{
+			Memory::EpochGuard guard = Memory::EpochGuard::Pin();
+
+			size_t segment = 0;
+			if (TNode* pNode = FindNextNode(segment, nullptr))
+			{
+				return TIterator(this, segment, pNode, std::move(guard));
+			}
+
+			return end();
+		}
+
+		TIterator end() { return TIterator(this, m_numSegments, nullptr, Memory::EpochGuard()); }
+
+		TConstIterator begin() const { return const_cast<TConcurrentHashTable*>(this)->begin(); }
+		TConstIterator end() const { return TConstIterator(this, m_numSegments, nullptr, Memory::EpochGuard()); }
+
+		// The iterator keeps the guard, so the node is not freed while the iterator points to it
+		TIterator IteratorAt(Memory::EpochGuard guard, TNode* pNode) { return TIterator(this, SegmentIndex(pNode->m_hash), pNode, std::move(guard)); }
+		TConstIterator IteratorAt(Memory::EpochGuard guard, TNode* pNode) const { return const_cast<TConcurrentHashTable*>(this)->IteratorAt(std::move(guard), pNode); }
+
+		static void Swap(TConcurrentHashTable& lhs, TConcurrentHashTable& rhs)
+		{
+			std::swap(lhs.m_pSegmentsData, rhs.m_pSegmentsData);
+			std::swap(lhs.m_pSegments, rhs.m_pSegments);
+			std::swap(lhs.m_numSegments, rhs.m_numSegments);
+			std::swap(lhs.m_initialNumBuckets, rhs.m_initialNumBuckets);
+			std::swap(lhs.m_allocator, rhs.m_allocator);
+		}
+
+	protected:
+
+		// The segment could have up to 2^MaxChunks buckets
+		static constexpr size_t MaxChunks = 32;
+
+		// The number of the removed nodes between the attempts to free them
+		static constexpr size_t ReclaimBatchSize = 64;
+
+		// The number of buckets is doubled after as many insertions as there are new buckets, so they are split before the next resize
+		static constexpr size_t NumBucketsToInitializePerInsert = 8;
+
+		// The dummy node of the bucket 'b' is stored in the chunk of the highest bit of 'b', so the directory grows without copying
+		struct TDirectory
+		{
+			static __forceinline size_t ChunkIndex(size_t bucket) { return bucket < 2 ? 0 : (size_t)std::bit_width(bucket) - 1; }
+			static __forceinline size_t ChunkSize(size_t chunk) { return chunk == 0 ? 2 : (size_t)1 << chunk; }
+			static __forceinline size_t ChunkOffset(size_t chunk) { return chunk == 0 ? 0 : (size_t)1 << chunk; }
+
+			// The dummy node that points to itself is not linked into the list yet
+			static __forceinline bool IsLinked(const TListNode* pDummy) { return pDummy->m_pNext.load(std::memory_order_acquire) != pDummy; }
+
+			// Returns nullptr if the bucket is not initialized yet
+			__forceinline TListNode* GetBucket(size_t bucket) const
+			{
+				const size_t chunk = ChunkIndex(bucket);
+				if (TListNode* pChunk = m_chunks[chunk].load(std::memory_order_acquire))
+				{
+					TListNode* pDummy = &pChunk[bucket - ChunkOffset(chunk)];
+					return IsLinked(pDummy) ? pDummy : nullptr;
+				}
+
+				return nullptr;
+			}
+
+			// The dummy node of the bucket 0, that is the head of the segment's list
+			__forceinline TListNode* GetHead() const { return m_chunks[0].load(std::memory_order_acquire); }
+
+			std::atomic<size_t> m_numBuckets = 0;
+
+			// Accessed under the segment lock, the buckets before it are initialized
+			size_t m_nextBucketToInitialize = 1;
+
+			std::atomic<TListNode*> m_chunks[MaxChunks]{};
+		};
+
+		struct alignas(64) Segment
+		{
+			SpinLock m_lock{ SAILOR_SPINLOCK_SITE("TConcurrentHashTable::Segment") };
+			std::atomic<DWORD> m_ownerThreadId = 0;
+			uint32_t m_lockDepth = 0;
+
+			std::atomic<TDirectory*> m_pDirectory = nullptr;
+			std::atomic<size_t> m_num = 0;
+
+			// From the newest to the oldest
+			TNode* m_pRetiredNodes = nullptr;
+			size_t m_numRetired = 0;
+			size_t m_numRetiredToReclaim = ReclaimBatchSize;
+		};
+
+		static uint32_t GetNumSegments()
+		{
+			static const uint32_t numSegments = []()
+				{
+					const uint32_t numThreads = std::thread::hardware_concurrency();
+					uint32_t res = 1;
+					while (res < concurrencyLevel || res < numThreads * 2)
+					{
+						res *= 2;
+					}
+					return res;
+				}();
+
+			return numSegments;
+		}
+
+		static size_t InitialNumBuckets(size_t desiredNumBuckets, size_t numSegments)
+		{
+			size_t res = 2;
+			while (res * numSegments < desiredNumBuckets)
+			{
+				res *= 2;
+			}
+			return res;
+		}
+
+		static __forceinline size_t ReverseBits(size_t value)
+		{
+			value = ((value >> 1) & 0x5555555555555555ull) | ((value & 0x5555555555555555ull) << 1);
+			value = ((value >> 2) & 0x3333333333333333ull) | ((value & 0x3333333333333333ull) << 2);
+			value = ((value >> 4) & 0x0F0F0F0F0F0F0F0Full) | ((value & 0x0F0F0F0F0F0F0F0Full) << 4);
+			value = ((value >> 8) & 0x00FF00FF00FF00FFull) | ((value & 0x00FF00FF00FF00FFull) << 8);
+			value = ((value >> 16) & 0x0000FFFF0000FFFFull) | ((value & 0x0000FFFF0000FFFFull) << 16);
+			return (value >> 32) | (value << 32);
+		}
+
+		// The highest bit of the hash is replaced by the flag, so the regular node goes after the dummy of its bucket
+		static __forceinline size_t RegularOrderKey(size_t hash) { return ReverseBits(hash) | 1; }
+		static __forceinline size_t DummyOrderKey(size_t bucket) { return ReverseBits(bucket); }
+
+		// The bucket is split from the one without the highest bit
+		static __forceinline size_t ParentBucket(size_t bucket) { return bucket & ~((size_t)1 << (std::bit_width(bucket) - 1)); }
+
+		// The dummy nodes never match
+		static __forceinline bool IsMatch(const TListNode* pNode, size_t orderKey, const TKeyType& key, size_t hash)
+		{
+			if (pNode->m_orderKey != orderKey)
+			{
+				return false;
+			}
+
+			const TNode* pRegularNode = static_cast<const TNode*>(pNode);
+			return pRegularNode->m_hash == hash && TGetKey::Get(pRegularNode->m_element) == key;
+		}
+
+		// The high bits select the segment, the low bits select the bucket
+		__forceinline size_t SegmentIndex(size_t hash) const { return (hash >> 32) & (m_numSegments - 1); }
+		__forceinline Segment& GetSegment(size_t hash) const { return m_pSegments[SegmentIndex(hash)]; }
+
+		void Initialize(size_t desiredNumBuckets)
+		{
+			m_numSegments = GetNumSegments();
+			m_initialNumBuckets = InitialNumBuckets(desiredNumBuckets, m_numSegments);
+
+			// Segments are aligned by the cache line to avoid the false sharing
+			m_pSegmentsData = m_allocator.Allocate(sizeof(Segment) * m_numSegments + alignof(Segment), 8);
+			m_pSegments = reinterpret_cast<Segment*>(((size_t)m_pSegmentsData + alignof(Segment) - 1) & ~(alignof(Segment) - 1));
+
+			for (size_t i = 0; i < m_numSegments; i++)
+			{
+				new (&m_pSegments[i]) Segment();
+			}
+		}
+
+		void Release()
+		{
+			if (!m_pSegmentsData)
+			{
+				return;
+			}
+
+			for (size_t i = 0; i < m_numSegments; i++)
+			{
+				ClearSegment(m_pSegments[i]);
+				m_pSegments[i].~Segment();
+			}
+
+			m_allocator.Free(m_pSegmentsData, sizeof(Segment) * m_numSegments + alignof(Segment));
+
+			m_pSegmentsData = nullptr;
+			m_pSegments = nullptr;
+			m_numSegments = 0;
+		}
+
+		void LockSegment(Segment& segment)
+		{
+			// Only the owner could see its own id there
+			const DWORD threadId = Platform::GetCurrentThreadId();
+			if (segment.m_ownerThreadId.load(std::memory_order_relaxed) == threadId)
+			{
+				segment.m_lockDepth++;
+				return;
+			}
+
+			segment.m_lock.Lock();
+			segment.m_ownerThreadId.store(threadId, std::memory_order_relaxed);
+			segment.m_lockDepth = 1;
+		}
+
+		void UnlockSegment(Segment& segment)
+		{
+			if (--segment.m_lockDepth == 0)
+			{
+				segment.m_ownerThreadId.store(0, std::memory_order_relaxed);
+				segment.m_lock.Unlock();
+			}
+		}
+
+		// The dummy nodes are not linked
+		TListNode* AllocateChunk(size_t chunk)
+		{
+			const size_t size = TDirectory::ChunkSize(chunk);
+			const size_t offset = TDirectory::ChunkOffset(chunk);
+			TListNode* pChunk = reinterpret_cast<TListNode*>(m_allocator.Allocate(sizeof(TListNode) * size, alignof(TListNode)));
+
+			for (size_t i = 0; i < size; i++)
+			{
+				TListNode* pDummy = new (&pChunk[i]) TListNode(DummyOrderKey(offset + i));
+				pDummy->m_pNext.store(pDummy, std::memory_order_relaxed);
+			}
+
+			return pChunk;
+		}
+
+		// Called under the segment lock
+		TDirectory* GetOrAllocateDirectory(Segment& segment)
+		{
+			if (TDirectory* pDirectory = segment.m_pDirectory.load(std::memory_order_relaxed))
+			{
+				return pDirectory;
+			}
+
+			TDirectory* pDirectory = new (m_allocator.Allocate(sizeof(TDirectory), alignof(TDirectory))) TDirectory();
+			pDirectory->m_numBuckets.store(m_initialNumBuckets, std::memory_order_relaxed);
+
+			TListNode* pChunk = AllocateChunk(0);
+			pChunk[0].m_pNext.store(nullptr, std::memory_order_relaxed);
+			pDirectory->m_chunks[0].store(pChunk, std::memory_order_relaxed);
+
+			segment.m_pDirectory.store(pDirectory, std::memory_order_release);
+
+			return pDirectory;
+		}
+
+		// Called under the segment lock, links the dummy node after the nodes of the parent bucket that go before it
+		TListNode* InitializeBucket(TDirectory& directory, size_t bucket)
+		{
+			const size_t chunk = TDirectory::ChunkIndex(bucket);
+
+			TListNode* pChunk = directory.m_chunks[chunk].load(std::memory_order_relaxed);
+			if (!pChunk)
+			{
+				pChunk = AllocateChunk(chunk);
+				directory.m_chunks[chunk].store(pChunk, std::memory_order_release);
+			}
+
+			TListNode* pDummy = &pChunk[bucket - TDirectory::ChunkOffset(chunk)];
+			if (pDummy->m_pNext.load(std::memory_order_relaxed) != pDummy)
+			{
+				return pDummy;
+			}
+
+			TListNode* pPrev = InitializeBucket(directory, ParentBucket(bucket));
+			TListNode* pNext = nullptr;
+			while ((pNext = pPrev->m_pNext.load(std::memory_order_relaxed)) && pNext->m_orderKey < pDummy->m_orderKey)
+			{
+				pPrev = pNext;
+			}
+
+			// The readers could start from the dummy node before it is reachable from the list
+			pDummy->m_pNext.store(pNext, std::memory_order_release);
+			pPrev->m_pNext.store(pDummy, std::memory_order_release);
+
+			return pDummy;
+		}
+
+		// Called under the segment lock, splits the buckets that are added by the last resizes
+		void InitializeNextBuckets(TDirectory& directory)
+		{
+			const size_t numBuckets = directory.m_numBuckets.load(std::memory_order_relaxed);
+			for (size_t i = 0; i < NumBucketsToInitializePerInsert && directory.m_nextBucketToInitialize < numBuckets; i++)
+			{
+				InitializeBucket(directory, directory.m_nextBucketToInitialize++);
+			}
+		}
+
+		void FreeNode(TNode* pNode)
+		{
+			pNode->~TNode();
+			m_allocator.Free(pNode, sizeof(TNode));
+		}
+
+		// Called under the segment lock after the node is unlinked
+		void Retire(Segment& segment, TNode* pNode)
+		{
+			pNode->m_retireEpoch = Memory::EpochReclamation::GetRetireEpoch();
+			pNode->m_pNextRetired = segment.m_pRetiredNodes;
+			segment.m_pRetiredNodes = pNode;
+
+			if (++segment.m_numRetired >= segment.m_numRetiredToReclaim)
+			{
+				Reclaim(segment, Memory::EpochReclamation::TryAdvance());
+
+				// The pinned readers could hold the nodes, so we don't scan the threads on each removal
+				segment.m_numRetiredToReclaim = segment.m_numRetired + ReclaimBatchSize;
+			}
+		}
+
+		// The retired list is sorted by the epoch, so the tail is freed
+		void Reclaim(Segment& segment, uint64_t globalEpoch)
+		{
+			TNode** ppLink = &segment.m_pRetiredNodes;
+			while (*ppLink && !Memory::EpochReclamation::IsSafeToFree((*ppLink)->m_retireEpoch, globalEpoch))
+			{
+				ppLink = &(*ppLink)->m_pNextRetired;
+			}
+
+			TNode* pNode = *ppLink;
+			*ppLink = nullptr;
+
+			while (pNode)
+			{
+				TNode* pNext = pNode->m_pNextRetired;
+				FreeNode(pNode);
+				segment.m_numRetired--;
+				pNode = pNext;
+			}
+		}
+
+		void ClearSegment(Segment& segment)
+		{
+			while (TNode* pNode = segment.m_pRetiredNodes)
+			{
+				segment.m_pRetiredNodes = pNode->m_pNextRetired;
+				FreeNode(pNode);
+			}
+
+			segment.m_numRetired = 0;
+			segment.m_numRetiredToReclaim = ReclaimBatchSize;
+
+			if (TDirectory* pDirectory = segment.m_pDirectory.load(std::memory_order_relaxed))
+			{
+				// The dummy nodes are freed with the chunks
+				TListNode* pNode = pDirectory->GetHead()->m_pNext.load(std::memory_order_relaxed);
+				while (pNode)
+				{
+					TListNode* pNext = pNode->m_pNext.load(std::memory_order_relaxed);
+					if (!pNode->IsDummy())
+					{
+						FreeNode(static_cast<TNode*>(pNode));
+					}
+					pNode = pNext;
+				}
+
+				for (size_t i = 0; i < MaxChunks; i++)
+				{
+					if (TListNode* pChunk = pDirectory->m_chunks[i].load(std::memory_order_relaxed))
+					{
+						m_allocator.Free(pChunk, sizeof(TListNode) * TDirectory::ChunkSize(i));
+					}
+				}
+
+				pDirectory->~TDirectory();
+				m_allocator.Free(pDirectory, sizeof(TDirectory));
+			}
+
+			segment.m_pDirectory.store(nullptr, std::memory_order_release);
+			segment.m_num.store(0, std::memory_order_relaxed);
+		}
+
+		// Returns the first regular node after pNode, or from the beginning of the segment if pNode is nullptr, the next segments are checked as well
+		TNode* FindNextNode(size_t& segment, TListNode* pNode) const
+		{
+			for (; segment < m_numSegments; segment++, pNode = nullptr)
+			{
+				if (!pNode)
+				{
+					TDirectory* pDirectory = m_pSegments[segment].m_pDirectory.load(std::memory_order_acquire);
+					if (!pDirectory)
+					{
+						continue;
+					}
+
+					pNode = pDirectory->GetHead();
+				}
+
+				for (pNode = pNode->m_pNext.load(std::memory_order_acquire); pNode; pNode = pNode->m_pNext.load(std::memory_order_acquire))
+				{
+					if (!pNode->IsDummy())
+					{
+						return static_cast<TNode*>(pNode);
+					}
+				}
+			}
+
+			return nullptr;
+		}
+
+		void* m_pSegmentsData = nullptr;
+		Segment* m_pSegments = nullptr;
+		size_t m_numSegments = 0;
+		size_t m_initialNumBuckets = 2;
+
+		TAllocator m_allocator{};
+	};
+}
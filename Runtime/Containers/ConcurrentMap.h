@@ -8,150 +8,154 @@
 #include "Containers/Vector.h"
 #include "Containers/Set.h"
 #include "Containers/ConcurrentSet.h"
+#include "Containers/ConcurrentHashTable.h"
 #include "Containers/Pair.h"
 
 namespace Sailor
 {
+	/* Lookups are lock free, writers lock the only segment that the key belongs to.
+	*  At_Lock keeps the key's segment locked until Unlock, the segment locks are reentrant for the owning thread.
+	*  The iterators keep the element alive even if it is removed, the references are valid while the caller holds the guard from Pin,
+	*  otherwise they are valid until the key is removed.
+	*/
 	template<typename TKeyType, typename TValueType, const uint32_t concurrencyLevel = 8, typename TAllocator = Memory::DefaultGlobalAllocator>
-	class TConcurrentMap final : public TConcurrentSet<TPair<TKeyType, TValueType>, concurrencyLevel, TAllocator>
+	class TConcurrentMap final
 	{
 	public:
 
-		using Super = Sailor::TConcurrentSet<TPair<TKeyType, TValueType>, concurrencyLevel, TAllocator>;
 		using TElementType = Sailor::TPair<TKeyType, TValueType>;
+		using TConcurrentHashTable = Internal::TConcurrentHashTable<TKeyType, TElementType, Internal::HashMapKey, concurrencyLevel, TAllocator>;
+		using TIterator = typename TConcurrentHashTable::TIterator;
+		using TConstIterator = typename TConcurrentHashTable::TConstIterator;
 
-		SAILOR_API TConcurrentMap(const uint32_t desiredNumBuckets = 16) : Super(desiredNumBuckets) {  }
+		SAILOR_API TConcurrentMap(const uint32_t desiredNumBuckets = 16) : m_table(desiredNumBuckets) {}
 		SAILOR_API TConcurrentMap(TConcurrentMap&&) = default;
-		SAILOR_API TConcurrentMap(const TConcurrentMap&) = default;
+		SAILOR_API TConcurrentMap(const TConcurrentMap& rhs) requires IsCopyConstructible<TElementType> : TConcurrentMap((uint32_t)rhs.Num())
+		{
+			for (const auto& el : rhs)
+			{
+				Insert(el.m_first, el.m_second);
+			}
+		}
+
 		SAILOR_API TConcurrentMap& operator=(TConcurrentMap&&) noexcept = default;
-		SAILOR_API TConcurrentMap& operator=(const TConcurrentMap&) = default;
+		SAILOR_API TConcurrentMap& operator=(const TConcurrentMap& rhs) requires IsCopyConstructible<TElementType>
+		{
+			if (this != &rhs)
+			{
+				Clear((uint32_t)rhs.Num());
+				for (const auto& el : rhs)
+				{
+					Insert(el.m_first, el.m_second);
+				}
+			}
 
-		SAILOR_API TConcurrentMap(std::initializer_list<TElementType> initList)
+			return *this;
+		}
+
+		SAILOR_API TConcurrentMap(std::initializer_list<TElementType> initList) : TConcurrentMap((uint32_t)initList.size())
 		{
 			for (const auto& el : initList)
 			{
-				Insert(el);
+				Insert(el.m_first, el.m_second);
 			}
 		}
 
+		// Approximated, the value could be outdated immediately
+		__forceinline bool IsEmpty() const { return m_table.Num() == 0; }
+		__forceinline size_t Num() const { return m_table.Num(); }
+
+		// The value is replaced if the key is already presented
 		SAILOR_API void Insert(const TKeyType& key, const TValueType& value) requires IsCopyConstructible<TValueType>
 		{
-			Super::Insert(TElementType(key, value));
+			const size_t hash = TConcurrentHashTable::Hash(key);
+
+			m_table.Lock(hash);
+
+			bool bInserted = false;
+			auto pNode = m_table.FindOrAdd(key, hash, bInserted, key, value);
+			if (!bInserted)
+			{
+				pNode->m_element.m_second = value;
+			}
+
+			m_table.Unlock(hash);
 		}
 
 		SAILOR_API void Insert(const TKeyType& key, TValueType&& value) requires IsMoveConstructible<TValueType>
 		{
-			Super::Insert(TElementType(key, std::move(value)));
-		}
+			const size_t hash = TConcurrentHashTable::Hash(key);
 
-		SAILOR_API bool ForcelyRemove(const TKeyType& key)
-		{
-			const size_t hash = Sailor::GetHash(key);
-			auto& element = Super::m_buckets[hash % Super::m_buckets.Num()];
+			m_table.Lock(hash);
 
-			if (element)
+			bool bInserted = false;
+			auto pNode = m_table.FindOrAdd(key, hash, bInserted, key, std::move(value));
+			if (!bInserted)
 			{
-				auto& container = element->GetContainer();
-				if (container.RemoveAll([&](const TElementType& el) { return el.First() == key; }))
-				{
-					if (container.Num() == 0)
-					{
-						if (element.GetRawPtr() == Super::m_last)
-						{
-							Super::m_last = element->m_prev;
-						}
-
-						if (element->m_next)
-						{
-							element->m_next->m_prev = element->m_prev;
-						}
-
-						if (element->m_prev)
-						{
-							element->m_prev->m_next = element->m_next;
-						}
-
-						if (Super::m_last == element.GetRawPtr())
-						{
-							Super::m_last = Super::m_last->m_prev;
-						}
-
-						if (Super::m_first == element.GetRawPtr())
-						{
-							Super::m_first = Super::m_first->m_next;
-						}
-
-						element.Clear();
-					}
-
-					Super::m_num--;
-					return true;
-				}
-
-				return false;
+				pNode->m_element.m_second = std::move(value);
 			}
-			return false;
+
+			m_table.Unlock(hash);
 		}
 
+		// The segment locks are reentrant, so that is the same as Remove
+		SAILOR_API __forceinline bool ForcelyRemove(const TKeyType& key) { return Remove(key); }
+
 		SAILOR_API bool Remove(const TKeyType& key)
 		{
-			const size_t hash = Sailor::GetHash(key);
-			auto& element = Super::m_buckets[hash % Super::m_buckets.Num()];
-
-			if (element)
-			{
-				Super::Lock(hash);
-				bool bRes = ForcelyRemove(key);
-				Super::Unlock(hash);
-
-				return bRes;
-			}
-			return false;
+			return m_table.Remove(key, TConcurrentHashTable::Hash(key));
 		}
 
 		SAILOR_API TValueType& At_Lock(const TKeyType& key)
 		{
-			const auto& hash = Sailor::GetHash(key);
-			Super::Lock(hash);
+			const size_t hash = TConcurrentHashTable::Hash(key);
+			m_table.Lock(hash);
 
-			auto& res = GetOrAdd(key).m_second;
-			return res;
+			bool bInserted = false;
+			return m_table.FindOrAdd(key, hash, bInserted, key, TValueType())->m_element.m_second;
 		}
 
 		SAILOR_API TValueType& At_Lock(const TKeyType& key, TValueType defaultValue)
 		{
-			const auto& hash = Sailor::GetHash(key);
-			Super::Lock(hash);
+			const size_t hash = TConcurrentHashTable::Hash(key);
+			m_table.Lock(hash);
 
-			auto& res = GetOrAdd(key, std::move(defaultValue)).m_second;
-			return res;
+			bool bInserted = false;
+			return m_table.FindOrAdd(key, hash, bInserted, key, std::move(defaultValue))->m_element.m_second;
 		}
 
 		SAILOR_API void Unlock(const TKeyType& key)
 		{
-			const auto& hash = Sailor::GetHash(key);
-			Super::Unlock(hash);
+			m_table.Unlock(TConcurrentHashTable::Hash(key));
 		}
 
+		// Lock free if the key is presented
 		SAILOR_API TValueType& operator[] (const TKeyType& key)
 		{
-			return GetOrAdd(key).m_second;
+			const size_t hash = TConcurrentHashTable::Hash(key);
+			if (auto pNode = m_table.Find(Memory::EpochGuard::Pin(), key, hash))
+			{
+				return pNode->m_element.m_second;
+			}
+
+			// TODO: rethink the approach when default constructor is missed
+			bool bInserted = false;
+			return m_table.FindOrAdd(key, hash, bInserted, key, TValueType())->m_element.m_second;
 		}
 
-		// TODO: rethink the approach for const operator []
 		SAILOR_API const TValueType& operator[] (const TKeyType& key) const
 		{
-			TValueType const* out = nullptr;
-			Find(key, out);
-			return *out;
+			auto pNode = m_table.Find(Memory::EpochGuard::Pin(), key, TConcurrentHashTable::Hash(key));
+			check(pNode);
+
+			return pNode->m_element.m_second;
 		}
 
 		SAILOR_API bool Find(const TKeyType& key, TValueType*& out)
 		{
-			auto it = Find(key);
-			if (it != Super::end())
+			if (auto pNode = m_table.Find(Memory::EpochGuard::Pin(), key, TConcurrentHashTable::Hash(key)))
 			{
-				out = &it->m_second;
+				out = &pNode->m_element.m_second;
 				return true;
 			}
 			return false;
@@ -159,58 +163,38 @@ namespace Sailor
 
 		SAILOR_API bool Find(const TKeyType& key, TValueType const*& out) const
 		{
-			auto it = Find(key);
-			out = &it->m_second;
-			return it != Super::end();
-		}
-
-		SAILOR_API Super::TIterator Find(const TKeyType& key)
-		{
-			const auto& hash = Sailor::GetHash(key);
-			auto& element = Super::m_buckets[hash % Super::m_buckets.Num()];
-
-			if (element && element->LikelyContains(hash))
+			if (auto pNode = m_table.Find(Memory::EpochGuard::Pin(), key, TConcurrentHashTable::Hash(key)))
 			{
-				auto& container = element->GetContainer();
-
-				typename Super::TElementContainer::TIterator it = container.FindIf([&](const TElementType& el) { return el.First() == key; });
-				if (it != container.end())
-				{
-					return Super::TIterator(element.GetRawPtr(), it);
-				}
+				out = &pNode->m_element.m_second;
+				return true;
 			}
-
-			return Super::end();
+			return false;
 		}
 
-		SAILOR_API Super::TConstIterator Find(const TKeyType& key) const
+		SAILOR_API TIterator Find(const TKeyType& key)
 		{
-			const auto& hash = Sailor::GetHash(key);
-			auto& element = Super::m_buckets[hash % Super::m_buckets.Num()];
-
-			if (element && element->LikelyContains(hash))
-			{
-				auto& container = element->GetContainer();
-				typename Super::TElementContainer::TConstIterator it = container.FindIf([&](const TElementType& el) { return el.First() == key; });
-				if (it != container.end())
-				{
-					return Super::TConstIterator(element.GetRawPtr(), it);
-				}
-			}
+			Memory::EpochGuard guard = Memory::EpochGuard::Pin();
+			auto pNode = m_table.Find(guard, key, TConcurrentHashTable::Hash(key));
+			return pNode ? m_table.IteratorAt(std::move(guard), pNode) : end();
+		}
 
-			return Super::end();
+		SAILOR_API TConstIterator Find(const TKeyType& key) const
+		{
+			Memory::EpochGuard guard = Memory::EpochGuard::Pin();
+			auto pNode = m_table.Find(guard, key, TConcurrentHashTable::Hash(key));
+			return pNode ? m_table.IteratorAt(std::move(guard), pNode) : end();
 		}
 
-		SAILOR_API bool ContainsKey(const TKeyType& key) const
+		SAILOR_API __forceinline bool ContainsKey(const TKeyType& key) const
 		{
-			return Find(key) != Super::end();
+			return m_table.Find(Memory::EpochGuard::Pin(), key, TConcurrentHashTable::Hash(key)) != nullptr;
 		}
 
 		SAILOR_API bool ContainsValue(const TValueType& value) const
 		{
-			for (const auto& bucket : Super::m_buckets)
+			for (const auto& el : *this)
 			{
-				if (bucket && bucket->GetContainer().FindIf([&](const TElementType& el) { return el.Second() == value; }) != -1)
+				if (el.Second() == value)
 				{
 					return true;
 				}
@@ -221,7 +205,7 @@ namespace Sailor
 		SAILOR_API TVector<TKeyType> GetKeys() const
 		{
 			TVector<TKeyType> res;
-			res.Reserve(Super::Num());
+			res.Reserve(Num());
 
 			for (const auto& pair : *this)
 			{
@@ -234,7 +218,7 @@ namespace Sailor
 		SAILOR_API TVector<TValueType> GetValues() const
 		{
 			TVector<TValueType> res;
-			res.Reserve(Super::Num());
+			res.Reserve(Num());
 
 			for (const auto& pair : *this)
 			{
@@ -244,62 +228,26 @@ namespace Sailor
 			return res;
 		}
 
-	protected:
-
-		SAILOR_API TElementType& GetOrAdd(const TKeyType& key)
-		{
-			const auto& hash = Sailor::GetHash(key);
-			{
-				const size_t index = hash % Super::m_buckets.Num();
-				auto& element = Super::m_buckets[index];
+		// That is not thread safe against the lookups
+		void Clear(uint32_t desiredBucketsNum = 16) { m_table.Clear(desiredBucketsNum); }
 
-				if (element)
-				{
-					auto& container = element->GetContainer();
-
-					TElementType* out;
-					if (container.FindIf(out, [&](const TElementType& element) { return element.First() == key; }))
-					{
-						return *out;
-					}
-				}
-			}
+		// Blocks the writers, lookups are still allowed
+		__forceinline void LockAll() { m_table.LockAll(); }
+		__forceinline void UnlockAll() { m_table.UnlockAll(); }
 
-			// TODO: rethink the approach when default constructor is missed
-			Super::ForcelyInsert(std::move(TElementType(key, TValueType())));
+		// The removed elements are not freed while the guard is alive, the guard is thread affine
+		static __forceinline Memory::EpochGuard Pin() { return Memory::EpochGuard::Pin(); }
 
-			const size_t index = hash % Super::m_buckets.Num();
-			auto& element = Super::m_buckets[index];
+		// Support ranged for
+		TIterator begin() { return m_table.begin(); }
+		TIterator end() { return m_table.end(); }
 
-			return *element->GetContainer().Last();
-		}
+		TConstIterator begin() const { return m_table.begin(); }
+		TConstIterator end() const { return m_table.end(); }
 
-		SAILOR_API TElementType& GetOrAdd(const TKeyType& key, TValueType defaultValue)
-		{
-			const auto& hash = Sailor::GetHash(key);
-			{
-				const size_t index = hash % Super::m_buckets.Num();
-				auto& element = Super::m_buckets[index];
-
-				if (element)
-				{
-					auto& container = element->GetContainer();
-
-					TElementType* out;
-					if (container.FindIf(out, [&](const TElementType& element) { return element.First() == key; }))
-					{
-						return *out;
-					}
-				}
-			}
-
-			Super::ForcelyInsert(TElementType(key, std::move(defaultValue)));
-
-			const size_t index = hash % Super::m_buckets.Num();
-			auto& element = Super::m_buckets[index];
+	protected:
 
-			return *element->GetContainer().Last();
-		}
+		TConcurrentHashTable m_table;
 	};
 
 	SAILOR_API void RunMapBenchmark();
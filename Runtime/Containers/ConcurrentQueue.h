@@ -0,0 +1,112 @@
+#pragma once
+#include <cassert>
+#include <mutex>
+#include <utility>
+#include "Core/Defines.h"
+#include "Containers/Vector.h"
+#include "Memory/MallocAllocator.hpp"
+
+#if defined(_WIN32)
+#include <concurrent_queue.h>
+#endif
+
+namespace Sailor
+{
+	/* Unbounded multiple producers multiple consumers FIFO queue.
+	*  PPL's lock-free concurrent_queue is used on Win32,
+	*  the other platforms use the ring buffer guarded by the mutex.
+	*/
+	template<typename TElementType, typename TAllocator = Memory::MallocAllocator>
+	class TConcurrentQueue final
+	{
+	public:
+
+		SAILOR_API TConcurrentQueue() = default;
+
+		TConcurrentQueue(const TConcurrentQueue&) = delete;
+		TConcurrentQueue(TConcurrentQueue&&) = delete;
+		TConcurrentQueue& operator=(const TConcurrentQueue&) = delete;
+		TConcurrentQueue& operator=(TConcurrentQueue&&) = delete;
+
+#if defined(_WIN32)
+
+		SAILOR_API __forceinline void Push(const TElementType& element) { m_queue.push(element); }
+		SAILOR_API __forceinline void Push(TElementType&& element) { m_queue.push(std::move(element)); }
+		SAILOR_API __forceinline bool TryPop(TElementType& outElement) { return m_queue.try_pop(outElement); }
+
+		// Approximated, the value could be outdated immediately
+		SAILOR_API __forceinline bool IsEmpty() const { return m_queue.empty(); }
+
+	protected:
+
+		concurrency::concurrent_queue<TElementType> m_queue;
+
+#else
+
+		SAILOR_API void Push(const TElementType& element)
+		{
+			const std::lock_guard<std::mutex> lock(m_mutex);
+			ResizeIfNeeded();
+			m_elements[(m_head + m_num++) & (m_elements.Num() - 1)] = element;
+		}
+
+		SAILOR_API void Push(TElementType&& element)
+		{
+			const std::lock_guard<std::mutex> lock(m_mutex);
+			ResizeIfNeeded();
+			m_elements[(m_head + m_num++) & (m_elements.Num() - 1)] = std::move(element);
+		}
+
+		SAILOR_API bool TryPop(TElementType& outElement)
+		{
+			const std::lock_guard<std::mutex> lock(m_mutex);
+			if (m_num == 0)
+			{
+				return false;
+			}
+
+			outElement = std::move(m_elements[m_head]);
+			m_head = (m_head + 1) & (m_elements.Num() - 1);
+			m_num--;
+
+			return true;
+		}
+
+		// Approximated, the value could be outdated immediately
+		SAILOR_API bool IsEmpty() const
+		{
+			const std::lock_guard<std::mutex> lock(m_mutex);
+			return m_num == 0;
+		}
+
+	protected:
+
+		// The capacity is always the power of two
+		__forceinline void ResizeIfNeeded()
+		{
+			const size_t capacity = m_elements.Num();
+			if (m_num < capacity)
+			{
+				return;
+			}
+
+			TVector<TElementType, TAllocator> elements;
+			elements.AddDefault(capacity ? capacity * 2 : 64);
+
+			for (size_t i = 0; i < m_num; i++)
+			{
+				elements[i] = std::move(m_elements[(m_head + i) & (capacity - 1)]);
+			}
+
+			m_elements = std::move(elements);
+			m_head = 0;
+		}
+
+		mutable std::mutex m_mutex;
+		TVector<TElementType, TAllocator> m_elements;
+		size_t m_head = 0;
+		size_t m_num = 0;
+
+#endif
+	};
+}
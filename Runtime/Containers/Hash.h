@@ -44,7 +44,7 @@ public:
 namespace std
 {
 	template<>
-	struct std::hash<Sailor::IHashable>
+	struct hash<Sailor::IHashable>
 	{
 		SAILOR_API std::size_t operator()(const Sailor::IHashable& p) const
 		{
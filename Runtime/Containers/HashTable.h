@@ -0,0 +1,578 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <bit>
+#include <iterator>
+#include <new>
+#include <utility>
+#include <type_traits>
+#include "Core/Defines.h"
+#include "Containers/Concepts.h"
+#include "Containers/Hash.h"
+#include "Memory/Memory.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SAILOR_HASH_TABLE_SSE2 1
+#include <emmintrin.h>
+#else
+#define SAILOR_HASH_TABLE_SSE2 0
+#endif
+
+namespace Sailor::Internal
+{
+	// std::hash of integers is the identity on most platforms, so we mix the bits
+	// to make both the low and the high bits of the hash meaningful
+	__forceinline size_t MixHash(size_t hash)
+	{
+		uint64_t res = (uint64_t)hash;
+		res ^= res >> 33;
+		res *= 0xff51afd7ed558ccdull;
+		res ^= res >> 33;
+		return (size_t)res;
+	}
+
+	// 16 control bytes that are matched at once
+	class HashTableGroup
+	{
+	public:
+
+		static constexpr size_t Width = 16;
+
+		// Full slots keep 7 low bits of the hash, so the sign bit marks the free slots
+		static constexpr int8_t Empty = -128;
+		static constexpr int8_t Deleted = -2;
+
+		__forceinline explicit HashTableGroup(const int8_t* pCtrl)
+		{
+#if SAILOR_HASH_TABLE_SSE2
+			m_ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pCtrl));
+#else
+			memcpy(m_ctrl, pCtrl, Width);
+#endif
+		}
+
+		// The bit mask of the slots with the same control byte
+		__forceinline uint32_t Match(int8_t ctrl) const
+		{
+#if SAILOR_HASH_TABLE_SSE2
+			return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(ctrl), m_ctrl));
+#else
+			uint32_t mask = 0;
+			for (uint32_t i = 0; i < Width; i++)
+			{
+				mask |= (m_ctrl[i] == ctrl ? 1u : 0u) << i;
+			}
+			return mask;
+#endif
+		}
+
+		__forceinline uint32_t MatchEmpty() const { return Match(Empty); }
+
+		__forceinline uint32_t MatchEmptyOrDeleted() const
+		{
+#if SAILOR_HASH_TABLE_SSE2
+			return (uint32_t)_mm_movemask_epi8(m_ctrl);
+#else
+			uint32_t mask = 0;
+			for (uint32_t i = 0; i < Width; i++)
+			{
+				mask |= (m_ctrl[i] < 0 ? 1u : 0u) << i;
+			}
+			return mask;
+#endif
+		}
+
+		// Returns the index of the lowest set bit and clears it
+		static __forceinline uint32_t PopLowestBit(uint32_t& mask)
+		{
+			const uint32_t index = (uint32_t)std::countr_zero(mask);
+			mask &= mask - 1;
+			return index;
+		}
+
+	protected:
+
+#if SAILOR_HASH_TABLE_SSE2
+		__m128i m_ctrl;
+#else
+		int8_t m_ctrl[Width];
+#endif
+	};
+
+	// The slot of TSet is the key itself
+	struct HashSetKey
+	{
+		template<typename TSlotType>
+		static __forceinline const TSlotType& Get(const TSlotType& slot) { return slot; }
+	};
+
+	// The slot of TMap is TPair<TKeyType, TValueType>
+	struct HashMapKey
+	{
+		template<typename TSlotType>
+		static __forceinline const auto& Get(const TSlotType& slot) { return slot.m_first; }
+	};
+
+	/* Open addressing hash table with the separate array of control bytes, the same layout as Swiss tables have.
+	*  The control byte of the slot is Empty, Deleted or 7 low bits of the hash, so the lookup
+	*  compares the whole group of 16 control bytes by one SSE2 instruction and touches the slots only on the likely match.
+	*  The capacity is the power of two and the multiple of the group width, the groups are probed quadratically.
+	*  The slots are stored inline right after the control bytes within the one allocation.
+	*/
+	template<typename TKeyType, typename TSlotType, typename TGetKey, typename TAllocator>
+	class THashTable
+	{
+	public:
+
+		static constexpr size_t InvalidIndex = (size_t)-1;
+
+		template<typename TDataType>
+		class TBaseIterator
+		{
+		public:
+
+			using iterator_category = std::bidirectional_iterator_tag;
+			using value_type = TDataType;
+			using difference_type = int64_t;
+			using pointer = TDataType*;
+			using reference = TDataType&;
+
+			TBaseIterator() = default;
+			TBaseIterator(const TBaseIterator&) = default;
+			TBaseIterator(TBaseIterator&&) = default;
+			~TBaseIterator() = default;
+
+			TBaseIterator(const int8_t* pCtrl, TDataType* pSlots, size_t index, size_t capacity) :
+				m_pCtrl(pCtrl), m_pSlots(pSlots), m_index(index), m_capacity(capacity) {}
+
+			operator TBaseIterator<const TDataType>() const { return TBaseIterator<const TDataType>(m_pCtrl, m_pSlots, m_index, m_capacity); }
+
+			TBaseIterator& operator=(const TBaseIterator& rhs) = default;
+			TBaseIterator& operator=(TBaseIterator&& rhs) = default;
+
+			bool operator==(const TBaseIterator& rhs) const { return m_index == rhs.m_index && m_pCtrl == rhs.m_pCtrl; }
+			bool operator!=(const TBaseIterator& rhs) const { return !(*this == rhs); }
+
+			pointer operator->() const { return &m_pSlots[m_index]; }
+			reference operator*() const { return m_pSlots[m_index]; }
+
+			TBaseIterator& operator++()
+			{
+				do
+				{
+					m_index++;
+				} while (m_index < m_capacity && m_pCtrl[m_index] < 0);
+
+				return *this;
+			}
+
+			TBaseIterator& operator--()
+			{
+				while (m_index > 0)
+				{
+					if (m_pCtrl[--m_index] >= 0)
+					{
+						break;
+					}
+				}
+
+				return *this;
+			}
+
+			__forceinline size_t GetIndex() const { return m_index; }
+
+		protected:
+
+			const int8_t* m_pCtrl = nullptr;
+			TDataType* m_pSlots = nullptr;
+			size_t m_index = 0;
+			size_t m_capacity = 0;
+		};
+
+		using TIterator = TBaseIterator<TSlotType>;
+		using TConstIterator = TBaseIterator<const TSlotType>;
+
+		THashTable() = default;
+		explicit THashTable(size_t desiredNum) { Reserve(desiredNum); }
+
+		THashTable(const THashTable& rhs) requires IsCopyConstructible<TSlotType> { CopyFrom(rhs); }
+		THashTable(THashTable&& rhs) noexcept { Swap(*this, rhs); }
+
+		THashTable& operator=(const THashTable& rhs) requires IsCopyConstructible<TSlotType>
+		{
+			if (this != &rhs)
+			{
+				Release();
+				CopyFrom(rhs);
+			}
+			return *this;
+		}
+
+		THashTable& operator=(THashTable&& rhs) noexcept
+		{
+			if (this != &rhs)
+			{
+				Release();
+				Swap(*this, rhs);
+			}
+			return *this;
+		}
+
+		~THashTable() { Release(); }
+
+		__forceinline size_t Num() const { return m_num; }
+		__forceinline size_t Capacity() const { return m_capacity; }
+
+		__forceinline TSlotType& GetSlot(size_t index) { return m_pSlots[index]; }
+		__forceinline const TSlotType& GetSlot(size_t index) const { return m_pSlots[index]; }
+
+		void Reserve(size_t num)
+		{
+			const size_t capacity = CapacityFor(num);
+			if (capacity > m_capacity)
+			{
+				Rehash(capacity);
+			}
+		}
+
+		size_t FindIndex(const TKeyType& key) const
+		{
+			if (m_num == 0)
+			{
+				return InvalidIndex;
+			}
+
+			return FindIndex(key, Hash(key));
+		}
+
+		// Returns the index of the slot with the key,
+		// construct(void* pSlot) is called to place the new slot only if the key is missed
+		template<typename TConstruct>
+		size_t FindOrInsert(const TKeyType& key, bool& bOutInserted, TConstruct&& construct)
+		{
+			const size_t hash = Hash(key);
+
+			if (m_num > 0)
+			{
+				const size_t index = FindIndex(key, hash);
+				if (index != InvalidIndex)
+				{
+					bOutInserted = false;
+					return index;
+				}
+			}
+
+			if (m_num + m_numDeleted + 1 > MaxLoad(m_capacity))
+			{
+				Grow();
+			}
+
+			const size_t index = FindFreeIndex(hash);
+			if (m_pCtrl[index] == HashTableGroup::Deleted)
+			{
+				m_numDeleted--;
+			}
+
+			m_pCtrl[index] = H2(hash);
+			construct(static_cast<void*>(&m_pSlots[index]));
+			m_num++;
+
+			bOutInserted = true;
+			return index;
+		}
+
+		void RemoveAt(size_t index)
+		{
+			m_pSlots[index].~TSlotType();
+
+			// The lookup stops on the group with the empty slot, so there was no probe through that group
+			// and we don't need the tombstone
+			const size_t groupStart = index & ~(HashTableGroup::Width - 1);
+			if (HashTableGroup(m_pCtrl + groupStart).MatchEmpty())
+			{
+				m_pCtrl[index] = HashTableGroup::Empty;
+			}
+			else
+			{
+				m_pCtrl[index] = HashTableGroup::Deleted;
+				m_numDeleted++;
+			}
+
+			m_num--;
+		}
+
+		bool Remove(const TKeyType& key)
+		{
+			const size_t index = FindIndex(key);
+			if (index == InvalidIndex)
+			{
+				return false;
+			}
+
+			RemoveAt(index);
+			return true;
+		}
+
+		// The allocation is kept if it fits the desired number of elements
+		void Clear(size_t desiredNum)
+		{
+			const size_t capacity = CapacityFor(desiredNum);
+			if (capacity != m_capacity)
+			{
+				Release();
+				Reserve(desiredNum);
+				return;
+			}
+
+			DestructSlots();
+
+			if (m_capacity > 0)
+			{
+				memset(m_pCtrl, HashTableGroup::Empty, m_capacity);
+			}
+
+			m_num = 0;
+			m_numDeleted = 0;
+		}
+
+		size_t FirstIndex() const
+		{
+			size_t index = 0;
+			while (index < m_capacity && m_pCtrl[index] < 0)
+			{
+				index++;
+			}
+			return index;
+		}
+
+		__forceinline TIterator IteratorAt(size_t index) { return TIterator(m_pCtrl, m_pSlots, index, m_capacity); }
+		__forceinline TConstIterator IteratorAt(size_t index) const { return TConstIterator(m_pCtrl, m_pSlots, index, m_capacity); }
+
+		TIterator begin() { return IteratorAt(FirstIndex()); }
+		TIterator end() { return IteratorAt(m_capacity); }
+
+		TConstIterator begin() const { return IteratorAt(FirstIndex()); }
+		TConstIterator end() const { return IteratorAt(m_capacity); }
+
+		static void Swap(THashTable& lhs, THashTable& rhs)
+		{
+			std::swap(lhs.m_pData, rhs.m_pData);
+			std::swap(lhs.m_pCtrl, rhs.m_pCtrl);
+			std::swap(lhs.m_pSlots, rhs.m_pSlots);
+			std::swap(lhs.m_capacity, rhs.m_capacity);
+			std::swap(lhs.m_num, rhs.m_num);
+			std::swap(lhs.m_numDeleted, rhs.m_numDeleted);
+			std::swap(lhs.m_allocator, rhs.m_allocator);
+		}
+
+	protected:
+
+		static __forceinline size_t Hash(const TKeyType& key) { return MixHash(Sailor::GetHash(key)); }
+
+		static __forceinline size_t H1(size_t hash) { return hash >> 7; }
+		static __forceinline int8_t H2(size_t hash) { return (int8_t)(hash & 0x7F); }
+
+		// The max load factor is 7/8
+		static __forceinline size_t MaxLoad(size_t capacity) { return capacity - capacity / 8; }
+
+		static size_t CapacityFor(size_t num)
+		{
+			if (num == 0)
+			{
+				return 0;
+			}
+
+			size_t capacity = HashTableGroup::Width;
+			while (MaxLoad(capacity) < num)
+			{
+				capacity *= 2;
+			}
+
+			return capacity;
+		}
+
+		size_t FindIndex(const TKeyType& key, size_t hash) const
+		{
+			const int8_t h2 = H2(hash);
+			const size_t groupMask = m_capacity / HashTableGroup::Width - 1;
+			size_t group = H1(hash) & groupMask;
+
+			for (size_t step = 1; ; step++)
+			{
+				const size_t groupStart = group * HashTableGroup::Width;
+				const HashTableGroup ctrl(m_pCtrl + groupStart);
+
+				uint32_t match = ctrl.Match(h2);
+				while (match)
+				{
+					const size_t index = groupStart + HashTableGroup::PopLowestBit(match);
+					if (TGetKey::Get(m_pSlots[index]) == key)
+					{
+						return index;
+					}
+				}
+
+				if (ctrl.MatchEmpty())
+				{
+					return InvalidIndex;
+				}
+
+				// Triangular numbers visit all the groups since the number of groups is the power of two
+				group = (group + step) & groupMask;
+			}
+		}
+
+		size_t FindFreeIndex(size_t hash) const
+		{
+			const size_t groupMask = m_capacity / HashTableGroup::Width - 1;
+			size_t group = H1(hash) & groupMask;
+
+			for (size_t step = 1; ; step++)
+			{
+				const size_t groupStart = group * HashTableGroup::Width;
+				uint32_t freeSlots = HashTableGroup(m_pCtrl + groupStart).MatchEmptyOrDeleted();
+
+				if (freeSlots)
+				{
+					return groupStart + HashTableGroup::PopLowestBit(freeSlots);
+				}
+
+				group = (group + step) & groupMask;
+			}
+		}
+
+		void Grow()
+		{
+			if (m_capacity == 0)
+			{
+				Rehash(HashTableGroup::Width);
+			}
+			else if (m_numDeleted > m_capacity / 4)
+			{
+				// That's enough to drop the tombstones
+				Rehash(m_capacity);
+			}
+			else
+			{
+				Rehash(m_capacity * 2);
+			}
+		}
+
+		void Rehash(size_t newCapacity)
+		{
+			void* pOldData = m_pData;
+			int8_t* pOldCtrl = m_pCtrl;
+			TSlotType* pOldSlots = m_pSlots;
+			const size_t oldCapacity = m_capacity;
+
+			Allocate(newCapacity);
+
+			for (size_t i = 0; i < oldCapacity; i++)
+			{
+				if (pOldCtrl[i] < 0)
+				{
+					continue;
+				}
+
+				const size_t hash = Hash(TGetKey::Get(pOldSlots[i]));
+				const size_t index = FindFreeIndex(hash);
+
+				m_pCtrl[index] = H2(hash);
+				new (&m_pSlots[index]) TSlotType(std::move(pOldSlots[i]));
+				pOldSlots[i].~TSlotType();
+			}
+
+			m_numDeleted = 0;
+
+			if (pOldData)
+			{
+				m_allocator.Free(pOldData, AllocationSize(oldCapacity));
+			}
+		}
+
+		static __forceinline size_t SlotsOffset(size_t capacity)
+		{
+			return (capacity + alignof(TSlotType) - 1) & ~(alignof(TSlotType) - 1);
+		}
+
+		static __forceinline size_t AllocationSize(size_t capacity)
+		{
+			return SlotsOffset(capacity) + capacity * sizeof(TSlotType);
+		}
+
+		// Doesn't free the previous allocation
+		void Allocate(size_t capacity)
+		{
+			const size_t alignment = alignof(TSlotType) > 8 ? alignof(TSlotType) : 8;
+
+			m_pData = m_allocator.Allocate(AllocationSize(capacity), alignment);
+			m_pCtrl = static_cast<int8_t*>(m_pData);
+			m_pSlots = reinterpret_cast<TSlotType*>(static_cast<uint8_t*>(m_pData) + SlotsOffset(capacity));
+			m_capacity = capacity;
+
+			memset(m_pCtrl, HashTableGroup::Empty, capacity);
+		}
+
+		void DestructSlots()
+		{
+			if constexpr (!std::is_trivially_destructible_v<TSlotType>)
+			{
+				for (size_t i = 0; i < m_capacity && m_num > 0; i++)
+				{
+					if (m_pCtrl[i] >= 0)
+					{
+						m_pSlots[i].~TSlotType();
+					}
+				}
+			}
+		}
+
+		void Release()
+		{
+			if (m_pData)
+			{
+				DestructSlots();
+				m_allocator.Free(m_pData, AllocationSize(m_capacity));
+			}
+
+			m_pData = nullptr;
+			m_pCtrl = nullptr;
+			m_pSlots = nullptr;
+			m_capacity = 0;
+			m_num = 0;
+			m_numDeleted = 0;
+		}
+
+		void CopyFrom(const THashTable& rhs)
+		{
+			if (rhs.m_num == 0)
+			{
+				return;
+			}
+
+			Allocate(rhs.m_capacity);
+
+			// The same capacity gives the same layout, so we copy the control bytes as is
+			memcpy(m_pCtrl, rhs.m_pCtrl, m_capacity);
+			for (size_t i = 0; i < m_capacity; i++)
+			{
+				if (m_pCtrl[i] >= 0)
+				{
+					new (&m_pSlots[i]) TSlotType(rhs.m_pSlots[i]);
+				}
+			}
+
+			m_num = rhs.m_num;
+			m_numDeleted = rhs.m_numDeleted;
+		}
+
+		void* m_pData = nullptr;
+		int8_t* m_pCtrl = nullptr;
+		TSlotType* m_pSlots = nullptr;
+		size_t m_capacity = 0;
+		size_t m_num = 0;
+		size_t m_numDeleted = 0;
+
+		TAllocator m_allocator{};
+	};
+}
@@ -1,10 +1,9 @@
-#include "Memory.h"
 #include <cstdlib>
 #include <list>
 #include <cassert>
 #include <cctype>
 #include "Core/Utils.h"
-#include "List.h"
+#include "Containers/List.h"
 #include "Memory/Memory.h"
 #include "Tasks/Tasks.h"
 #include "Tasks/Scheduler.h"
@@ -8,38 +8,40 @@
 #include "Containers/Vector.h"
 #include "Containers/Set.h"
 #include "Containers/Pair.h"
+#include "Containers/HashTable.h"
 
 namespace Sailor
 {
+	/* Open addressing hash map, the keys and the values are stored inline as TPair<TKeyType, TValueType>.
+	*  Insert, operator[] and Remove invalidate the iterators and the references to the values.
+	*/
 	template<typename TKeyType, typename TValueType, typename TAllocator = Memory::DefaultGlobalAllocator>
-	class TMap final : public TSet<TPair<TKeyType, size_t>, TAllocator>
+	class TMap final
 	{
 	public:
 
-		using Super = Sailor::TSet<TPair<TKeyType, size_t>, TAllocator>;
-		using TElementType = Sailor::TPair<TKeyType, size_t>;
+		using TElementType = Sailor::TPair<TKeyType, TValueType>;
+		using THashTable = Internal::THashTable<TKeyType, TElementType, Internal::HashMapKey, TAllocator>;
 
-		template<typename TDataType, typename TElementIterator>
+		template<typename TSlotIterator>
 		class SAILOR_API TBaseIterator
 		{
 		public:
 
 			using iterator_category = std::bidirectional_iterator_tag;
-			using value_type = TDataType;
+			using value_type = TPair<TKeyType, TValueType*>;
 			using difference_type = int64_t;
-			using pointer = TDataType*;
-			using reference = TDataType&;
-
-			TBaseIterator() : m_map(nullptr), m_it(nullptr), m_currentBucket(nullptr) {}
+			using pointer = value_type*;
+			using reference = value_type;
 
+			TBaseIterator() = default;
 			TBaseIterator(const TBaseIterator&) = default;
 			TBaseIterator(TBaseIterator&&) = default;
-
 			~TBaseIterator() = default;
 
-			TBaseIterator(const TMap* map, Super::TEntry* bucket, TElementIterator it) : m_map(const_cast<TMap*>(map)), m_it(std::move(it)), m_currentBucket(bucket) {}
+			TBaseIterator(TSlotIterator it) : m_it(std::move(it)) {}
 
-			operator TBaseIterator<const TDataType, TElementIterator>() { return TBaseIterator<const TDataType, TElementIterator>(m_map, m_currentBucket, m_it); }
+			operator TBaseIterator<typename THashTable::TConstIterator>() const { return TBaseIterator<typename THashTable::TConstIterator>(m_it); }
 
 			TBaseIterator& operator=(const TBaseIterator& rhs) = default;
 			TBaseIterator& operator=(TBaseIterator&& rhs) = default;
@@ -47,82 +49,53 @@ namespace Sailor
 			bool operator==(const TBaseIterator& rhs) const { return m_it == rhs.m_it; }
 			bool operator!=(const TBaseIterator& rhs) const { return m_it != rhs.m_it; }
 
-			TPair<TKeyType, TValueType*> operator*() { return TPair<TKeyType, TValueType*>(m_it->m_first, &(*m_map->m_values[m_it->m_second])); }
-			TPair<TKeyType, const TValueType*> operator*() const { return TPair<TKeyType, TValueType*>(m_it->m_first, &(*m_map->m_values[m_it->m_second])); }
-
-			TPair<TKeyType, TValueType*> operator->() { return TPair<TKeyType, TValueType*>(m_it->m_first, &(*m_map->m_values[m_it->m_second])); }
-			TPair<TKeyType, const TValueType*> operator->() const { return TPair<TKeyType, TValueType*>(m_it->m_first, &(*m_map->m_values[m_it->m_second])); }
+			TPair<TKeyType, TValueType*> operator*() const { return TPair<TKeyType, TValueType*>(m_it->m_first, const_cast<TValueType*>(&m_it->m_second)); }
 
 			const TKeyType& Key() const { return m_it->m_first; }
 
-			TValueType& Value() { return m_map->m_values[m_it->m_second].value(); }
-			const TValueType& Value() const { return m_map->m_values[m_it->m_second].value(); }
-
-			/*
-			pointer operator->() { return &*m_it; }
-			pointer operator->() const { return &*m_it; }
-
-			reference operator*() { return *m_it; }
-			reference operator*() const { return *m_it; }
-			*/
+			TValueType& Value() { return const_cast<TValueType&>(m_it->m_second); }
+			const TValueType& Value() const { return m_it->m_second; }
 
 			TBaseIterator& operator++()
 			{
 				++m_it;
-
-				if (m_it == m_currentBucket->GetContainer().end())
-				{
-					if (m_currentBucket->m_next)
-					{
-						m_currentBucket = m_currentBucket->m_next;
-						m_it = m_currentBucket->GetContainer().begin();
-					}
-				}
-
 				return *this;
 			}
 
 			TBaseIterator& operator--()
 			{
-				if (m_it == m_currentBucket->GetContainer().begin())
-				{
-					if (m_currentBucket->m_prev)
-					{
-						m_currentBucket = m_currentBucket->m_prev;
-						m_it = m_currentBucket->GetContainer().Last();
-					}
-				}
-				else
-				{
-					--m_it;
-				}
-
+				--m_it;
 				return *this;
 			}
 
 		protected:
 
-			Super::TEntry* m_currentBucket;
-			TElementIterator m_it;
-			TMap* m_map;
-			friend class TEntry;
+			TSlotIterator m_it{};
 		};
 
-		using TIterator = TBaseIterator<TElementType, typename Super::TElementContainer::TIterator>;
-		using TConstIterator = TBaseIterator<const TElementType, typename Super::TElementContainer::TConstIterator>;
+		using TIterator = TBaseIterator<typename THashTable::TIterator>;
+		using TConstIterator = TBaseIterator<typename THashTable::TConstIterator>;
+
+		TMap(const uint32_t desiredNumElements = 0) : m_table(desiredNumElements) {}
+		TMap(TMap&&) noexcept = default;
+		TMap(const TMap&) requires IsCopyConstructible<TElementType> = default;
 
-		using TValueContainer = Sailor::TVector<std::optional<TValueType>>;
+		TMap& operator=(TMap&&) noexcept = default;
+		TMap& operator=(const TMap&) requires IsCopyConstructible<TElementType> = default;
 
-		TMap(const uint32_t desiredNumBuckets = 16) : Super(desiredNumBuckets), m_values(desiredNumBuckets * 4) {  }
-		TMap(std::initializer_list<TElementType> initList)
+		TMap(std::initializer_list<TElementType> initList) : m_table(initList.size())
 		{
-			m_values.Reserve(std::max(Super::m_buckets.Num(), initList.size()));
 			for (const auto& el : initList)
 			{
-				Insert(el);
+				Insert(el.m_first, el.m_second);
 			}
 		}
 
+		__forceinline bool IsEmpty() const { return m_table.Num() == 0; }
+		__forceinline size_t Num() const { return m_table.Num(); }
+
+		__forceinline void Reserve(size_t num) { m_table.Reserve(num); }
+
 		void Add(const TKeyType& key, const TValueType& value) requires IsCopyConstructible<TValueType>
 		{
 			Insert(key, value);
@@ -130,137 +103,62 @@ namespace Sailor
 
 		void Add(const TKeyType& key, TValueType&& value) requires IsMoveConstructible<TValueType>
 		{
-			Insert(key, value);
+			Insert(key, std::move(value));
 		}
 
+		// The value is replaced if the key is already presented
 		void Insert(const TKeyType& key, const TValueType& value) requires IsCopyConstructible<TValueType>
 		{
-			size_t index = 0;
-			if (m_freeList.Num() > 0)
-			{
-				index = *m_freeList.Last();
-				m_freeList.RemoveLast();
+			bool bInserted = false;
+			const size_t index = m_table.FindOrInsert(key, bInserted, [&](void* pSlot) { new (pSlot) TElementType(key, value); });
 
-				m_values[index] = std::move(std::make_optional(value));
-			}
-			else
+			if (!bInserted)
 			{
-				index = m_values.Emplace(std::make_optional(value));
+				m_table.GetSlot(index).m_second = value;
 			}
-
-			Super::Insert(TElementType(key, index));
 		}
 
 		void Insert(const TKeyType& key, TValueType&& value) requires IsMoveConstructible<TValueType>
 		{
-			size_t index = 0;
-			if (m_freeList.Num() > 0)
-			{
-				index = *m_freeList.Last();
-				m_freeList.RemoveLast();
+			bool bInserted = false;
+			const size_t index = m_table.FindOrInsert(key, bInserted, [&](void* pSlot) { new (pSlot) TElementType(key, std::move(value)); });
 
-				m_values[index] = std::move(std::make_optional(std::move(value)));
-			}
-			else
+			if (!bInserted)
 			{
-				index = m_values.Emplace(std::move(std::make_optional(std::move(value))));
+				m_table.GetSlot(index).m_second = std::move(value);
 			}
-
-			Super::Insert(TElementType(key, index));
 		}
 
-		bool Remove(const TKeyType& key)
-		{
-			const auto& hash = Sailor::GetHash(key);
-			auto& element = Super::m_buckets[hash % Super::m_buckets.Num()];
-
-			if (element)
-			{
-				auto& container = element->GetContainer();
-				if (container.RemoveAll([&](const TElementType& el)
-					{
-						if (el.First() == key)
-						{
-							m_values[el.m_second].reset();
-							m_freeList.Add(el.m_second);
-
-							return true;
-						}
-						return false;
-
-					}))
-				{
-					if (container.Num() == 0)
-					{
-						if (element.GetRawPtr() == Super::m_last)
-						{
-							Super::m_last = element->m_prev;
-						}
-
-						if (element->m_next)
-						{
-							element->m_next->m_prev = element->m_prev;
-						}
-
-						if (element->m_prev)
-						{
-							element->m_prev->m_next = element->m_next;
-						}
-
-						if (Super::m_last == element.GetRawPtr())
-						{
-							Super::m_last = Super::m_last->m_prev;
-						}
-
-						if (Super::m_first == element.GetRawPtr())
-						{
-							Super::m_first = Super::m_first->m_next;
-						}
-
-						element.Clear();
-					}
-
-					Super::m_num--;
-					return true;
-				}
-				return false;
-			}
-			return false;
-		}
+		__forceinline bool Remove(const TKeyType& key) { return m_table.Remove(key); }
 
 		TValueType& UpdateKey(const TKeyType& key)
 		{
 			auto& pair = GetOrAdd(key);
 			pair.m_first = key;
-			return *m_values[pair.m_second];
+			return pair.m_second;
 		}
 
-		TValueType& operator[] (const TKeyType& key)
+		__forceinline TValueType& operator[] (const TKeyType& key)
 		{
-			return *m_values[GetOrAdd(key).m_second];
+			return GetOrAdd(key).m_second;
 		}
 
-		void Clear(uint32_t desiredBucketsNum = 8)
-		{
-			Super::Clear(desiredBucketsNum);
-			m_values.Clear();
-			m_freeList.Clear();
-		}
+		void Clear(uint32_t desiredNumElements = 8) { m_table.Clear(desiredNumElements); }
 
-		// TODO: rethink the approach for const operator []
 		const TValueType& operator[] (const TKeyType& key) const
 		{
-			TValueType const* out = nullptr;
-			Find(key, out);
-			return *out;
+			const size_t index = m_table.FindIndex(key);
+			check(index != THashTable::InvalidIndex);
+
+			return m_table.GetSlot(index).m_second;
 		}
 
 		bool Find(const TKeyType& key, TValueType*& out)
 		{
-			auto it = Find(key);
-			if (it != end())
+			const size_t index = m_table.FindIndex(key);
+			if (index != THashTable::InvalidIndex)
 			{
-				out = &it.Value();
+				out = &m_table.GetSlot(index).m_second;
 				return true;
 			}
 			return false;
@@ -268,10 +166,10 @@ namespace Sailor
 
 		bool Find(const TKeyType& key, TValueType const*& out) const
 		{
-			auto it = Find(key);
-			if (it != end())
+			const size_t index = m_table.FindIndex(key);
+			if (index != THashTable::InvalidIndex)
 			{
-				out = &it.Value();
+				out = &m_table.GetSlot(index).m_second;
 				return true;
 			}
 			return false;
@@ -279,50 +177,26 @@ namespace Sailor
 
 		TIterator Find(const TKeyType& key)
 		{
-			const auto& hash = Sailor::GetHash(key);
-			auto& element = Super::m_buckets[hash % Super::m_buckets.Num()];
-
-			if (element && element->LikelyContains(hash))
-			{
-				auto& container = element->GetContainer();
-				typename Super::TElementContainer::TIterator it = container.FindIf([&](const TElementType& el) { return el.First() == key; });
-				if (it != container.end())
-				{
-					return TIterator(this, element.GetRawPtr(), it);
-				}
-			}
-
-			return end();
+			const size_t index = m_table.FindIndex(key);
+			return index != THashTable::InvalidIndex ? TIterator(m_table.IteratorAt(index)) : end();
 		}
 
 		TConstIterator Find(const TKeyType& key) const
 		{
-			const auto& hash = Sailor::GetHash(key);
-			auto& element = Super::m_buckets[hash % Super::m_buckets.Num()];
-
-			if (element && element->LikelyContains(hash))
-			{
-				auto& container = element->GetContainer();
-				typename Super::TElementContainer::TConstIterator it = container.FindIf([&](const TElementType& el) { return el.First() == key; });
-				if (it != container.end())
-				{
-					return TConstIterator(this, element.GetRawPtr(), it);
-				}
-			}
-
-			return end();
+			const size_t index = m_table.FindIndex(key);
+			return index != THashTable::InvalidIndex ? TConstIterator(m_table.IteratorAt(index)) : end();
 		}
 
-		bool ContainsKey(const TKeyType& key) const
+		__forceinline bool ContainsKey(const TKeyType& key) const
 		{
-			return Find(key) != end();
+			return m_table.FindIndex(key) != THashTable::InvalidIndex;
 		}
 
 		bool ContainsValue(const TValueType& value) const
 		{
-			for (const auto& bucket : Super::m_buckets)
+			for (const auto& el : m_table)
 			{
-				if (bucket && bucket->GetContainer().FindIf([&](const TElementType& el) { return *m_values[el.Second()] == value; }) != -1)
+				if (el.m_second == value)
 				{
 					return true;
 				}
@@ -332,11 +206,12 @@ namespace Sailor
 
 		TVector<TKeyType> GetKeys() const
 		{
-			TVector<TKeyType> res(Super::Num());
+			TVector<TKeyType> res;
+			res.Reserve(Num());
 
-			for (const auto& pair : *this)
+			for (const auto& el : m_table)
 			{
-				res.Add(pair.m_first);
+				res.Add(el.m_first);
 			}
 
 			return res;
@@ -344,58 +219,34 @@ namespace Sailor
 
 		TVector<TValueType> GetValues() const
 		{
-			TVector<TValueType> res(Super::Num());
+			TVector<TValueType> res;
+			res.Reserve(Num());
 
-			for (const auto& pair : *this)
+			for (const auto& el : m_table)
 			{
-				res.Add(pair.m_second);
+				res.Add(el.m_second);
 			}
 
 			return res;
 		}
 
 		// Support ranged for
-		TIterator begin() { return TIterator(this, Super::m_first, Super::m_first ? Super::m_first->GetContainer().begin() : nullptr); }
-		TIterator end() { return TIterator(this, Super::m_last, nullptr); }
+		TIterator begin() { return TIterator(m_table.begin()); }
+		TIterator end() { return TIterator(m_table.end()); }
 
-		TConstIterator begin() const { return TConstIterator(this, Super::m_first, Super::m_first ? Super::m_first->GetContainer().begin() : nullptr); }
-		TConstIterator end() const { return TConstIterator(this, Super::m_last, nullptr); }
+		TConstIterator begin() const { return TConstIterator(m_table.begin()); }
+		TConstIterator end() const { return TConstIterator(m_table.end()); }
 
 	protected:
 
-		TValueContainer m_values;
-		TVector<size_t> m_freeList;
-
-		TElementType& GetOrAdd(const TKeyType& key)
+		// TODO: rethink the approach when default constructor is missed
+		__forceinline TElementType& GetOrAdd(const TKeyType& key)
 		{
-			const auto& hash = Sailor::GetHash(key);
-			{
-				const size_t index = hash % Super::m_buckets.Num();
-				auto& element = Super::m_buckets[index];
-
-				if (element)
-				{
-					auto& container = element->GetContainer();
-
-					TElementType* out;
-					if (container.FindIf(out, [&](const TElementType& element) { return element.First() == key; }))
-					{
-						return *out;
-					}
-				}
-			}
-
-			// TODO: rethink the approach when default constructor is missed
-			Insert(key, std::move(TValueType()));
-
-			const size_t index = hash % Super::m_buckets.Num();
-			auto& element = Super::m_buckets[index];
-
-			return *element->GetContainer().Last();
+			bool bInserted = false;
+			return m_table.GetSlot(m_table.FindOrInsert(key, bInserted, [&](void* pSlot) { new (pSlot) TElementType(key, TValueType()); }));
 		}
 
-		friend class TIterator;
-		friend class TConstIterator;
+		THashTable m_table{};
 	};
 
 	SAILOR_API void RunMapBenchmark();
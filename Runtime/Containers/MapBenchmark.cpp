@@ -1,5 +1,9 @@
 #include <unordered_map>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
 #include "Containers/Map.h"
+#include "Containers/ChainedMap.h"
 #include "Containers/ConcurrentMap.h"
 #include "Core/Utils.h"
 #include <random>
@@ -67,7 +71,7 @@ public:
 			const size_t value = i % 2 ? g() : g() % count;
 			if (!container.ContainsKey(value))
 			{
-				misses++;
+				misses = misses + 1;
 			}
 		}
 		tMap.Stop();
@@ -80,7 +84,7 @@ public:
 			const size_t value = i % 2 ? g() : g() % count;
 			if (ideal.find(value) == ideal.end())
 			{
-				misses++;
+				misses = misses + 1;
 			}
 		}
 		stdMap.Stop();
@@ -114,17 +118,24 @@ public:
 		SAILOR_LOG("Performance test Remove:\n\tstd::Map %llums\n\tTMap %llums", stdMap.ResultMs(), tMap.ResultMs());
 	}
 
+	// TMap iterates over the pairs with the pointers to the values, TConcurrentMap over the pairs with the values
+	template<typename T>
+	static const T& Deref(const T& value) { return value; }
+
+	template<typename T>
+	static const T& Deref(T* value) { return *value; }
+
 	static bool SanityCheck()
 	{
 		const size_t count = 180;
 
-		TConcurrentMap<size_t, size_t> container;
-		std::unordered_map<size_t, size_t> ideal;
+		TContainer container;
+		std::unordered_map<size_t, std::string> ideal;
 
 		for (size_t i = 0; i < count; i++)
 		{
-			ideal[i] = i * 3;
-			container[i] = i * 3;
+			ideal[i] = std::to_string(i * 3);
+			container[i] = std::to_string(i * 3);
 		}
 
 		for (size_t i = 0; i < count / 2; i++)
@@ -142,7 +153,7 @@ public:
 
 			for (const auto& el : container)
 			{
-				if (ideal[el.m_first] != el.m_second)
+				if (ideal[el.m_first] != Deref(el.m_second))
 				{
 					return false;
 				}
@@ -152,10 +163,175 @@ public:
 	}
 };
 
+// std::unordered_map guarded by the readers-writer lock, the reference point for the concurrent map
+class SharedMutexMap
+{
+public:
+
+	bool ContainsKey(size_t key) const
+	{
+		std::shared_lock<std::shared_mutex> lock(m_mutex);
+		return m_map.find(key) != m_map.end();
+	}
+
+	bool Find(size_t key, size_t& outValue) const
+	{
+		std::shared_lock<std::shared_mutex> lock(m_mutex);
+
+		auto it = m_map.find(key);
+		if (it != m_map.end())
+		{
+			outValue = it->second;
+			return true;
+		}
+		return false;
+	}
+
+	void Insert(size_t key, size_t value)
+	{
+		std::unique_lock<std::shared_mutex> lock(m_mutex);
+		m_map[key] = value;
+	}
+
+	bool Remove(size_t key)
+	{
+		std::unique_lock<std::shared_mutex> lock(m_mutex);
+		return m_map.erase(key) != 0;
+	}
+
+protected:
+
+	mutable std::shared_mutex m_mutex;
+	std::unordered_map<size_t, size_t> m_map;
+};
+
+template<typename TContainer>
+class TestCase_ConcurrentMapPerfromance
+{
+public:
+
+	static void RunTests()
+	{
+		printf("%s\n", typeid(TContainer).name());
+
+		const uint32_t maxThreads = max(2u, std::thread::hardware_concurrency());
+
+		// Read heavy, mixed and write heavy workloads
+		bool bSanityCheck = true;
+		for (const uint32_t readsPercent : { 95u, 50u, 10u })
+		{
+			for (uint32_t numThreads = 1; numThreads <= maxThreads; numThreads *= 2)
+			{
+				size_t numCorruptedReads = 0;
+				SAILOR_LOG("Performance test %u%% reads, %u threads: %zums", readsPercent, numThreads, PerformanceTest(numThreads, readsPercent, numCorruptedReads));
+
+				bSanityCheck &= numCorruptedReads == 0;
+			}
+		}
+
+		SAILOR_LOG("Sanity check passed: %d", bSanityCheck);
+
+		printf("\n");
+	}
+
+	static bool ReadValue(const SharedMutexMap& container, size_t key, size_t& outValue) { return container.Find(key, outValue); }
+
+	// The iterator keeps the element alive while the writers remove it
+	template<typename TMapType>
+	static bool ReadValue(const TMapType& container, size_t key, size_t& outValue)
+	{
+		auto it = container.Find(key);
+		if (it != container.end())
+		{
+			outValue = (*it).m_second;
+			return true;
+		}
+		return false;
+	}
+
+	static size_t PerformanceTest(uint32_t numThreads, uint32_t readsPercent, size_t& outNumCorruptedReads)
+	{
+		const size_t keysRange = 1 << 16;
+		const size_t opsPerThread = 1 << 20;
+
+		TContainer container;
+		for (size_t i = 0; i < keysRange; i += 2)
+		{
+			container.Insert(i, i);
+		}
+
+		std::atomic<size_t> hits = 0;
+		std::atomic<size_t> corruptedReads = 0;
+		std::vector<std::thread> threads;
+
+		Timer timer;
+		timer.Start();
+
+		for (uint32_t i = 0; i < numThreads; i++)
+		{
+			threads.emplace_back([&, i]()
+				{
+					std::mt19937 g(i);
+					size_t localHits = 0;
+					size_t localCorruptedReads = 0;
+
+					for (size_t j = 0; j < opsPerThread; j++)
+					{
+						const size_t key = g() % keysRange;
+						const uint32_t op = g() % 100;
+
+						if (op < readsPercent)
+						{
+							// The value is always the key, so the freed node is likely to be noticed
+							size_t value = 0;
+							if (op % 2)
+							{
+								localHits += container.ContainsKey(key) ? 1 : 0;
+							}
+							else if (ReadValue(container, key, value))
+							{
+								localHits++;
+								localCorruptedReads += value != key ? 1 : 0;
+							}
+						}
+						else if (op % 2)
+						{
+							container.Insert(key, key);
+						}
+						else
+						{
+							container.Remove(key);
+						}
+					}
+
+					hits += localHits;
+					corruptedReads += localCorruptedReads;
+				});
+		}
+
+		for (auto& thread : threads)
+		{
+			thread.join();
+		}
+
+		timer.Stop();
+
+		outNumCorruptedReads = corruptedReads;
+
+		return timer.ResultMs();
+	}
+};
+
 void Sailor::RunMapBenchmark()
 {
 	printf("\nStarting Map benchmark...\n");
 
 	TestCase_MapPerfromance<Sailor::TMap<size_t, std::string>>::RunTests();
+	TestCase_MapPerfromance<Sailor::TChainedMap<size_t, std::string>>::RunTests();
 	TestCase_MapPerfromance<TConcurrentMap<size_t, std::string>>::RunTests();
+
+	printf("\nStarting concurrent Map benchmark...\n");
+
+	TestCase_ConcurrentMapPerfromance<SharedMutexMap>::RunTests();
+	TestCase_ConcurrentMapPerfromance<TConcurrentMap<size_t, size_t>>::RunTests();
 }
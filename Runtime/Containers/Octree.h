@@ -116,7 +116,7 @@ namespace Sailor
 			m_root = nullptr;
 		}
 
-		TOctree(const TOctree& octree) : TOctree(octree.m_center, octree.m_root->m_size, octree.m_minSize)
+		TOctree(const TOctree& octree) : TOctree(octree.m_root->m_center, octree.m_root->m_size, octree.m_minSize)
 		{
 			m_num = octree.m_num;
 			CopyFrom_Internal(*m_root, *octree.m_root);
@@ -124,6 +124,11 @@ namespace Sailor
 
 		TOctree& operator= (const TOctree& octree)
 		{
+			if (this == &octree)
+			{
+				return *this;
+			}
+
 			Clear();
 
 			m_num = octree.m_num;
@@ -198,14 +203,16 @@ namespace Sailor
 					Resolve_Internal(**node);
 				}
 
+				// The element is moved, so the number of elements is the same
 				if (Insert_Internal(*m_root, pos, extents, element))
 				{
-					m_num++;
 					return true;
 				}
 
 				// Cannot insert the element into octree
 				m_map.Remove(element);
+				m_num--;
+				return false;
 			}
 
 			if (Insert_Internal(*m_root, pos, extents, element))
@@ -234,6 +241,38 @@ namespace Sailor
 			return false;
 		}
 
+		// The elements are compared by the predicate, since the octree finds them by operator==
+		template<typename TPredicate>
+		bool IsEqual(const TOctree& rhs, TPredicate isElementEqual) const
+		{
+			if (m_num != rhs.m_num || m_map.Num() != rhs.m_map.Num())
+			{
+				return false;
+			}
+
+			for (const auto& el : m_map)
+			{
+				TNode* const* ppRhsNode = nullptr;
+				if (!rhs.m_map.Find(el.m_first, ppRhsNode))
+				{
+					return false;
+				}
+
+				const auto lhsIt = (*el.m_second)->m_elements.Find(el.m_first);
+				const auto rhsIt = (*ppRhsNode)->m_elements.Find(el.m_first);
+
+				if (lhsIt == (*el.m_second)->m_elements.end() || rhsIt == (*ppRhsNode)->m_elements.end() ||
+					lhsIt.Value().m_position != rhsIt.Value().m_position ||
+					lhsIt.Value().m_extents != rhsIt.Value().m_extents ||
+					!isElementEqual(lhsIt.Key(), rhsIt.Key()))
+				{
+					return false;
+				}
+			}
+
+			return true;
+		}
+
 		__forceinline void Resolve() { Resolve_Internal(*m_root); }
 		__forceinline void DrawOctree(RHI::DebugContext& context, float duration = 0.0f) const { DrawOctree_Internal(*m_root, context, duration); }
 		__forceinline void Trace(const Math::Frustum& frustum, TVector<TElementType>& outElements) const
@@ -373,6 +412,11 @@ namespace Sailor
 			node.m_center = rhsNode.m_center;
 			node.m_elements = rhsNode.m_elements;
 
+			for (const auto& el : node.m_elements)
+			{
+				m_map[el.m_first] = &node;
+			}
+
 			if (rhsNode.m_internal != nullptr)
 			{
 				Subdivide(node);
@@ -1,5 +1,7 @@
 #include "Containers/Octree.h"
 #include "Containers/Octree2.h"
+#include "Containers/OctreeSnapshots.h"
+#include "RHI/SceneView.h"
 #include "Core/Utils.h"
 #include <random>
 
@@ -92,6 +94,196 @@ public:
 	}
 };
 
+namespace
+{
+	// The frames that hold the snapshots, Renderer::MaxFramesInQueue + 1
+	const uint32_t NumFramesInFlight = 3;
+
+	// Each 4th change removes the element, the removed element is added back by the next change that picks it
+	const uint32_t RemovalsFraction = 4;
+
+	template<typename TProxy>
+	TProxy CreateProxy(size_t index, const glm::ivec3& position, const glm::ivec3& extents, size_t frame);
+
+	template<>
+	RHI::RHIMeshProxy CreateProxy<RHI::RHIMeshProxy>(size_t index, const glm::ivec3& position, const glm::ivec3& extents, size_t frame)
+	{
+		RHI::RHIMeshProxy proxy;
+		proxy.m_staticMeshEcs = index;
+		proxy.m_worldMatrix[3] = glm::vec4(glm::vec3(position), 1.0f);
+		return proxy;
+	}
+
+	// The meshes and the materials are empty since there are no RHI resources, the rest is filled as StaticMeshRendererECS does
+	template<>
+	RHI::RHISceneViewProxy CreateProxy<RHI::RHISceneViewProxy>(size_t index, const glm::ivec3& position, const glm::ivec3& extents, size_t frame)
+	{
+		RHI::RHISceneViewProxy proxy;
+		proxy.m_staticMeshEcs = index;
+		proxy.m_worldMatrix = glm::mat4(1.0f);
+		proxy.m_worldMatrix[3] = glm::vec4(glm::vec3(position), 1.0f);
+		proxy.m_worldAabb = Math::AABB(glm::vec3(position), glm::vec3(extents));
+		proxy.m_bCastShadows = index % 2 == 0;
+		proxy.m_frame = frame;
+		return proxy;
+	}
+
+	__forceinline bool IsSameProxy(const RHI::RHIMeshProxy& lhs, const RHI::RHIMeshProxy& rhs)
+	{
+		return lhs.m_staticMeshEcs == rhs.m_staticMeshEcs && lhs.m_worldMatrix == rhs.m_worldMatrix;
+	}
+
+	__forceinline bool IsSameProxy(const RHI::RHISceneViewProxy& lhs, const RHI::RHISceneViewProxy& rhs)
+	{
+		return lhs.m_staticMeshEcs == rhs.m_staticMeshEcs &&
+			lhs.m_worldMatrix == rhs.m_worldMatrix &&
+			lhs.m_worldAabb.m_min == rhs.m_worldAabb.m_min &&
+			lhs.m_worldAabb.m_max == rhs.m_worldAabb.m_max &&
+			lhs.m_bCastShadows == rhs.m_bCastShadows &&
+			lhs.m_frame == rhs.m_frame &&
+			lhs.m_meshes.Num() == rhs.m_meshes.Num() &&
+			lhs.m_overrideMaterials.Num() == rhs.m_overrideMaterials.Num();
+	}
+
+	// The proxies of StaticMeshRendererECS: RHIMeshProxy for the stationary octree and RHISceneViewProxy for the static one
+	template<typename TProxy>
+	class TestCase_OctreeSnapshots
+	{
+	public:
+
+		using TOctreePtr = typename TOctreeSnapshots<TProxy>::TOctreePtr;
+
+		TestCase_OctreeSnapshots(uint32_t count) : m_snapshots(glm::ivec3(0, 0, 0), 16536 * 16, 4)
+		{
+			std::mt19937 random(count);
+			std::uniform_int_distribution<int32_t> position(-50000, 50000);
+			std::uniform_int_distribution<int32_t> extents(1, 100);
+
+			m_positions.Resize(count);
+			m_extents.Resize(count);
+			m_bIsRemoved.Resize(count);
+
+			for (uint32_t i = 0; i < count; i++)
+			{
+				m_positions[i] = glm::ivec3(position(random), position(random), position(random));
+				m_extents[i] = glm::ivec3(extents(random), extents(random), extents(random));
+				m_bIsRemoved[i] = false;
+
+				m_snapshots.Update(m_positions[i], m_extents[i], CreateProxy<TProxy>(i, m_positions[i], m_extents[i], 0));
+			}
+		}
+
+		// The snapshot is compared with the copy that is made at the same frame, while the frame holds it
+		void Run(uint32_t numFrames, float changingRatio, float& outCopyMs, float& outSnapshotMs, bool& bOutMatches)
+		{
+			std::mt19937 random((uint32_t)(changingRatio * 1000.0f));
+			std::uniform_int_distribution<size_t> index(0, m_positions.Num() - 1);
+			std::uniform_int_distribution<int32_t> shift(-200, 200);
+
+			const size_t numChanging = (size_t)(changingRatio * m_positions.Num());
+
+			TVector<TOctreePtr> snapshots;
+			TVector<TOctreePtr> copies;
+
+			int64_t copyMicro = 0;
+			int64_t snapshotMicro = 0;
+			bOutMatches = true;
+
+			for (uint32_t frame = 0; frame < numFrames; frame++)
+			{
+				for (size_t i = 0; i < numChanging; i++)
+				{
+					const size_t k = index(random);
+
+					if (!m_bIsRemoved[k] && i % RemovalsFraction == 0)
+					{
+						m_snapshots.Remove(CreateProxy<TProxy>(k, m_positions[k], m_extents[k], m_frame));
+						m_bIsRemoved[k] = true;
+						continue;
+					}
+
+					m_positions[k] += glm::ivec3(shift(random), shift(random), shift(random));
+					m_bIsRemoved[k] = false;
+
+					m_snapshots.Update(m_positions[k], m_extents[k], CreateProxy<TProxy>(k, m_positions[k], m_extents[k], m_frame));
+				}
+
+				// That is what CopySceneView did before
+				int64_t start = Utils::GetCurrentTimeMicro();
+				TOctreePtr copy = TOctreePtr::Make(glm::ivec3(0, 0, 0), 16536 * 16, 4);
+				*copy = m_snapshots.GetOctree();
+				copyMicro += Utils::GetCurrentTimeMicro() - start;
+
+				start = Utils::GetCurrentTimeMicro();
+				TOctreePtr snapshot = m_snapshots.GetSnapshot();
+				snapshotMicro += Utils::GetCurrentTimeMicro() - start;
+
+				if (snapshots.Num() == NumFramesInFlight)
+				{
+					snapshots.RemoveAt(0);
+					copies.RemoveAt(0);
+				}
+
+				snapshots.Add(std::move(snapshot));
+				copies.Add(std::move(copy));
+
+				for (size_t i = 0; i < snapshots.Num(); i++)
+				{
+					bOutMatches &= snapshots[i]->IsEqual(*copies[i], [](const TProxy& lhs, const TProxy& rhs) { return IsSameProxy(lhs, rhs); });
+				}
+
+				m_frame++;
+			}
+
+			outCopyMs = (float)copyMicro / (1000.0f * numFrames);
+			outSnapshotMs = (float)snapshotMicro / (1000.0f * numFrames);
+		}
+
+		size_t GetNumCopies() const { return m_snapshots.GetNumCopies(); }
+		size_t GetNum() const { return m_snapshots.GetOctree().Num(); }
+
+	protected:
+
+		TOctreeSnapshots<TProxy> m_snapshots;
+		TVector<glm::ivec3> m_positions;
+		TVector<glm::ivec3> m_extents;
+		TVector<bool> m_bIsRemoved;
+		size_t m_frame = 1;
+	};
+
+	template<typename TProxy>
+	void RunOctreeSnapshotsTestCase(const char* proxyName, uint32_t numFrames)
+	{
+		for (const uint32_t count : { 10000u, 100000u })
+		{
+			TestCase_OctreeSnapshots<TProxy> testCase(count);
+
+			for (const float changingRatio : { 0.0f, 0.01f, 0.1f })
+			{
+				float copyMs = 0.0f;
+				float snapshotMs = 0.0f;
+				bool bMatches = false;
+
+				testCase.Run(numFrames, changingRatio, copyMs, snapshotMs, bMatches);
+
+				SAILOR_LOG("%s: %u proxies (%zu in the octree), %.0f%% changing per frame: copy %.3fms, snapshot %.3fms per frame, speedup %.1f, %u frames in flight use %zu copies, matches %d",
+					proxyName, count, testCase.GetNum(), changingRatio * 100.0f, copyMs, snapshotMs, snapshotMs > 0.0f ? copyMs / snapshotMs : 0.0f,
+					NumFramesInFlight, testCase.GetNumCopies(), bMatches);
+			}
+		}
+	}
+}
+
+void Sailor::RunOctreeSnapshotsBenchmark()
+{
+	printf("\nStarting Octree snapshots benchmark...\n");
+
+	const uint32_t numFrames = 30;
+
+	RunOctreeSnapshotsTestCase<RHI::RHIMeshProxy>("RHIMeshProxy", numFrames);
+	RunOctreeSnapshotsTestCase<RHI::RHISceneViewProxy>("RHISceneViewProxy", numFrames);
+}
+
 void Sailor::RunOctreeBenchmark()
 {
 	printf("\nStarting Octree benchmark...\n");
@@ -0,0 +1,164 @@
+#pragma once
+#include "Core/Defines.h"
+#include "Memory/SharedPtr.hpp"
+#include "Containers/Vector.h"
+#include "Containers/Octree.h"
+
+namespace Sailor
+{
+	/* The read only copies of the octree for the other threads, i.e. the frames in flight.
+	*  The changes are recorded and replayed to the copy that is not used anymore, so only the changed elements are applied.
+	*  The copy is free when nobody holds it except the snapshots, the copy that lags too much is copied from the octree again.
+	*  Update, Remove and GetSnapshot are not thread safe and should be serialized externally,
+	*  i.e. StaticMeshRendererECS calls Update from its RHI thread tasks and waits for them before GetSnapshot is called.
+	*  The readers use only the snapshots that are obtained after that point, the snapshot itself is never changed.
+	*/
+	template<typename TElementType>
+	class TOctreeSnapshots
+	{
+	public:
+
+		using TOctreePtr = TSharedPtr<TOctree<TElementType>>;
+
+		TOctreeSnapshots(glm::ivec3 center = glm::ivec3(0, 0, 0), uint32_t size = 16536u, uint32_t minSize = 4) : m_octree(center, size, minSize) {}
+
+		TOctreeSnapshots(const TOctreeSnapshots&) = delete;
+		TOctreeSnapshots& operator=(const TOctreeSnapshots&) = delete;
+
+		bool Update(const glm::ivec3& pos, const glm::ivec3& extents, const TElementType& element)
+		{
+			AddChange(pos, extents, element, false);
+			return m_octree.Update(pos, extents, element);
+		}
+
+		bool Remove(const TElementType& element)
+		{
+			AddChange(glm::ivec3(0), glm::ivec3(0), element, true);
+			return m_octree.Remove(element);
+		}
+
+		// The copies that are held by the snapshots are released when they are not used anymore
+		void Clear()
+		{
+			m_octree.Clear();
+			m_changes.Clear();
+			m_copies.Clear();
+			m_baseVersion = 0;
+		}
+
+		const TOctree<TElementType>& GetOctree() const { return m_octree; }
+
+		// The number of the recorded changes
+		size_t GetVersion() const { return m_baseVersion + m_changes.Num(); }
+
+		size_t GetNumCopies() const { return m_copies.Num(); }
+		size_t GetNumChangesToReplay() const { return m_changes.Num(); }
+
+		// The returned octree is not changed until the caller releases it
+		TOctreePtr GetSnapshot()
+		{
+			SAILOR_PROFILE_FUNCTION();
+
+			const size_t version = GetVersion();
+
+			// The most recent free copy has the least changes to replay
+			Copy* pCopy = nullptr;
+			for (auto& copy : m_copies)
+			{
+				if (!copy.m_octree.IsShared() && (!pCopy || copy.m_version > pCopy->m_version))
+				{
+					pCopy = &copy;
+				}
+			}
+
+			if (!pCopy)
+			{
+				m_copies.Add(Copy{ TOctreePtr::Make(m_octree), version });
+				pCopy = &m_copies[m_copies.Num() - 1];
+			}
+			else if (pCopy->m_version < m_baseVersion || (version > pCopy->m_version && version - pCopy->m_version >= m_octree.Num()))
+			{
+				// The changes are trimmed or there are more changes than the elements
+				*pCopy->m_octree = m_octree;
+			}
+			else
+			{
+				for (size_t i = pCopy->m_version - m_baseVersion; i < m_changes.Num(); i++)
+				{
+					const Change& change = m_changes[i];
+
+					if (change.m_bIsRemoved)
+					{
+						pCopy->m_octree->Remove(change.m_element);
+					}
+					else
+					{
+						pCopy->m_octree->Update(change.m_position, change.m_extents, change.m_element);
+					}
+				}
+			}
+
+			pCopy->m_version = version;
+
+			TrimChanges(m_octree.Num());
+
+			return pCopy->m_octree;
+		}
+
+	protected:
+
+		struct Change
+		{
+			glm::ivec3 m_position{};
+			glm::ivec3 m_extents{};
+			TElementType m_element{};
+			bool m_bIsRemoved = false;
+		};
+
+		struct Copy
+		{
+			TOctreePtr m_octree{};
+			size_t m_version = 0;
+		};
+
+		void AddChange(const glm::ivec3& pos, const glm::ivec3& extents, const TElementType& element, bool bIsRemoved)
+		{
+			// The log is trimmed when nobody takes the snapshots
+			if (m_changes.Num() > 2 * m_octree.Num() + 1)
+			{
+				TrimChanges(m_octree.Num());
+			}
+
+			m_changes.Add(Change{ pos, extents, element, bIsRemoved });
+		}
+
+		// The changes are kept for the most lagging copy, but no more than maxChanges
+		void TrimChanges(size_t maxChanges)
+		{
+			const size_t version = GetVersion();
+
+			size_t minVersion = version;
+			for (const auto& copy : m_copies)
+			{
+				minVersion = std::min(minVersion, copy.m_version);
+			}
+
+			minVersion = std::max(minVersion, version - std::min(version, maxChanges));
+
+			if (minVersion > m_baseVersion)
+			{
+				m_changes.RemoveAt(0, minVersion - m_baseVersion);
+				m_baseVersion = minVersion;
+			}
+		}
+
+		TOctree<TElementType> m_octree;
+
+		TVector<Change> m_changes;
+		size_t m_baseVersion = 0;
+
+		TVector<Copy> m_copies;
+	};
+
+	SAILOR_API void RunOctreeSnapshotsBenchmark();
+}
@@ -12,162 +12,30 @@
 #include "Containers/List.h"
 #include "Core/LogMacros.h"
 #include "Containers/Hash.h"
+#include "Containers/HashTable.h"
 
 namespace Sailor
 {
-	template<typename TElementType, typename TAllocator = Memory::DefaultGlobalAllocator, const size_t ReservedElements = 12>
+	/* Open addressing hash set, the elements are stored inline.
+	*  Insert and Remove invalidate the iterators and the references to the elements.
+	*/
+	template<typename TElementType, typename TAllocator = Memory::DefaultGlobalAllocator>
 	class TSet
 	{
 	public:
 
-		using TElementContainer = TList<TElementType, Memory::TInlineAllocator<sizeof(TElementType) * ReservedElements, TAllocator>>;
+		using THashTable = Internal::THashTable<TElementType, TElementType, Internal::HashSetKey, TAllocator>;
+		using TIterator = typename THashTable::TIterator;
+		using TConstIterator = typename THashTable::TConstIterator;
 
-		class SAILOR_API TEntry
-		{
-		public:
-
-			TEntry(size_t hashCode) : m_hashCode(hashCode) {}
-			TEntry(TEntry&&) noexcept = default;
-			TEntry(const TEntry&) = default;
-			TEntry& operator=(TEntry&&) noexcept = default;
-			TEntry& operator=(const TEntry&) = default;
-
-			__forceinline explicit operator bool() const { return m_elements.Num() > 0; }
-			virtual ~TEntry() = default;
-
-			__forceinline TElementContainer& GetContainer() { return m_elements; }
-			__forceinline const TElementContainer& GetContainer() const { return m_elements; }
-
-			__forceinline bool operator==(const TEntry& Other) const
-			{
-				return this->Value == Other.Value;
-			}
-			__forceinline bool operator!=(const TEntry& Other) const
-			{
-				return this->Value != Other.Value;
-			}
-
-			__forceinline size_t GetHash() const { return m_hashCode; }
-			__forceinline size_t LikelyContains(size_t hashCode) const { return (m_bloom & hashCode) == hashCode; }
-
-			// Should we hide the data in internal class 
-			// that programmer has no access but it could be used by derived classes?
-			//protected:
-
-			size_t m_bloom = 0;
-			size_t m_hashCode = 0;
-			TElementContainer m_elements;
-
-			// That's unsafe but we handle that properly
-			TEntry* m_next = nullptr;
-			TEntry* m_prev = nullptr;
-
-			friend class TSet;
-		};
-
-		template<typename TDataType, typename TElementIterator>
-		class SAILOR_API TBaseIterator
-		{
-		public:
-
-			using iterator_category = std::bidirectional_iterator_tag;
-			using value_type = TDataType;
-			using difference_type = int64_t;
-			using pointer = TDataType*;
-			using reference = TDataType&;
-
-			TBaseIterator() : m_it(nullptr), m_currentBucket(nullptr) {}
-
-			TBaseIterator(const TBaseIterator&) = default;
-			TBaseIterator(TBaseIterator&&) = default;
-
-			~TBaseIterator() = default;
-
-			TBaseIterator(TEntry* bucket, TElementIterator it) : m_it(std::move(it)), m_currentBucket(bucket) {}
-
-			operator TBaseIterator<const TDataType, TElementIterator>() { return TBaseIterator<const TDataType, TElementIterator>(m_currentBucket, m_it); }
-
-			TBaseIterator& operator=(const TBaseIterator& rhs) = default;
-			TBaseIterator& operator=(TBaseIterator&& rhs) = default;
-
-			bool operator==(const TBaseIterator& rhs) const { return m_it == rhs.m_it; }
-			bool operator!=(const TBaseIterator& rhs) const { return m_it != rhs.m_it; }
-
-			pointer operator->() { return &*m_it; }
-			pointer operator->() const { return &*m_it; }
-
-			reference operator*() { return *m_it; }
-			reference operator*() const { return *m_it; }
-
-			TBaseIterator& operator++()
-			{
-				++m_it;
-
-				if (m_it == m_currentBucket->GetContainer().end())
-				{
-					if (m_currentBucket->m_next)
-					{
-						m_currentBucket = m_currentBucket->m_next;
-						m_it = m_currentBucket->GetContainer().begin();
-					}
-				}
-
-				return *this;
-			}
-
-			TBaseIterator& operator--()
-			{
-				if (m_it == m_currentBucket->GetContainer().begin())
-				{
-					if (m_currentBucket->m_prev)
-					{
-						m_currentBucket = m_currentBucket->m_prev;
-						m_it = m_currentBucket->GetContainer().Last();
-					}
-				}
-				else
-				{
-					--m_it;
-				}
-
-				return *this;
-			}
-
-		protected:
-
-			TEntry* m_currentBucket;
-			TElementIterator m_it;
-
-			friend class TEntry;
-		};
-
-		using TIterator = TBaseIterator<TElementType, typename TElementContainer::TIterator>;
-		using TConstIterator = TBaseIterator<const TElementType, typename TElementContainer::TConstIterator>;
-		using TEntryPtr = TUniquePtr<TEntry>;
-		using TBucketContainer = TVector<TEntryPtr, TAllocator>;
-
-		TSet(const uint32_t desiredNumBuckets = 8) { m_buckets.Resize(desiredNumBuckets); }
-		TSet(TSet&&) = default;
-		TSet(const TSet& rhs) requires IsCopyConstructible<TElementType> : TSet((uint32_t)rhs.m_buckets.Num())
-		{
-			for (const auto& el : rhs)
-			{
-				Insert(el);
-			}
-		}
+		TSet(const uint32_t desiredNumElements = 0) : m_table(desiredNumElements) {}
+		TSet(TSet&&) noexcept = default;
+		TSet(const TSet& rhs) requires IsCopyConstructible<TElementType> = default;
 
 		TSet& operator=(TSet&&) noexcept = default;
-		TSet& operator=(const TSet& rhs) requires IsCopyConstructible<TElementType>
-		{
-			Clear((uint32_t)rhs.m_buckets.Num());
-			for (const auto& el : rhs)
-			{
-				Insert(el);
-			}
-			return *this;
-		}
+		TSet& operator=(const TSet& rhs) requires IsCopyConstructible<TElementType> = default;
 
-		TSet(std::initializer_list<TElementType> initList)
+		TSet(std::initializer_list<TElementType> initList) : m_table(initList.size())
 		{
 			for (const auto& el : initList)
 			{
@@ -186,21 +54,14 @@ namespace Sailor
 			}
 		}
 
-		__forceinline bool IsEmpty() const { return m_num == 0; }
-		__forceinline size_t Num() const { return m_num; }
+		__forceinline bool IsEmpty() const { return m_table.Num() == 0; }
+		__forceinline size_t Num() const { return m_table.Num(); }
 
-		bool Contains(const TElementType& inElement) const
-		{
-			const auto& hash = Sailor::GetHash(inElement);
-			const size_t index = hash % m_buckets.Num();
-			auto& element = m_buckets[index];
-
-			if (element && element->LikelyContains(hash))
-			{
-				return element->GetContainer().Contains(inElement);
-			}
+		__forceinline void Reserve(size_t num) { m_table.Reserve(num); }
 
-			return false;
+		__forceinline bool Contains(const TElementType& inElement) const
+		{
+			return m_table.FindIndex(inElement) != THashTable::InvalidIndex;
 		}
 
 		TVector<TElementType> ToVector() const
@@ -218,49 +79,18 @@ namespace Sailor
 
 		void Insert(TElementType inElement)
 		{
-			if (ShouldRehash())
-			{
-				Rehash(m_buckets.Capacity() * 4);
-			}
-
-			const auto& hash = Sailor::GetHash(inElement);
-			const size_t index = hash % m_buckets.Num();
-			auto& element = m_buckets[index];
-
-			if (!element)
-			{
-				element = TEntryPtr::Make(hash);
-
-				if (!m_first)
-				{
-					m_last = m_first = element.GetRawPtr();
-				}
-				else
-				{
-					m_first->m_prev = element.GetRawPtr();
-					element->m_next = m_first;
-					m_first = element.GetRawPtr();
-				}
-			}
-
-			if (element->GetContainer().Contains(inElement))
-			{
-				return;
-			}
-
-			element->GetContainer().EmplaceBack(std::move(inElement));
-			element->m_bloom |= hash;
-
-			m_num++;
+			bool bInserted = false;
+			m_table.FindOrInsert(inElement, bInserted, [&](void* pSlot) { new (pSlot) TElementType(std::move(inElement)); });
 		}
 
 		bool RemoveFirst(const TPredicate<TElementType>& predicate)
 		{
-			for (auto& el : *this)
+			for (auto it = begin(); it != end(); ++it)
 			{
-				if (predicate(el))
+				if (predicate(*it))
 				{
-					return Remove(el);
+					m_table.RemoveAt(it.GetIndex());
+					return true;
 				}
 			}
 			return false;
@@ -269,87 +99,30 @@ namespace Sailor
 		size_t RemoveAll(const TPredicate<TElementType>& predicate)
 		{
 			size_t num = 0;
-			TVector<TElementType> toRemove;
-			for (auto& el : *this)
+
+			// Removal doesn't move the elements, so we can iterate over the slots
+			for (auto it = begin(); it != end(); ++it)
 			{
-				if (predicate(el))
+				if (predicate(*it))
 				{
-					toRemove.Add(el);
+					m_table.RemoveAt(it.GetIndex());
 					num++;
 				}
 			}
 
-			for (auto& el : toRemove)
-			{
-				Remove(el);
-			}
-
 			return num;
 		}
 
-		bool Remove(const TElementType& inElement)
-		{
-			const auto& hash = Sailor::GetHash(inElement);
-			const size_t index = hash % m_buckets.Num();
-			auto& element = m_buckets[index];
-
-			if (element)
-			{
-				auto& container = element->GetContainer();
-				if (container.RemoveFirst(inElement))
-				{
-					if (container.Num() == 0)
-					{
-						if (element.GetRawPtr() == m_last)
-						{
-							m_last = element->m_prev;
-						}
-
-						if (element->m_next)
-						{
-							element->m_next->m_prev = element->m_prev;
-						}
-
-						if (element->m_prev)
-						{
-							element->m_prev->m_next = element->m_next;
-						}
-
-						if (m_last == element.GetRawPtr())
-						{
-							m_last = m_last->m_prev;
-						}
-
-						if (m_first == element.GetRawPtr())
-						{
-							m_first = m_first->m_next;
-						}
-
-						element.Clear();
-					}
-
-					m_num--;
-					return true;
-				}
-				return false;
-			}
-			return false;
-		}
+		__forceinline bool Remove(const TElementType& inElement) { return m_table.Remove(inElement); }
 
-		void Clear(uint32_t desiredBucketsNum = 8)
-		{
-			m_num = 0;
-			m_first = m_last = nullptr;
-			m_buckets.Clear();
-			m_buckets.Resize(desiredBucketsNum);
-		}
+		void Clear(uint32_t desiredNumElements = 8) { m_table.Clear(desiredNumElements); }
 
 		// Support ranged for
-		TIterator begin() { return TIterator(m_first, m_first ? m_first->GetContainer().begin() : nullptr); }
-		TIterator end() { return TIterator(m_last, nullptr); }
+		TIterator begin() { return m_table.begin(); }
+		TIterator end() { return m_table.end(); }
 
-		TConstIterator begin() const { return TConstIterator(m_first, m_first ? m_first->GetContainer().begin() : nullptr); }
-		TConstIterator end() const { return TConstIterator(m_last, nullptr); }
+		TConstIterator begin() const { return m_table.begin(); }
+		TConstIterator end() const { return m_table.end(); }
 
 		bool operator==(const TSet& rhs) const
 		{
@@ -366,70 +139,12 @@ namespace Sailor
 				}
 			}
 
-			for (auto& el : *this)
-			{
-				if (!rhs.Contains(el))
-				{
-					return false;
-				}
-			}
-
 			return true;
 		}
 
 	protected:
 
-		__forceinline bool ShouldRehash() const
-		{
-			// We assume that each bucket has ~ReservedElements elements inside
-			// TODO: Rethink the approach
-			return (size_t)m_num > (m_buckets.Num() * 4);
-		}
-
-		void Rehash(size_t desiredBucketsNum)
-		{
-			if (desiredBucketsNum <= m_buckets.Num())
-			{
-				return;
-			}
-
-			TVector<TEntryPtr, TAllocator> buckets(desiredBucketsNum);
-			TVector<TEntryPtr, TAllocator>::Swap(buckets, m_buckets);
-
-			TEntry* current = m_first;
-
-			m_num = 0;
-			m_first = nullptr;
-			m_last = nullptr;
-
-			while (current)
-			{
-				const size_t oldIndex = current->GetHash() % m_buckets.Num();
-
-				for (auto& el : current->GetContainer())
-				{
-					if constexpr (IsMoveConstructible<TElementType>)
-					{
-						Insert(std::move(el));
-					}
-					else
-					{
-						Insert(el);
-					}
-				}
-
-				current = current->m_next;
-			}
-
-			buckets.Clear();
-		}
-
-		TBucketContainer m_buckets{};
-		size_t m_num = 0;
-
-		// That's unsafe but we handle that properly
-		TEntry* m_first = nullptr;
-		TEntry* m_last = nullptr;
+		THashTable m_table{};
 	};
 
 	SAILOR_API void RunSetBenchmark();
@@ -438,11 +153,11 @@ namespace Sailor
 namespace std
 {
 	template<typename TKeyType, typename TValueType>
-	struct std::hash<Sailor::TPair<TKeyType, TValueType>>
+	struct hash<Sailor::TPair<TKeyType, TValueType>>
 	{
 		SAILOR_API std::size_t operator()(const Sailor::TPair<TKeyType, TValueType>& p) const
 		{
 			return Sailor::GetHash(p.First());
 		}
 	};
-}
\ No newline at end of file
+}
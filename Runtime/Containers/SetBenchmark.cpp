@@ -1,5 +1,6 @@
 #include <unordered_set>
 #include "Containers/Set.h"
+#include "Containers/ChainedSet.h"
 #include "Containers/ConcurrentSet.h"
 #include "Core/Utils.h"
 #include <random>
@@ -186,6 +187,9 @@ void Sailor::RunSetBenchmark()
 	printf("\nStarting set benchmark...\n");
 	TestCase_SetPerfromance<Sailor::TSet<size_t>>::RunTests();
 
+	printf("\nStarting chained set benchmark...\n");
+	TestCase_SetPerfromance<Sailor::TChainedSet<size_t>>::RunTests();
+
 	printf("\nStarting concurrent set benchmark...\n");
 	TestCase_SetPerfromance<Sailor::TConcurrentSet<size_t>>::RunTests();
 }
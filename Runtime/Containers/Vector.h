@@ -6,6 +6,7 @@
 #include <type_traits>
 #include <iterator>
 #include <algorithm>
+#include <cstring>
 #include "Core/Defines.h"
 #include "Math/Math.h"
 #include "Containers/Concepts.h"
@@ -86,12 +87,12 @@ namespace Sailor
 			return (difference_type)(m_element - other.m_element);
 		}
 
-		static friend TVectorIterator<TDataType> operator-(const difference_type& offset, TVectorIterator<TDataType>& other)
+		friend TVectorIterator<TDataType> operator-(const difference_type& offset, TVectorIterator<TDataType>& other)
 		{
 			return other - offset;
 		}
 
-		static friend TVectorIterator<TDataType> operator+(const difference_type& offset, TVectorIterator<TDataType>& other)
+		friend TVectorIterator<TDataType> operator+(const difference_type& offset, TVectorIterator<TDataType>& other)
 		{
 			return other + offset;
 		}
@@ -148,7 +149,7 @@ namespace Sailor
 			ConstructElements(0, rawPtr[0], count);
 		}
 
-		TVector(TElementType* rawPtr, size_t count) requires IsMoveConstructible<TElementType> && !IsCopyConstructible<TElementType>
+		TVector(TElementType* rawPtr, size_t count) requires (IsMoveConstructible<TElementType> && !IsCopyConstructible<TElementType>)
 		{
 			ResizeIfNeeded(count);
 
@@ -337,7 +338,7 @@ namespace Sailor
 
 		size_t FindLast(const TElementType& item) const
 		{
-			for (int32 i = m_arrayNum - 1; i >= 0; i--)
+			for (int32_t i = (int32_t)m_arrayNum - 1; i >= 0; i--)
 			{
 				if (m_pRawPtr[i] == item)
 				{
@@ -712,7 +713,7 @@ namespace Sailor
 			}
 		}
 
-		__forceinline void DestructElements(size_t index, size_t count = 1) requires !IsTriviallyDestructible<TElementType>
+		__forceinline void DestructElements(size_t index, size_t count = 1) requires (!IsTriviallyDestructible<TElementType>)
 		{
 			for (size_t i = 0; i < count; i++)
 			{
@@ -777,6 +778,7 @@ namespace Sailor
 			}
 		}
 
+		template<typename, typename>
 		friend class TVector;
 	};
 
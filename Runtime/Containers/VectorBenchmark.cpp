@@ -1,10 +1,9 @@
-#include "Memory.h"
 #include <cstdlib>
 #include <vector>
 #include <cassert>
 #include <cctype>
 #include "Core/Utils.h"
-#include "Vector.h"
+#include "Containers/Vector.h"
 #include "Memory/Memory.h"
 #include "Tasks/Tasks.h"
 #include "Tasks/Scheduler.h"
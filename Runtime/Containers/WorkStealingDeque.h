@@ -0,0 +1,171 @@
+#pragma once
+#include <cassert>
+#include <atomic>
+#include <memory>
+#include <type_traits>
+#include "Core/Defines.h"
+#include "Containers/Concepts.h"
+#include "Containers/Vector.h"
+#include "Memory/MallocAllocator.hpp"
+
+namespace Sailor
+{
+	/* Chase-Lev work stealing deque (Le, Pop, Cohen, Nardelli 'Correct and Efficient Work-Stealing for Weak Memory Models').
+	*  Only the owner thread is allowed to call Push/Pop, that works with the bottom of the deque in LIFO order.
+	*  Any other thread could call Steal, that takes the elements from the top of the deque in FIFO order.
+	*  The elements should be trivially copyable (raw pointers, handles) since the thieves read the slots speculatively.
+	*/
+	template<typename TElementType, typename TAllocator = Memory::MallocAllocator>
+	class TWorkStealingDeque final
+	{
+		static_assert(IsTriviallyCopyable<TElementType>, "TWorkStealingDeque supports only trivially copyable elements");
+
+		class TBuffer
+		{
+		public:
+
+			TBuffer(int64_t capacity) : m_capacity(capacity), m_mask(capacity - 1)
+			{
+				m_pElements = static_cast<std::atomic<TElementType>*>(TAllocator::allocate(sizeof(std::atomic<TElementType>) * capacity, alignof(std::atomic<TElementType>)));
+				for (int64_t i = 0; i < capacity; i++)
+				{
+					new (&m_pElements[i]) std::atomic<TElementType>();
+				}
+			}
+
+			~TBuffer() { TAllocator::free(m_pElements); }
+
+			__forceinline int64_t Capacity() const { return m_capacity; }
+
+			__forceinline void Put(int64_t index, TElementType element) { m_pElements[index & m_mask].store(element, std::memory_order_relaxed); }
+			__forceinline TElementType Get(int64_t index) const { return m_pElements[index & m_mask].load(std::memory_order_relaxed); }
+
+			TBuffer* Grow(int64_t bottom, int64_t top) const
+			{
+				TBuffer* pRes = new TBuffer(m_capacity * 2);
+				for (int64_t i = top; i != bottom; i++)
+				{
+					pRes->Put(i, Get(i));
+				}
+				return pRes;
+			}
+
+		protected:
+
+			int64_t m_capacity;
+			int64_t m_mask;
+			std::atomic<TElementType>* m_pElements;
+		};
+
+	public:
+
+		SAILOR_API TWorkStealingDeque(int64_t capacity = 1024)
+		{
+			check(capacity > 0 && (capacity & (capacity - 1)) == 0);
+			m_pBuffer.store(new TBuffer(capacity), std::memory_order_relaxed);
+		}
+
+		SAILOR_API ~TWorkStealingDeque()
+		{
+			for (auto& pBuffer : m_retiredBuffers)
+			{
+				delete pBuffer;
+			}
+
+			delete m_pBuffer.load(std::memory_order_relaxed);
+		}
+
+		TWorkStealingDeque(const TWorkStealingDeque&) = delete;
+		TWorkStealingDeque(TWorkStealingDeque&&) = delete;
+		TWorkStealingDeque& operator=(const TWorkStealingDeque&) = delete;
+		TWorkStealingDeque& operator=(TWorkStealingDeque&&) = delete;
+
+		// Approximated, the value could be outdated immediately
+		SAILOR_API __forceinline size_t Num() const
+		{
+			const int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+			const int64_t top = m_top.load(std::memory_order_relaxed);
+			return bottom > top ? (size_t)(bottom - top) : 0;
+		}
+
+		SAILOR_API __forceinline bool IsEmpty() const { return Num() == 0; }
+
+		// Owner thread only
+		SAILOR_API void Push(TElementType element)
+		{
+			const int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+			const int64_t top = m_top.load(std::memory_order_acquire);
+			TBuffer* pBuffer = m_pBuffer.load(std::memory_order_relaxed);
+
+			if (bottom - top > pBuffer->Capacity() - 1)
+			{
+				// Thieves could still read the old buffer, so we keep it alive till the destruction of the deque
+				m_retiredBuffers.Add(pBuffer);
+				pBuffer = pBuffer->Grow(bottom, top);
+				m_pBuffer.store(pBuffer, std::memory_order_release);
+			}
+
+			pBuffer->Put(bottom, element);
+			std::atomic_thread_fence(std::memory_order_release);
+			m_bottom.store(bottom + 1, std::memory_order_relaxed);
+		}
+
+		// Owner thread only
+		SAILOR_API bool Pop(TElementType& outElement)
+		{
+			const int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+			TBuffer* pBuffer = m_pBuffer.load(std::memory_order_relaxed);
+			m_bottom.store(bottom, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			int64_t top = m_top.load(std::memory_order_relaxed);
+
+			if (top > bottom)
+			{
+				// The deque is empty
+				m_bottom.store(bottom + 1, std::memory_order_relaxed);
+				return false;
+			}
+
+			outElement = pBuffer->Get(bottom);
+			if (top == bottom)
+			{
+				// The last element, we're racing with the thieves
+				const bool bWon = m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+				m_bottom.store(bottom + 1, std::memory_order_relaxed);
+				return bWon;
+			}
+
+			return true;
+		}
+
+		// Any thread
+		SAILOR_API bool Steal(TElementType& outElement)
+		{
+			int64_t top = m_top.load(std::memory_order_acquire);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			const int64_t bottom = m_bottom.load(std::memory_order_acquire);
+
+			if (top < bottom)
+			{
+				TBuffer* pBuffer = m_pBuffer.load(std::memory_order_acquire);
+				TElementType element = pBuffer->Get(top);
+
+				if (m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+				{
+					outElement = element;
+					return true;
+				}
+			}
+
+			return false;
+		}
+
+	protected:
+
+		alignas(64) std::atomic<int64_t> m_top = 0;
+		alignas(64) std::atomic<int64_t> m_bottom = 0;
+		alignas(64) std::atomic<TBuffer*> m_pBuffer = nullptr;
+
+		TVector<TBuffer*, Memory::MallocAllocator> m_retiredBuffers;
+	};
+}
@@ -2,10 +2,15 @@
 
 struct IUnknown; // Workaround for "combaseapi.h(229): error C2187: syntax error: 'identifier' was unexpected here" when using /permissive-
 
-#ifndef _SAILOR_IMPORT_
-# define SAILOR_API __declspec(dllexport)
+#if defined(_WIN32)
+# ifndef _SAILOR_IMPORT_
+#  define SAILOR_API __declspec(dllexport)
+# else
+#  define SAILOR_API __declspec(dllimport)
+# endif
 #else
-# define SAILOR_API __declspec(dllimport)
+# define SAILOR_API __attribute__((visibility("default")))
+# define __forceinline inline __attribute__((always_inline))
 #endif
 
 #include <cassert>
@@ -46,6 +51,7 @@ typedef unsigned long DWORD;
 #define MAGIC_ENUM_RANGE_MAX 256
 #include "magic_enum/include/magic_enum.hpp"
 
+#if defined(_WIN32)
 #ifndef min
 #define min(a,b) ((a) < (b) ? (a) : (b))
 #endif
@@ -53,6 +59,14 @@ typedef unsigned long DWORD;
 #ifndef max
 #define max(a,b) ((a) > (b) ? (a) : (b))
 #endif
+#else
+// The macros would break the standard library headers that are included after them
+template<typename T1, typename T2>
+constexpr auto min(const T1& a, const T2& b) { return (a) < (b) ? (a) : (b); }
+
+template<typename T1, typename T2>
+constexpr auto max(const T1& a, const T2& b) { return (a) > (b) ? (a) : (b); }
+#endif
 
 #define checkAtCompileTime(expr, msg) static_assert(expr, #msg);
 #define check(expr) assert(expr);
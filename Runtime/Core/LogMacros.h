@@ -1,6 +1,8 @@
 #pragma once
 #include <string>
 #include <iostream>
+
+#if defined(_WIN32)
 #include <windows.h>
 
 #define SAILOR_LOG(Format, ...) \
@@ -61,4 +63,60 @@
 		std::cerr /*<< "Main thread: " */ << (buffer) << std::endl; \
 		SetConsoleTextAttribute(hConsole, 7); \
 	} \
-}
\ No newline at end of file
+}
+#else
+#include <cstdio>
+
+#define SAILOR_LOG(Format, ...) \
+{ \
+	char buffer[4096]; \
+	snprintf(buffer, sizeof(buffer), Format __VA_OPT__(,) __VA_ARGS__); \
+	auto scheduler = App::GetSubmodule<Tasks::Scheduler>(); \
+	if (scheduler && !scheduler->IsMainThread()) \
+	{ \
+		const bool bIsRendererThread = scheduler->IsRendererThread(); \
+		Tasks::CreateTask("Log", [=]() \
+		{ \
+			if(!bIsRendererThread) \
+			{ \
+				std::cout << (buffer) << std::endl; \
+			} \
+			else \
+			{ \
+				std::cout << "Renderer thread: " << (buffer) << std::endl; \
+			} \
+		}, Tasks::EThreadType::Main)->Run(); \
+	} \
+	else \
+	{ \
+		std::cout << (buffer) << std::endl; \
+	} \
+}
+
+// The console colors are set by ANSI escape codes
+#define SAILOR_LOG_ERROR(Format, ...) \
+{ \
+	char buffer[4096]; \
+	snprintf(buffer, sizeof(buffer), Format __VA_OPT__(,) __VA_ARGS__); \
+	auto scheduler = App::GetSubmodule<Tasks::Scheduler>(); \
+	if (scheduler && !scheduler->IsMainThread()) \
+	{ \
+		const bool bIsRendererThread = scheduler->IsRendererThread(); \
+		Tasks::CreateTask("LogError", [=]() \
+		{ \
+			if(!bIsRendererThread) \
+			{ \
+				std::cerr << "\033[31m" << (buffer) << "\033[0m" << std::endl; \
+			} \
+			else \
+			{ \
+				std::cerr << "\033[31m" << "Renderer thread: " << (buffer) << "\033[0m" << std::endl; \
+			} \
+		}, Tasks::EThreadType::Main)->Run(); \
+	} \
+	else \
+	{ \
+		std::cerr << "\033[31m" << (buffer) << "\033[0m" << std::endl; \
+	} \
+}
+#endif
@@ -41,7 +41,14 @@ void Reflection::RegisterType(const std::string& typeName, const TypeInfo* pType
 
 	auto& type = Internal::g_pReflectionTypes->At_Lock(typeName);
 	type = pType;
-	Internal::g_pPlacementFactoryMethods->Unlock(typeName);
+	Internal::g_pReflectionTypes->Unlock(typeName);
+}
+
+bool Reflection::IsTypeRegistered(const std::string& typeName)
+{
+	// The object of the type could be created only if its factory method is registered too
+	return Internal::g_pReflectionTypes && Internal::g_pReflectionTypes->ContainsKey(typeName) &&
+		Internal::g_pPlacementFactoryMethods && Internal::g_pPlacementFactoryMethods->ContainsKey(typeName);
 }
 
 const TypeInfo& Reflection::GetTypeByName(const std::string& typeName)
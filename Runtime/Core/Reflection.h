@@ -135,9 +135,17 @@ namespace Sailor
 		virtual YAML::Node Serialize() const;
 		virtual void Deserialize(const YAML::Node& inData);
 
+		bool IsValid() const { return m_typeInfo != nullptr; }
 		const TypeInfo& GetTypeInfo() const { return *m_typeInfo; }
 		const TMap<std::string, YAML::Node>& GetProperties() const { return m_properties; }
 
+		// The assignment of YAML::Node rebinds the node that could be shared with the copies of the reflection, so the property is replaced
+		void SetProperty(const std::string& name, YAML::Node value)
+		{
+			m_properties.Remove(name);
+			m_properties.Insert(name, value);
+		}
+
 	private:
 
 		// TODO: Rethink the approach with raw pointer
@@ -184,6 +192,8 @@ namespace Sailor
 			return pRes;
 		}
 
+		// The names that come from the loaded data should be checked before GetTypeByName
+		static bool IsTypeRegistered(const std::string& typeName);
 		static const TypeInfo& GetTypeByName(const std::string& typeName);
 
 		template<typename T>
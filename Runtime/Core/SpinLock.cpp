@@ -0,0 +1,82 @@
+#include "Core/SpinLock.h"
+#include "Core/LogMacros.h"
+#include "Containers/Vector.h"
+#include "Tasks/Scheduler.h"
+
+using namespace Sailor;
+
+namespace
+{
+	// The sites are function local statics, so they are never unregistered
+	std::atomic<SpinLockStats*> g_pSpinLockSites = nullptr;
+}
+
+SpinLockStats::SpinLockStats(const char* siteName) : m_siteName(siteName)
+{
+	SpinLockStats* pHead = g_pSpinLockSites.load(std::memory_order_relaxed);
+	do
+	{
+		m_pNext = pHead;
+	} while (!g_pSpinLockSites.compare_exchange_weak(pHead, this, std::memory_order_release, std::memory_order_relaxed));
+}
+
+void SpinLockStats::OnContendedAcquired(uint64_t spins, uint64_t waitNs) noexcept
+{
+	m_acquisitions.fetch_add(1, std::memory_order_relaxed);
+	m_contendedAcquisitions.fetch_add(1, std::memory_order_relaxed);
+	m_spins.fetch_add(spins, std::memory_order_relaxed);
+
+	uint64_t maxWaitNs = m_maxWaitNs.load(std::memory_order_relaxed);
+	while (waitNs > maxWaitNs && !m_maxWaitNs.compare_exchange_weak(maxWaitNs, waitNs, std::memory_order_relaxed));
+}
+
+void SpinLockStats::Reset() noexcept
+{
+	m_acquisitions = 0;
+	m_contendedAcquisitions = 0;
+	m_spins = 0;
+	m_maxWaitNs = 0;
+}
+
+void SpinLockStats::DumpAll()
+{
+#ifdef SAILOR_SPINLOCK_STATS
+	TVector<SpinLockStats*> sites;
+	for (SpinLockStats* pSite = g_pSpinLockSites.load(std::memory_order_acquire); pSite; pSite = pSite->m_pNext)
+	{
+		sites.Add(pSite);
+	}
+
+	sites.Sort([](const auto& lhs, const auto& rhs) { return lhs->GetSpins() > rhs->GetSpins(); });
+
+	SAILOR_LOG("SpinLock stats, %llu sites:", (uint64_t)sites.Num());
+	for (const SpinLockStats* pSite : sites)
+	{
+		const uint64_t acquisitions = pSite->GetAcquisitions();
+		const uint64_t contended = pSite->GetContendedAcquisitions();
+
+		SAILOR_LOG("\t%s: acquisitions %llu, contended %llu (%.2f%%), spins %llu, max wait %.3fus",
+			pSite->GetSiteName(),
+			acquisitions,
+			contended,
+			acquisitions ? 100.0 * (double)contended / (double)acquisitions : 0.0,
+			pSite->GetSpins(),
+			(double)pSite->GetMaxWaitNs() / 1000.0);
+	}
+#else
+	SAILOR_LOG("SpinLock stats are not collected, build with SAILOR_SPINLOCK_STATS");
+#endif
+}
+
+void SpinLockStats::ResetAll()
+{
+	for (SpinLockStats* pSite = g_pSpinLockSites.load(std::memory_order_acquire); pSite; pSite = pSite->m_pNext)
+	{
+		pSite->Reset();
+	}
+}
+
+void Sailor::DumpSpinLockStats()
+{
+	SpinLockStats::DumpAll();
+}
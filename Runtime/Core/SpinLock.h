@@ -2,18 +2,146 @@
 #include <cassert>
 #include <memory>
 #include <atomic>
+#include <thread>
+#include <chrono>
 #include "Core/Defines.h"
 
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SAILOR_CPU_PAUSE() _mm_pause()
+#elif defined(_M_ARM64)
+#include <intrin.h>
+#define SAILOR_CPU_PAUSE() __yield()
+#elif defined(__aarch64__) || defined(__arm__)
+#define SAILOR_CPU_PAUSE() __asm__ __volatile__("yield")
+#else
+#define SAILOR_CPU_PAUSE() std::atomic_signal_fence(std::memory_order_seq_cst)
+#endif
+
+/* The lock site is the static SpinLockStats that all the locks declared at the same place share,
+*  SpinLock m_lock{ SAILOR_SPINLOCK_SITE("MemoryPoolAllocator") };
+*  The statistics are compiled out without SAILOR_SPINLOCK_STATS and the site is just nullptr.
+*/
+#ifdef SAILOR_SPINLOCK_STATS
+#define SAILOR_SPINLOCK_SITE(Name) ([]() { static ::Sailor::SpinLockStats s_stats(Name); return &s_stats; }())
+#else
+#define SAILOR_SPINLOCK_SITE(Name) nullptr
+#endif
+
 namespace Sailor
 {
+	// Contention counters of the lock site, that are dumped by DumpAll
+	class SpinLockStats
+	{
+	public:
+
+		SAILOR_API SpinLockStats(const char* siteName);
+
+		SpinLockStats(SpinLockStats&&) = delete;
+		SpinLockStats(const SpinLockStats&) = delete;
+
+		SpinLockStats& operator=(SpinLockStats&&) = delete;
+		SpinLockStats& operator=(const SpinLockStats&) = delete;
+
+		__forceinline void OnAcquired() noexcept
+		{
+			m_acquisitions.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		SAILOR_API void OnContendedAcquired(uint64_t spins, uint64_t waitNs) noexcept;
+
+		const char* GetSiteName() const { return m_siteName; }
+
+		uint64_t GetAcquisitions() const { return m_acquisitions.load(std::memory_order_relaxed); }
+		uint64_t GetContendedAcquisitions() const { return m_contendedAcquisitions.load(std::memory_order_relaxed); }
+		uint64_t GetSpins() const { return m_spins.load(std::memory_order_relaxed); }
+		uint64_t GetMaxWaitNs() const { return m_maxWaitNs.load(std::memory_order_relaxed); }
+
+		SAILOR_API void Reset() noexcept;
+
+		// All the sites that have been touched so far, the most contended first
+		SAILOR_API static void DumpAll();
+		SAILOR_API static void ResetAll();
+
+	protected:
+
+		const char* m_siteName = nullptr;
+		SpinLockStats* m_pNext = nullptr;
+
+		std::atomic<uint64_t> m_acquisitions = 0;
+		std::atomic<uint64_t> m_contendedAcquisitions = 0;
+		std::atomic<uint64_t> m_spins = 0;
+		std::atomic<uint64_t> m_maxWaitNs = 0;
+	};
+
+	SAILOR_API void DumpSpinLockStats();
+	SAILOR_API void RunSpinLockBenchmark();
+
+	namespace Internal
+	{
+		/* Exponential backoff: the pause instruction frees the pipeline for the hyperthread sibling
+		*  and the number of pauses doubles each round, after that the thread yields its time slice.
+		*/
+		class SpinWait
+		{
+		public:
+
+			static constexpr uint32_t MaxPauses = 64;
+
+			__forceinline void Wait() noexcept
+			{
+				if (m_numPauses <= MaxPauses)
+				{
+					for (uint32_t i = 0; i < m_numPauses; i++)
+					{
+						SAILOR_CPU_PAUSE();
+					}
+					m_numPauses <<= 1;
+				}
+				else
+				{
+					std::this_thread::yield();
+				}
+
+				m_numSpins++;
+			}
+
+			__forceinline uint64_t GetNumSpins() const { return m_numSpins; }
+
+		protected:
+
+			uint32_t m_numPauses = 1;
+			uint64_t m_numSpins = 0;
+		};
+
+		__forceinline uint64_t GetSpinLockTimeNs()
+		{
+			return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		}
+	}
+
+	/* Test and test-and-set lock, the waiting threads spin on the plain load that hits their own cache
+	*  and try to exchange only when the lock looks free, so the cache line is not bounced between the cores.
+	*/
 	class SpinLock
 	{
-		std::atomic_flag m_lock = ATOMIC_FLAG_INIT;
+		std::atomic<bool> m_lock = false;
+
+#ifdef SAILOR_SPINLOCK_STATS
+		SpinLockStats* m_pStats = nullptr;
+#endif
 
 	public:
 
 		SpinLock() = default;
 
+		SpinLock([[maybe_unused]] SpinLockStats* pStats)
+		{
+#ifdef SAILOR_SPINLOCK_STATS
+			m_pStats = pStats;
+#endif
+		}
+
 		SpinLock(SpinLock&&) = delete;
 		SpinLock(const SpinLock&) = delete;
 
@@ -22,23 +150,228 @@ namespace Sailor
 
 		SAILOR_API __forceinline void Lock() noexcept
 		{
-			while (m_lock.test_and_set(std::memory_order_acquire)) { ; }
+			if (!m_lock.exchange(true, std::memory_order_acquire))
+			{
+#ifdef SAILOR_SPINLOCK_STATS
+				if (m_pStats)
+				{
+					m_pStats->OnAcquired();
+				}
+#endif
+				return;
+			}
+
+			LockContended();
 		}
 
 		SAILOR_API __forceinline bool TryLock() noexcept
 		{
-			if (!m_lock.test(std::memory_order_acquire))
+			if (m_lock.load(std::memory_order_relaxed) || m_lock.exchange(true, std::memory_order_acquire))
+			{
+				return false;
+			}
+
+#ifdef SAILOR_SPINLOCK_STATS
+			if (m_pStats)
+			{
+				m_pStats->OnAcquired();
+			}
+#endif
+			return true;
+		}
+
+		SAILOR_API __forceinline void Unlock() noexcept
+		{
+			m_lock.store(false, std::memory_order_release);
+		}
+
+		__forceinline bool IsLocked() const noexcept { return m_lock.load(std::memory_order_relaxed); }
+
+	protected:
+
+		void LockContended() noexcept
+		{
+#ifdef SAILOR_SPINLOCK_STATS
+			const uint64_t startNs = m_pStats ? Internal::GetSpinLockTimeNs() : 0;
+#endif
+			Internal::SpinWait spinWait;
+
+			do
 			{
-				Lock();
+				while (m_lock.load(std::memory_order_relaxed))
+				{
+					spinWait.Wait();
+				}
+			} while (m_lock.exchange(true, std::memory_order_acquire));
+
+#ifdef SAILOR_SPINLOCK_STATS
+			if (m_pStats)
+			{
+				m_pStats->OnContendedAcquired(spinWait.GetNumSpins(), Internal::GetSpinLockTimeNs() - startNs);
+			}
+#endif
+		}
+	};
+
+	/* Readers-writer spin lock, the readers share the lock and the writer owns it exclusively.
+	*  The waiting writer sets the pending bit that holds off the new readers, so the writers are not starved.
+	*/
+	class RWSpinLock
+	{
+		static constexpr uint32_t Writer = 1;
+		static constexpr uint32_t WriterPending = 2;
+		static constexpr uint32_t Reader = 4;
+
+		std::atomic<uint32_t> m_state = 0;
+
+#ifdef SAILOR_SPINLOCK_STATS
+		SpinLockStats* m_pStats = nullptr;
+#endif
+
+	public:
+
+		RWSpinLock() = default;
+
+		RWSpinLock([[maybe_unused]] SpinLockStats* pStats)
+		{
+#ifdef SAILOR_SPINLOCK_STATS
+			m_pStats = pStats;
+#endif
+		}
+
+		RWSpinLock(RWSpinLock&&) = delete;
+		RWSpinLock(const RWSpinLock&) = delete;
+
+		RWSpinLock& operator=(RWSpinLock&&) = delete;
+		RWSpinLock& operator=(const RWSpinLock&) = delete;
+
+		SAILOR_API __forceinline bool TryLockRead() noexcept
+		{
+			uint32_t state = m_state.load(std::memory_order_relaxed);
+			if ((state & (Writer | WriterPending)) == 0 &&
+				m_state.compare_exchange_weak(state, state + Reader, std::memory_order_acquire, std::memory_order_relaxed))
+			{
+#ifdef SAILOR_SPINLOCK_STATS
+				if (m_pStats)
+				{
+					m_pStats->OnAcquired();
+				}
+#endif
 				return true;
 			}
 
 			return false;
 		}
 
-		SAILOR_API __forceinline void Unlock() noexcept
+		SAILOR_API __forceinline void LockRead() noexcept
+		{
+			if (!TryLockRead())
+			{
+				LockReadContended();
+			}
+		}
+
+		SAILOR_API __forceinline void UnlockRead() noexcept
+		{
+			check((m_state.load(std::memory_order_relaxed) & ~(Writer | WriterPending)) != 0);
+			m_state.fetch_sub(Reader, std::memory_order_release);
+		}
+
+		SAILOR_API __forceinline bool TryLockWrite() noexcept
+		{
+			// The pending bit could be set by the other writer, we clear it anyway, the other writer sets it again
+			uint32_t state = m_state.load(std::memory_order_relaxed);
+			if ((state & ~WriterPending) == 0 &&
+				m_state.compare_exchange_weak(state, Writer, std::memory_order_acquire, std::memory_order_relaxed))
+			{
+#ifdef SAILOR_SPINLOCK_STATS
+				if (m_pStats)
+				{
+					m_pStats->OnAcquired();
+				}
+#endif
+				return true;
+			}
+
+			return false;
+		}
+
+		SAILOR_API __forceinline void LockWrite() noexcept
+		{
+			if (!TryLockWrite())
+			{
+				LockWriteContended();
+			}
+		}
+
+		SAILOR_API __forceinline void UnlockWrite() noexcept
+		{
+			check(m_state.load(std::memory_order_relaxed) & Writer);
+			m_state.fetch_and(~Writer, std::memory_order_release);
+		}
+
+	protected:
+
+		void LockReadContended() noexcept
+		{
+#ifdef SAILOR_SPINLOCK_STATS
+			const uint64_t startNs = m_pStats ? Internal::GetSpinLockTimeNs() : 0;
+#endif
+			Internal::SpinWait spinWait;
+
+			for (;;)
+			{
+				uint32_t state = m_state.load(std::memory_order_relaxed);
+				if ((state & (Writer | WriterPending)) == 0 &&
+					m_state.compare_exchange_weak(state, state + Reader, std::memory_order_acquire, std::memory_order_relaxed))
+				{
+					break;
+				}
+
+				spinWait.Wait();
+			}
+
+#ifdef SAILOR_SPINLOCK_STATS
+			if (m_pStats)
+			{
+				m_pStats->OnContendedAcquired(spinWait.GetNumSpins(), Internal::GetSpinLockTimeNs() - startNs);
+			}
+#endif
+		}
+
+		void LockWriteContended() noexcept
 		{
-			m_lock.clear(std::memory_order_release);
+#ifdef SAILOR_SPINLOCK_STATS
+			const uint64_t startNs = m_pStats ? Internal::GetSpinLockTimeNs() : 0;
+#endif
+			Internal::SpinWait spinWait;
+
+			for (;;)
+			{
+				uint32_t state = m_state.load(std::memory_order_relaxed);
+				if ((state & ~WriterPending) == 0)
+				{
+					if (m_state.compare_exchange_weak(state, Writer, std::memory_order_acquire, std::memory_order_relaxed))
+					{
+						break;
+					}
+					continue;
+				}
+
+				if ((state & WriterPending) == 0)
+				{
+					m_state.fetch_or(WriterPending, std::memory_order_relaxed);
+				}
+
+				spinWait.Wait();
+			}
+
+#ifdef SAILOR_SPINLOCK_STATS
+			if (m_pStats)
+			{
+				m_pStats->OnContendedAcquired(spinWait.GetNumSpins(), Internal::GetSpinLockTimeNs() - startNs);
+			}
+#endif
 		}
 	};
-}
\ No newline at end of file
+}
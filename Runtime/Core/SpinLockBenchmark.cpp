@@ -0,0 +1,229 @@
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <shared_mutex>
+#include <random>
+#include "Core/SpinLock.h"
+#include "Core/Utils.h"
+#include "Tasks/Scheduler.h"
+#include "Tasks/Tasks.h"
+
+using namespace Sailor;
+using Timer = Utils::Timer;
+
+namespace
+{
+	// The previous implementation, spins on test_and_set that writes the cache line on each try
+	class TestAndSetLock
+	{
+	public:
+
+		void Lock() { while (m_lock.test_and_set(std::memory_order_acquire)) { ; } }
+		void Unlock() { m_lock.clear(std::memory_order_release); }
+
+		static const char* GetName() { return "test_and_set"; }
+
+	protected:
+
+		std::atomic_flag m_lock = ATOMIC_FLAG_INIT;
+	};
+
+	class TTASLock
+	{
+	public:
+
+		void Lock() { m_lock.Lock(); }
+		void Unlock() { m_lock.Unlock(); }
+
+		static const char* GetName() { return "SpinLock"; }
+
+	protected:
+
+		SpinLock m_lock{ SAILOR_SPINLOCK_SITE("SpinLockBenchmark") };
+	};
+
+	class MutexLock
+	{
+	public:
+
+		void Lock() { m_lock.lock(); }
+		void Unlock() { m_lock.unlock(); }
+
+		static const char* GetName() { return "std::mutex"; }
+
+	protected:
+
+		std::mutex m_lock;
+	};
+
+	class RWSpinLockPolicy
+	{
+	public:
+
+		void LockRead() { m_lock.LockRead(); }
+		void UnlockRead() { m_lock.UnlockRead(); }
+		void LockWrite() { m_lock.LockWrite(); }
+		void UnlockWrite() { m_lock.UnlockWrite(); }
+
+		static const char* GetName() { return "RWSpinLock"; }
+
+	protected:
+
+		RWSpinLock m_lock{ SAILOR_SPINLOCK_SITE("RWSpinLockBenchmark") };
+	};
+
+	class SharedMutexPolicy
+	{
+	public:
+
+		void LockRead() { m_lock.lock_shared(); }
+		void UnlockRead() { m_lock.unlock_shared(); }
+		void LockWrite() { m_lock.lock(); }
+		void UnlockWrite() { m_lock.unlock(); }
+
+		static const char* GetName() { return "std::shared_mutex"; }
+
+	protected:
+
+		std::shared_mutex m_lock;
+	};
+
+	// The exclusive lock that is used as readers-writer one
+	template<typename TLock>
+	class ExclusivePolicy
+	{
+	public:
+
+		void LockRead() { m_lock.Lock(); }
+		void UnlockRead() { m_lock.Unlock(); }
+		void LockWrite() { m_lock.Lock(); }
+		void UnlockWrite() { m_lock.Unlock(); }
+
+		static const char* GetName() { return TLock::GetName(); }
+
+	protected:
+
+		TLock m_lock;
+	};
+
+	template<typename TFunc>
+	int64_t RunThreads(uint32_t numThreads, TFunc func)
+	{
+		TVector<std::thread> threads;
+		threads.Reserve(numThreads);
+
+		Timer timer;
+		timer.Start();
+
+		for (uint32_t i = 0; i < numThreads; i++)
+		{
+			threads.Emplace([&func, i]() { func(i); });
+		}
+
+		for (auto& thread : threads)
+		{
+			thread.join();
+		}
+
+		timer.Stop();
+
+		return timer.ResultMs();
+	}
+
+	// All the threads increment the same counter, that is the worst case of the contention
+	template<typename TLock>
+	void RunExclusiveTest(uint32_t numThreads)
+	{
+		const size_t opsPerThread = 1 << 20;
+
+		TLock lock;
+		size_t counter = 0;
+
+		const int64_t resultMs = RunThreads(numThreads, [&](uint32_t)
+			{
+				for (size_t i = 0; i < opsPerThread; i++)
+				{
+					lock.Lock();
+					counter++;
+					lock.Unlock();
+				}
+			});
+
+		check(counter == opsPerThread * numThreads);
+		SAILOR_LOG("\t%s, %u threads: %lldms", TLock::GetName(), numThreads, (long long)resultMs);
+	}
+
+	// The readers copy the small array, the writers update it
+	template<typename TPolicy>
+	void RunReadersWriterTest(uint32_t numThreads, uint32_t readsPercent)
+	{
+		const size_t opsPerThread = 1 << 19;
+
+		TPolicy lock;
+		size_t data[8]{};
+		std::atomic<size_t> checksum = 0;
+
+		const int64_t resultMs = RunThreads(numThreads, [&](uint32_t threadIndex)
+			{
+				std::mt19937 g(threadIndex);
+				size_t localChecksum = 0;
+
+				for (size_t i = 0; i < opsPerThread; i++)
+				{
+					if (g() % 100 < readsPercent)
+					{
+						lock.LockRead();
+						for (size_t j = 0; j < 8; j++)
+						{
+							localChecksum += data[j];
+						}
+						lock.UnlockRead();
+					}
+					else
+					{
+						lock.LockWrite();
+						for (size_t j = 0; j < 8; j++)
+						{
+							data[j]++;
+						}
+						lock.UnlockWrite();
+					}
+				}
+
+				checksum += localChecksum;
+			});
+
+		SAILOR_LOG("\t%s, %u%% reads, %u threads: %lldms", TPolicy::GetName(), readsPercent, numThreads, (long long)resultMs);
+	}
+}
+
+void Sailor::RunSpinLockBenchmark()
+{
+	printf("\nStarting SpinLock benchmark...\n");
+
+	SpinLockStats::ResetAll();
+
+	// Oversubscribed as well, the spinning threads could prevent the owner from running
+	const uint32_t maxThreads = 2 * max(2u, std::thread::hardware_concurrency());
+
+	SAILOR_LOG("Exclusive lock, the shared counter:");
+	for (uint32_t numThreads = 1; numThreads <= maxThreads; numThreads *= 2)
+	{
+		RunExclusiveTest<TestAndSetLock>(numThreads);
+		RunExclusiveTest<TTASLock>(numThreads);
+		RunExclusiveTest<MutexLock>(numThreads);
+	}
+
+	SAILOR_LOG("Readers-writer lock:");
+	for (const uint32_t readsPercent : { 95u, 50u })
+	{
+		for (uint32_t numThreads = 1; numThreads <= maxThreads; numThreads *= 2)
+		{
+			RunReadersWriterTest<ExclusivePolicy<TTASLock>>(numThreads, readsPercent);
+			RunReadersWriterTest<RWSpinLockPolicy>(numThreads, readsPercent);
+			RunReadersWriterTest<SharedMutexPolicy>(numThreads, readsPercent);
+		}
+	}
+
+	SpinLockStats::DumpAll();
+}
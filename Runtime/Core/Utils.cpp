@@ -1,26 +1,26 @@
 #include "Utils.h"
 #include <sys/types.h>
 #include <sys/stat.h>
-#include <processthreadsapi.h>
 
-#ifndef WIN32
+#if defined(_WIN32)
+#include <processthreadsapi.h>
+#include <windows.h>
+#else
 #include <unistd.h>
-#define stat _stat
-#include <ntverp.h>
 #endif
 
 #include <algorithm> 
 #include <functional> 
 #include <cctype>
+#include <chrono>
 
 #include <sstream>
 #include <string>
-#include <format>
 
-#include <windows.h>
 #include "Containers/Vector.h"
 #include "Tasks/Tasks.h"
 #include "Tasks/Scheduler.h"
+#include "Platform/Platform.h"
 
 using namespace Sailor;
 using namespace Sailor::Utils;
@@ -37,12 +37,12 @@ glm::vec4 Utils::SRGBToLinear(const glm::u8vec4& srgbIn)
 
 glm::vec4 Utils::LinearToSRGB(const glm::vec4& linearRGB)
 {
-	return vec4(LinearToSRGB(linearRGB.xyz), linearRGB.a);
+	return vec4(LinearToSRGB(glm::vec3(linearRGB)), linearRGB.a);
 }
 
 glm::vec4 Utils::SRGBToLinear(const glm::vec4& srgbIn)
 {
-	return vec4(SRGBToLinear(srgbIn.xyz), srgbIn.a);
+	return vec4(SRGBToLinear(glm::vec3(srgbIn)), srgbIn.a);
 }
 
 glm::vec3 Utils::LinearToSRGB(const glm::vec3& linearRGB)
@@ -140,13 +140,12 @@ std::wstring Utils::UTF8_to_wchar(const char* in)
 
 DWORD Utils::GetRandomColorHex()
 {
-	COLORREF res = RGB(
-		(BYTE)(rand() % 255), // red component of color
-		(BYTE)(rand() % 255), // green component of color
-		(BYTE)(rand() % 255) // blue component of color
-	);
+	// The same layout as COLORREF: 0x00BBGGRR
+	const DWORD red = (DWORD)(rand() % 255);
+	const DWORD green = (DWORD)(rand() % 255);
+	const DWORD blue = (DWORD)(rand() % 255);
 
-	return (DWORD)res;
+	return red | (green << 8) | (blue << 16);
 }
 
 std::string Utils::GetCurrentThreadName()
@@ -161,32 +160,18 @@ std::string Utils::GetCurrentThreadName()
 	}
 	else
 	{
-		return std::format("Thread {}", GetCurrentThreadId());
+		return std::string("Thread ") + std::to_string(Platform::GetCurrentThreadId());
 	}
 }
 
-void Utils::SetThreadName(size_t dwThreadID, const std::string& threadName)
-{
-	SetThreadDescription(
-		(HANDLE)(dwThreadID),
-		UTF8_to_wchar(threadName.c_str()).c_str()
-	);
-}
-
 void Utils::SetThreadName(const std::string& threadName)
 {
-	SetThreadDescription(
-		GetCurrentThread(),
-		UTF8_to_wchar(threadName.c_str()).c_str()
-	);
+	Platform::SetThreadName(threadName);
 }
 
 void Utils::SetThreadName(std::thread* thread, const std::string& threadName)
 {
-	SetThreadDescription(
-		(HANDLE)thread->native_handle(),
-		UTF8_to_wchar(threadName.c_str()).c_str()
-	);
+	Platform::SetThreadName(thread, threadName);
 }
 
 std::string Utils::RemoveFileExtension(const std::string& filename)
@@ -335,27 +320,50 @@ int64_t Utils::GetCurrentTimeNano()
 	return (int64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
 }
 
-void Utils::Timer::Start()
+namespace
 {
-	LARGE_INTEGER li;
-	if (!QueryPerformanceFrequency(&li))
+#if defined(_WIN32)
+	__forceinline int64_t QueryCounter()
 	{
-		SAILOR_LOG("QueryPerformanceFrequency failed!");
+		LARGE_INTEGER li;
+		QueryPerformanceCounter(&li);
+		return li.QuadPart;
 	}
 
-	m_pcFrequence = double(li.QuadPart) / 1000.0;
+	__forceinline double QueryFrequencyMs()
+	{
+		LARGE_INTEGER li;
+		if (!QueryPerformanceFrequency(&li))
+		{
+			SAILOR_LOG("QueryPerformanceFrequency failed!");
+		}
 
-	QueryPerformanceCounter(&li);
-	m_counterStart = li.QuadPart;
+		return double(li.QuadPart) / 1000.0;
+	}
+#else
+	__forceinline int64_t QueryCounter()
+	{
+		return (int64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	__forceinline double QueryFrequencyMs()
+	{
+		return 1000000.0;
+	}
+#endif
+}
+
+void Utils::Timer::Start()
+{
+	m_pcFrequence = QueryFrequencyMs();
+	m_counterStart = QueryCounter();
 
 	m_bIsStarted = true;
 }
 
 void Utils::Timer::Stop()
 {
-	LARGE_INTEGER li;
-	QueryPerformanceCounter(&li);
-	m_counterEnd = li.QuadPart;
+	m_counterEnd = QueryCounter();
 
 	m_counterAcc += m_counterEnd - m_counterStart;
 
@@ -366,9 +374,7 @@ int64_t Utils::Timer::ResultMs() const
 {
 	if (m_bIsStarted)
 	{
-		LARGE_INTEGER li;
-		QueryPerformanceCounter(&li);
-		return int64_t(double(li.QuadPart - m_counterStart) / m_pcFrequence);
+		return int64_t(double(QueryCounter() - m_counterStart) / m_pcFrequence);
 	}
 	return int64_t(double(m_counterEnd - m_counterStart) / m_pcFrequence);
 }
@@ -382,9 +388,7 @@ int64_t Utils::Timer::ResultAccumulatedMs() const
 
 	if (m_bIsStarted)
 	{
-		LARGE_INTEGER li;
-		QueryPerformanceCounter(&li);
-		return int64_t(double(li.QuadPart - m_counterStart + m_counterAcc) / m_pcFrequence);
+		return int64_t(double(QueryCounter() - m_counterStart + m_counterAcc) / m_pcFrequence);
 	}
 
 	return int64_t((double)m_counterAcc / m_pcFrequence);
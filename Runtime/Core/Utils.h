@@ -27,21 +27,20 @@ namespace Sailor
 
 		SAILOR_API void Trim(std::string& s);
 
-		SAILOR_API void SetThreadName(size_t dwThreadID, const std::string& threadName);
 		SAILOR_API void SetThreadName(const std::string& threadName);
 		SAILOR_API void SetThreadName(std::thread* thread, const std::string& threadName);
 		SAILOR_API std::string GetCurrentThreadName();
 
 		SAILOR_API DWORD GetRandomColorHex();
 
-		SAILOR_API __forceinline glm::vec4 LinearToSRGB(const glm::u8vec4& linearRGB);
-		SAILOR_API __forceinline glm::vec4 SRGBToLinear(const glm::u8vec4& srgbIn);
+		SAILOR_API glm::vec4 LinearToSRGB(const glm::u8vec4& linearRGB);
+		SAILOR_API glm::vec4 SRGBToLinear(const glm::u8vec4& srgbIn);
 
-		SAILOR_API __forceinline glm::vec4 LinearToSRGB(const glm::vec4& linearRGB);
-		SAILOR_API __forceinline glm::vec4 SRGBToLinear(const glm::vec4& srgbIn);
+		SAILOR_API glm::vec4 LinearToSRGB(const glm::vec4& linearRGB);
+		SAILOR_API glm::vec4 SRGBToLinear(const glm::vec4& srgbIn);
 
-		SAILOR_API __forceinline glm::vec3 LinearToSRGB(const glm::vec3& linearRGB);
-		SAILOR_API __forceinline glm::vec3 SRGBToLinear(const glm::vec3& srgbIn);
+		SAILOR_API glm::vec3 LinearToSRGB(const glm::vec3& linearRGB);
+		SAILOR_API glm::vec3 SRGBToLinear(const glm::vec3& srgbIn);
 
 		SAILOR_API int64_t GetCurrentTimeMs();
 		SAILOR_API int64_t GetCurrentTimeMicro();
@@ -181,7 +181,7 @@ namespace YAML
 			rhs.x = node[0].as<float>();
 			rhs.y = node[1].as<float>();
 			rhs.z = node[2].as<float>();
-			rhs.w = node[2].as<float>();
+			rhs.w = node[3].as<float>();
 			return true;
 		}
 	};
@@ -204,7 +204,7 @@ namespace YAML
 			rhs.x = node[0].as<float>();
 			rhs.y = node[1].as<float>();
 			rhs.z = node[2].as<float>();
-			rhs.w = node[2].as<float>();
+			rhs.w = node[3].as<float>();
 			return true;
 		}
 	};
@@ -21,6 +21,16 @@ Tasks::ITaskPtr CameraECS::Tick(float deltaTime)
 	return nullptr;
 }
 
+TVector<size_t> CameraECS::GetReadComponents() const
+{
+	return { TransformECS::GetComponentStaticType() };
+}
+
+TVector<size_t> CameraECS::GetWriteComponents() const
+{
+	return { GetComponentStaticType() };
+}
+
 glm::mat4 CameraData::GetInvProjection() const
 {
 	return glm::inverse(m_projectionMatrix);
@@ -54,5 +54,8 @@ namespace Sailor
 		void CopyCameraData(RHI::RHISceneViewPtr& outCameras);
 
 		virtual uint32_t GetOrder() const override { return 100; }
+
+		virtual TVector<size_t> GetReadComponents() const override;
+		virtual TVector<size_t> GetWriteComponents() const override;
 	};
 }
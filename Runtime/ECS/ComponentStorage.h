@@ -0,0 +1,128 @@
+#pragma once
+#include <tuple>
+#include "Core/Defines.h"
+#include "Containers/Vector.h"
+
+namespace Sailor::ECS
+{
+	/* Structure of arrays storage: each hot field is packed to its own array, the rest of the component (TCold) is stored aside.
+	*  All arrays are dense and have the same order, so the systems iterate the only field they need without gaps.
+	*  Remove moves the last component to the freed place, so the dense index changes, while the handle doesn't:
+	*  the handles are stable until the component is removed and are reused after that.
+	*/
+	template<typename TCold, typename... THot>
+	class TSoAStorage
+	{
+	public:
+
+		static constexpr size_t InvalidHandle = (size_t)-1;
+		static constexpr size_t NumHotFields = sizeof...(THot);
+
+		template<size_t Field>
+		using THotType = std::tuple_element_t<Field, std::tuple<THot...>>;
+
+		size_t Add()
+		{
+			const size_t denseIndex = m_denseToHandle.Num();
+
+			size_t handle = InvalidHandle;
+			if (m_freeHandles.Num() > 0)
+			{
+				handle = m_freeHandles[m_freeHandles.Num() - 1];
+				m_freeHandles.RemoveLast();
+				m_handleToDense[handle] = denseIndex;
+			}
+			else
+			{
+				handle = m_handleToDense.Num();
+				m_handleToDense.Add(denseIndex);
+			}
+
+			m_denseToHandle.Add(handle);
+			m_cold.AddDefault(1);
+			std::apply([](auto&... arrays) { (arrays.AddDefault(1), ...); }, m_hot);
+
+			return handle;
+		}
+
+		// Swap-remove, the last component takes the place of the removed one
+		void Remove(size_t handle)
+		{
+			check(IsValid(handle));
+
+			const size_t denseIndex = m_handleToDense[handle];
+			const size_t lastIndex = m_denseToHandle.Num() - 1;
+
+			if (denseIndex != lastIndex)
+			{
+				const size_t movedHandle = m_denseToHandle[lastIndex];
+
+				m_cold[denseIndex] = std::move(m_cold[lastIndex]);
+				std::apply([=](auto&... arrays) { ((arrays[denseIndex] = std::move(arrays[lastIndex])), ...); }, m_hot);
+
+				m_denseToHandle[denseIndex] = movedHandle;
+				m_handleToDense[movedHandle] = denseIndex;
+			}
+
+			m_cold.RemoveLast();
+			std::apply([](auto&... arrays) { (arrays.RemoveLast(), ...); }, m_hot);
+			m_denseToHandle.RemoveLast();
+
+			m_handleToDense[handle] = InvalidHandle;
+			m_freeHandles.Add(handle);
+		}
+
+		void Clear()
+		{
+			m_cold.Clear();
+			std::apply([](auto&... arrays) { (arrays.Clear(), ...); }, m_hot);
+			m_denseToHandle.Clear();
+			m_handleToDense.Clear();
+			m_freeHandles.Clear();
+		}
+
+		void Reserve(size_t num)
+		{
+			m_cold.Reserve(num);
+			std::apply([=](auto&... arrays) { (arrays.Reserve(num), ...); }, m_hot);
+			m_denseToHandle.Reserve(num);
+			m_handleToDense.Reserve(num);
+		}
+
+		__forceinline size_t Num() const { return m_denseToHandle.Num(); }
+
+		__forceinline bool IsValid(size_t handle) const { return handle < m_handleToDense.Num() && m_handleToDense[handle] != InvalidHandle; }
+
+		__forceinline size_t GetDenseIndex(size_t handle) const { return m_handleToDense[handle]; }
+		__forceinline size_t GetHandle(size_t denseIndex) const { return m_denseToHandle[denseIndex]; }
+
+		// The dense arrays to iterate, the index is the dense one
+		template<size_t Field>
+		__forceinline TVector<THotType<Field>>& GetHotArray() { return std::get<Field>(m_hot); }
+
+		template<size_t Field>
+		__forceinline const TVector<THotType<Field>>& GetHotArray() const { return std::get<Field>(m_hot); }
+
+		__forceinline TVector<TCold>& GetColdArray() { return m_cold; }
+		__forceinline const TVector<TCold>& GetColdArray() const { return m_cold; }
+
+		// The access by the handle
+		template<size_t Field>
+		__forceinline THotType<Field>& GetHot(size_t handle) { return std::get<Field>(m_hot)[m_handleToDense[handle]]; }
+
+		__forceinline TCold& GetCold(size_t handle) { return m_cold[m_handleToDense[handle]]; }
+		__forceinline const TCold& GetCold(size_t handle) const { return m_cold[m_handleToDense[handle]]; }
+
+		// The handle of the cold part by its address, it changes after Remove
+		__forceinline size_t GetHandle(const TCold* rawPtr) const { return m_denseToHandle[(size_t)(rawPtr - m_cold.GetData())]; }
+
+	protected:
+
+		std::tuple<TVector<THot>...> m_hot;
+		TVector<TCold> m_cold;
+
+		TVector<size_t> m_denseToHandle;
+		TVector<size_t> m_handleToDense;
+		TVector<size_t> m_freeHandles;
+	};
+}
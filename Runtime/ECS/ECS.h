@@ -9,11 +9,15 @@
 #include "Containers/Concepts.h"
 #include "Core/Submodule.h"
 #include "Memory/UniquePtr.hpp"
+#include "ECS/ComponentStorage.h"
 
 namespace Sailor::ECS
 {
 	constexpr size_t InvalidIndex = ((size_t)-1);
 
+	// The write of that type conflicts with any access, the system runs exclusively
+	constexpr size_t AllComponents = ((size_t)-2);
+
 	class TComponent
 	{
 	public:
@@ -67,6 +71,13 @@ namespace Sailor::ECS
 
 		virtual uint32_t GetOrder() const { return 100; }
 
+		/* The component types (GetComponentStaticType) that are read and written by Tick, the shared state could be declared by its type hash as well.
+		*  The systems that don't conflict are ticked in parallel, the conflicting ones are ticked in GetOrder order.
+		*  By default the system writes AllComponents, so it is not ticked with any other system.
+		*/
+		virtual TVector<size_t> GetReadComponents() const { return {}; }
+		virtual TVector<size_t> GetWriteComponents() const { return { AllComponents }; }
+
 		void UpdateGameObject(GameObjectPtr gameObject, size_t lastFrameChanges);
 
 	private:
@@ -159,11 +170,94 @@ namespace Sailor::ECS
 	template<typename T, typename R>
 	using TSystemPtr = TUniquePtr<class TSystem<T, R>>;
 
+	/* Opt-in structure of arrays storage for the systems that iterate a few fields of many components.
+	*  THot are the fields that are packed to their own dense arrays, TData is the rest of the component.
+	*  The component index is the stable handle, the dense index changes when the other components are removed.
+	*/
+	template<typename TECS, typename TData, typename... THot>
+	class SAILOR_API TSoASystem : public TBaseSystem
+	{
+		static_assert(IsBaseOf<TComponent, TData>, "TData must inherit from TComponent");
+
+	public:
+
+		using TStorage = TSoAStorage<TData, THot...>;
+
+		TSoASystem()
+		{
+			TSoASystem::s_registrationFactoryMethod;
+		}
+
+		virtual size_t RegisterComponent() override
+		{
+			return m_storage.Add();
+		}
+
+		virtual void UnregisterComponent(size_t index) override
+		{
+			if (index != InvalidIndex && m_storage.IsValid(index))
+			{
+				m_storage.GetCold(index).Clear();
+				m_storage.Remove(index);
+			}
+		}
+
+		__forceinline TData& GetComponentData(size_t index) { return m_storage.GetCold(index); }
+
+		template<size_t Field>
+		__forceinline auto& GetHotData(size_t index) { return m_storage.template GetHot<Field>(index); }
+
+		static size_t GetStaticType() { return std::type_index(typeid(TSoASystem)).hash_code(); }
+		virtual size_t GetComponentType() const override { return TSoASystem::GetComponentStaticType(); }
+		static size_t GetComponentStaticType() { return std::type_index(typeid(TData)).hash_code(); }
+
+		__forceinline size_t GetComponentIndex(TData* rawPtr) const { return m_storage.GetHandle(rawPtr); }
+
+		virtual void EndPlay() override
+		{
+			m_storage.Clear();
+		}
+
+	protected:
+
+		TStorage m_storage;
+
+		class SAILOR_API RegistrationFactoryMethod
+		{
+		public:
+
+			RegistrationFactoryMethod()
+			{
+				if (!s_bRegistered)
+				{
+					ECSFactory::RegisterECS(GetComponentStaticType(), []() { return TUniquePtr<TECS>::Make(); });
+					s_bRegistered = true;
+				}
+			}
+
+		protected:
+
+			static bool s_bRegistered;
+		};
+
+		static volatile RegistrationFactoryMethod s_registrationFactoryMethod;
+	};
+
+	SAILOR_API void RunECSBenchmark();
+	SAILOR_API void RunSystemsGraphBenchmark();
+	SAILOR_API void RunTransformPropagationBenchmark();
+
 #ifndef _SAILOR_IMPORT_
 	template<typename T, typename R>
 	TSystem<T, R>::RegistrationFactoryMethod volatile TSystem<T, R>::s_registrationFactoryMethod;
 
 	template<typename T, typename R>
 	bool TSystem<T, R>::RegistrationFactoryMethod::s_bRegistered = false;
+
+	template<typename T, typename R, typename... H>
+	TSoASystem<T, R, H...>::RegistrationFactoryMethod volatile TSoASystem<T, R, H...>::s_registrationFactoryMethod;
+
+	template<typename T, typename R, typename... H>
+	bool TSoASystem<T, R, H...>::RegistrationFactoryMethod::s_bRegistered = false;
 #endif
 }
@@ -0,0 +1,815 @@
+#include <random>
+#include <atomic>
+#include "ECS/ECS.h"
+#include "ECS/ComponentStorage.h"
+#include "ECS/SystemsGraph.h"
+#include "ECS/TransformECS.h"
+#include "Engine/World.h"
+#include "Engine/GameObject.h"
+#include "Math/Transform.h"
+#include "Math/Bounds.h"
+#include "Memory/Memory.h"
+#include "Core/Utils.h"
+
+using namespace Sailor;
+using namespace Sailor::ECS;
+using Timer = Utils::Timer;
+
+namespace
+{
+	// The same layout as TransformComponent, that is stored by TSystem now
+	class FatTransformData : public TComponent
+	{
+	public:
+
+		__forceinline bool IsDirty() const { return m_bIsDirty; }
+		__forceinline void SetDirty(bool bIsDirty) { m_bIsDirty = bIsDirty; }
+
+		glm::mat4x4 m_cachedRelativeMatrix = glm::identity<glm::mat4>();
+		glm::mat4x4 m_cachedWorldMatrix = glm::identity<glm::mat4>();
+
+		Math::Transform m_transform;
+		size_t m_parent = InvalidIndex;
+		TVector<size_t, Memory::TInlineAllocator<4 * sizeof(size_t)>> m_children;
+	};
+
+	// StaticMeshRendererData with the bounds of the mesh
+	class FatMeshData : public TComponent
+	{
+	public:
+
+		ObjectPtr m_model;
+		TVector<ObjectPtr> m_materials;
+		Math::AABB m_bounds;
+	};
+
+	// The cold parts that are left when the hot fields are moved to the arrays
+	class ColdTransformData : public TComponent
+	{
+	public:
+
+		glm::mat4x4 m_cachedRelativeMatrix = glm::identity<glm::mat4>();
+		size_t m_parent = InvalidIndex;
+		TVector<size_t, Memory::TInlineAllocator<4 * sizeof(size_t)>> m_children;
+	};
+
+	class ColdMeshData : public TComponent
+	{
+	public:
+
+		ObjectPtr m_model;
+		TVector<ObjectPtr> m_materials;
+	};
+
+	enum ETransformField : size_t { Transform = 0, WorldMatrix, Dirty };
+	using SoATransformStorage = TSoAStorage<ColdTransformData, Math::Transform, glm::mat4x4, uint8_t>;
+	using SoAMeshStorage = TSoAStorage<ColdMeshData, Math::AABB>;
+
+	__forceinline bool Overlaps(const Math::AABB& lhs, const Math::AABB& rhs)
+	{
+		return lhs.m_min.x <= rhs.m_max.x && lhs.m_max.x >= rhs.m_min.x &&
+			lhs.m_min.y <= rhs.m_max.y && lhs.m_max.y >= rhs.m_min.y &&
+			lhs.m_min.z <= rhs.m_max.z && lhs.m_max.z >= rhs.m_min.z;
+	}
+
+	class TestCase_ComponentLayout
+	{
+	public:
+
+		TestCase_ComponentLayout(uint32_t count) : m_count(count)
+		{
+			std::mt19937 random(count);
+			std::uniform_real_distribution<float> dist(-100.0f, 100.0f);
+			std::uniform_int_distribution<uint32_t> index(0, count - 1);
+
+			m_fatTransforms.AddDefault(count);
+			m_fatMeshes.AddDefault(count);
+			m_soaTransforms.Reserve(count);
+			m_soaMeshes.Reserve(count);
+
+			for (uint32_t i = 0; i < count; i++)
+			{
+				const Math::Transform transform(glm::vec4(dist(random), dist(random), dist(random), 1.0f),
+					glm::angleAxis(dist(random), glm::normalize(glm::vec3(dist(random), dist(random), dist(random)) + 0.01f)));
+
+				const Math::AABB bounds(glm::vec3(dist(random), dist(random), dist(random)), glm::vec3(1.0f + 0.01f * std::abs(dist(random))));
+
+				m_fatTransforms[i].m_transform = transform;
+				m_fatMeshes[i].m_bounds = bounds;
+
+				const size_t transformHandle = m_soaTransforms.Add();
+				m_soaTransforms.GetHot<ETransformField::Transform>(transformHandle) = transform;
+
+				const size_t meshHandle = m_soaMeshes.Add();
+				m_soaMeshes.GetHot<0>(meshHandle) = bounds;
+			}
+
+			// A tenth of the transforms is changed each frame
+			m_dirtyIndices.Reserve(count / 10);
+			for (uint32_t i = 0; i < count / 10; i++)
+			{
+				m_dirtyIndices.Add(index(random));
+			}
+
+			m_query = Math::AABB(glm::vec3(0.0f), glm::vec3(40.0f));
+		}
+
+		// The full pass of TransformECS::Tick: the dirty transforms update their matrices, the roots take them as the world ones
+		int64_t RunTransformsAoS(uint32_t numFrames)
+		{
+			Timer timer;
+			timer.Start();
+
+			for (uint32_t frame = 0; frame < numFrames; frame++)
+			{
+				for (const auto i : m_dirtyIndices)
+				{
+					m_fatTransforms[i].SetDirty(true);
+				}
+
+				for (auto& data : m_fatTransforms)
+				{
+					if (data.IsDirty())
+					{
+						data.m_cachedRelativeMatrix = data.m_transform.Matrix();
+						data.m_cachedWorldMatrix = data.m_cachedRelativeMatrix;
+						data.SetDirty(false);
+					}
+				}
+			}
+
+			timer.Stop();
+			return timer.ResultMs();
+		}
+
+		int64_t RunTransformsSoA(uint32_t numFrames)
+		{
+			Timer timer;
+			timer.Start();
+
+			auto& transforms = m_soaTransforms.GetHotArray<ETransformField::Transform>();
+			auto& worldMatrices = m_soaTransforms.GetHotArray<ETransformField::WorldMatrix>();
+			auto& dirty = m_soaTransforms.GetHotArray<ETransformField::Dirty>();
+			auto& cold = m_soaTransforms.GetColdArray();
+
+			for (uint32_t frame = 0; frame < numFrames; frame++)
+			{
+				for (const auto i : m_dirtyIndices)
+				{
+					dirty[m_soaTransforms.GetDenseIndex(i)] = 1;
+				}
+
+				// Only the flags are streamed, the matrices are touched for the dirty ones
+				for (size_t i = 0; i < dirty.Num(); i++)
+				{
+					if (dirty[i])
+					{
+						cold[i].m_cachedRelativeMatrix = transforms[i].Matrix();
+						worldMatrices[i] = cold[i].m_cachedRelativeMatrix;
+						dirty[i] = 0;
+					}
+				}
+			}
+
+			timer.Stop();
+			return timer.ResultMs();
+		}
+
+		int64_t RunBoundsAoS(uint32_t numFrames, size_t& outNumVisible)
+		{
+			Timer timer;
+			timer.Start();
+
+			for (uint32_t frame = 0; frame < numFrames; frame++)
+			{
+				outNumVisible = 0;
+				for (const auto& data : m_fatMeshes)
+				{
+					outNumVisible += Overlaps(data.m_bounds, m_query) ? 1 : 0;
+				}
+			}
+
+			timer.Stop();
+			return timer.ResultMs();
+		}
+
+		int64_t RunBoundsSoA(uint32_t numFrames, size_t& outNumVisible)
+		{
+			Timer timer;
+			timer.Start();
+
+			const auto& bounds = m_soaMeshes.GetHotArray<0>();
+			for (uint32_t frame = 0; frame < numFrames; frame++)
+			{
+				outNumVisible = 0;
+				for (const auto& aabb : bounds)
+				{
+					outNumVisible += Overlaps(aabb, m_query) ? 1 : 0;
+				}
+			}
+
+			timer.Stop();
+			return timer.ResultMs();
+		}
+
+		// The world matrices of both layouts should be the same after the same frames
+		bool IsTransformsEqual() const
+		{
+			for (uint32_t i = 0; i < m_count; i++)
+			{
+				if (m_fatTransforms[i].m_cachedWorldMatrix != m_soaTransforms.GetHotArray<ETransformField::WorldMatrix>()[m_soaTransforms.GetDenseIndex(i)])
+				{
+					return false;
+				}
+			}
+
+			return true;
+		}
+
+		// Removes and adds the components in random order, the handles should keep pointing to the same data
+		bool RunHandlesTest()
+		{
+			std::mt19937 random(m_count + 1);
+
+			TVector<size_t> handles;
+			TVector<uint32_t> ids(m_count);
+			for (uint32_t i = 0; i < m_count; i++)
+			{
+				handles.Add(i);
+				ids[i] = i;
+				m_soaTransforms.GetCold(i).m_parent = i;
+			}
+
+			uint32_t nextId = m_count;
+			for (uint32_t i = 0; i < m_count / 2; i++)
+			{
+				const size_t k = std::uniform_int_distribution<size_t>(0, handles.Num() - 1)(random);
+
+				m_soaTransforms.Remove(handles[k]);
+				handles.RemoveAtSwap(k);
+				ids.RemoveAtSwap(k);
+
+				if (random() % 2)
+				{
+					const size_t handle = m_soaTransforms.Add();
+					m_soaTransforms.GetCold(handle).m_parent = nextId;
+
+					handles.Add(handle);
+					ids.Add(nextId++);
+				}
+			}
+
+			bool bIsValid = handles.Num() == m_soaTransforms.Num();
+			for (size_t i = 0; bIsValid && i < handles.Num(); i++)
+			{
+				const ColdTransformData& data = m_soaTransforms.GetCold(handles[i]);
+				bIsValid = data.m_parent == ids[i] && m_soaTransforms.GetHandle(&data) == handles[i];
+			}
+
+			return bIsValid;
+		}
+
+	protected:
+
+		uint32_t m_count = 0;
+
+		TVector<FatTransformData> m_fatTransforms;
+		TVector<FatMeshData> m_fatMeshes;
+
+		SoATransformStorage m_soaTransforms;
+		SoAMeshStorage m_soaMeshes;
+
+		TVector<uint32_t> m_dirtyIndices;
+		Math::AABB m_query;
+	};
+}
+
+void Sailor::ECS::RunECSBenchmark()
+{
+	printf("\nStarting ECS benchmark...\n");
+
+	SAILOR_LOG("Component sizes: transform %zu bytes fat, %zu bytes hot (transform, world matrix, flag), mesh %zu bytes fat, %zu bytes hot (bounds)",
+		sizeof(FatTransformData), sizeof(Math::Transform) + sizeof(glm::mat4x4) + sizeof(uint8_t), sizeof(FatMeshData), sizeof(Math::AABB));
+
+	for (const uint32_t count : { 10000u, 100000u, 1000000u })
+	{
+		// The same number of the processed components for each count
+		const uint32_t numFrames = std::max(4u, 10000000u / count);
+
+		TestCase_ComponentLayout test(count);
+
+		size_t numVisibleAoS = 0;
+		size_t numVisibleSoA = 0;
+
+		const int64_t transformsAoSMs = test.RunTransformsAoS(numFrames);
+		const int64_t transformsSoAMs = test.RunTransformsSoA(numFrames);
+		const int64_t boundsAoSMs = test.RunBoundsAoS(numFrames, numVisibleAoS);
+		const int64_t boundsSoAMs = test.RunBoundsSoA(numFrames, numVisibleSoA);
+
+		const bool bIsEqual = test.IsTransformsEqual() && numVisibleAoS == numVisibleSoA;
+		const bool bIsHandlesValid = test.RunHandlesTest();
+
+		SAILOR_LOG("%u components, %u frames:\n\ttransforms tick AoS %lldms, SoA %lldms, speedup %.2f\n\tbounds iteration (%zu visible) AoS %lldms, SoA %lldms, speedup %.2f\n\tresults match %d, handles are stable after swap-remove %d",
+			count, numFrames,
+			transformsAoSMs, transformsSoAMs, transformsSoAMs ? (float)transformsAoSMs / transformsSoAMs : 1.0f,
+			numVisibleSoA, boundsAoSMs, boundsSoAMs, boundsSoAMs ? (float)boundsAoSMs / boundsSoAMs : 1.0f,
+			bIsEqual, bIsHandlesValid);
+	}
+}
+
+namespace
+{
+	const size_t SyntheticBufferSize = 32 * 1024;
+	const uint32_t MaxSyntheticTypes = 64;
+
+	// The component type is the index of the buffer, the conflicting accesses are detected by the counters
+	struct SyntheticWorld
+	{
+		SyntheticWorld(uint32_t numTypes) : m_buffers(numTypes)
+		{
+			check(numTypes <= MaxSyntheticTypes);
+
+			for (uint32_t type = 0; type < numTypes; type++)
+			{
+				m_buffers[type].Resize(SyntheticBufferSize);
+				for (size_t i = 0; i < SyntheticBufferSize; i++)
+				{
+					m_buffers[type][i] = (float)((i * 31 + type * 17) % 101) * 0.01f;
+				}
+
+				m_numReaders[type] = 0;
+				m_numWriters[type] = 0;
+			}
+		}
+
+		TVector<TVector<float>> m_buffers;
+		std::atomic<int32_t> m_numReaders[MaxSyntheticTypes];
+		std::atomic<int32_t> m_numWriters[MaxSyntheticTypes];
+		std::atomic<bool> m_bIsRaceDetected = false;
+	};
+
+	class SyntheticSystem : public TBaseSystem
+	{
+	public:
+
+		SyntheticSystem(SyntheticWorld& world, TVector<size_t> reads, TVector<size_t> writes, uint32_t order, uint32_t numIterations) :
+			m_world(world), m_reads(std::move(reads)), m_writes(std::move(writes)), m_order(order), m_numIterations(numIterations)
+		{}
+
+		virtual size_t RegisterComponent() override { return 0; }
+		virtual void UnregisterComponent(size_t index) override {}
+
+		virtual uint32_t GetOrder() const override { return m_order; }
+		virtual TVector<size_t> GetReadComponents() const override { return m_reads; }
+		virtual TVector<size_t> GetWriteComponents() const override { return m_writes; }
+
+		virtual Tasks::ITaskPtr Tick(float deltaTime) override
+		{
+			for (const auto& type : m_reads)
+			{
+				m_world.m_numReaders[type]++;
+				m_world.m_bIsRaceDetected = m_world.m_bIsRaceDetected || m_world.m_numWriters[type] > 0;
+			}
+
+			for (const auto& type : m_writes)
+			{
+				m_world.m_bIsRaceDetected = m_world.m_bIsRaceDetected || m_world.m_numWriters[type]++ > 0 || m_world.m_numReaders[type] > 0;
+			}
+
+			// The result depends on the order of the accesses, so any reordering of the conflicting systems changes it
+			for (size_t i = 0; i < SyntheticBufferSize; i++)
+			{
+				float input = (float)m_order;
+				for (const auto& type : m_reads)
+				{
+					input += m_world.m_buffers[type][i];
+				}
+
+				for (const auto& type : m_writes)
+				{
+					float value = m_world.m_buffers[type][i];
+					for (uint32_t k = 0; k < m_numIterations; k++)
+					{
+						value = value * 0.75f + std::sqrt(std::abs(input - value) + 1.0f);
+					}
+
+					m_world.m_buffers[type][i] = value;
+				}
+			}
+
+			for (const auto& type : m_reads)
+			{
+				m_world.m_numReaders[type]--;
+			}
+
+			for (const auto& type : m_writes)
+			{
+				m_world.m_numWriters[type]--;
+			}
+
+			return nullptr;
+		}
+
+	protected:
+
+		SyntheticWorld& m_world;
+		TVector<size_t> m_reads;
+		TVector<size_t> m_writes;
+		uint32_t m_order = 0;
+		uint32_t m_numIterations = 0;
+	};
+
+	class TestCase_SystemsGraph
+	{
+	public:
+
+		TestCase_SystemsGraph(uint32_t numTypes) : m_world(numTypes) {}
+
+		void AddSystem(TVector<size_t> reads, TVector<size_t> writes, uint32_t numIterations)
+		{
+			m_systems.Add(TUniquePtr<SyntheticSystem>::Make(m_world, std::move(reads), std::move(writes), (uint32_t)m_systems.Num(), numIterations));
+		}
+
+		void Build()
+		{
+			TVector<TBaseSystem*> systems;
+			for (auto& system : m_systems)
+			{
+				systems.Add(system.GetRawPtr());
+			}
+
+			m_graph.Build(systems);
+		}
+
+		int64_t RunSequential(uint32_t numFrames)
+		{
+			Timer timer;
+			timer.Start();
+
+			for (uint32_t frame = 0; frame < numFrames; frame++)
+			{
+				for (auto& system : m_systems)
+				{
+					system->Tick(0.0f);
+				}
+			}
+
+			timer.Stop();
+			return timer.ResultMs();
+		}
+
+		int64_t RunGraph(uint32_t numFrames)
+		{
+			Timer timer;
+			timer.Start();
+
+			for (uint32_t frame = 0; frame < numFrames; frame++)
+			{
+				m_graph.Tick(0.0f);
+			}
+
+			timer.Stop();
+			return timer.ResultMs();
+		}
+
+		const SystemsGraph& GetGraph() const { return m_graph; }
+		const SyntheticWorld& GetWorld() const { return m_world; }
+
+		bool IsBitwiseEqual(const TestCase_SystemsGraph& rhs) const
+		{
+			for (size_t type = 0; type < m_world.m_buffers.Num(); type++)
+			{
+				if (memcmp(m_world.m_buffers[type].GetData(), rhs.m_world.m_buffers[type].GetData(), SyntheticBufferSize * sizeof(float)) != 0)
+				{
+					return false;
+				}
+			}
+
+			return true;
+		}
+
+	protected:
+
+		SyntheticWorld m_world;
+		TVector<TUniquePtr<SyntheticSystem>> m_systems;
+		SystemsGraph m_graph;
+	};
+
+	// The layout of the engine's systems: Transform, Camera, Lighting, StaticMeshRenderer
+	enum EEngineBuffer : size_t { TransformBuffer = 0, CameraBuffer, LightBuffer, MeshBuffer, GameObjectBuffer, CommandListBuffer, NumEngineBuffers };
+
+	void FillEngineLayout(TestCase_SystemsGraph& test, uint32_t numIterations)
+	{
+		test.AddSystem({}, { TransformBuffer, GameObjectBuffer }, numIterations);
+		test.AddSystem({ TransformBuffer }, { CameraBuffer }, numIterations);
+		test.AddSystem({ TransformBuffer }, { LightBuffer, GameObjectBuffer, CommandListBuffer }, numIterations);
+		test.AddSystem({ TransformBuffer }, { MeshBuffer, GameObjectBuffer }, numIterations);
+		test.Build();
+	}
+
+	// The systems that read the shared components and write their own, the last one reads all of them
+	void FillWideLayout(TestCase_SystemsGraph& test, uint32_t numSystems, uint32_t numIterations)
+	{
+		test.AddSystem({}, { 0 }, numIterations);
+
+		TVector<size_t> all;
+		for (uint32_t i = 1; i <= numSystems - 2; i++)
+		{
+			test.AddSystem({ 0 }, { i }, numIterations);
+			all.Add(i);
+		}
+
+		test.AddSystem(all, { 0 }, numIterations);
+		test.Build();
+	}
+
+	void FillRandomLayout(TestCase_SystemsGraph& test, uint32_t numTypes, uint32_t numSystems, uint32_t seed)
+	{
+		std::mt19937 random(seed);
+
+		for (uint32_t i = 0; i < numSystems; i++)
+		{
+			TVector<size_t> reads;
+			TVector<size_t> writes;
+
+			const uint32_t numReads = random() % 3;
+			const uint32_t numWrites = 1 + random() % 2;
+
+			for (uint32_t k = 0; k < numReads; k++)
+			{
+				reads.Add(random() % numTypes);
+			}
+
+			for (uint32_t k = 0; k < numWrites; k++)
+			{
+				const size_t type = random() % numTypes;
+				if (!writes.Contains(type))
+				{
+					writes.Add(type);
+				}
+			}
+
+			// The system could read what it writes
+			reads.RemoveAll([&](const auto& type) { return writes.Contains(type); });
+
+			test.AddSystem(std::move(reads), std::move(writes), 4);
+		}
+
+		test.Build();
+	}
+}
+
+void Sailor::ECS::RunSystemsGraphBenchmark()
+{
+	printf("\nStarting ECS systems graph benchmark...\n");
+
+	const uint32_t numThreads = App::GetSubmodule<Tasks::Scheduler>()->GetNumWorkerThreads(Tasks::EThreadType::Worker);
+
+	// Camera, Lighting and StaticMeshRenderer wait Transform only, StaticMeshRenderer waits Lighting because both write the game objects
+	{
+		TestCase_SystemsGraph sequential(NumEngineBuffers);
+		TestCase_SystemsGraph parallel(NumEngineBuffers);
+		FillEngineLayout(sequential, 16);
+		FillEngineLayout(parallel, 16);
+
+		const auto& graph = parallel.GetGraph();
+		const bool bIsExpected = graph.GetNumLevels() == 3 &&
+			graph.GetDependencies(0).Num() == 0 &&
+			graph.GetDependencies(1).Num() == 1 && graph.GetDependencies(1)[0] == 0 &&
+			graph.GetDependencies(2).Num() == 1 && graph.GetDependencies(2)[0] == 0 &&
+			graph.GetDependencies(3).Num() == 1 && graph.GetDependencies(3)[0] == 2;
+
+		const uint32_t numFrames = 100;
+		const int64_t sequentialMs = sequential.RunSequential(numFrames);
+		const int64_t parallelMs = parallel.RunGraph(numFrames);
+
+		SAILOR_LOG("Engine layout (Transform, Camera, Lighting, StaticMeshRenderer), %u worker threads, %u frames:\n\tdependencies as expected %d, %u levels\n\tsequential %lldms, graph %lldms, speedup %.2f\n\tresults match %d, races detected %d",
+			numThreads, numFrames, bIsExpected, graph.GetNumLevels(),
+			sequentialMs, parallelMs, parallelMs ? (float)sequentialMs / parallelMs : 1.0f,
+			sequential.IsBitwiseEqual(parallel), (bool)parallel.GetWorld().m_bIsRaceDetected);
+	}
+
+	for (const uint32_t numSystems : { 4u, 8u, 16u, 32u })
+	{
+		TestCase_SystemsGraph sequential(numSystems);
+		TestCase_SystemsGraph parallel(numSystems);
+		FillWideLayout(sequential, numSystems, 16);
+		FillWideLayout(parallel, numSystems, 16);
+
+		const uint32_t numFrames = 400 / numSystems;
+		const int64_t sequentialMs = sequential.RunSequential(numFrames);
+		const int64_t parallelMs = parallel.RunGraph(numFrames);
+
+		SAILOR_LOG("Wide layout, %u systems, %u levels, %u frames:\n\tframe time sequential %.2fms, graph %.2fms, speedup %.2f\n\tresults match %d, races detected %d",
+			numSystems, parallel.GetGraph().GetNumLevels(), numFrames,
+			(float)sequentialMs / numFrames, (float)parallelMs / numFrames, parallelMs ? (float)sequentialMs / parallelMs : 1.0f,
+			sequential.IsBitwiseEqual(parallel), (bool)parallel.GetWorld().m_bIsRaceDetected);
+	}
+
+	// The graphs by the random reads and writes should produce the same results as the sequential tick
+	const uint32_t numRandomGraphs = 32;
+	uint32_t numMatched = 0;
+	uint32_t numRaces = 0;
+	for (uint32_t seed = 0; seed < numRandomGraphs; seed++)
+	{
+		TestCase_SystemsGraph sequential(8);
+		TestCase_SystemsGraph parallel(8);
+		FillRandomLayout(sequential, 8, 16, seed);
+		FillRandomLayout(parallel, 8, 16, seed);
+
+		sequential.RunSequential(4);
+		parallel.RunGraph(4);
+
+		numMatched += sequential.IsBitwiseEqual(parallel) ? 1 : 0;
+		numRaces += parallel.GetWorld().m_bIsRaceDetected ? 1 : 0;
+	}
+
+	SAILOR_LOG("Random layouts, 16 systems, 8 component types: %u/%u results match, %u with races", numMatched, numRandomGraphs, numRaces);
+}
+
+namespace
+{
+	enum class EHierarchy : uint8_t
+	{
+		// 100 children per root
+		Wide = 0,
+		// Each node has 4 children
+		Tree,
+		// The chains of 100 nodes
+		Deep
+	};
+
+	const char* HierarchyNames[] = { "wide (100 children per root)", "tree (4 children per node)", "deep (chains of 100)" };
+
+	class TestCase_TransformHierarchy
+	{
+	public:
+
+		TestCase_TransformHierarchy(EHierarchy hierarchy, uint32_t count, ETransformPropagation propagation) : m_world("TransformHierarchyBenchmark")
+		{
+			std::mt19937 random(count);
+			std::uniform_real_distribution<float> dist(-10.0f, 10.0f);
+
+			m_ecs = m_world.GetECS<TransformECS>();
+			m_ecs->SetPropagation(propagation);
+
+			m_objects.Reserve(count);
+			for (uint32_t i = 0; i < count; i++)
+			{
+				m_objects.Add(m_world.Instantiate(glm::vec3(dist(random), dist(random), dist(random))));
+				m_objects[i]->GetTransformComponent().SetRotation(glm::angleAxis(dist(random), glm::normalize(glm::vec3(dist(random), dist(random), dist(random)) + 0.01f)));
+			}
+
+			for (uint32_t i = 0; i < count; i++)
+			{
+				size_t parent = InvalidIndex;
+				switch (hierarchy)
+				{
+				case EHierarchy::Wide:
+					parent = (i % 101 == 0) ? InvalidIndex : i - i % 101;
+					break;
+				case EHierarchy::Tree:
+					parent = (i == 0) ? InvalidIndex : (i - 1) / 4;
+					break;
+				case EHierarchy::Deep:
+					parent = (i % 100 == 0) ? InvalidIndex : i - 1;
+					break;
+				}
+
+				if (parent != InvalidIndex)
+				{
+					m_ecs->SetParent(&m_objects[i]->GetTransformComponent(), &m_objects[parent]->GetTransformComponent());
+				}
+			}
+
+			m_ecs->Tick(0.0f);
+			m_ecs->PostTick();
+		}
+
+		~TestCase_TransformHierarchy()
+		{
+			m_objects.Clear();
+			m_world.Clear();
+		}
+
+		// The same transforms are changed in the same way for the same seed
+		int64_t Run(uint32_t numFrames, float dirtyRatio, uint32_t seed)
+		{
+			std::mt19937 random(seed);
+			std::uniform_real_distribution<float> dist(-10.0f, 10.0f);
+			std::uniform_int_distribution<size_t> index(0, m_objects.Num() - 1);
+
+			const size_t numDirty = (size_t)(dirtyRatio * m_objects.Num());
+
+			Timer timer;
+			for (uint32_t frame = 0; frame < numFrames; frame++)
+			{
+				for (size_t i = 0; i < numDirty; i++)
+				{
+					const size_t k = numDirty == m_objects.Num() ? i : index(random);
+					m_objects[k]->GetTransformComponent().SetPosition(glm::vec3(dist(random), dist(random), dist(random)));
+				}
+
+				timer.Start();
+				m_ecs->Tick(0.0f);
+				timer.Stop();
+
+				m_ecs->PostTick();
+			}
+
+			return timer.ResultAccumulatedMs();
+		}
+
+		float GetMaxDifference(const TestCase_TransformHierarchy& rhs) const
+		{
+			float res = 0.0f;
+			for (size_t i = 0; i < m_objects.Num(); i++)
+			{
+				const glm::mat4& lhsMatrix = m_objects[i]->GetTransformComponent().GetCachedWorldMatrix();
+				const glm::mat4& rhsMatrix = rhs.m_objects[i]->GetTransformComponent().GetCachedWorldMatrix();
+
+				for (int32_t column = 0; column < 4; column++)
+				{
+					const glm::vec4 delta = glm::abs(lhsMatrix[column] - rhsMatrix[column]);
+					res = std::max(res, std::max(std::max(delta.x, delta.y), std::max(delta.z, delta.w)));
+				}
+			}
+
+			return res;
+		}
+
+		// The world matrices are multiplied from the root by glm
+		bool IsValid() const
+		{
+			TVector<size_t> chain;
+			for (size_t i = 0; i < m_objects.Num(); i++)
+			{
+				auto& transform = m_objects[i]->GetTransformComponent();
+
+				chain.Clear(false);
+				for (size_t parent = transform.GetParent(); parent != InvalidIndex; parent = m_ecs->GetComponentData(parent).GetParent())
+				{
+					chain.Add(parent);
+				}
+
+				glm::mat4 expected = glm::mat4(1.0f);
+				for (int64_t k = (int64_t)chain.Num() - 1; k >= 0; k--)
+				{
+					expected = expected * m_ecs->GetComponentData(chain[k]).GetTransform().Matrix();
+				}
+				expected = expected * transform.GetTransform().Matrix();
+
+				for (int32_t column = 0; column < 4; column++)
+				{
+					const glm::vec4 delta = glm::abs(expected[column] - transform.GetCachedWorldMatrix()[column]);
+					if (std::max(std::max(delta.x, delta.y), std::max(delta.z, delta.w)) > 1e-3f)
+					{
+						return false;
+					}
+				}
+			}
+
+			return true;
+		}
+
+	protected:
+
+		World m_world;
+		TransformECS* m_ecs = nullptr;
+		TVector<GameObjectPtr> m_objects;
+	};
+}
+
+void Sailor::ECS::RunTransformPropagationBenchmark()
+{
+	printf("\nStarting transform propagation benchmark...\n");
+
+	const uint32_t count = 100000;
+	const uint32_t numFrames = 20;
+	const uint32_t numThreads = App::GetSubmodule<Tasks::Scheduler>()->GetNumWorkerThreads(Tasks::EThreadType::Worker) + 1;
+
+	for (const auto hierarchy : { EHierarchy::Wide, EHierarchy::Tree, EHierarchy::Deep })
+	{
+		TestCase_TransformHierarchy recursive(hierarchy, count, ETransformPropagation::Recursive);
+		TestCase_TransformHierarchy levels(hierarchy, count, ETransformPropagation::Levels);
+
+		SAILOR_LOG("%u transforms, %s, %u threads, %u frames:", count, HierarchyNames[(uint32_t)hierarchy], numThreads, numFrames);
+
+		uint32_t seed = 0;
+		for (const float dirtyRatio : { 0.001f, 0.01f, 0.1f, 0.5f, 1.0f })
+		{
+			const int64_t recursiveMs = recursive.Run(numFrames, dirtyRatio, seed);
+			const int64_t levelsMs = levels.Run(numFrames, dirtyRatio, seed);
+			seed++;
+
+			const bool bAutoLevels = count >= TransformECS::LevelsMinComponents && (size_t)(dirtyRatio * count) * TransformECS::LevelsMinDirtyFraction >= count;
+
+			SAILOR_LOG("\t%.1f%% dirty: recursive %.2fms, levels %.2fms per frame, speedup %.2f, auto picks %s, max difference %e",
+				dirtyRatio * 100.0f, (float)recursiveMs / numFrames, (float)levelsMs / numFrames,
+				levelsMs ? (float)recursiveMs / levelsMs : 1.0f, bAutoLevels ? "levels" : "recursive",
+				recursive.GetMaxDifference(levels));
+		}
+
+		SAILOR_LOG("\tmatches the reference %d", recursive.IsValid() && levels.IsValid());
+	}
+}
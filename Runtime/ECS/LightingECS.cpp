@@ -3,6 +3,7 @@
 #include "RHI/Shader.h"
 #include "RHI/Texture.h"
 #include "RHI/RenderTarget.h"
+#include "RHI/CommandList.h"
 #include "RHI/SceneView.h"
 #include "RHI/DebugContext.h"
 #include "Engine/GameObject.h"
@@ -75,6 +76,19 @@ void LightingECS::BeginPlay()
 	m_shadowIndices = Sailor::RHI::Renderer::GetDriver()->AddSsboToShaderBindings(shaderBindingSet, "shadowIndices", sizeof(uint32_t), LightingECS::MaxShadowsInView, 7);
 }
 
+TVector<size_t> LightingECS::GetReadComponents() const
+{
+	return { TransformECS::GetComponentStaticType() };
+}
+
+// The lights are uploaded by the world's command list, that can't be recorded by the other systems simultaneously
+TVector<size_t> LightingECS::GetWriteComponents() const
+{
+	return { GetComponentStaticType(),
+		std::type_index(typeid(GameObject)).hash_code(),
+		std::type_index(typeid(RHI::RHICommandList)).hash_code() };
+}
+
 Tasks::ITaskPtr LightingECS::Tick(float deltaTime)
 {
 	SAILOR_PROFILE_FUNCTION();
@@ -85,6 +85,9 @@ namespace Sailor
 		SAILOR_API virtual void EndPlay() override;
 		SAILOR_API virtual uint32_t GetOrder() const override { return 150; }
 
+		SAILOR_API virtual TVector<size_t> GetReadComponents() const override;
+		SAILOR_API virtual TVector<size_t> GetWriteComponents() const override;
+
 		void FillLightingData(RHI::RHISceneViewPtr& sceneView);
 		
 		float GetShadowsOccupiedMemoryMb() const { return m_shadowMapsMb; }
@@ -11,7 +11,18 @@ using namespace Sailor::Tasks;
 
 void StaticMeshRendererECS::BeginPlay()
 {
-	m_sceneViewProxiesCache = RHI::RHISceneViewPtr::Make();
+	m_stationaryOctree.Clear();
+	m_staticOctree.Clear();
+}
+
+TVector<size_t> StaticMeshRendererECS::GetReadComponents() const
+{
+	return { TransformECS::GetComponentStaticType() };
+}
+
+TVector<size_t> StaticMeshRendererECS::GetWriteComponents() const
+{
+	return { GetComponentStaticType(), std::type_index(typeid(GameObject)).hash_code() };
 }
 
 Tasks::ITaskPtr StaticMeshRendererECS::Tick(float deltaTime)
@@ -41,7 +52,7 @@ Tasks::ITaskPtr StaticMeshRendererECS::Tick(float deltaTime)
 					proxy.m_worldMatrix = ownerTransform.GetCachedWorldMatrix();
 
 					adjustedBounds.Apply(proxy.m_worldMatrix);
-					m_sceneViewProxiesCache->m_stationaryOctree.Update(glm::vec4(adjustedBounds.GetCenter(), 1), adjustedBounds.GetExtents(), proxy);
+					m_stationaryOctree.Update(glm::vec4(adjustedBounds.GetCenter(), 1), adjustedBounds.GetExtents(), proxy);
 
 					data.m_frameLastChange = ownerTransform.GetFrameLastChange();
 
@@ -52,7 +63,7 @@ Tasks::ITaskPtr StaticMeshRendererECS::Tick(float deltaTime)
 				}
 			}
 		}
-	}, EThreadType::RHI)->Run();
+	}, EThreadType::RHI, EPriority::High)->Run();
 
 	auto updateStaticTask = Tasks::CreateTask("StaticMeshRendererECS:Update Static Objects",
 		[this]()
@@ -86,7 +97,7 @@ Tasks::ITaskPtr StaticMeshRendererECS::Tick(float deltaTime)
 					}
 
 					adjustedBounds.Apply(proxy.m_worldMatrix);
-					m_sceneViewProxiesCache->m_staticOctree.Update(glm::vec4(adjustedBounds.GetCenter(), 1), adjustedBounds.GetExtents(), proxy);
+					m_staticOctree.Update(glm::vec4(adjustedBounds.GetCenter(), 1), adjustedBounds.GetExtents(), proxy);
 					
 					data.m_frameLastChange = ownerTransform.GetFrameLastChange();
 
@@ -97,7 +108,7 @@ Tasks::ITaskPtr StaticMeshRendererECS::Tick(float deltaTime)
 				}
 			}
 		}
-	}, EThreadType::RHI)->Run();
+	}, EThreadType::RHI, EPriority::High)->Run();
 
 	updateStaticTask->Wait();
 	updateStationaryTask->Wait();
@@ -107,12 +118,15 @@ Tasks::ITaskPtr StaticMeshRendererECS::Tick(float deltaTime)
 
 void StaticMeshRendererECS::CopySceneView(RHI::RHISceneViewPtr& outProxies)
 {
-	outProxies->m_stationaryOctree = m_sceneViewProxiesCache->m_stationaryOctree;
-	outProxies->m_staticOctree = m_sceneViewProxiesCache->m_staticOctree;
+	SAILOR_PROFILE_FUNCTION();
+
+	outProxies->m_stationaryOctree = m_stationaryOctree.GetSnapshot();
+	outProxies->m_staticOctree = m_staticOctree.GetSnapshot();
 }
 
 void StaticMeshRendererECS::EndPlay()
 {
 	ECS::TSystem<StaticMeshRendererECS, StaticMeshRendererData>::EndPlay();
-	m_sceneViewProxiesCache.Clear();
+	m_stationaryOctree.Clear();
+	m_staticOctree.Clear();
 }
@@ -7,6 +7,7 @@
 #include "Math/Transform.h"
 #include "Memory/Memory.h"
 #include "RHI/SceneView.h"
+#include "Containers/OctreeSnapshots.h"
 #include "Memory/UniquePtr.hpp"
 
 namespace Sailor
@@ -38,13 +39,19 @@ namespace Sailor
 		virtual void EndPlay() override;
 
 		virtual Tasks::ITaskPtr Tick(float deltaTime) override;
+
+		// The scene view gets the snapshots of the octrees, only the changes since the snapshot was used the last time are applied to it
 		void CopySceneView(RHI::RHISceneViewPtr& outProxies);
 
 		virtual uint32_t GetOrder() const override { return 1000; }
 
+		virtual TVector<size_t> GetReadComponents() const override;
+		virtual TVector<size_t> GetWriteComponents() const override;
+
 	protected:
 
-		RHI::RHISceneViewPtr m_sceneViewProxiesCache;
+		TOctreeSnapshots<RHI::RHIMeshProxy> m_stationaryOctree{ glm::ivec3(0,0,0), 16536 * 16, 4 };
+		TOctreeSnapshots<RHI::RHISceneViewProxy> m_staticOctree{ glm::ivec3(0,0,0), 16536 * 16, 4 };
 	};
 
 	template ECS::TSystem<StaticMeshRendererECS, StaticMeshRendererData>;
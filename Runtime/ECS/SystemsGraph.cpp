@@ -0,0 +1,140 @@
+#include <typeinfo>
+#include "ECS/SystemsGraph.h"
+#include "Tasks/Tasks.h"
+
+using namespace Sailor;
+using namespace Sailor::ECS;
+
+namespace
+{
+	__forceinline bool Contains(const TVector<size_t>& types, size_t type)
+	{
+		for (const auto& t : types)
+		{
+			if (t == type)
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	// The write conflicts with any access of the same type and AllComponents conflicts with everything
+	bool IsWriteConflicting(const TVector<size_t>& writes, const TVector<size_t>& reads, const TVector<size_t>& otherWrites)
+	{
+		if (writes.Num() > 0 && (reads.Num() > 0 || otherWrites.Num() > 0) && Contains(writes, AllComponents))
+		{
+			return true;
+		}
+
+		for (const auto& type : writes)
+		{
+			if (Contains(reads, type) || Contains(otherWrites, type))
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+}
+
+bool SystemsGraph::IsConflicting(const TVector<size_t>& lhsReads, const TVector<size_t>& lhsWrites,
+	const TVector<size_t>& rhsReads, const TVector<size_t>& rhsWrites)
+{
+	return IsWriteConflicting(lhsWrites, rhsReads, rhsWrites) || IsWriteConflicting(rhsWrites, lhsReads, lhsWrites);
+}
+
+void SystemsGraph::Build(const TVector<TBaseSystem*>& sortedSystems)
+{
+	SAILOR_PROFILE_FUNCTION();
+
+	const size_t numSystems = sortedSystems.Num();
+
+	m_systems = sortedSystems;
+	m_taskNames.Clear();
+	m_dependencies.Clear();
+	m_dependencies.Resize(numSystems);
+	m_numLevels = 0;
+
+	TVector<TVector<size_t>> reads(numSystems);
+	TVector<TVector<size_t>> writes(numSystems);
+
+	for (size_t i = 0; i < numSystems; i++)
+	{
+		reads[i] = m_systems[i]->GetReadComponents();
+		writes[i] = m_systems[i]->GetWriteComponents();
+
+		m_taskNames.Add(std::string("ECS Tick: ") + typeid(*m_systems[i]).name());
+	}
+
+	// The system's ancestors, so the edges that are already implied are not added
+	TVector<TVector<bool>> reachable(numSystems);
+	TVector<uint32_t> levels(numSystems);
+
+	for (size_t j = 0; j < numSystems; j++)
+	{
+		reachable[j].AddDefault(numSystems);
+		levels[j] = 1;
+
+		// The closest system goes first, so the farther ones are mostly reachable through it
+		for (int64_t i = (int64_t)j - 1; i >= 0; i--)
+		{
+			if (reachable[j][i] || !IsConflicting(reads[i], writes[i], reads[j], writes[j]))
+			{
+				continue;
+			}
+
+			m_dependencies[j].Add((uint32_t)i);
+			levels[j] = std::max(levels[j], levels[i] + 1);
+
+			reachable[j][i] = true;
+			for (size_t k = 0; k < (size_t)i; k++)
+			{
+				reachable[j][k] = reachable[j][k] || reachable[i][k];
+			}
+		}
+
+		m_numLevels = std::max(m_numLevels, levels[j]);
+	}
+}
+
+void SystemsGraph::Tick(float deltaTime)
+{
+	SAILOR_PROFILE_FUNCTION();
+
+	TVector<Tasks::ITaskPtr> tasks;
+	tasks.Reserve(m_systems.Num());
+
+	for (size_t i = 0; i < m_systems.Num(); i++)
+	{
+		TBaseSystem* pSystem = m_systems[i];
+
+		// The system could return the task that is still running, the dependent systems should wait it too
+		auto task = Tasks::CreateTask(m_taskNames[i], [pSystem, deltaTime]()
+			{
+				if (Tasks::ITaskPtr systemTask = pSystem->Tick(deltaTime))
+				{
+					systemTask->Wait();
+				}
+			});
+
+		for (const auto& dependency : m_dependencies[i])
+		{
+			task->Join(tasks[dependency]);
+		}
+
+		tasks.Emplace(std::move(task));
+	}
+
+	for (auto& task : tasks)
+	{
+		task->Run();
+	}
+
+	for (auto& task : tasks)
+	{
+		task->Wait();
+	}
+}
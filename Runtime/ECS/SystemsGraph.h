@@ -0,0 +1,42 @@
+#pragma once
+#include "Sailor.h"
+#include "Core/Defines.h"
+#include "Containers/Vector.h"
+#include "ECS/ECS.h"
+
+namespace Sailor::ECS
+{
+	/* The dependency graph of the systems that is built by their declared reads and writes.
+	*  The system depends on the previous (in GetOrder order) systems that write what it accesses or access what it writes,
+	*  so the results are the same as the sequential tick, while the independent systems are ticked concurrently.
+	*  The tasks are created each frame, the graph is rebuilt by Build when the systems are changed.
+	*/
+	class SystemsGraph
+	{
+	public:
+
+		// The systems should be sorted by GetOrder
+		SAILOR_API void Build(const TVector<TBaseSystem*>& sortedSystems);
+
+		// Ticks all the systems on the worker threads and returns when all of them (and the tasks they return) are finished
+		SAILOR_API void Tick(float deltaTime);
+
+		SAILOR_API size_t Num() const { return m_systems.Num(); }
+
+		// The indices of the systems that should be finished before the system starts
+		SAILOR_API const TVector<uint32_t>& GetDependencies(size_t systemIndex) const { return m_dependencies[systemIndex]; }
+
+		// The length of the longest dependency chain, 1 means that all the systems are independent
+		SAILOR_API uint32_t GetNumLevels() const { return m_numLevels; }
+
+		SAILOR_API static bool IsConflicting(const TVector<size_t>& lhsReads, const TVector<size_t>& lhsWrites,
+			const TVector<size_t>& rhsReads, const TVector<size_t>& rhsWrites);
+
+	protected:
+
+		TVector<TBaseSystem*> m_systems;
+		TVector<std::string> m_taskNames;
+		TVector<TVector<uint32_t>> m_dependencies;
+		uint32_t m_numLevels = 0;
+	};
+}
@@ -1,9 +1,18 @@
+#include <cstring>
 #include "ECS/TransformECS.h"
 #include "Engine/GameObject.h"
+#include "Tasks/ParallelFor.h"
+#include "Math/Math.h"
 
 using namespace Sailor;
 using namespace Sailor::Tasks;
 
+namespace
+{
+	const size_t RelativeMatricesGrainSize = 1024;
+	const size_t LevelGrainSize = 1024;
+}
+
 /*
 void TransformComponent::SetPosition(const glm::vec4& position)
 {
@@ -52,11 +61,82 @@ void TransformComponent::MarkDirty()
 	m_frameLastChange = GetOwner().StaticCast<GameObject>()->GetWorld()->GetCurrentFrame();
 }
 
+size_t TransformECS::RegisterComponent()
+{
+	m_bIsHierarchyDirty = true;
+	return ECS::TSystem<TransformECS, TransformComponent>::RegisterComponent();
+}
+
+void TransformECS::UnregisterComponent(size_t index)
+{
+	if (index != ECS::InvalidIndex)
+	{
+		auto& data = m_components[index];
+
+		// The children become the roots
+		for (const auto& child : data.m_children)
+		{
+			m_components[child].m_parent = ECS::InvalidIndex;
+		}
+
+		if (data.m_parent != ECS::InvalidIndex)
+		{
+			m_components[data.m_parent].m_children.RemoveFirst(index);
+		}
+
+		data.m_children.Clear();
+		data.m_parent = ECS::InvalidIndex;
+
+		m_bIsHierarchyDirty = true;
+	}
+
+	ECS::TSystem<TransformECS, TransformComponent>::UnregisterComponent(index);
+}
+
+void TransformECS::SetParent(TransformComponent* child, TransformComponent* parent)
+{
+	const size_t index = GetComponentIndex(child);
+	const size_t parentIndex = parent ? GetComponentIndex(parent) : ECS::InvalidIndex;
+
+	auto& data = m_components[index];
+	if (data.m_parent == parentIndex)
+	{
+		return;
+	}
+
+	// The parent could not be the descendant
+	for (size_t i = parentIndex; i != ECS::InvalidIndex; i = m_components[i].m_parent)
+	{
+		check(i != index);
+	}
+
+	if (data.m_parent != ECS::InvalidIndex)
+	{
+		m_components[data.m_parent].m_children.RemoveFirst(index);
+	}
+
+	data.m_parent = parentIndex;
+
+	if (parentIndex != ECS::InvalidIndex)
+	{
+		m_components[parentIndex].m_children.Add(index);
+	}
+
+	m_bIsHierarchyDirty = true;
+	child->MarkDirty();
+}
+
 void TransformECS::MarkDirty(TransformComponent* ptr)
 {
 	m_dirtyComponents.Add(TransformECS::GetComponentIndex(ptr));
 }
 
+// The frame of the last change is written to the game objects
+TVector<size_t> TransformECS::GetWriteComponents() const
+{
+	return { GetComponentStaticType(), std::type_index(typeid(GameObject)).hash_code() };
+}
+
 Tasks::ITaskPtr TransformECS::PostTick()
 {
 	m_dirtyComponents.Clear(false);
@@ -67,6 +147,17 @@ Tasks::ITaskPtr TransformECS::Tick(float deltaTime)
 {
 	SAILOR_PROFILE_FUNCTION();
 
+	const bool bUseLevels = m_propagation == ETransformPropagation::Levels ||
+		(m_propagation == ETransformPropagation::Auto &&
+			m_components.Num() >= LevelsMinComponents &&
+			m_dirtyComponents.Num() * LevelsMinDirtyFraction >= m_components.Num());
+
+	if (bUseLevels)
+	{
+		PropagateByLevels();
+		return nullptr;
+	}
+
 	// We guess that the amount of changed transform during frame
 	// Could be much less than the whole transforms num
 
@@ -137,26 +228,130 @@ Tasks::ITaskPtr TransformECS::Tick(float deltaTime)
 	return nullptr;
 }
 
-void TransformECS::CalculateMatrices(TransformComponent& parent)
+void TransformECS::CalculateMatrices(TransformComponent& root)
 {
-	const glm::mat4x4& parentMatrix = parent.GetCachedRelativeMatrix();
+	if (root.m_parent == ECS::InvalidIndex)
+	{
+		root.m_cachedWorldMatrix = root.m_cachedRelativeMatrix;
+	}
+	else
+	{
+		Math::MultiplyMatrices(m_components[root.m_parent].m_cachedWorldMatrix, root.m_cachedRelativeMatrix, root.m_cachedWorldMatrix);
+	}
 
-	if (parent.m_parent == ECS::InvalidIndex)
+	// The children are moved with the parent, so they are changed as well
+	const size_t currentFrame = GetWorld()->GetCurrentFrame();
+	root.m_frameLastChange = currentFrame;
+	root.m_bIsDirty = false;
+
+	UpdateGameObject(root.GetOwner().StaticCast<GameObject>(), currentFrame);
+
+	for (auto& child : root.GetChildren())
 	{
-		parent.m_cachedWorldMatrix = parent.m_cachedRelativeMatrix;
+		if (m_components[child].m_bIsActive)
+		{
+			CalculateMatrices(m_components[child]);
+		}
 	}
+}
 
-	for (auto& child : parent.GetChildren())
+void TransformECS::PropagateByLevels()
+{
+	SAILOR_PROFILE_FUNCTION();
+
+	if (m_bIsHierarchyDirty)
 	{
-		m_components[child].m_cachedWorldMatrix = parentMatrix * m_components[child].m_cachedRelativeMatrix;
+		UpdateHierarchyLevels();
+	}
+
+	const size_t currentFrame = GetWorld()->GetCurrentFrame();
 
-		CalculateMatrices(m_components[child]);
+	Tasks::ParallelFor("TransformECS:Update Relative Matrices", 0, m_dirtyComponents.Num(), RelativeMatricesGrainSize,
+		[this](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				auto& data = m_components[m_dirtyComponents[i]];
+				if (data.m_bIsActive)
+				{
+					data.m_cachedRelativeMatrix = data.m_transform.Matrix();
+				}
+			}
+		});
+
+	// The transform is updated when it is dirty or its parent is updated
+	m_updatedFlags.Resize(m_components.Num());
+	memset(m_updatedFlags.GetData(), 0, m_updatedFlags.Num());
+	uint8_t* pUpdated = m_updatedFlags.GetData();
+
+	for (const auto& level : m_levels)
+	{
+		// The level reads the previous one only, so the transforms of the level don't depend on each other
+		Tasks::ParallelFor("TransformECS:Update Level", 0, level.Num(), LevelGrainSize,
+			[&](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; i++)
+				{
+					const size_t index = level[i];
+					auto& data = m_components[index];
+
+					const bool bIsParentUpdated = data.m_parent != ECS::InvalidIndex && pUpdated[data.m_parent];
+					if (!data.m_bIsActive || !(data.m_bIsDirty || bIsParentUpdated))
+					{
+						continue;
+					}
+
+					if (data.m_parent == ECS::InvalidIndex)
+					{
+						data.m_cachedWorldMatrix = data.m_cachedRelativeMatrix;
+					}
+					else
+					{
+						Math::MultiplyMatrices(m_components[data.m_parent].m_cachedWorldMatrix, data.m_cachedRelativeMatrix, data.m_cachedWorldMatrix);
+					}
+
+					data.m_frameLastChange = currentFrame;
+					data.m_bIsDirty = false;
+					pUpdated[index] = 1;
+
+					UpdateGameObject(data.GetOwner().StaticCast<GameObject>(), currentFrame);
+				}
+			});
 	}
+}
 
-	if (parent.m_bIsDirty)
+void TransformECS::UpdateHierarchyLevels()
+{
+	SAILOR_PROFILE_FUNCTION();
+
+	m_levels.Clear();
+
+	TVector<size_t> level;
+	for (size_t i = 0; i < m_components.Num(); i++)
 	{
-		UpdateGameObject(parent.GetOwner().StaticCast<GameObject>(), GetWorld()->GetCurrentFrame());
+		if (m_components[i].m_parent == ECS::InvalidIndex)
+		{
+			level.Add(i);
+		}
+	}
+
+	while (level.Num() > 0)
+	{
+		TVector<size_t> nextLevel;
+		for (const auto& index : level)
+		{
+			for (const auto& child : m_components[index].m_children)
+			{
+				nextLevel.Add(child);
+			}
+		}
+
+		// The level is iterated in the storage order
+		nextLevel.Sort();
+
+		m_levels.Emplace(std::move(level));
+		level = std::move(nextLevel);
 	}
 
-	parent.m_bIsDirty = false;
+	m_bIsHierarchyDirty = false;
 }
@@ -51,20 +51,56 @@ namespace Sailor
 		friend class TransformECS;
 	};
 
+	/* The world matrices are propagated by the recursive walk from the dirty transforms,
+	*  or, for the big scenes with many changes, level by level of the hierarchy: the transforms of the same depth
+	*  depend on the previous level only, so each level is processed by the worker threads in parallel.
+	*/
+	enum class ETransformPropagation : uint8_t
+	{
+		Auto = 0,
+		Recursive,
+		Levels
+	};
+
 	class SAILOR_API TransformECS : public ECS::TSystem<TransformECS, TransformComponent>
 	{
 	public:
 
+		// The smaller scenes or the fewer changes are handled by the recursive walk
+		static constexpr size_t LevelsMinComponents = 4096;
+		static constexpr size_t LevelsMinDirtyFraction = 16;
+
+		virtual size_t RegisterComponent() override;
+		virtual void UnregisterComponent(size_t index) override;
+
 		virtual Tasks::ITaskPtr PostTick() override;
 		virtual Tasks::ITaskPtr Tick(float deltaTime) override;
 
 		void MarkDirty(TransformComponent* ptr);
 		void CalculateMatrices(TransformComponent& root);
 
+		// Pass nullptr as the parent to make the transform the root
+		void SetParent(TransformComponent* child, TransformComponent* parent);
+
+		void SetPropagation(ETransformPropagation propagation) { m_propagation = propagation; }
+		ETransformPropagation GetPropagation() const { return m_propagation; }
+
 		virtual uint32_t GetOrder() const override { return 0; }
 
+		virtual TVector<size_t> GetWriteComponents() const override;
+
 	protected:
 
+		void UpdateHierarchyLevels();
+		void PropagateByLevels();
+
 		TVector<size_t> m_dirtyComponents;
+
+		// The component indices by their depth, the roots are the first level
+		TVector<TVector<size_t>> m_levels;
+		TVector<uint8_t> m_updatedFlags;
+		bool m_bIsHierarchyDirty = true;
+
+		ETransformPropagation m_propagation = ETransformPropagation::Auto;
 	};
 }
@@ -21,13 +21,45 @@ TransformComponent& GameObject::GetTransformComponent()
 	return m_pWorld->GetECS<TransformECS>()->GetComponentData(m_transformHandle);
 }
 
+ComponentPtr GameObject::AddComponentRaw(ComponentPtr component, ReflectionInfo reflection)
+{
+	check(component->GetTypeInfo() == reflection.GetTypeInfo());
+
+	if (m_bBeginPlayCalled)
+	{
+		AddComponentRaw(component);
+		Reflection::ApplyReflection(component.GetRawPtr(), reflection);
+		return component;
+	}
+
+	m_pendingReflections[component] = std::move(reflection);
+	return AddComponentRaw(component);
+}
+
+void GameObject::ApplyPendingReflection(const ComponentPtr& component)
+{
+	const ReflectionInfo* pReflection = nullptr;
+	if (m_pendingReflections.Num() > 0 && m_pendingReflections.Find(component, pReflection))
+	{
+		Reflection::ApplyReflection(component.GetRawPtr(), *pReflection);
+		m_pendingReflections.Remove(component);
+	}
+}
+
 bool GameObject::RemoveComponent(ComponentPtr component)
 {
 	check(component);
 
 	if (m_components.RemoveFirst(component) || m_componentsToAdd.RemoveFirst(component))
 	{
-		component->EndPlay();
+		m_pendingReflections.Remove(component);
+
+		// The loaded components could be destroyed before they begin play
+		if (component->m_bBeginPlayCalled)
+		{
+			component->EndPlay();
+		}
+
 		component.DestroyObject(m_pWorld->GetAllocator());
 		return true;
 	}
@@ -39,7 +71,11 @@ void GameObject::RemoveAllComponents()
 {
 	for (auto& el : m_components)
 	{
-		el->EndPlay();
+		if (el->m_bBeginPlayCalled)
+		{
+			el->EndPlay();
+		}
+
 		el.DestroyObject(m_pWorld->GetAllocator());
 	}
 
@@ -50,6 +86,8 @@ void GameObject::RemoveAllComponents()
 	}
 	
 	m_components.Clear(true);
+	m_componentsToAdd.Clear(true);
+	m_pendingReflections.Clear();
 }
 
 void GameObject::EndPlay()
@@ -69,6 +107,8 @@ void GameObject::Tick(float deltaTime)
 		{
 			el->BeginPlay();
 			el->m_bBeginPlayCalled = true;
+
+			ApplyPendingReflection(el);
 		}
 
 #ifdef SAILOR_EDITOR
@@ -33,6 +33,7 @@ namespace Sailor
 			auto newObject = TObjectPtr<TComponent>::Make(m_pWorld->GetAllocator(), std::forward<TArgs>(args) ...);
 
 			newObject->m_owner = m_self;
+			newObject->m_instanceId = InstanceId::CreateNewInstanceId();
 
 			if (m_bBeginPlayCalled)
 			{
@@ -55,7 +56,12 @@ namespace Sailor
 			check(!component->GetOwner().IsValid());
 
 			component->m_owner = m_self;
-			
+
+			if (!component->m_instanceId)
+			{
+				component->m_instanceId = InstanceId::CreateNewInstanceId();
+			}
+
 			if (m_bBeginPlayCalled)
 			{
 				component->BeginPlay();
@@ -70,6 +76,9 @@ namespace Sailor
 			return component;
 		}
 
+		// The reflection is applied when the component begins play, so the properties could rely on the initialized component
+		SAILOR_API ComponentPtr AddComponentRaw(ComponentPtr component, ReflectionInfo reflection);
+
 		template<typename TComponent>
 		SAILOR_API TObjectPtr<TComponent> GetComponent()
 		{
@@ -120,6 +129,11 @@ namespace Sailor
 		TVector<ComponentPtr> m_components;
 		TVector<ComponentPtr> m_componentsToAdd;
 
+		void ApplyPendingReflection(const ComponentPtr& component);
+
+		// The reflections of the components that are not started yet
+		TMap<ComponentPtr, ReflectionInfo> m_pendingReflections;
+
 		size_t m_frameLastChange = 0;
 
 		friend GameObjectPtr;
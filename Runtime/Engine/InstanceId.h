@@ -21,6 +21,7 @@ namespace Sailor
 		SAILOR_API InstanceId() = default;
 		SAILOR_API InstanceId(const InstanceId& inInstanceId) = default;
 		SAILOR_API InstanceId(InstanceId&& inInstanceId) = default;
+		SAILOR_API explicit InstanceId(std::string instanceId) : m_InstanceId(std::move(instanceId)) {}
 
 		SAILOR_API InstanceId& operator=(const InstanceId& inInstanceId) = default;
 		SAILOR_API InstanceId& operator=(InstanceId&& inInstanceId) = default;
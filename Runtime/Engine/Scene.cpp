@@ -1,5 +1,624 @@
 #include "Engine/Scene.h"
 #include "Tasks/Scheduler.h"
+#include "AssetRegistry/AssetRegistry.h"
+#include "Core/LogMacros.h"
+#include <filesystem>
+#include <fstream>
 
 using namespace Sailor;
 using namespace Sailor::Tasks;
+
+namespace
+{
+	// The component is stored as its reflection node, that is encoded without the text parsing
+	enum class ENodeTag : uint8_t
+	{
+		Null = 0,
+		Scalar,
+		Sequence,
+		Map
+	};
+
+	// The corrupted file should not blow the stack up
+	const uint32_t MaxNodeDepth = 64;
+
+	class BinaryWriter
+	{
+	public:
+
+		BinaryWriter(TVector<uint8_t>& data) : m_data(data) {}
+
+		template<typename T>
+		void Write(const T& value)
+		{
+			const size_t offset = m_data.Num();
+			m_data.AddDefault(sizeof(T));
+			memcpy(&m_data[offset], &value, sizeof(T));
+		}
+
+		void WriteString(const std::string& value)
+		{
+			Write((uint32_t)value.size());
+
+			const size_t offset = m_data.Num();
+			m_data.AddDefault(value.size());
+			memcpy(m_data.GetData() + offset, value.data(), value.size());
+		}
+
+		void WriteNode(const YAML::Node& node)
+		{
+			switch (node.Type())
+			{
+			case YAML::NodeType::Scalar:
+				Write(ENodeTag::Scalar);
+				WriteString(node.Scalar());
+				break;
+
+			case YAML::NodeType::Sequence:
+				Write(ENodeTag::Sequence);
+				Write((uint32_t)node.size());
+				for (const auto& el : node)
+				{
+					WriteNode(el);
+				}
+				break;
+
+			case YAML::NodeType::Map:
+				Write(ENodeTag::Map);
+				Write((uint32_t)node.size());
+				for (const auto& el : node)
+				{
+					WriteString(el.first.Scalar());
+					WriteNode(el.second);
+				}
+				break;
+
+			default:
+				Write(ENodeTag::Null);
+				break;
+			}
+		}
+
+	protected:
+
+		TVector<uint8_t>& m_data;
+	};
+
+	class BinaryReader
+	{
+	public:
+
+		BinaryReader(const TVector<uint8_t>& data) : m_pData(data.GetData()), m_size(data.Num()) {}
+
+		bool IsValid() const { return m_bIsValid; }
+		bool IsEnd() const { return m_offset == m_size; }
+		size_t GetRemainingSize() const { return m_size - m_offset; }
+
+		template<typename T>
+		bool Read(T& outValue)
+		{
+			if (!m_bIsValid || m_offset + sizeof(T) > m_size)
+			{
+				m_bIsValid = false;
+				return false;
+			}
+
+			memcpy(&outValue, m_pData + m_offset, sizeof(T));
+			m_offset += sizeof(T);
+			return true;
+		}
+
+		bool ReadString(std::string& outValue)
+		{
+			uint32_t length = 0;
+			if (!Read(length) || m_offset + length > m_size)
+			{
+				m_bIsValid = false;
+				return false;
+			}
+
+			outValue.assign(reinterpret_cast<const char*>(m_pData + m_offset), length);
+			m_offset += length;
+			return true;
+		}
+
+		YAML::Node ReadNode(uint32_t depth = 0)
+		{
+			ENodeTag tag = ENodeTag::Null;
+			if (depth >= MaxNodeDepth || !Read(tag))
+			{
+				m_bIsValid = false;
+				return YAML::Node();
+			}
+
+			uint32_t num = 0;
+			switch (tag)
+			{
+			case ENodeTag::Scalar:
+			{
+				std::string value;
+				ReadString(value);
+				return YAML::Node(value);
+			}
+
+			case ENodeTag::Sequence:
+			{
+				YAML::Node res(YAML::NodeType::Sequence);
+				Read(num);
+				for (uint32_t i = 0; i < num && m_bIsValid; i++)
+				{
+					res.push_back(ReadNode(depth + 1));
+				}
+				return res;
+			}
+
+			case ENodeTag::Map:
+			{
+				YAML::Node res(YAML::NodeType::Map);
+				Read(num);
+				for (uint32_t i = 0; i < num && m_bIsValid; i++)
+				{
+					std::string key;
+					ReadString(key);
+					res[key] = ReadNode(depth + 1);
+				}
+				return res;
+			}
+
+			case ENodeTag::Null:
+				return YAML::Node(YAML::NodeType::Null);
+
+			default:
+				m_bIsValid = false;
+				return YAML::Node();
+			}
+		}
+
+	protected:
+
+		const uint8_t* m_pData = nullptr;
+		size_t m_size = 0;
+		size_t m_offset = 0;
+		bool m_bIsValid = true;
+	};
+
+	// The ids of lhs are mapped to the ids of rhs, the rest of the scalars should be the same
+	bool IsNodeEqual(const YAML::Node& lhs, const YAML::Node& rhs, const TMap<std::string, std::string>& ids)
+	{
+		if (lhs.Type() != rhs.Type())
+		{
+			return false;
+		}
+
+		switch (lhs.Type())
+		{
+		case YAML::NodeType::Scalar:
+		{
+			if (lhs.Scalar() == rhs.Scalar())
+			{
+				return true;
+			}
+
+			const std::string* pMapped = nullptr;
+			return ids.Find(lhs.Scalar(), pMapped) && *pMapped == rhs.Scalar();
+		}
+
+		case YAML::NodeType::Sequence:
+			if (lhs.size() != rhs.size())
+			{
+				return false;
+			}
+
+			for (size_t i = 0; i < lhs.size(); i++)
+			{
+				if (!IsNodeEqual(lhs[i], rhs[i], ids))
+				{
+					return false;
+				}
+			}
+			return true;
+
+		case YAML::NodeType::Map:
+			if (lhs.size() != rhs.size())
+			{
+				return false;
+			}
+
+			for (const auto& el : lhs)
+			{
+				const YAML::Node& value = rhs[el.first.Scalar()];
+				if (!value.IsDefined() || !IsNodeEqual(el.second, value, ids))
+				{
+					return false;
+				}
+			}
+			return true;
+
+		default:
+			return true;
+		}
+	}
+
+	// The smallest game object in the binary scene is the one with the empty strings and without components
+	constexpr size_t MinBinaryGameObjectSize = sizeof(uint32_t) * 2 + sizeof(EMobilityType) + sizeof(uint32_t) +
+		sizeof(glm::vec3) + sizeof(glm::quat) + sizeof(glm::vec4) + sizeof(uint32_t);
+
+	// The typename comes from the file, so it is checked before ReflectionInfo resolves it, the component is skipped if its type is unknown
+	bool DeserializeComponent(const YAML::Node& node, ReflectionInfo& outReflection)
+	{
+		if (!node.IsMap() || !node["typename"].IsScalar() || !node["properties"])
+		{
+			SAILOR_LOG("The component of the scene is corrupted and skipped");
+			return false;
+		}
+
+		const std::string& typeName = node["typename"].Scalar();
+		if (!Reflection::IsTypeRegistered(typeName))
+		{
+			SAILOR_LOG("The component type %s is not registered, the component of the scene is skipped", typeName.c_str());
+			return false;
+		}
+
+		try
+		{
+			outReflection.Deserialize(node);
+		}
+		catch (const YAML::Exception& e)
+		{
+			SAILOR_LOG("The component %s of the scene is corrupted and skipped: %s", typeName.c_str(), e.what());
+			return false;
+		}
+
+		return true;
+	}
+
+	const std::string& GetComponentInstanceId(const ReflectionInfo& reflection)
+	{
+		static const std::string Empty{};
+
+		const YAML::Node* pNode = nullptr;
+		return reflection.GetProperties().Find(Scene::InstanceIdProperty, pNode) && pNode->IsScalar() ? pNode->Scalar() : Empty;
+	}
+}
+
+bool Scene::IsYamlFile(const std::string& filepath)
+{
+	return std::filesystem::path(filepath).extension() == ".yaml";
+}
+
+bool Scene::SaveToFile(const std::string& filepath) const
+{
+	SAILOR_PROFILE_FUNCTION();
+
+	if (IsYamlFile(filepath))
+	{
+		std::ofstream file(filepath, std::ofstream::trunc);
+		if (!file.is_open())
+		{
+			SAILOR_LOG("Cannot write scene %s", filepath.c_str());
+			return false;
+		}
+
+		file << Serialize();
+		return file.good();
+	}
+
+	TVector<uint8_t> data;
+	SerializeBinary(data);
+
+	std::ofstream file(filepath, std::ofstream::binary | std::ofstream::trunc);
+	if (!file.is_open())
+	{
+		SAILOR_LOG("Cannot write scene %s", filepath.c_str());
+		return false;
+	}
+
+	file.write(reinterpret_cast<const char*>(data.GetData()), data.Num());
+	return file.good();
+}
+
+bool Scene::LoadFromFile(const std::string& filepath)
+{
+	SAILOR_PROFILE_FUNCTION();
+
+	if (IsYamlFile(filepath))
+	{
+		std::string text;
+		if (!AssetRegistry::ReadAllTextFile(filepath, text))
+		{
+			SAILOR_LOG("Cannot read scene %s", filepath.c_str());
+			return false;
+		}
+
+		try
+		{
+			Deserialize(YAML::Load(text));
+		}
+		catch (const YAML::Exception& e)
+		{
+			SAILOR_LOG("Scene %s is corrupted: %s", filepath.c_str(), e.what());
+			m_gameObjects.Clear();
+			return false;
+		}
+
+		return true;
+	}
+
+	TVector<uint8_t> data;
+	if (!AssetRegistry::ReadBinaryFile(filepath, data))
+	{
+		SAILOR_LOG("Cannot read scene %s", filepath.c_str());
+		return false;
+	}
+
+	if (!DeserializeBinary(data))
+	{
+		SAILOR_LOG("Scene %s is corrupted or has the unsupported version", filepath.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+void Scene::SerializeBinary(TVector<uint8_t>& outData) const
+{
+	SAILOR_PROFILE_FUNCTION();
+
+	outData.Clear();
+
+	BinaryWriter writer(outData);
+	writer.Write(BinaryMagic);
+	writer.Write(BinaryVersion);
+	writer.Write((uint32_t)m_gameObjects.Num());
+
+	for (const auto& gameObject : m_gameObjects)
+	{
+		writer.WriteString(gameObject.m_instanceId.ToString());
+		writer.WriteString(gameObject.m_name);
+		writer.Write(gameObject.m_mobilityType);
+		writer.Write(gameObject.m_parent);
+
+		writer.Write(gameObject.m_position);
+		writer.Write(gameObject.m_rotation);
+		writer.Write(gameObject.m_scale);
+
+		writer.Write((uint32_t)gameObject.m_components.Num());
+		for (const auto& component : gameObject.m_components)
+		{
+			writer.WriteNode(component.Serialize());
+		}
+	}
+}
+
+bool Scene::DeserializeBinary(const TVector<uint8_t>& data)
+{
+	SAILOR_PROFILE_FUNCTION();
+
+	m_gameObjects.Clear();
+
+	BinaryReader reader(data);
+
+	uint32_t magic = 0;
+	uint32_t version = 0;
+	uint32_t numGameObjects = 0;
+
+	if (!reader.Read(magic) || !reader.Read(version) || !reader.Read(numGameObjects) ||
+		magic != BinaryMagic || version != BinaryVersion)
+	{
+		return false;
+	}
+
+	// The count is not trusted until the objects are read, the corrupted one should not reserve the gigabytes
+	m_gameObjects.Reserve(std::min((size_t)numGameObjects, reader.GetRemainingSize() / MinBinaryGameObjectSize));
+
+	for (uint32_t i = 0; i < numGameObjects && reader.IsValid(); i++)
+	{
+		GameObjectData& gameObject = m_gameObjects[m_gameObjects.Emplace()];
+
+		std::string instanceId;
+		reader.ReadString(instanceId);
+		gameObject.m_instanceId = InstanceId(std::move(instanceId));
+
+		reader.ReadString(gameObject.m_name);
+		reader.Read(gameObject.m_mobilityType);
+		reader.Read(gameObject.m_parent);
+
+		reader.Read(gameObject.m_position);
+		reader.Read(gameObject.m_rotation);
+		reader.Read(gameObject.m_scale);
+
+		uint32_t numComponents = 0;
+		reader.Read(numComponents);
+
+		for (uint32_t j = 0; j < numComponents && reader.IsValid(); j++)
+		{
+			YAML::Node node = reader.ReadNode();
+
+			ReflectionInfo reflection;
+			if (reader.IsValid() && DeserializeComponent(node, reflection))
+			{
+				gameObject.m_components.Add(std::move(reflection));
+			}
+		}
+
+		// The parent goes before its children
+		if (gameObject.m_parent != InvalidParent && gameObject.m_parent >= i)
+		{
+			return false;
+		}
+	}
+
+	return reader.IsValid() && reader.IsEnd();
+}
+
+YAML::Node Scene::Serialize() const
+{
+	SAILOR_PROFILE_FUNCTION();
+
+	YAML::Node gameObjects(YAML::NodeType::Sequence);
+
+	for (const auto& gameObject : m_gameObjects)
+	{
+		YAML::Node node;
+		node["instanceId"] = gameObject.m_instanceId;
+		node["name"] = gameObject.m_name;
+		node["mobilityType"] = SerializeEnum<EMobilityType>(gameObject.m_mobilityType);
+
+		if (gameObject.m_parent != InvalidParent)
+		{
+			node["parent"] = m_gameObjects[gameObject.m_parent].m_instanceId;
+		}
+
+		node["position"] = gameObject.m_position;
+		node["rotation"] = gameObject.m_rotation;
+		node["scale"] = gameObject.m_scale;
+
+		if (gameObject.m_components.Num() > 0)
+		{
+			node["components"] = gameObject.m_components;
+		}
+
+		gameObjects.push_back(node);
+	}
+
+	YAML::Node res;
+	res["version"] = BinaryVersion;
+	res["gameObjects"] = gameObjects;
+
+	return res;
+}
+
+void Scene::Deserialize(const YAML::Node& inData)
+{
+	SAILOR_PROFILE_FUNCTION();
+
+	m_gameObjects.Clear();
+
+	if (!inData["gameObjects"])
+	{
+		return;
+	}
+
+	const YAML::Node& gameObjects = inData["gameObjects"];
+	m_gameObjects.Reserve(gameObjects.size());
+
+	// The parents are referenced by their ids
+	TMap<std::string, uint32_t> indices;
+	indices.Reserve(gameObjects.size());
+
+	for (const auto& node : gameObjects)
+	{
+		const uint32_t index = (uint32_t)m_gameObjects.Emplace();
+		GameObjectData& gameObject = m_gameObjects[index];
+
+		gameObject.m_instanceId.Deserialize(node["instanceId"]);
+		gameObject.m_name = node["name"].as<std::string>();
+		DeserializeEnum<EMobilityType>(node["mobilityType"], gameObject.m_mobilityType);
+
+		if (node["parent"])
+		{
+			const std::string parentId = node["parent"].as<std::string>();
+
+			const uint32_t* pParent = nullptr;
+			if (indices.Find(parentId, pParent))
+			{
+				gameObject.m_parent = *pParent;
+			}
+			else
+			{
+				SAILOR_LOG("The parent %s of the game object %s should go before it in the scene", parentId.c_str(), gameObject.m_name.c_str());
+			}
+		}
+
+		gameObject.m_position = node["position"].as<glm::vec3>();
+		gameObject.m_rotation = node["rotation"].as<glm::quat>();
+		gameObject.m_scale = node["scale"].as<glm::vec4>();
+
+		if (node["components"])
+		{
+			for (const auto& component : node["components"])
+			{
+				ReflectionInfo reflection;
+				if (DeserializeComponent(component, reflection))
+				{
+					gameObject.m_components.Add(std::move(reflection));
+				}
+			}
+		}
+
+		indices[gameObject.m_instanceId.ToString()] = index;
+	}
+}
+
+bool Scene::IsEqual(const Scene& rhs) const
+{
+	if (m_gameObjects.Num() != rhs.m_gameObjects.Num())
+	{
+		return false;
+	}
+
+	TMap<std::string, std::string> ids;
+	ids.Reserve(m_gameObjects.Num());
+
+	for (size_t i = 0; i < m_gameObjects.Num(); i++)
+	{
+		const auto& lhsObject = m_gameObjects[i];
+		const auto& rhsObject = rhs.m_gameObjects[i];
+
+		if (lhsObject.m_components.Num() != rhsObject.m_components.Num())
+		{
+			return false;
+		}
+
+		ids[lhsObject.m_instanceId.ToString()] = rhsObject.m_instanceId.ToString();
+
+		for (size_t j = 0; j < lhsObject.m_components.Num(); j++)
+		{
+			const std::string& lhsId = GetComponentInstanceId(lhsObject.m_components[j]);
+			if (!lhsId.empty())
+			{
+				ids[lhsId] = GetComponentInstanceId(rhsObject.m_components[j]);
+			}
+		}
+	}
+
+	for (size_t i = 0; i < m_gameObjects.Num(); i++)
+	{
+		const auto& lhsObject = m_gameObjects[i];
+		const auto& rhsObject = rhs.m_gameObjects[i];
+
+		if (lhsObject.m_name != rhsObject.m_name ||
+			lhsObject.m_mobilityType != rhsObject.m_mobilityType ||
+			lhsObject.m_parent != rhsObject.m_parent ||
+			lhsObject.m_position != rhsObject.m_position ||
+			lhsObject.m_rotation != rhsObject.m_rotation ||
+			lhsObject.m_scale != rhsObject.m_scale)
+		{
+			return false;
+		}
+
+		for (size_t j = 0; j < lhsObject.m_components.Num(); j++)
+		{
+			const auto& lhsComponent = lhsObject.m_components[j];
+			const auto& rhsComponent = rhsObject.m_components[j];
+
+			if (lhsComponent.GetTypeInfo() != rhsComponent.GetTypeInfo() ||
+				lhsComponent.GetProperties().Num() != rhsComponent.GetProperties().Num())
+			{
+				return false;
+			}
+
+			for (const auto& property : lhsComponent.GetProperties())
+			{
+				const YAML::Node* pRhsProperty = nullptr;
+				if (!rhsComponent.GetProperties().Find(property.m_first, pRhsProperty) ||
+					!IsNodeEqual(*property.m_second, *pRhsProperty, ids))
+				{
+					return false;
+				}
+			}
+		}
+	}
+
+	return true;
+}
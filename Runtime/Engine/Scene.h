@@ -1,24 +1,79 @@
 #pragma once
 #include "Sailor.h"
 #include "Memory/SharedPtr.hpp"
+#include "Containers/Vector.h"
+#include "Core/Reflection.h"
+#include "Core/YamlSerializable.h"
+#include "Engine/InstanceId.h"
+#include "Engine/Types.h"
 
 namespace Sailor
 {
 	using ScenePtr = TWeakPtr<class Scene>;
 
-	class Scene
+	/* The snapshot of the World's game objects, their transforms and the reflected components.
+	*  The binary format is compact and fast to load, YAML is used for the scenes under version control.
+	*  The parent goes before its children, the references are the instance ids, that are remapped when the scene is loaded to the World.
+	*/
+	class Scene : public IYamlSerializable
 	{
 	public:
 
-		Scene() = default;
-		virtual ~Scene() = default;
+		static constexpr uint32_t InvalidParent = (uint32_t)-1;
+
+		static constexpr uint32_t BinaryMagic = 0x4E435353;
+		static constexpr uint32_t BinaryVersion = 1;
+
+		// Component reflects its id by that name
+		static constexpr const char* InstanceIdProperty = "instanceId";
+
+		struct GameObjectData
+		{
+			InstanceId m_instanceId;
+			std::string m_name;
+			EMobilityType m_mobilityType = EMobilityType::Stationary;
+
+			glm::vec3 m_position{ 0.0f };
+			glm::quat m_rotation{ 1.0f, 0.0f, 0.0f, 0.0f };
+			glm::vec4 m_scale{ 1.0f };
+
+			// The index of the parent in the scene
+			uint32_t m_parent = InvalidParent;
+
+			TVector<ReflectionInfo> m_components;
+		};
+
+		SAILOR_API Scene() = default;
+		SAILOR_API virtual ~Scene() = default;
 
 		Scene(const Scene&) = delete;
 		Scene& operator=(const Scene&) = delete;
 
-		Scene(Scene&&) = default;
-		Scene& operator=(Scene&&) = default;
+		SAILOR_API Scene(Scene&&) = default;
+		SAILOR_API Scene& operator=(Scene&&) = default;
+
+		SAILOR_API TVector<GameObjectData>& GetGameObjects() { return m_gameObjects; }
+		SAILOR_API const TVector<GameObjectData>& GetGameObjects() const { return m_gameObjects; }
+
+		// The format is chosen by the extension: YAML for '.yaml', the binary one for the rest
+		SAILOR_API bool SaveToFile(const std::string& filepath) const;
+		SAILOR_API bool LoadFromFile(const std::string& filepath);
+
+		SAILOR_API static bool IsYamlFile(const std::string& filepath);
+
+		SAILOR_API void SerializeBinary(TVector<uint8_t>& outData) const;
+		SAILOR_API bool DeserializeBinary(const TVector<uint8_t>& data);
+
+		SAILOR_API virtual YAML::Node Serialize() const override;
+		SAILOR_API virtual void Deserialize(const YAML::Node& inData) override;
+
+		// The instance ids are compared by the objects they identify, so the scene that is saved after the load is equal to the loaded one
+		SAILOR_API bool IsEqual(const Scene& rhs) const;
 
 	protected:
+
+		TVector<GameObjectData> m_gameObjects;
 	};
+
+	SAILOR_API void RunSceneBenchmark();
 }
@@ -0,0 +1,297 @@
+#include <random>
+#include <filesystem>
+#include "Engine/Scene.h"
+#include "Engine/World.h"
+#include "Engine/GameObject.h"
+#include "Engine/Frame.h"
+#include "ECS/TransformECS.h"
+#include "Components/LightComponent.h"
+#include "AssetRegistry/AssetRegistry.h"
+#include "Core/Utils.h"
+
+namespace Sailor
+{
+	// References the other game object of the scene by its id, that should be remapped when the scene is loaded
+	class SceneBenchmarkComponent : public Component
+	{
+		SAILOR_REFLECTABLE(SceneBenchmarkComponent)
+
+	public:
+
+		const InstanceId& GetTarget() const { return m_target; }
+		void SetTarget(const InstanceId& target) { m_target = target; }
+
+	protected:
+
+		InstanceId m_target;
+	};
+}
+
+REFL_AUTO(
+	type(Sailor::SceneBenchmarkComponent, bases<Sailor::Component>),
+
+	func(GetTarget, property("target")),
+	func(SetTarget, property("target"))
+)
+
+using namespace Sailor;
+using Timer = Utils::Timer;
+
+namespace
+{
+	// The part of the game objects has the light, that is reflected
+	const uint32_t LightsFraction = 10;
+
+	// The part of the game objects references the other one, that could go before or after it in the scene
+	const uint32_t TargetsFraction = 7;
+
+	__forceinline uint32_t GetTargetIndex(uint32_t index, uint32_t count) { return (uint32_t)(((uint64_t)index * 7919u + 1u) % count); }
+
+	ReflectionInfo CreateLightReflection(std::mt19937& random)
+	{
+		std::uniform_real_distribution<float> dist(0.0f, 10.0f);
+		std::uniform_int_distribution<uint32_t> lightType(0, (uint32_t)ELightType::Spot);
+
+		YAML::Node intensity;
+		intensity["intensity"] = glm::vec3(dist(random), dist(random), dist(random));
+
+		YAML::Node bounds;
+		bounds["bounds"] = glm::vec3(dist(random), dist(random), dist(random));
+
+		YAML::Node cutOff;
+		cutOff["cutOff"] = glm::vec2(dist(random), dist(random));
+
+		YAML::Node type;
+		type["lightType"] = SerializeEnum<ELightType>((ELightType)lightType(random));
+
+		YAML::Node node;
+		node["typename"] = LightComponent::GetStaticTypeInfo().Name();
+		node["properties"].push_back(intensity);
+		node["properties"].push_back(bounds);
+		node["properties"].push_back(cutOff);
+		node["properties"].push_back(type);
+
+		ReflectionInfo res;
+		res.Deserialize(node);
+		return res;
+	}
+
+	ReflectionInfo CreateTargetReflection(const GameObjectPtr& target)
+	{
+		YAML::Node property;
+		property["target"] = target->GetInstanceId();
+
+		YAML::Node node;
+		node["typename"] = SceneBenchmarkComponent::GetStaticTypeInfo().Name();
+		node["properties"].push_back(property);
+
+		ReflectionInfo res;
+		res.Deserialize(node);
+		return res;
+	}
+
+	// The components begin play and apply their reflections on the second tick of the world
+	void TickWorld(World& world, uint32_t numFrames)
+	{
+		for (uint32_t i = 0; i < numFrames; i++)
+		{
+			FrameState frame(&world, Utils::GetCurrentTimeMs(), FrameInputState(), glm::ivec2(0, 0));
+			world.Tick(frame);
+		}
+	}
+
+	// The 4-ary tree with the random transforms, every 10th object has the light, every 7th references the other object
+	void FillWorld(World& world, uint32_t count)
+	{
+		std::mt19937 random(count);
+		std::uniform_real_distribution<float> dist(-10.0f, 10.0f);
+
+		auto pTransformECS = world.GetECS<TransformECS>();
+
+		TVector<GameObjectPtr> objects;
+		objects.Reserve(count);
+
+		for (uint32_t i = 0; i < count; i++)
+		{
+			char name[64];
+			snprintf(name, sizeof(name), "GameObject_%u", i);
+
+			GameObjectPtr gameObject = world.Instantiate(glm::vec3(dist(random), dist(random), dist(random)), name);
+			gameObject->SetMobilityType((EMobilityType)(i % 3));
+
+			auto& transform = gameObject->GetTransformComponent();
+			transform.SetRotation(glm::angleAxis(dist(random), glm::normalize(glm::vec3(dist(random), dist(random), dist(random)) + 0.01f)));
+			transform.SetScale(glm::vec4(glm::abs(dist(random)) + 0.1f));
+
+			if (i > 0)
+			{
+				pTransformECS->SetParent(&transform, &objects[(i - 1) / 4]->GetTransformComponent());
+			}
+
+			if (i % LightsFraction == 0)
+			{
+				const ReflectionInfo reflection = CreateLightReflection(random);
+				gameObject->AddComponentRaw(Reflection::CreateObject<Component>(reflection.GetTypeInfo(), world.GetAllocator()), reflection);
+			}
+
+			objects.Add(std::move(gameObject));
+		}
+
+		// The targets are added when all the objects exist
+		for (uint32_t i = 0; i < count; i += TargetsFraction)
+		{
+			const ReflectionInfo reflection = CreateTargetReflection(objects[GetTargetIndex(i, count)]);
+			objects[i]->AddComponentRaw(Reflection::CreateObject<Component>(reflection.GetTypeInfo(), world.GetAllocator()), reflection);
+		}
+	}
+
+	// The live components of the loaded objects should begin play and reference the loaded objects, the loaded objects go in the scene order
+	bool IsLoadedStateValid(const World& world, const Scene& scene, const TVector<GameObjectPtr>& loadedObjects)
+	{
+		const auto& sceneObjects = scene.GetGameObjects();
+		if (loadedObjects.Num() != sceneObjects.Num())
+		{
+			return false;
+		}
+
+		TMap<std::string, GameObjectPtr> savedObjects;
+		savedObjects.Reserve(world.GetGameObjects().Num());
+		for (const auto& gameObject : world.GetGameObjects())
+		{
+			savedObjects[gameObject->GetInstanceId().ToString()] = gameObject;
+		}
+
+		TMap<std::string, size_t> sceneIndices;
+		sceneIndices.Reserve(sceneObjects.Num());
+		for (size_t i = 0; i < sceneObjects.Num(); i++)
+		{
+			sceneIndices[sceneObjects[i].m_instanceId.ToString()] = i;
+		}
+
+		for (size_t i = 0; i < loadedObjects.Num(); i++)
+		{
+			const GameObjectPtr* pSavedObject = nullptr;
+			if (!savedObjects.Find(sceneObjects[i].m_instanceId.ToString(), pSavedObject))
+			{
+				return false;
+			}
+
+			GameObjectPtr loadedObject = loadedObjects[i];
+			GameObjectPtr savedObject = *pSavedObject;
+
+			auto target = loadedObject->GetComponent<SceneBenchmarkComponent>();
+			auto savedTarget = savedObject->GetComponent<SceneBenchmarkComponent>();
+			if ((bool)target != (bool)savedTarget)
+			{
+				return false;
+			}
+
+			if (target)
+			{
+				const size_t* pTargetIndex = nullptr;
+				if (!target->IsValid() ||
+					!sceneIndices.Find(savedTarget->GetTarget().ToString(), pTargetIndex) ||
+					target->GetTarget() != loadedObjects[*pTargetIndex]->GetInstanceId())
+				{
+					return false;
+				}
+			}
+
+			auto light = loadedObject->GetComponent<LightComponent>();
+			auto savedLight = savedObject->GetComponent<LightComponent>();
+			if ((bool)light != (bool)savedLight)
+			{
+				return false;
+			}
+
+			// The values of the live lights are compared by the world round trip
+			if (light && !light->IsValid())
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+}
+
+void Sailor::RunSceneBenchmark()
+{
+	printf("\nStarting scene serialization benchmark...\n");
+
+	const uint32_t count = 100000;
+
+	World world("SceneBenchmark");
+	FillWorld(world, count);
+
+	// The saved state is the live one, not the reflections that are pending to be applied
+	TickWorld(world, 2);
+
+	Scene scene;
+
+	Timer saveTimer;
+	saveTimer.Start();
+	world.Save(scene);
+	saveTimer.Stop();
+
+	SAILOR_LOG("%u game objects are saved to the scene in %lldms", (uint32_t)scene.GetGameObjects().Num(), saveTimer.ResultMs());
+
+	std::error_code error;
+	std::filesystem::create_directories(AssetRegistry::CacheRootFolder, error);
+
+	for (const char* extension : { ".scene", ".yaml" })
+	{
+		const std::string filepath = std::string(AssetRegistry::CacheRootFolder) + "SceneBenchmark" + extension;
+
+		Timer writeTimer;
+		writeTimer.Start();
+		const bool bIsSaved = scene.SaveToFile(filepath);
+		writeTimer.Stop();
+
+		const float sizeMb = bIsSaved ? (float)std::filesystem::file_size(filepath, error) / (1024.0f * 1024.0f) : 0.0f;
+
+		Scene loadedScene;
+		World loadedWorld("SceneBenchmarkLoaded");
+
+		Timer parseTimer;
+		parseTimer.Start();
+		const bool bIsLoaded = bIsSaved && loadedScene.LoadFromFile(filepath);
+		parseTimer.Stop();
+
+		Timer instantiateTimer;
+		instantiateTimer.Start();
+		TVector<GameObjectPtr> objects = loadedWorld.Load(loadedScene);
+		instantiateTimer.Stop();
+
+		// The file keeps the ids, while the loaded objects get the new ones
+		size_t numSameIds = 0;
+		for (size_t i = 0; i < objects.Num(); i++)
+		{
+			if (objects[i]->GetInstanceId() == scene.GetGameObjects()[i].m_instanceId)
+			{
+				numSameIds++;
+			}
+		}
+
+		// The loaded components begin play and apply their remapped reflections
+		TickWorld(loadedWorld, 2);
+		const bool bIsLiveStateValid = IsLoadedStateValid(world, scene, objects);
+
+		Scene savedScene;
+		loadedWorld.Save(savedScene);
+
+		SAILOR_LOG("\t%s: %.2fMb, written in %lldms, loaded in %lldms (parse %lldms, instantiate %lldms)",
+			extension, sizeMb, writeTimer.ResultMs(), parseTimer.ResultMs() + instantiateTimer.ResultMs(),
+			parseTimer.ResultMs(), instantiateTimer.ResultMs());
+
+		SAILOR_LOG("\tfile round trip %d, world round trip %d, remapped ids %d, live components %d",
+			bIsLoaded && scene.IsEqual(loadedScene), savedScene.IsEqual(scene), objects.Num() == count && numSameIds == 0, bIsLiveStateValid);
+
+		objects.Clear();
+		loadedWorld.Clear();
+
+		std::filesystem::remove(filepath, error);
+	}
+
+	world.Clear();
+}
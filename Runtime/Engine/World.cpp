@@ -1,11 +1,32 @@
 #include "Engine/World.h"
 #include "Engine/GameObject.h"
 #include "Engine/EngineLoop.h"
+#include "Engine/Scene.h"
 #include <Components/TestComponent.h>
 #include <ECS/TransformECS.h>
 
 using namespace Sailor;
 
+namespace
+{
+	// The references are the scalar properties that are equal to the saved ids
+	ReflectionInfo RemapInstanceIds(const ReflectionInfo& reflection, const TMap<std::string, InstanceId>& remap)
+	{
+		ReflectionInfo res = reflection;
+
+		for (const auto& property : reflection.GetProperties())
+		{
+			const InstanceId* pNewId = nullptr;
+			if (property.m_second->IsScalar() && remap.Find(property.m_second->Scalar(), pNewId))
+			{
+				res.SetProperty(property.m_first, pNewId->Serialize());
+			}
+		}
+
+		return res;
+	}
+}
+
 World::World(std::string name) : m_name(std::move(name)), m_bIsBeginPlayCalled(false), m_currentFrame(0)
 {
 	m_allocator = Memory::ObjectAllocatorPtr::Make();
@@ -27,6 +48,15 @@ World::World(std::string name) : m_name(std::move(name)), m_bIsBeginPlayCalled(f
 		m_sortedEcs.Insert(ecs.m_first, it - m_sortedEcs.begin());
 	}
 
+	TVector<ECS::TBaseSystem*> sortedSystems;
+	sortedSystems.Reserve(m_sortedEcs.Num());
+	for (const auto& ecs : m_sortedEcs)
+	{
+		sortedSystems.Add(m_ecs[ecs].GetRawPtr());
+	}
+
+	m_systemsGraph.Build(sortedSystems);
+
 	m_pDebugContext = TUniquePtr<RHI::DebugContext>::Make();
 }
 
@@ -64,10 +94,8 @@ void World::Tick(FrameState& frameState)
 		}
 	}
 
-	for (auto& ecs : m_sortedEcs)
-	{
-		m_ecs[ecs]->Tick(frameState.GetDeltaTime());
-	}
+	// The systems that don't share the components are ticked in parallel
+	m_systemsGraph.Tick(frameState.GetDeltaTime());
 
 	for (auto& ecs : m_sortedEcs)
 	{
@@ -97,6 +125,7 @@ GameObjectPtr World::Instantiate(const glm::vec3& worldPosition, const std::stri
 	auto newObject = GameObjectPtr::Make(m_allocator, this, name);
 	check(newObject);
 	newObject->m_self = newObject;
+	newObject->m_instanceId = InstanceId::CreateNewInstanceId();
 
 	if (m_bIsBeginPlayCalled)
 	{
@@ -139,4 +168,209 @@ void World::Clear()
 	{
 		(*ecs.m_second)->EndPlay();
 	}
+}
+
+void World::Save(Scene& outScene)
+{
+	SAILOR_PROFILE_FUNCTION();
+
+	auto& gameObjects = outScene.GetGameObjects();
+	gameObjects.Clear();
+	gameObjects.Reserve(m_objects.Num());
+
+	// The children are found by their transforms
+	TMap<size_t, GameObject*> objectsByTransform;
+	objectsByTransform.Reserve(m_objects.Num());
+
+	for (auto& el : m_objects)
+	{
+		if (!el->m_bPendingDestroy)
+		{
+			objectsByTransform[el->m_transformHandle] = el.GetRawPtr();
+		}
+	}
+
+	size_t numSkippedComponents = 0;
+	TVector<TPair<GameObject*, uint32_t>> stack;
+
+	for (auto& root : m_objects)
+	{
+		const size_t parent = root->GetTransformComponent().GetParent();
+		if (root->m_bPendingDestroy || (parent != ECS::InvalidIndex && objectsByTransform.ContainsKey(parent)))
+		{
+			continue;
+		}
+
+		stack.Add(TPair<GameObject*, uint32_t>(root.GetRawPtr(), Scene::InvalidParent));
+
+		while (stack.Num() > 0)
+		{
+			GameObject* pGameObject = stack[stack.Num() - 1].m_first;
+			const uint32_t parentIndex = stack[stack.Num() - 1].m_second;
+			stack.RemoveLast();
+
+			const uint32_t index = (uint32_t)gameObjects.Emplace();
+			auto& data = gameObjects[index];
+			const auto& transform = pGameObject->GetTransformComponent();
+
+			data.m_instanceId = pGameObject->GetInstanceId();
+			data.m_name = pGameObject->m_name;
+			data.m_mobilityType = pGameObject->m_type;
+			data.m_position = glm::vec3(transform.GetPosition());
+			data.m_rotation = transform.GetRotation();
+			data.m_scale = transform.GetScale();
+			data.m_parent = parentIndex;
+
+			for (const auto* pComponents : { &pGameObject->m_components, &pGameObject->m_componentsToAdd })
+			{
+				for (const auto& component : *pComponents)
+				{
+					const ReflectionInfo* pPendingReflection = nullptr;
+					if (pGameObject->m_pendingReflections.Find(component, pPendingReflection))
+					{
+						// The pending reflection could be made before the component got its id
+						ReflectionInfo reflection = *pPendingReflection;
+						reflection.SetProperty(Scene::InstanceIdProperty, component->GetInstanceId().Serialize());
+						data.m_components.Add(std::move(reflection));
+					}
+					else if (component->IsValid() && component->GetTypeInfo() != Component::GetStaticTypeInfo())
+					{
+						data.m_components.Add(component->GetReflectionInfo());
+					}
+					else
+					{
+						numSkippedComponents++;
+					}
+				}
+			}
+
+			// The children are pushed in the reverse order, so they go in the scene in their order
+			const auto& children = transform.GetChildren();
+			for (size_t i = children.Num(); i > 0; i--)
+			{
+				GameObject** ppChild = nullptr;
+				if (objectsByTransform.Find(children[i - 1], ppChild))
+				{
+					stack.Add(TPair<GameObject*, uint32_t>(*ppChild, index));
+				}
+			}
+		}
+	}
+
+	if (numSkippedComponents > 0)
+	{
+		SAILOR_LOG("World %s: %zu components are not saved, since they are not reflectable or not started", m_name.c_str(), numSkippedComponents);
+	}
+}
+
+TVector<GameObjectPtr> World::Load(const Scene& scene)
+{
+	SAILOR_PROFILE_FUNCTION();
+
+	const auto& gameObjects = scene.GetGameObjects();
+	auto pTransformECS = GetECS<TransformECS>();
+
+	TVector<GameObjectPtr> res;
+	res.Reserve(gameObjects.Num());
+
+	// The saved ids of the game objects and the components are mapped to the new ones
+	TMap<std::string, InstanceId> remap;
+	remap.Reserve(gameObjects.Num());
+
+	TVector<InstanceId> componentIds;
+
+	// The scene could be made in code, so the types are checked before the components are created
+	auto IsLoadable = [](const ReflectionInfo& reflection)
+		{
+			return reflection.IsValid() && Reflection::IsTypeRegistered(reflection.GetTypeInfo().Name());
+		};
+
+	size_t numSkippedComponents = 0;
+
+	for (const auto& data : gameObjects)
+	{
+		GameObjectPtr gameObject = Instantiate(data.m_position, data.m_name);
+		gameObject->SetMobilityType(data.m_mobilityType);
+
+		auto& transform = gameObject->GetTransformComponent();
+		transform.SetRotation(data.m_rotation);
+		transform.SetScale(data.m_scale);
+
+		if (data.m_parent != Scene::InvalidParent)
+		{
+			check(data.m_parent < res.Num());
+			pTransformECS->SetParent(&transform, &res[data.m_parent]->GetTransformComponent());
+		}
+
+		if (data.m_instanceId)
+		{
+			remap[data.m_instanceId.ToString()] = gameObject->GetInstanceId();
+		}
+
+		for (const auto& reflection : data.m_components)
+		{
+			if (!IsLoadable(reflection))
+			{
+				numSkippedComponents++;
+				continue;
+			}
+
+			const InstanceId newId = InstanceId::CreateNewInstanceId();
+
+			const YAML::Node* pOldId = nullptr;
+			if (reflection.GetProperties().Find(Scene::InstanceIdProperty, pOldId) && pOldId->IsScalar())
+			{
+				remap[pOldId->Scalar()] = newId;
+			}
+
+			componentIds.Add(newId);
+		}
+
+		res.Add(std::move(gameObject));
+	}
+
+	// The components are added when all the ids are known, so they could reference any object of the scene
+	size_t componentIndex = 0;
+	for (size_t i = 0; i < gameObjects.Num(); i++)
+	{
+		for (const auto& reflection : gameObjects[i].m_components)
+		{
+			if (!IsLoadable(reflection))
+			{
+				continue;
+			}
+
+			ComponentPtr component = Reflection::CreateObject<Component>(reflection.GetTypeInfo(), m_allocator);
+			component->m_instanceId = componentIds[componentIndex++];
+
+			res[i]->AddComponentRaw(component, RemapInstanceIds(reflection, remap));
+		}
+	}
+
+	if (numSkippedComponents > 0)
+	{
+		SAILOR_LOG("World %s: %zu components are not loaded, since their types are not registered", m_name.c_str(), numSkippedComponents);
+	}
+
+	return res;
+}
+
+bool World::SaveToFile(const std::string& filepath)
+{
+	Scene scene;
+	Save(scene);
+
+	return scene.SaveToFile(filepath);
+}
+
+bool World::LoadFromFile(const std::string& filepath)
+{
+	Scene scene;
+	if (!scene.LoadFromFile(filepath))
+	{
+		return false;
+	}
+
+	Load(scene);
+	return true;
 }
\ No newline at end of file
@@ -7,6 +7,7 @@
 #include "Engine/Types.h"
 #include "RHI/DebugContext.h"
 #include "ECS/ECS.h"
+#include "ECS/SystemsGraph.h"
 
 namespace Sailor
 {
@@ -49,6 +50,15 @@ namespace Sailor
 		SAILOR_API const TVector<GameObjectPtr>& GetGameObjects() const { return m_objects; }
 
 		SAILOR_API void Clear();
+
+		// The game objects that are pending destroy are not saved, as well as the components that are not reflectable
+		SAILOR_API void Save(class Scene& outScene);
+
+		// Instantiates the scene's game objects with the new instance ids, the results go in the scene order
+		SAILOR_API TVector<GameObjectPtr> Load(const class Scene& scene);
+
+		SAILOR_API bool SaveToFile(const std::string& filepath);
+		SAILOR_API bool LoadFromFile(const std::string& filepath);
 		SAILOR_API size_t GetCurrentFrame() const { return m_currentFrame; }
 
 	protected:
@@ -59,6 +69,7 @@ namespace Sailor
 		TList<GameObjectPtr, Memory::TInlineAllocator<sizeof(GameObjectPtr) * 32>> m_pendingDestroyObjects;
 		TMap<size_t, Sailor::ECS::TBaseSystemPtr> m_ecs;
 		TVector<size_t> m_sortedEcs;
+		ECS::SystemsGraph m_systemsGraph;
 
 		FrameInputState m_frameInput;
 		float m_time{};
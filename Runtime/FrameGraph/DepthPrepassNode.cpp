@@ -6,6 +6,7 @@
 #include "RHI/Types.h"
 #include "RHI/Batch.hpp"
 #include "RHI/VertexDescription.h"
+#include "Memory/FrameAllocator.h"
 #include "AssetRegistry/Texture/TextureImporter.h"
 
 using namespace Sailor;
@@ -171,7 +172,7 @@ void DepthPrepassNode::Process(RHIFrameGraph* frameGraph, RHI::RHICommandListPtr
 	RHI::RHIShaderBindingPtr storageBinding = m_perInstanceData->GetOrAddShaderBinding("data");
 	SAILOR_PROFILE_END_BLOCK();
 
-	TVector<DepthPrepassNode::PerInstanceData> gpuMatricesData;
+	TVector<DepthPrepassNode::PerInstanceData, Memory::FrameAllocator> gpuMatricesData;
 	gpuMatricesData.AddDefault(m_numMeshes);
 	auto vecBatches = m_batches.ToVector();
 
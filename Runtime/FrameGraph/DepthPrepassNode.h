@@ -38,7 +38,7 @@ namespace Sailor
 	protected:
 
 		uint32_t m_numMeshes = 0;
-		SpinLock m_syncSharedResources;
+		SpinLock m_syncSharedResources{ SAILOR_SPINLOCK_SITE("DepthPrepassNode") };
 		RHI::TDrawCalls<PerInstanceData> m_drawCalls;
 		TSet<RHI::RHIBatch> m_batches;
 
@@ -8,6 +8,7 @@
 #include "RHI/Types.h"
 #include "RHI/VertexDescription.h"
 #include "RHI/CommandList.h"
+#include "Memory/FrameAllocator.h"
 #include "AssetRegistry/Texture/TextureImporter.h"
 
 using namespace Sailor;
@@ -133,7 +134,7 @@ void RenderSceneNode::Process(RHIFrameGraph* frameGraph, RHI::RHICommandListPtr
 	SAILOR_PROFILE_END_BLOCK();
 
 	SAILOR_PROFILE_BLOCK("Prepare command list");
-	TVector<PerInstanceData> gpuMatricesData;
+	TVector<PerInstanceData, Memory::FrameAllocator> gpuMatricesData;
 	gpuMatricesData.AddDefault(m_numMeshes);
 
 	RHI::RHISurfacePtr colorAttachment = GetRHIResource("color").DynamicCast<RHI::RHISurface>();
@@ -212,7 +213,7 @@ void RenderSceneNode::Process(RHIFrameGraph* frameGraph, RHI::RHICommandListPtr
 
 				commands->EndCommandList(cmdList);
 				secondaryCommandLists[i] = std::move(cmdList);
-			}, Tasks::EThreadType::RHI);
+			}, Tasks::EThreadType::RHI, Tasks::EPriority::Critical);
 
 		task->Run();
 		tasks.Add(task);
@@ -40,7 +40,7 @@ namespace Sailor::Framegraph
 		static const char* m_name;
 
 		uint32_t m_numMeshes = 0;
-		SpinLock m_syncSharedResources;
+		SpinLock m_syncSharedResources{ SAILOR_SPINLOCK_SITE("RenderSceneNode") };
 		RHI::TDrawCalls<PerInstanceData> m_drawCalls;
 		TSet<RHI::RHIBatch> m_batches;
 		TVector<RHI::RHIBufferPtr> m_indirectBuffers;
@@ -11,6 +11,7 @@
 #include "Engine/GameObject.h"
 #include "Math/Math.h"
 #include "Math/Noise.h"
+#include "Tasks/ParallelFor.h"
 #include "glm/glm/gtx/quaternion.hpp"
 #include "AssetRegistry/Texture/TextureImporter.h"
 #include "EnvironmentNode.h"
@@ -121,12 +122,9 @@ TVector<uint8_t> SkyNode::GenerateCloudsNoiseLow() const
 	TVector<uint8_t> res;
 	res.Resize(CloudsNoiseLowResolution * CloudsNoiseLowResolution * CloudsNoiseLowResolution);
 
-	TVector<Tasks::ITaskPtr> tasks;
-	tasks.Reserve(CloudsNoiseLowResolution);
-
-	for (uint32_t z = 0; z < CloudsNoiseLowResolution; z++)
-	{
-		auto pTask = Tasks::CreateTask("Generate Clouds Noise Low", [=, &res]()
+	Tasks::ParallelFor("Generate Clouds Noise Low", 0, CloudsNoiseLowResolution, 1, [&res](size_t zBegin, size_t zEnd)
+		{
+			for (uint32_t z = (uint32_t)zBegin; z < (uint32_t)zEnd; z++)
 			{
 				for (uint32_t y = 0; y < CloudsNoiseLowResolution; y++)
 				{
@@ -148,16 +146,8 @@ TVector<uint8_t> SkyNode::GenerateCloudsNoiseLow() const
 						value = uint8_t(noise * 255.0f);
 					}
 				}
-
-			})->Run();
-
-			tasks.Add(pTask);
-	}
-
-	for (uint32_t i = 0; i < tasks.Num(); i++)
-	{
-		tasks[i]->Wait();
-	}
+			}
+		});
 
 	return res;
 }
@@ -167,26 +157,29 @@ TVector<uint8_t> SkyNode::GenerateCloudsNoiseHigh() const
 	TVector<uint8_t> res;
 	res.Resize(CloudsNoiseHighResolution * CloudsNoiseHighResolution * CloudsNoiseHighResolution);
 
-	for (uint32_t z = 0; z < CloudsNoiseHighResolution; z++)
-	{
-		for (uint32_t y = 0; y < CloudsNoiseHighResolution; y++)
+	Tasks::ParallelFor("Generate Clouds Noise High", 0, CloudsNoiseHighResolution, 1, [&res](size_t zBegin, size_t zEnd)
 		{
-			for (uint32_t x = 0; x < CloudsNoiseHighResolution; x++)
+			for (uint32_t z = (uint32_t)zBegin; z < (uint32_t)zEnd; z++)
 			{
-				uint8_t& value = res[x + y * CloudsNoiseHighResolution + z * CloudsNoiseHighResolution * CloudsNoiseHighResolution];
+				for (uint32_t y = 0; y < CloudsNoiseHighResolution; y++)
+				{
+					for (uint32_t x = 0; x < CloudsNoiseHighResolution; x++)
+					{
+						uint8_t& value = res[x + y * CloudsNoiseHighResolution + z * CloudsNoiseHighResolution * CloudsNoiseHighResolution];
 
-				vec3 uv = vec3((float)x / CloudsNoiseHighResolution, (float)y / CloudsNoiseHighResolution, (float)z / CloudsNoiseHighResolution);
+						vec3 uv = vec3((float)x / CloudsNoiseHighResolution, (float)y / CloudsNoiseHighResolution, (float)z / CloudsNoiseHighResolution);
 
-				const float tiling = 5.0f;
+						const float tiling = 5.0f;
 
-				float noise = 0.5f * (Math::fBmTiledPerlin(uv * tiling, 4, (int32_t)tiling) + 1) * 0.625f +
-					(Math::fBmTiledWorley(uv * tiling * 2.0f, 4, (int32_t)tiling * 2)) * 0.25f +
-					(Math::fBmTiledWorley(uv * tiling * 3.0f, 4, (int32_t)tiling * 3)) * 0.125f;
+						float noise = 0.5f * (Math::fBmTiledPerlin(uv * tiling, 4, (int32_t)tiling) + 1) * 0.625f +
+							(Math::fBmTiledWorley(uv * tiling * 2.0f, 4, (int32_t)tiling * 2)) * 0.25f +
+							(Math::fBmTiledWorley(uv * tiling * 3.0f, 4, (int32_t)tiling * 3)) * 0.125f;
 
-				value = uint8_t(noise * 255.0f);
+						value = uint8_t(noise * 255.0f);
+					}
+				}
 			}
-		}
-	}
+		});
 
 	return res;
 }
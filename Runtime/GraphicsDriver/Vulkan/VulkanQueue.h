@@ -37,6 +37,6 @@ namespace Sailor::GraphicsDriver::Vulkan
 		uint32_t m_queueFamilyIndex;
 		uint32_t m_queueIndex;
 		
-		mutable SpinLock m_lock;
+		mutable SpinLock m_lock{ SAILOR_SPINLOCK_SITE("VulkanQueue") };
 	};
 }
\ No newline at end of file
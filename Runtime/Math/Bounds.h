@@ -1,6 +1,8 @@
 #pragma once
+#include <cfloat>
 #include <glm/glm/glm.hpp>
 #include <glm/glm/gtx/hash.hpp>
+#include <emmintrin.h>
 #include "Memory/Memory.h"
 #include "Memory/LockFreeHeapAllocator.h"
 #include "Containers/Vector.h"
@@ -26,7 +28,7 @@ namespace Sailor::Math
 
 	struct Ray
 	{
-		Ray() { O4 = D4 = rD4 = _mm_set1_ps(1); }
+		Ray() : m_origin(1.0f), m_direction(1.0f), m_rDirection(1.0f) {}
 		Ray(const vec3& origin, const vec3& direction) : m_origin(origin)
 		{
 			SetDirection(direction);
@@ -36,9 +38,9 @@ namespace Sailor::Math
 		__forceinline const vec3& GetDirection() const { return m_direction; }
 		__forceinline const vec3& GetReciprocalDirection() const { return m_rDirection; }
 
-		__forceinline const __m128& GetOrigin4() const { return O4; }
-		__forceinline const __m128& GetDirection4() const { return D4; }
-		__forceinline const __m128& GetReciprocalDirection4() const { return rD4; }
+		__forceinline __m128 GetOrigin4() const { return _mm_load_ps(&m_origin.x); }
+		__forceinline __m128 GetDirection4() const { return _mm_load_ps(&m_direction.x); }
+		__forceinline __m128 GetReciprocalDirection4() const { return _mm_load_ps(&m_rDirection.x); }
 
 		__forceinline void SetOrigin(const vec3& value) { m_origin = value; }
 		__forceinline void SetDirection(const vec3& value)
@@ -49,9 +51,13 @@ namespace Sailor::Math
 
 	protected:
 
-		union { struct { vec3 m_origin; float dummy1; }; __m128 O4; };
-		union { struct { vec3 m_direction; float dummy2; }; __m128 D4; };
-		union { struct { vec3 m_rDirection; float dummy3; }; __m128 rD4; };
+		// The padding completes the vectors to 4 floats, that are loaded to SSE registers at once
+		alignas(16) vec3 m_origin;
+		float m_originPad = 1.0f;
+		alignas(16) vec3 m_direction;
+		float m_directionPad = 1.0f;
+		alignas(16) vec3 m_rDirection;
+		float m_rDirectionPad = 1.0f;
 
 		friend float IntersectRayAABB(const Ray& ray, const __m128 bmin4, const __m128 bmax4, float maxRayLength);
 	};
@@ -125,14 +131,14 @@ namespace Sailor::Math
 			glm::vec3(m_min.x, m_min.y, m_max.z) });
 		}
 
-		SAILOR_API __forceinline glm::vec3 GetCenter() const;
-		SAILOR_API __forceinline glm::vec3 GetExtents() const;
+		SAILOR_API glm::vec3 GetCenter() const;
+		SAILOR_API glm::vec3 GetExtents() const;
 
-		SAILOR_API __forceinline float Volume() const;
-		SAILOR_API __forceinline float Area() const;
-		SAILOR_API __forceinline void Extend(const AABB& inner);
-		SAILOR_API __forceinline void Extend(const glm::vec3& inner);
-		SAILOR_API __forceinline void Apply(const glm::mat4& transformMatrix);
+		SAILOR_API float Volume() const;
+		SAILOR_API float Area() const;
+		SAILOR_API void Extend(const AABB& inner);
+		SAILOR_API void Extend(const glm::vec3& inner);
+		SAILOR_API void Apply(const glm::mat4& transformMatrix);
 		SAILOR_API __forceinline bool IsValid() const { return m_min != m_max; }
 
 		SAILOR_API bool operator==(const AABB& rhs) const { return this->m_max == rhs.m_max && this->m_min == rhs.m_min; }
@@ -143,26 +149,26 @@ namespace Sailor::Math
 		SAILOR_API Frustum() : m_corners(8) {}
 		SAILOR_API Frustum(const glm::mat4& projectionViewMatrix) : m_corners(8) { ExtractFrustumPlanes(projectionViewMatrix); }
 
-		SAILOR_API __forceinline bool OverlapsAABB(const AABB& aabb) const;
-		SAILOR_API __forceinline bool OverlapsSphere(const Sphere& sphere) const;
+		SAILOR_API bool OverlapsAABB(const AABB& aabb) const;
+		SAILOR_API bool OverlapsSphere(const Sphere& sphere) const;
 
 		// SSE version, the most optimized
-		SAILOR_API __forceinline void OverlapsAABB(AABB* aabb, uint32_t numObjects, int32_t* outResults) const;
+		SAILOR_API void OverlapsAABB(AABB* aabb, uint32_t numObjects, int32_t* outResults) const;
 
 		// SSE version, the most optimized
-		SAILOR_API __forceinline void OverlapsSphere(Sphere* spheres, uint32_t numObjects, int32_t* outResults) const;
+		SAILOR_API void OverlapsSphere(Sphere* spheres, uint32_t numObjects, int32_t* outResults) const;
 
-		SAILOR_API __forceinline void ContainsSphere(Sphere* spheres, uint32_t numObjects, int32_t* outResults) const;
-		SAILOR_API __forceinline bool ContainsPoint(const glm::vec3& point) const;
-		SAILOR_API __forceinline bool ContainsSphere(const Sphere& sphere) const;
+		SAILOR_API void ContainsSphere(Sphere* spheres, uint32_t numObjects, int32_t* outResults) const;
+		SAILOR_API bool ContainsPoint(const glm::vec3& point) const;
+		SAILOR_API bool ContainsSphere(const Sphere& sphere) const;
 
-		SAILOR_API __forceinline glm::vec3 CalculateCenter() const;
-		SAILOR_API __forceinline glm::mat4 CalculateOrthoMatrixByView(const glm::mat4& view, float zMult) const;
+		SAILOR_API glm::vec3 CalculateCenter() const;
+		SAILOR_API glm::mat4 CalculateOrthoMatrixByView(const glm::mat4& view, float zMult) const;
 
-		SAILOR_API __forceinline const TVector<glm::vec3>& GetCorners() const;
+		SAILOR_API const TVector<glm::vec3>& GetCorners() const;
 
-		SAILOR_API __forceinline void ExtractFrustumPlanes(const glm::mat4& projectionViewMatrix, bool bNormalizePlanes = true);
-		SAILOR_API __forceinline void ExtractFrustumPlanes(const glm::mat4& worldMatrix, float aspect, float fovY, float zNear, float zFar);
+		SAILOR_API void ExtractFrustumPlanes(const glm::mat4& projectionViewMatrix, bool bNormalizePlanes = true);
+		SAILOR_API void ExtractFrustumPlanes(const glm::mat4& worldMatrix, float aspect, float fovY, float zNear, float zFar);
 
 	protected:
 
@@ -259,7 +265,7 @@ namespace Sailor::Math
 namespace std
 {
 	template<>
-	struct std::hash<Sailor::Math::AABB>
+	struct hash<Sailor::Math::AABB>
 	{
 		SAILOR_API size_t operator()(Sailor::Math::AABB const& instance) const
 		{
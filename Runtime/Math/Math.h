@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Transform.h"
+#include <xmmintrin.h>
 
 #include <glm/glm/glm.hpp>
 #include <glm/glm/gtc/quaternion.hpp>
@@ -54,8 +55,33 @@ namespace Sailor::Math
 	template<typename T>
 	T Lerp(const T& a, const T& b, float t) { return a + (b - a) * t; }
 
-	SAILOR_API __forceinline glm::mat4 PerspectiveInfiniteRH(float fovRadians, float aspectWbyH, float zNear);
-	SAILOR_API __forceinline glm::mat4 PerspectiveRH(float fovRadians, float aspectWbyH, float zNear, float zFar);
+	/* The same as outRes = lhs * rhs, each column of the result is the sum of the lhs columns scaled by the rhs column by SSE.
+	*  The sum has the same order as glm, so the result is the same, outRes could be lhs or rhs.
+	*/
+	SAILOR_API __forceinline void MultiplyMatrices(const glm::mat4& lhs, const glm::mat4& rhs, glm::mat4& outRes)
+	{
+		const __m128 lhs0 = _mm_loadu_ps(&lhs[0][0]);
+		const __m128 lhs1 = _mm_loadu_ps(&lhs[1][0]);
+		const __m128 lhs2 = _mm_loadu_ps(&lhs[2][0]);
+		const __m128 lhs3 = _mm_loadu_ps(&lhs[3][0]);
+
+		__m128 res[4];
+		for (uint32_t i = 0; i < 4; i++)
+		{
+			res[i] = _mm_mul_ps(lhs0, _mm_set1_ps(rhs[i][0]));
+			res[i] = _mm_add_ps(res[i], _mm_mul_ps(lhs1, _mm_set1_ps(rhs[i][1])));
+			res[i] = _mm_add_ps(res[i], _mm_mul_ps(lhs2, _mm_set1_ps(rhs[i][2])));
+			res[i] = _mm_add_ps(res[i], _mm_mul_ps(lhs3, _mm_set1_ps(rhs[i][3])));
+		}
+
+		for (uint32_t i = 0; i < 4; i++)
+		{
+			_mm_storeu_ps(&outRes[i][0], res[i]);
+		}
+	}
+
+	SAILOR_API glm::mat4 PerspectiveInfiniteRH(float fovRadians, float aspectWbyH, float zNear);
+	SAILOR_API glm::mat4 PerspectiveRH(float fovRadians, float aspectWbyH, float zNear, float zFar);
 }
 
 #if defined(min)
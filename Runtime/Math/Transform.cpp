@@ -38,7 +38,14 @@ Transform& Transform::operator*= (const Transform& parent)
 
 mat4 Transform::Matrix() const
 {
-	return glm::translate(glm::mat4(1), vec3(m_position)) * glm::toMat4(m_rotation) * glm::scale(glm::mat4(1), vec3(m_scale));
+	// translate * rotate * scale without the multiplications by the zeros, the result is the same
+	mat4 res = glm::toMat4(m_rotation);
+	res[0] *= m_scale.x;
+	res[1] *= m_scale.y;
+	res[2] *= m_scale.z;
+	res[3] = vec4(vec3(m_position), 1.0f);
+
+	return res;
 }
 
 vec4 Transform::TransformPosition(const vec4& position) const
@@ -0,0 +1,147 @@
+#include "EpochReclamation.h"
+#include <atomic>
+
+using namespace Sailor;
+using namespace Sailor::Memory;
+
+namespace Sailor::Memory::Internal
+{
+	// Each thread writes only its own record, the records are reused by the new threads and never freed
+	struct alignas(64) EpochRecord
+	{
+		// The epoch observed by the outermost guard, Quiescent if the thread is not pinned
+		std::atomic<uint64_t> m_epoch = 0;
+		uint32_t m_depth = 0;
+
+		std::atomic<bool> m_bInUse = false;
+		EpochRecord* m_pNext = nullptr;
+	};
+}
+
+namespace
+{
+	using EpochRecord = Sailor::Memory::Internal::EpochRecord;
+
+	constexpr uint64_t Quiescent = 0;
+
+	std::atomic<uint64_t> g_globalEpoch = 1;
+	std::atomic<EpochRecord*> g_pRecords = nullptr;
+
+	EpochRecord* AcquireRecord()
+	{
+		for (EpochRecord* pRecord = g_pRecords.load(std::memory_order_acquire); pRecord; pRecord = pRecord->m_pNext)
+		{
+			bool bInUse = false;
+			if (!pRecord->m_bInUse.load(std::memory_order_relaxed) &&
+				pRecord->m_bInUse.compare_exchange_strong(bInUse, true, std::memory_order_acquire, std::memory_order_relaxed))
+			{
+				return pRecord;
+			}
+		}
+
+		EpochRecord* pRecord = new EpochRecord();
+		pRecord->m_bInUse.store(true, std::memory_order_relaxed);
+
+		EpochRecord* pHead = g_pRecords.load(std::memory_order_relaxed);
+		do
+		{
+			pRecord->m_pNext = pHead;
+		} while (!g_pRecords.compare_exchange_weak(pHead, pRecord, std::memory_order_release, std::memory_order_relaxed));
+
+		return pRecord;
+	}
+
+	struct ThreadRecord
+	{
+		EpochRecord* m_pRecord = nullptr;
+
+		~ThreadRecord()
+		{
+			if (m_pRecord)
+			{
+				check(m_pRecord->m_depth == 0);
+
+				m_pRecord->m_epoch.store(Quiescent, std::memory_order_release);
+				m_pRecord->m_bInUse.store(false, std::memory_order_release);
+			}
+		}
+	};
+
+	thread_local ThreadRecord t_threadRecord;
+
+	__forceinline EpochRecord* GetThreadRecord()
+	{
+		if (!t_threadRecord.m_pRecord)
+		{
+			t_threadRecord.m_pRecord = AcquireRecord();
+		}
+
+		return t_threadRecord.m_pRecord;
+	}
+}
+
+EpochGuard EpochGuard::Pin()
+{
+	EpochRecord* pRecord = GetThreadRecord();
+
+	if (pRecord->m_depth++ == 0)
+	{
+		// The exchange is the full fence that is cheaper than mfence,
+		// the loads of the shared nodes are not reordered before the record is published
+		pRecord->m_epoch.exchange(g_globalEpoch.load(std::memory_order_relaxed), std::memory_order_seq_cst);
+	}
+
+	EpochGuard guard;
+	guard.m_pRecord = pRecord;
+	return guard;
+}
+
+void EpochGuard::Release()
+{
+	if (!m_pRecord)
+	{
+		return;
+	}
+
+	check(m_pRecord->m_depth > 0);
+
+	if (--m_pRecord->m_depth == 0)
+	{
+		m_pRecord->m_epoch.store(Quiescent, std::memory_order_release);
+	}
+
+	m_pRecord = nullptr;
+}
+
+uint64_t EpochReclamation::GetRetireEpoch()
+{
+	// Pairs with the pinning: either the reader pinned the later epoch and can't see the unlinked object,
+	// or the object is stamped with the epoch that is not older than the reader's one
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	return g_globalEpoch.load(std::memory_order_relaxed);
+}
+
+uint64_t EpochReclamation::TryAdvance()
+{
+	const uint64_t epoch = g_globalEpoch.load(std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+
+	for (EpochRecord* pRecord = g_pRecords.load(std::memory_order_acquire); pRecord; pRecord = pRecord->m_pNext)
+	{
+		const uint64_t recordEpoch = pRecord->m_epoch.load(std::memory_order_relaxed);
+		if (recordEpoch != Quiescent && recordEpoch != epoch)
+		{
+			return epoch;
+		}
+	}
+
+	std::atomic_thread_fence(std::memory_order_acquire);
+
+	uint64_t expected = epoch;
+	if (g_globalEpoch.compare_exchange_strong(expected, epoch + 1, std::memory_order_release, std::memory_order_relaxed))
+	{
+		return epoch + 1;
+	}
+
+	return expected;
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <cassert>
+#include <cstdint>
+#include <utility>
+#include "Core/Defines.h"
+
+namespace Sailor::Memory
+{
+	namespace Internal
+	{
+		struct EpochRecord;
+	}
+
+	/* Epoch based reclamation for the lock free containers.
+	*  The reader pins the global epoch for the time it accesses the shared nodes, that is the store to its own cache line,
+	*  the writer unlinks the node, stamps it with EpochReclamation::GetRetireEpoch and frees it
+	*  only when the global epoch is two steps ahead, so no pinned reader could reach the node.
+	*  The guards are thread affine, the nested guards are cheap and the long living guard only delays the reclamation.
+	*/
+	class EpochGuard final
+	{
+	public:
+
+		EpochGuard() = default;
+
+		// The copy pins the current thread
+		EpochGuard(const EpochGuard& rhs)
+		{
+			if (rhs.IsPinned())
+			{
+				*this = Pin();
+			}
+		}
+
+		EpochGuard(EpochGuard&& rhs) noexcept : m_pRecord(rhs.m_pRecord) { rhs.m_pRecord = nullptr; }
+
+		EpochGuard& operator=(const EpochGuard& rhs)
+		{
+			EpochGuard copy(rhs);
+			std::swap(m_pRecord, copy.m_pRecord);
+			return *this;
+		}
+
+		EpochGuard& operator=(EpochGuard&& rhs) noexcept
+		{
+			std::swap(m_pRecord, rhs.m_pRecord);
+			return *this;
+		}
+
+		~EpochGuard() { Release(); }
+
+		SAILOR_API static EpochGuard Pin();
+
+		__forceinline bool IsPinned() const { return m_pRecord != nullptr; }
+
+		SAILOR_API void Release();
+
+	protected:
+
+		Internal::EpochRecord* m_pRecord = nullptr;
+	};
+
+	class EpochReclamation final
+	{
+	public:
+
+		// Should be called after the object is unlinked
+		SAILOR_API static uint64_t GetRetireEpoch();
+
+		// Advances the global epoch if all pinned threads have observed it, returns the global epoch
+		SAILOR_API static uint64_t TryAdvance();
+
+		static __forceinline bool IsSafeToFree(uint64_t retireEpoch, uint64_t globalEpoch) { return retireEpoch + 2 <= globalEpoch; }
+	};
+}
@@ -0,0 +1,149 @@
+#include "FrameAllocator.h"
+#include <atomic>
+#include <cstdlib>
+#include <mutex>
+#include <cstdio>
+
+using namespace Sailor;
+using namespace Sailor::Memory;
+
+namespace
+{
+	struct Chunk
+	{
+		Chunk* m_pNext = nullptr;
+		size_t m_size = 0;
+
+		__forceinline uintptr_t Begin() const { return (uintptr_t)(this + 1); }
+		__forceinline uintptr_t End() const { return (uintptr_t)this + m_size; }
+	};
+
+	// Guards the lists, the frame index is changed under the lock as well
+	std::mutex g_chunksMutex;
+	Chunk* g_pFreeChunks = nullptr;
+	Chunk* g_pUsedChunks[FrameAllocator::NumFrames]{};
+	std::atomic<uint64_t> g_frameIndex = 0;
+
+	struct ThreadArena
+	{
+		uint64_t m_frameIndex = UINT64_MAX;
+		uintptr_t m_current = 0;
+		uintptr_t m_end = 0;
+		uintptr_t m_lastAllocation = 0;
+	};
+
+	thread_local ThreadArena t_arena;
+
+	__forceinline uintptr_t AlignUp(uintptr_t ptr, size_t alignment)
+	{
+		return (ptr + alignment - 1) & ~(uintptr_t)(alignment - 1);
+	}
+
+	bool AcquireChunk(ThreadArena& arena, size_t minSize)
+	{
+		const std::lock_guard<std::mutex> lock(g_chunksMutex);
+
+		const uint64_t frameIndex = g_frameIndex.load(std::memory_order_relaxed);
+		const size_t requiredSize = minSize + sizeof(Chunk);
+
+		Chunk* pChunk = nullptr;
+		if (requiredSize <= FrameAllocator::ChunkSize && g_pFreeChunks)
+		{
+			pChunk = g_pFreeChunks;
+			g_pFreeChunks = pChunk->m_pNext;
+		}
+		else
+		{
+			// The huge blocks get their own chunk that is released on recycle
+			const size_t size = requiredSize > FrameAllocator::ChunkSize ? requiredSize : FrameAllocator::ChunkSize;
+
+			pChunk = (Chunk*)std::malloc(size);
+			if (!pChunk)
+			{
+				// The log goes to stderr directly, since the scheduled logging could allocate under the lock
+				fprintf(stderr, "FrameAllocator cannot allocate the chunk of %zu bytes\n", size);
+				check(pChunk);
+				return false;
+			}
+
+			pChunk->m_size = size;
+		}
+
+		Chunk*& pUsedChunks = g_pUsedChunks[frameIndex % FrameAllocator::NumFrames];
+		pChunk->m_pNext = pUsedChunks;
+		pUsedChunks = pChunk;
+
+		arena.m_frameIndex = frameIndex;
+		arena.m_current = pChunk->Begin();
+		arena.m_end = pChunk->End();
+
+		return true;
+	}
+}
+
+void* FrameAllocator::allocate(size_t size, size_t alignment)
+{
+	ThreadArena& arena = t_arena;
+
+	uintptr_t res = AlignUp(arena.m_current, alignment);
+	if (arena.m_frameIndex != g_frameIndex.load(std::memory_order_acquire) || res + size > arena.m_end)
+	{
+		if (!AcquireChunk(arena, size + alignment))
+		{
+			return nullptr;
+		}
+
+		res = AlignUp(arena.m_current, alignment);
+	}
+
+	arena.m_current = res + size;
+	arena.m_lastAllocation = res;
+
+	return (void*)res;
+}
+
+bool FrameAllocator::reallocate(void* ptr, size_t size, size_t)
+{
+	ThreadArena& arena = t_arena;
+
+	if ((uintptr_t)ptr != arena.m_lastAllocation ||
+		arena.m_frameIndex != g_frameIndex.load(std::memory_order_acquire) ||
+		(uintptr_t)ptr + size > arena.m_end)
+	{
+		return false;
+	}
+
+	arena.m_current = (uintptr_t)ptr + size;
+	return true;
+}
+
+void FrameAllocator::BeginFrame()
+{
+	const std::lock_guard<std::mutex> lock(g_chunksMutex);
+
+	const uint64_t frameIndex = g_frameIndex.load(std::memory_order_relaxed) + 1;
+
+	Chunk*& pRetiredChunks = g_pUsedChunks[frameIndex % NumFrames];
+	while (Chunk* pChunk = pRetiredChunks)
+	{
+		pRetiredChunks = pChunk->m_pNext;
+
+		if (pChunk->m_size == ChunkSize)
+		{
+			pChunk->m_pNext = g_pFreeChunks;
+			g_pFreeChunks = pChunk;
+		}
+		else
+		{
+			std::free(pChunk);
+		}
+	}
+
+	// The threads notice the new frame on the next allocation and take the new chunks
+	g_frameIndex.store(frameIndex, std::memory_order_release);
+}
+
+uint64_t FrameAllocator::GetFrameIndex()
+{
+	return g_frameIndex.load(std::memory_order_acquire);
+}
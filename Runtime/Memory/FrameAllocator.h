@@ -0,0 +1,36 @@
+#pragma once
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include "Core/Defines.h"
+
+namespace Sailor::Memory
+{
+	/* Global linear allocator for the transient data that doesn't outlive the frame in flight.
+	*  Each thread bumps the pointer in its own chunk without locks, Free does nothing,
+	*  all chunks of the frame are recycled at once when NumFrames newer frames have begun.
+	*/
+	class SAILOR_API FrameAllocator
+	{
+	public:
+
+		// The frame that is being built, the frames in the render queue and the frame that is being rendered
+		static constexpr uint32_t NumFrames = 4;
+		static constexpr size_t ChunkSize = 256 * 1024;
+
+		__forceinline void* Allocate(size_t size, size_t alignment = 8) { return FrameAllocator::allocate(size, alignment); }
+		__forceinline bool Reallocate(void* ptr, size_t size, size_t alignment = 8) { return FrameAllocator::reallocate(ptr, size, alignment); }
+		__forceinline void Free(void*, size_t = 0) {}
+
+		// Returns nullptr if the system is out of memory
+		static void* allocate(size_t size, size_t alignment = 8);
+
+		// Only the last allocation of the current thread could grow in place
+		static bool reallocate(void* ptr, size_t size, size_t alignment = 8);
+		static void free(void*, size_t = 0) {}
+
+		// Recycles the chunks of the frame that has begun NumFrames ago
+		static void BeginFrame();
+		static uint64_t GetFrameIndex();
+	};
+}
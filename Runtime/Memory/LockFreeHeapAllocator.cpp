@@ -1,56 +1,165 @@
-#pragma once
 #include "LockFreeHeapAllocator.h"
-#include <windows.h>
+#include <atomic>
 #include <mutex>
 
 using namespace Sailor;
 using namespace Sailor::Memory;
 
-// For now TConcurrentMap doesn't have dll interface, so cannot 
-// handle that in class
-std::unique_ptr<TConcurrentMap<DWORD, TUniquePtr<HeapAllocator>, 8, Memory::MallocAllocator>>& GetAllocator()
+namespace
 {
-	static std::unique_ptr<TConcurrentMap<DWORD, TUniquePtr<HeapAllocator>, 8, Memory::MallocAllocator>> g_lockFreeAllocators = std::make_unique<TConcurrentMap<DWORD, TUniquePtr<HeapAllocator>, 8, Memory::MallocAllocator>>();
-	return g_lockFreeAllocators;
-}
+	struct ThreadHeap;
 
-void* LockFreeHeapAllocator::allocate(size_t size, size_t alignment)
-{
-	auto& allocator = GetAllocator();
-	const DWORD currentThreadId = GetCurrentThreadId();
-	void* res = nullptr;
+	// Is placed in front of each block.
+	// The owner is replaced by the link of the remote free list once the block is freed by the other thread.
+	union BlockHeader
+	{
+		ThreadHeap* m_pOwner;
+		BlockHeader* m_pNextRemoteFree;
+	};
+
+	struct ThreadHeap
+	{
+		HeapAllocator m_allocator;
+
+		// Multiple producers push, only the owner takes the whole list at once, so there is no ABA
+		std::atomic<BlockHeader*> m_remoteFrees = nullptr;
+
+		// Guarded by g_orphanedHeapsMutex
+		ThreadHeap* m_pNextOrphaned = nullptr;
+
+		void PushRemoteFree(BlockHeader* pBlock)
+		{
+			BlockHeader* pHead = m_remoteFrees.load(std::memory_order_relaxed);
+			do
+			{
+				pBlock->m_pNextRemoteFree = pHead;
+			} while (!m_remoteFrees.compare_exchange_weak(pHead, pBlock, std::memory_order_release, std::memory_order_relaxed));
+		}
+
+		void DrainRemoteFrees()
+		{
+			if (m_remoteFrees.load(std::memory_order_relaxed) == nullptr)
+			{
+				return;
+			}
+
+			BlockHeader* pBlock = m_remoteFrees.exchange(nullptr, std::memory_order_acquire);
+			while (pBlock)
+			{
+				BlockHeader* pNext = pBlock->m_pNextRemoteFree;
+				m_allocator.Free(pBlock);
+				pBlock = pNext;
+			}
+		}
+	};
+
+	// The heaps are never released: the blocks could outlive the thread and be freed later.
+	// The heap of the finished thread is orphaned and then adopted by the next new thread.
+	std::mutex g_orphanedHeapsMutex;
+	ThreadHeap* g_pOrphanedHeaps = nullptr;
+
+	ThreadHeap* PopOrphanedHeap()
+	{
+		ThreadHeap* pHeap = g_pOrphanedHeaps;
+		if (pHeap)
+		{
+			g_pOrphanedHeaps = pHeap->m_pNextOrphaned;
+			pHeap->m_pNextOrphaned = nullptr;
+			return pHeap;
+		}
+
+		return new ThreadHeap();
+	}
+
+	void PushOrphanedHeap(ThreadHeap* pHeap)
+	{
+		pHeap->m_pNextOrphaned = g_pOrphanedHeaps;
+		g_pOrphanedHeaps = pHeap;
+	}
+
+	// Trivial thread locals are the plain TLS access, so that is the fast path
+	thread_local ThreadHeap* t_pHeap = nullptr;
+	thread_local bool t_bIsThreadExiting = false;
 
-	check(currentThreadId < 100000000);
+	// Is touched only once per thread to orphan the heap on the thread exit
+	struct ThreadHeapGuard
+	{
+		ThreadHeap* m_pHeap = nullptr;
+
+		~ThreadHeapGuard()
+		{
+			const std::lock_guard<std::mutex> lock(g_orphanedHeapsMutex);
+
+			PushOrphanedHeap(m_pHeap);
+
+			t_pHeap = nullptr;
+			t_bIsThreadExiting = true;
+		}
+	};
+
+	thread_local ThreadHeapGuard t_heapGuard;
 
-	auto& pAllocator = allocator->At_Lock(currentThreadId);
+	ThreadHeap* AcquireThreadHeap()
+	{
+		{
+			const std::lock_guard<std::mutex> lock(g_orphanedHeapsMutex);
+			t_pHeap = PopOrphanedHeap();
+		}
+
+		t_heapGuard.m_pHeap = t_pHeap;
+		return t_pHeap;
+	}
 
-	if (!pAllocator)
+	__forceinline void* AllocateBlock(ThreadHeap* pHeap, size_t size, size_t alignment)
 	{
-		pAllocator = TUniquePtr<HeapAllocator>::Make();
+		pHeap->DrainRemoteFrees();
+
+		BlockHeader* pBlock = (BlockHeader*)pHeap->m_allocator.Allocate(size + sizeof(BlockHeader), alignment);
+		if (!pBlock)
+		{
+			return nullptr;
+		}
+
+		pBlock->m_pOwner = pHeap;
+		return pBlock + 1;
 	}
+}
 
-	res = pAllocator->Allocate(size + sizeof(DWORD), alignment);
-	((DWORD*)res)[0] = currentThreadId;
-	allocator->Unlock(currentThreadId);
+void* LockFreeHeapAllocator::allocate(size_t size, size_t alignment)
+{
+	if (ThreadHeap* pHeap = t_pHeap)
+	{
+		return AllocateBlock(pHeap, size, alignment);
+	}
 
-	if (!res)
+	if (!t_bIsThreadExiting)
 	{
-		return nullptr;
+		return AllocateBlock(AcquireThreadHeap(), size, alignment);
 	}
 
-	return &((DWORD*)res)[1];
+	// The thread locals of the exiting thread are allocating,
+	// the orphaned heap is used under the lock and returned back
+	const std::lock_guard<std::mutex> lock(g_orphanedHeapsMutex);
+
+	ThreadHeap* pHeap = PopOrphanedHeap();
+	void* res = AllocateBlock(pHeap, size, alignment);
+	PushOrphanedHeap(pHeap);
+
+	return res;
 }
 
 bool LockFreeHeapAllocator::reallocate(void* ptr, size_t size, size_t alignment)
 {
-	auto& allocator = GetAllocator();
-	void* pRaw = (((DWORD*)ptr) - 1);
-	const DWORD allocatedThreadId = *(DWORD*)pRaw;
+	BlockHeader* pBlock = ((BlockHeader*)ptr) - 1;
+	ThreadHeap* pOwner = pBlock->m_pOwner;
 
-	bool res = allocator->At_Lock(allocatedThreadId)->Reallocate(pRaw, size + sizeof(DWORD), alignment);
-	allocator->Unlock(allocatedThreadId);
+	if (pOwner != t_pHeap)
+	{
+		return false;
+	}
 
-	check(((DWORD*)pRaw)[0] == allocatedThreadId);
+	const bool res = pOwner->m_allocator.Reallocate(pBlock, size + sizeof(BlockHeader), alignment);
+	check(pBlock->m_pOwner == pOwner);
 
 	return res;
 }
@@ -59,12 +168,16 @@ void LockFreeHeapAllocator::free(void* ptr, size_t size)
 {
 	if (ptr != nullptr)
 	{
-		auto& allocator = GetAllocator();
-		void* pRaw = (((DWORD*)ptr) - 1);
-		const DWORD allocatedThreadId = *((DWORD*)pRaw);
+		BlockHeader* pBlock = ((BlockHeader*)ptr) - 1;
+		ThreadHeap* pOwner = pBlock->m_pOwner;
 
-		check(allocator->ContainsKey(allocatedThreadId));
-		allocator->At_Lock(allocatedThreadId)->Free(pRaw);
-		allocator->Unlock(allocatedThreadId);
+		if (pOwner == t_pHeap)
+		{
+			pOwner->m_allocator.Free(pBlock);
+		}
+		else
+		{
+			pOwner->PushRemoteFree(pBlock);
+		}
 	}
 }
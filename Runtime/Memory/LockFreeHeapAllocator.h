@@ -1,13 +1,15 @@
 #pragma once
 #include <cassert>
 #include "Core/Defines.h"
-#include "Memory/UniquePtr.hpp"
 #include "HeapAllocator.h"
-#include "Containers/ConcurrentMap.h"
 
 namespace Sailor::Memory
 {
-	// Global allocator
+	/* Global allocator
+	*  Each thread owns the HeapAllocator and allocates/frees its own blocks without locks.
+	*  The block that is freed by the other thread is pushed to the owner's remote free list,
+	*  the owner drains the list on the next allocation.
+	*/
 	class SAILOR_API LockFreeHeapAllocator
 	{
 	public:
@@ -18,9 +20,11 @@ namespace Sailor::Memory
 
 		// Used for smart ptrs
 		static void* allocate(size_t size, size_t alignment = 8);
+
+		// Only the owner thread can grow the block in place, false means 'allocate the new one'
 		static bool reallocate(void* ptr, size_t size, size_t alignment = 8);
 		static void free(void* ptr, size_t size = 0);
 
 	protected:
 	};
-}
\ No newline at end of file
+}
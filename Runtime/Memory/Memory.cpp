@@ -6,13 +6,15 @@
 #include <cassert>
 #include <functional> 
 #include <cctype>
+#include <atomic>
+#include <thread>
 #include "Core/Utils.h"
 #include "Containers/Pair.h"
 #include "MallocAllocator.hpp"
-#include "MemoryBlockAllocator.hpp"
-#include "MemoryPoolAllocator.hpp"
-#include "MemoryMultiPoolAllocator.hpp"
-#include "psapi.h"
+#include "Containers/ConcurrentMap.h"
+#include "Containers/Map.h"
+#include "FrameAllocator.h"
+#include "Platform/Platform.h"
 
 using namespace Sailor;
 using namespace Sailor::Memory;
@@ -20,22 +22,7 @@ using Timer = Utils::Timer;
 
 size_t GetTotalUsedVirtualMemory()
 {
-	PROCESS_MEMORY_COUNTERS_EX pmc;
-	GetProcessMemoryInfo(GetCurrentProcess(), (PROCESS_MEMORY_COUNTERS*)&pmc, sizeof(pmc));
-	SIZE_T virtualMemUsedByMe = pmc.PrivateUsage;
-
-	MEMORYSTATUSEX statex;
-
-	statex.dwLength = sizeof(statex);
-
-	GlobalMemoryStatusEx(&statex);
-
-	MEMORYSTATUSEX memInfo;
-	memInfo.dwLength = sizeof(MEMORYSTATUSEX);
-	GlobalMemoryStatusEx(&memInfo);
-	DWORDLONG virtualMemUsed = memInfo.ullTotalVirtual - memInfo.ullAvailVirtual;
-
-	return (size_t)virtualMemUsedByMe;
+	return Platform::GetProcessUsedMemory();
 }
 
 typedef std::unordered_map<std::string, std::unordered_map<size_t, std::pair<size_t, float>>> TestResult;
@@ -456,27 +443,18 @@ public:
 				char buf[64];
 				if (size >= (1 << 10))
 				{
-					sprintf_s(buf, 64, "%.*f", 2, (double)size / (double)(1 << 10));
+					snprintf(buf, 64, "%.*f", 2, (double)size / (double)(1 << 10));
 					return std::string(buf) + " " + METRICS[idx + 1];
 				}
 				else
 				{
-					sprintf_s(buf, 64, "%d", (int)size);
+					snprintf(buf, 64, "%d", (int)size);
 					return std::string(buf) + " " + METRICS[idx];
 				}
 			}
 		};
 
-		size_t ramSize;
-		{
-			ULONGLONG ramSizeKB;
-			if (!GetPhysicallyInstalledSystemMemory(&ramSizeKB))
-			{
-				printf("FUCK!\n");
-				exit(0);
-			}
-			ramSize = (size_t)ramSizeKB << 10;
-		}
+		const size_t ramSize = Platform::GetPhysicalMemorySize();
 
 		timer.Start();
 		{
@@ -590,6 +568,288 @@ public:
 template<typename TAllocator>
 float TestCase_MemoryPerformance<TAllocator>::m_globalScore = 0.0f;
 
+namespace
+{
+	// The previous design of LockFreeHeapAllocator: the heap per thread in the striped concurrent map,
+	// each call locks the owner's stripe, so the cross thread free waits for the owner
+	class LockedHeapAllocator
+	{
+	public:
+
+		void* Allocate(size_t size, size_t alignment = 8)
+		{
+			auto& allocators = GetAllocators();
+			const DWORD currentThreadId = Platform::GetCurrentThreadId();
+
+			auto& pAllocator = allocators.At_Lock(currentThreadId);
+			if (!pAllocator)
+			{
+				pAllocator = TUniquePtr<HeapAllocator>::Make();
+			}
+
+			void* res = pAllocator->Allocate(size + sizeof(DWORD), alignment);
+			((DWORD*)res)[0] = currentThreadId;
+			allocators.Unlock(currentThreadId);
+
+			return &((DWORD*)res)[1];
+		}
+
+		void Free(void* ptr, size_t = 0)
+		{
+			auto& allocators = GetAllocators();
+			void* pRaw = (((DWORD*)ptr) - 1);
+			const DWORD allocatedThreadId = *((DWORD*)pRaw);
+
+			allocators.At_Lock(allocatedThreadId)->Free(pRaw);
+			allocators.Unlock(allocatedThreadId);
+		}
+
+	protected:
+
+		static TConcurrentMap<DWORD, TUniquePtr<HeapAllocator>, 8, Memory::MallocAllocator>& GetAllocators()
+		{
+			static TConcurrentMap<DWORD, TUniquePtr<HeapAllocator>, 8, Memory::MallocAllocator> allocators;
+			return allocators;
+		}
+	};
+
+	// Single producer single consumer ring, to hand the blocks over without measuring the queue itself
+	class BlocksRing
+	{
+	public:
+
+		static constexpr size_t Capacity = 1024;
+
+		void Push(void* ptr)
+		{
+			const size_t tail = m_tail.load(std::memory_order_relaxed);
+			while (tail - m_head.load(std::memory_order_acquire) == Capacity)
+			{
+				std::this_thread::yield();
+			}
+
+			m_blocks[tail & (Capacity - 1)] = ptr;
+			m_tail.store(tail + 1, std::memory_order_release);
+		}
+
+		void* Pop()
+		{
+			const size_t head = m_head.load(std::memory_order_relaxed);
+			while (m_tail.load(std::memory_order_acquire) == head)
+			{
+				std::this_thread::yield();
+			}
+
+			void* ptr = m_blocks[head & (Capacity - 1)];
+			m_head.store(head + 1, std::memory_order_release);
+
+			return ptr;
+		}
+
+	protected:
+
+		void* m_blocks[Capacity]{};
+		alignas(64) std::atomic<size_t> m_head = 0;
+		alignas(64) std::atomic<size_t> m_tail = 0;
+	};
+
+	template<typename TAllocator>
+	class TestCase_MultithreadedMemoryPerformance
+	{
+	public:
+
+		// Each thread allocates the batch of blocks and frees them, everything is thread local
+		static int64_t RunAllThreadsAllocate(uint32_t numThreads, size_t numAllocations)
+		{
+			const size_t BatchSize = 1024;
+
+			Timer timer;
+			timer.Start();
+
+			std::vector<std::thread> threads;
+			for (uint32_t i = 0; i < numThreads; i++)
+			{
+				threads.emplace_back([=]()
+					{
+						TAllocator allocator;
+						uint32_t seed = i + 1;
+						void* ptrs[BatchSize];
+
+						for (size_t j = 0; j < numAllocations; j += BatchSize)
+						{
+							for (size_t k = 0; k < BatchSize; k++)
+							{
+								ptrs[k] = allocator.Allocate(GetBlockSize(seed), 8);
+								((uint8_t*)ptrs[k])[0] = (uint8_t)k;
+							}
+
+							for (size_t k = 0; k < BatchSize; k++)
+							{
+								check(((uint8_t*)ptrs[k])[0] == (uint8_t)k);
+								allocator.Free(ptrs[k]);
+							}
+						}
+					});
+			}
+
+			for (auto& thread : threads)
+			{
+				thread.join();
+			}
+
+			timer.Stop();
+			return timer.ResultMs();
+		}
+
+		// Half of threads allocate, the other half frees, all frees are cross thread
+		static int64_t RunProducerConsumer(uint32_t numThreads, size_t numAllocations)
+		{
+			const uint32_t numPairs = max(1u, numThreads / 2);
+			std::vector<std::unique_ptr<BlocksRing>> rings;
+			for (uint32_t i = 0; i < numPairs; i++)
+			{
+				rings.emplace_back(std::make_unique<BlocksRing>());
+			}
+
+			Timer timer;
+			timer.Start();
+
+			std::vector<std::thread> threads;
+			for (uint32_t i = 0; i < numPairs; i++)
+			{
+				BlocksRing* pRing = rings[i].get();
+
+				threads.emplace_back([=]()
+					{
+						TAllocator allocator;
+						uint32_t seed = i + 1;
+
+						for (size_t j = 0; j < numAllocations; j++)
+						{
+							void* ptr = allocator.Allocate(GetBlockSize(seed), 8);
+							((uint8_t*)ptr)[0] = (uint8_t)j;
+							pRing->Push(ptr);
+						}
+					});
+
+				threads.emplace_back([=]()
+					{
+						TAllocator allocator;
+
+						for (size_t j = 0; j < numAllocations; j++)
+						{
+							void* ptr = pRing->Pop();
+							check(((uint8_t*)ptr)[0] == (uint8_t)j);
+							allocator.Free(ptr);
+						}
+					});
+			}
+
+			for (auto& thread : threads)
+			{
+				thread.join();
+			}
+
+			timer.Stop();
+			return timer.ResultMs();
+		}
+
+	protected:
+
+		// Mostly small blocks, the same distribution that containers and smart ptrs produce
+		static size_t GetBlockSize(uint32_t& seed)
+		{
+			seed = 1664525u * seed + 1013904223u;
+			return (seed >> 8) % 8 == 0 ? 256 + (seed >> 16) % 4096 : 8 + (seed >> 16) % 248;
+		}
+	};
+
+	template<typename TAllocator>
+	void RunMultithreadedTests(const char* allocatorName, uint32_t numThreads)
+	{
+		const size_t numAllocations = 1 << 20;
+
+		const int64_t allThreadsMs = TestCase_MultithreadedMemoryPerformance<TAllocator>::RunAllThreadsAllocate(numThreads, numAllocations);
+		const int64_t producerConsumerMs = TestCase_MultithreadedMemoryPerformance<TAllocator>::RunProducerConsumer(numThreads, numAllocations);
+
+		printf("%s, %u threads:\n\tall threads allocate (%zu per thread) %llums\n\tproducer/consumer (%zu per pair) %llums\n",
+			allocatorName, numThreads,
+			numAllocations, (unsigned long long)allThreadsMs,
+			numAllocations, (unsigned long long)producerConsumerMs);
+	}
+
+	// Synthetic RHISceneView rebuild: proxies with the meshes and materials,
+	// then the draw calls are grouped by batches, the same as RenderSceneNode does.
+	template<typename TAllocator>
+	class TestCase_FrameDataPerformance
+	{
+	public:
+
+		struct PerInstanceData
+		{
+			glm::mat4 m_model;
+			uint32_t m_materialInstance;
+		};
+
+		struct Proxy
+		{
+			glm::mat4 m_worldMatrix;
+			TVector<uint64_t, TAllocator> m_meshes;
+			TVector<uint64_t, TAllocator> m_materials;
+		};
+
+		static size_t RebuildFrame(uint32_t numProxies, uint32_t seed)
+		{
+			TVector<Proxy, TAllocator> proxies;
+
+			for (uint32_t i = 0; i < numProxies; i++)
+			{
+				seed = 1664525u * seed + 1013904223u;
+
+				Proxy& proxy = proxies[proxies.Emplace()];
+				proxy.m_worldMatrix = glm::mat4(1.0f);
+
+				const uint32_t numMeshes = 1 + (seed >> 8) % 4;
+				for (uint32_t j = 0; j < numMeshes; j++)
+				{
+					proxy.m_meshes.Add((seed >> 4) % 512 + j);
+					proxy.m_materials.Add((seed >> 12) % 64);
+				}
+			}
+
+			TMap<uint64_t, TVector<PerInstanceData, TAllocator>, TAllocator> drawCalls;
+			for (const auto& proxy : proxies)
+			{
+				for (size_t j = 0; j < proxy.m_meshes.Num(); j++)
+				{
+					drawCalls[proxy.m_materials[j] * 1024 + proxy.m_meshes[j]].Add(PerInstanceData{ proxy.m_worldMatrix, (uint32_t)j });
+				}
+			}
+
+			return drawCalls.Num();
+		}
+
+		static int64_t Run(uint32_t numFrames, uint32_t numProxies, size_t& outNumBatches)
+		{
+			Timer timer;
+			timer.Start();
+
+			for (uint32_t i = 0; i < numFrames; i++)
+			{
+				if constexpr (std::is_same_v<TAllocator, FrameAllocator>)
+				{
+					FrameAllocator::BeginFrame();
+				}
+
+				outNumBatches = RebuildFrame(numProxies, 1);
+			}
+
+			timer.Stop();
+			return timer.ResultMs();
+		}
+	};
+}
+
 std::string GetJsData(std::string allocSize, std::string testName, std::vector<Result> results, bool bTime)
 {
 	std::string res;
@@ -634,6 +894,27 @@ void Sailor::Memory::RunMemoryBenchmark()
 {
 	printf("Starting memory benchmark...\n");
 
+	const uint32_t numThreads = max(2u, std::thread::hardware_concurrency());
+	RunMultithreadedTests<LockFreeHeapAllocator>("LockFreeHeapAllocator", numThreads);
+	RunMultithreadedTests<LockedHeapAllocator>("LockedHeapAllocator (per thread heaps under locks)", numThreads);
+	RunMultithreadedTests<MallocAllocator>("MallocAllocator", numThreads);
+
+	{
+		const uint32_t numProxies = 50000;
+		const uint32_t numFrames = 32;
+
+		size_t numBatchesDefault = 0;
+		size_t numBatchesFrame = 0;
+
+		const int64_t defaultMs = TestCase_FrameDataPerformance<DefaultGlobalAllocator>::Run(numFrames, numProxies, numBatchesDefault);
+		const int64_t frameMs = TestCase_FrameDataPerformance<FrameAllocator>::Run(numFrames, numProxies, numBatchesFrame);
+
+		check(numBatchesDefault == numBatchesFrame);
+
+		printf("Scene view rebuild, %u proxies, %zu batches:\n\tDefaultGlobalAllocator %.2fms per frame\n\tFrameAllocator %.2fms per frame\n",
+			numProxies, numBatchesFrame, (float)defaultMs / numFrames, (float)frameMs / numFrames);
+	}
+
 	std::vector<Result> results;
 
 	results.reserve(3);
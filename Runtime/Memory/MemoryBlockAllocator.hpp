@@ -287,7 +287,7 @@ namespace Sailor::Memory
 
 	private:
 
-		SpinLock m_lock;
+		SpinLock m_lock{ SAILOR_SPINLOCK_SITE("TBlockAllocator") };
 		static constexpr uint32_t InvalidIndexUINT32 = (uint32_t)-1;
 
 		bool HeuristicToSkipBlocks(float occupation) const
@@ -325,7 +325,7 @@ namespace Sailor::Memory
 
 	private:
 
-		SpinLock m_lock;
+		SpinLock m_lock{ SAILOR_SPINLOCK_SITE("TPoolAllocator") };
 
 		static constexpr uint32_t InvalidIndex = (uint32_t)-1;
 
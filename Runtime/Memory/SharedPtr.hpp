@@ -213,6 +213,7 @@ namespace Sailor
 			pSharedPtr.m_pControlBlock = nullptr;
 		}
 
+		template<typename, typename>
 		friend class TSharedPtr;
 
 		template<typename, typename>
@@ -223,7 +224,7 @@ namespace Sailor
 namespace std
 {
 	template<typename T>
-	struct std::hash<Sailor::TSharedPtr<T>>
+	struct hash<Sailor::TSharedPtr<T>>
 	{
 		SAILOR_API std::size_t operator()(const Sailor::TSharedPtr<T>& p) const
 		{
@@ -129,6 +129,7 @@ namespace Sailor
 			pPtr.m_pRawPtr = nullptr;
 		}
 
+		template<typename>
 		friend class TUniquePtr;
 	};
 }
\ No newline at end of file
@@ -200,6 +200,7 @@ namespace Sailor
 			pPtr.m_pControlBlock = nullptr;
 		}
 
+		template<typename, typename>
 		friend class TWeakPtr;
 		friend class TSharedPtr<T>;
 	};
@@ -208,7 +209,7 @@ namespace Sailor
 namespace std
 {
 	template<typename T>
-	struct std::hash<Sailor::TWeakPtr<T>>
+	struct hash<Sailor::TWeakPtr<T>>
 	{
 		SAILOR_API std::size_t operator()(const Sailor::TWeakPtr<T>& p) const
 		{
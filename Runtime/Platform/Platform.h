@@ -0,0 +1,99 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <thread>
+#include "Core/Defines.h"
+
+#if !defined(_WIN32)
+#include <pthread.h>
+#endif
+
+/* The thin layer over the OS that is required by Tasks, Memory and Containers.
+*  Win32 and POSIX implementations live in Platform/Win32 and Platform/Posix,
+*  both are compiled everywhere but only one of them is enabled by the preprocessor.
+*/
+namespace Sailor::Platform
+{
+	SAILOR_API DWORD GetCurrentThreadId();
+
+	SAILOR_API void SetThreadName(const std::string& threadName);
+	SAILOR_API void SetThreadName(std::thread* thread, const std::string& threadName);
+
+	// The mask of logical cores that the thread is allowed to run on
+	SAILOR_API bool SetThreadAffinity(uint64_t affinityMask);
+	SAILOR_API bool SetThreadAffinity(std::thread* thread, uint64_t affinityMask);
+
+	// That could fail without the permissions on POSIX, so that is the hint
+	SAILOR_API bool SetThreadHighPriority();
+	SAILOR_API bool SetProcessHighPriority();
+
+	SAILOR_API int64_t GetProcessCpuTimeMicro();
+	SAILOR_API int64_t GetThreadCpuTimeMicro();
+
+	// Private bytes on Win32, resident set size on POSIX
+	SAILOR_API size_t GetProcessUsedMemory();
+	SAILOR_API size_t GetPhysicalMemorySize();
+
+	// Auto reset event wakes up the one waiting thread and resets itself,
+	// the manual reset event stays signaled until Reset is called
+	class SAILOR_API Event
+	{
+	public:
+
+		Event(bool bManualReset = false);
+		~Event();
+
+		Event(const Event&) = delete;
+		Event(Event&&) = delete;
+		Event& operator=(const Event&) = delete;
+		Event& operator=(Event&&) = delete;
+
+		void Set();
+		void Reset();
+		void Wait();
+
+		// Returns false on timeout
+		bool Wait(uint32_t timeoutMs);
+
+	protected:
+
+#if defined(_WIN32)
+		void* m_handle = nullptr;
+#else
+		pthread_mutex_t m_mutex;
+		pthread_cond_t m_condVar;
+		bool m_bIsSignaled = false;
+		bool m_bManualReset = false;
+#endif
+	};
+
+	// Read only view of the whole file, the data is valid until Unmap
+	class SAILOR_API MappedFile
+	{
+	public:
+
+		MappedFile() = default;
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile(MappedFile&&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+		MappedFile& operator=(MappedFile&&) = delete;
+
+		bool Map(const std::string& filepath);
+		void Unmap();
+
+		bool IsMapped() const { return m_pData != nullptr; }
+		const uint8_t* GetData() const { return m_pData; }
+		size_t GetSize() const { return m_size; }
+
+	protected:
+
+#if defined(_WIN32)
+		void* m_file = nullptr;
+		void* m_mapping = nullptr;
+#endif
+		const uint8_t* m_pData = nullptr;
+		size_t m_size = 0;
+	};
+}
@@ -0,0 +1,276 @@
+#if !defined(_WIN32)
+#include "Platform/Platform.h"
+#include <atomic>
+#include <ctime>
+#include <cstdio>
+#include <cerrno>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
+
+using namespace Sailor;
+using namespace Sailor::Platform;
+
+namespace
+{
+	__forceinline int64_t GetClockMicro(clockid_t clockId)
+	{
+		timespec time{};
+		clock_gettime(clockId, &time);
+		return (int64_t)time.tv_sec * 1000000 + time.tv_nsec / 1000;
+	}
+
+	bool SetAffinity(pthread_t thread, uint64_t affinityMask)
+	{
+#if defined(__linux__)
+		cpu_set_t cpuSet;
+		CPU_ZERO(&cpuSet);
+
+		for (uint32_t i = 0; i < 64; i++)
+		{
+			if (affinityMask & (1ull << i))
+			{
+				CPU_SET(i, &cpuSet);
+			}
+		}
+
+		return pthread_setaffinity_np(thread, sizeof(cpuSet), &cpuSet) == 0;
+#else
+		return false;
+#endif
+	}
+
+	void SetName(pthread_t thread, const std::string& threadName)
+	{
+#if defined(__linux__)
+		// Linux limits the name by 16 characters including the null terminator
+		pthread_setname_np(thread, threadName.substr(0, 15).c_str());
+#endif
+	}
+}
+
+DWORD Platform::GetCurrentThreadId()
+{
+	// The syscall is not free, so we cache the id
+	static thread_local DWORD threadId = 0;
+
+	if (threadId == 0)
+	{
+#if defined(__linux__)
+		threadId = (DWORD)syscall(SYS_gettid);
+#else
+		static std::atomic<DWORD> nextThreadId = 1;
+		threadId = nextThreadId++;
+#endif
+	}
+
+	return threadId;
+}
+
+void Platform::SetThreadName(const std::string& threadName)
+{
+	SetName(pthread_self(), threadName);
+}
+
+void Platform::SetThreadName(std::thread* thread, const std::string& threadName)
+{
+	SetName(thread->native_handle(), threadName);
+}
+
+bool Platform::SetThreadAffinity(uint64_t affinityMask)
+{
+	return SetAffinity(pthread_self(), affinityMask);
+}
+
+bool Platform::SetThreadAffinity(std::thread* thread, uint64_t affinityMask)
+{
+	return SetAffinity(thread->native_handle(), affinityMask);
+}
+
+bool Platform::SetThreadHighPriority()
+{
+#if defined(__linux__)
+	// The nice value is per thread on Linux, the negative values require CAP_SYS_NICE
+	return setpriority(PRIO_PROCESS, (id_t)GetCurrentThreadId(), -5) == 0;
+#else
+	return false;
+#endif
+}
+
+bool Platform::SetProcessHighPriority()
+{
+	return setpriority(PRIO_PROCESS, 0, -5) == 0;
+}
+
+int64_t Platform::GetProcessCpuTimeMicro()
+{
+	return GetClockMicro(CLOCK_PROCESS_CPUTIME_ID);
+}
+
+int64_t Platform::GetThreadCpuTimeMicro()
+{
+	return GetClockMicro(CLOCK_THREAD_CPUTIME_ID);
+}
+
+size_t Platform::GetProcessUsedMemory()
+{
+	size_t numPages = 0;
+	size_t numResidentPages = 0;
+
+	if (FILE* pFile = fopen("/proc/self/statm", "r"))
+	{
+		if (fscanf(pFile, "%zu %zu", &numPages, &numResidentPages) != 2)
+		{
+			numResidentPages = 0;
+		}
+		fclose(pFile);
+	}
+
+	return numResidentPages * (size_t)sysconf(_SC_PAGESIZE);
+}
+
+size_t Platform::GetPhysicalMemorySize()
+{
+	return (size_t)sysconf(_SC_PHYS_PAGES) * (size_t)sysconf(_SC_PAGESIZE);
+}
+
+Event::Event(bool bManualReset) : m_bManualReset(bManualReset)
+{
+	pthread_mutex_init(&m_mutex, nullptr);
+	pthread_cond_init(&m_condVar, nullptr);
+}
+
+Event::~Event()
+{
+	pthread_cond_destroy(&m_condVar);
+	pthread_mutex_destroy(&m_mutex);
+}
+
+void Event::Set()
+{
+	pthread_mutex_lock(&m_mutex);
+	m_bIsSignaled = true;
+
+	if (m_bManualReset)
+	{
+		pthread_cond_broadcast(&m_condVar);
+	}
+	else
+	{
+		pthread_cond_signal(&m_condVar);
+	}
+
+	pthread_mutex_unlock(&m_mutex);
+}
+
+void Event::Reset()
+{
+	pthread_mutex_lock(&m_mutex);
+	m_bIsSignaled = false;
+	pthread_mutex_unlock(&m_mutex);
+}
+
+void Event::Wait()
+{
+	pthread_mutex_lock(&m_mutex);
+
+	while (!m_bIsSignaled)
+	{
+		pthread_cond_wait(&m_condVar, &m_mutex);
+	}
+
+	if (!m_bManualReset)
+	{
+		m_bIsSignaled = false;
+	}
+
+	pthread_mutex_unlock(&m_mutex);
+}
+
+bool Event::Wait(uint32_t timeoutMs)
+{
+	timespec deadline{};
+	clock_gettime(CLOCK_REALTIME, &deadline);
+
+	deadline.tv_sec += timeoutMs / 1000;
+	deadline.tv_nsec += (long)(timeoutMs % 1000) * 1000000;
+
+	if (deadline.tv_nsec >= 1000000000)
+	{
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000;
+	}
+
+	pthread_mutex_lock(&m_mutex);
+
+	int res = 0;
+	while (!m_bIsSignaled && res != ETIMEDOUT)
+	{
+		res = pthread_cond_timedwait(&m_condVar, &m_mutex, &deadline);
+	}
+
+	const bool bIsSignaled = m_bIsSignaled;
+	if (bIsSignaled && !m_bManualReset)
+	{
+		m_bIsSignaled = false;
+	}
+
+	pthread_mutex_unlock(&m_mutex);
+
+	return bIsSignaled;
+}
+
+MappedFile::~MappedFile()
+{
+	Unmap();
+}
+
+bool MappedFile::Map(const std::string& filepath)
+{
+	Unmap();
+
+	const int fd = open(filepath.c_str(), O_RDONLY);
+	if (fd == -1)
+	{
+		return false;
+	}
+
+	struct stat fileStat {};
+	if (fstat(fd, &fileStat) != 0 || fileStat.st_size == 0)
+	{
+		close(fd);
+		return false;
+	}
+
+	// The mapping keeps the file referenced, so the descriptor is not needed anymore
+	void* pData = mmap(nullptr, (size_t)fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if (pData == MAP_FAILED)
+	{
+		return false;
+	}
+
+	m_pData = (const uint8_t*)pData;
+	m_size = (size_t)fileStat.st_size;
+
+	return true;
+}
+
+void MappedFile::Unmap()
+{
+	if (m_pData)
+	{
+		munmap((void*)m_pData, m_size);
+		m_pData = nullptr;
+		m_size = 0;
+	}
+}
+#endif
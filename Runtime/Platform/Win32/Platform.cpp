@@ -0,0 +1,171 @@
+#if defined(_WIN32)
+#include "Platform/Platform.h"
+#include <windows.h>
+#include <psapi.h>
+#include "Core/Utils.h"
+
+using namespace Sailor;
+using namespace Sailor::Platform;
+
+namespace
+{
+	__forceinline int64_t ToMicro(const FILETIME& time)
+	{
+		// FILETIME is measured in 100ns intervals
+		return (((int64_t)time.dwHighDateTime << 32) | time.dwLowDateTime) / 10;
+	}
+}
+
+DWORD Platform::GetCurrentThreadId()
+{
+	return ::GetCurrentThreadId();
+}
+
+void Platform::SetThreadName(const std::string& threadName)
+{
+	SetThreadDescription(GetCurrentThread(), Utils::UTF8_to_wchar(threadName.c_str()).c_str());
+}
+
+void Platform::SetThreadName(std::thread* thread, const std::string& threadName)
+{
+	SetThreadDescription((HANDLE)thread->native_handle(), Utils::UTF8_to_wchar(threadName.c_str()).c_str());
+}
+
+bool Platform::SetThreadAffinity(uint64_t affinityMask)
+{
+	return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)affinityMask) != 0;
+}
+
+bool Platform::SetThreadAffinity(std::thread* thread, uint64_t affinityMask)
+{
+	return SetThreadAffinityMask((HANDLE)thread->native_handle(), (DWORD_PTR)affinityMask) != 0;
+}
+
+bool Platform::SetThreadHighPriority()
+{
+	return SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_HIGHEST) != 0;
+}
+
+bool Platform::SetProcessHighPriority()
+{
+	return SetPriorityClass(GetCurrentProcess(), HIGH_PRIORITY_CLASS) != 0;
+}
+
+int64_t Platform::GetProcessCpuTimeMicro()
+{
+	FILETIME creationTime, exitTime, kernelTime, userTime;
+	GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime);
+	return ToMicro(kernelTime) + ToMicro(userTime);
+}
+
+int64_t Platform::GetThreadCpuTimeMicro()
+{
+	FILETIME creationTime, exitTime, kernelTime, userTime;
+	GetThreadTimes(GetCurrentThread(), &creationTime, &exitTime, &kernelTime, &userTime);
+	return ToMicro(kernelTime) + ToMicro(userTime);
+}
+
+size_t Platform::GetProcessUsedMemory()
+{
+	PROCESS_MEMORY_COUNTERS_EX pmc;
+	GetProcessMemoryInfo(GetCurrentProcess(), (PROCESS_MEMORY_COUNTERS*)&pmc, sizeof(pmc));
+	return (size_t)pmc.PrivateUsage;
+}
+
+size_t Platform::GetPhysicalMemorySize()
+{
+	ULONGLONG ramSizeKB = 0;
+	GetPhysicallyInstalledSystemMemory(&ramSizeKB);
+	return (size_t)ramSizeKB << 10;
+}
+
+Event::Event(bool bManualReset)
+{
+	m_handle = CreateEvent(nullptr, bManualReset, FALSE, nullptr);
+}
+
+Event::~Event()
+{
+	CloseHandle((HANDLE)m_handle);
+}
+
+void Event::Set()
+{
+	SetEvent((HANDLE)m_handle);
+}
+
+void Event::Reset()
+{
+	ResetEvent((HANDLE)m_handle);
+}
+
+void Event::Wait()
+{
+	WaitForSingleObject((HANDLE)m_handle, INFINITE);
+}
+
+bool Event::Wait(uint32_t timeoutMs)
+{
+	return WaitForSingleObject((HANDLE)m_handle, timeoutMs) == WAIT_OBJECT_0;
+}
+
+MappedFile::~MappedFile()
+{
+	Unmap();
+}
+
+bool MappedFile::Map(const std::string& filepath)
+{
+	Unmap();
+
+	HANDLE file = CreateFileA(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER size{};
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!mapping)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	const void* pData = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!pData)
+	{
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+
+	m_file = file;
+	m_mapping = mapping;
+	m_pData = (const uint8_t*)pData;
+	m_size = (size_t)size.QuadPart;
+
+	return true;
+}
+
+void MappedFile::Unmap()
+{
+	if (m_pData)
+	{
+		UnmapViewOfFile(m_pData);
+		CloseHandle((HANDLE)m_mapping);
+		CloseHandle((HANDLE)m_file);
+
+		m_pData = nullptr;
+		m_mapping = nullptr;
+		m_file = nullptr;
+		m_size = 0;
+	}
+}
+#endif
@@ -200,7 +200,7 @@ namespace Sailor::RHI
 
 		SAILOR_API void TrackPendingCommandList_ThreadSafe(RHIFencePtr handle);
 
-		SpinLock m_lockTrackedFences;
+		SpinLock m_lockTrackedFences{ SAILOR_SPINLOCK_SITE("IGraphicsDriver::TrackedFences") };
 		TVector<RHIFencePtr> m_trackedFences{};
 
 		TConcurrentMap<VertexAttributeBits, RHIVertexDescriptionPtr> m_cachedVertexDescriptions{};
@@ -11,6 +11,7 @@
 #include "GraphicsDriver/Vulkan/VulkanDevice.h"
 #include "Tasks/Scheduler.h"
 #include "Memory/MemoryBlockAllocator.hpp"
+#include "Memory/FrameAllocator.h"
 #include "GraphicsDriver/Vulkan/VulkanGraphicsDriver.h"
 #include "Components/TestComponent.h"
 #include "Components/MeshRendererComponent.h"
@@ -334,6 +335,10 @@ bool Renderer::PushFrame(const Sailor::FrameState& frame)
 	App::GetSubmodule<Tasks::Scheduler>()->Run(preRenderingJob);
 	App::GetSubmodule<Tasks::Scheduler>()->Run(renderingJob);
 
+	// The transient allocations of the frame stay valid until the frame retires
+	checkAtCompileTime(Memory::FrameAllocator::NumFrames >= MaxFramesInQueue + 2, FrameAllocator must outlive the frames in the render queue);
+	Memory::FrameAllocator::BeginFrame();
+
 	SAILOR_PROFILE_END_BLOCK();
 
 	return true;
@@ -44,6 +44,9 @@ void RHISceneView::Clear()
 {
 	m_rhiLightsData.Clear();
 
+	m_stationaryOctree.Clear();
+	m_staticOctree.Clear();
+
 	m_cameras.Clear();
 	m_cameraTransforms.Clear();
 	m_shadowMapsToUpdate.Clear();
@@ -61,7 +64,10 @@ TVector<RHISceneViewProxy> RHISceneView::TraceScene(const Math::Frustum& frustum
 
 	// Stationary
 	TVector<RHIMeshProxy> meshProxies;
-	m_stationaryOctree.Trace(frustum, meshProxies);
+	if (m_stationaryOctree)
+	{
+		m_stationaryOctree->Trace(frustum, meshProxies);
+	}
 
 	res.Reserve(meshProxies.Num());
 	for (auto& meshProxy : meshProxies)
@@ -102,7 +108,10 @@ TVector<RHISceneViewProxy> RHISceneView::TraceScene(const Math::Frustum& frustum
 
 	// Static
 	TVector<RHISceneViewProxy> proxies;
-	m_staticOctree.Trace(frustum, proxies);
+	if (m_staticOctree)
+	{
+		m_staticOctree->Trace(frustum, proxies);
+	}
 	res.Reserve(meshProxies.Num() + proxies.Num());
 
 	for (auto& proxy : proxies)
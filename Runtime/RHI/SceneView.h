@@ -87,8 +87,9 @@ namespace Sailor::RHI
 		SAILOR_API void PrepareSnapshots();
 		SAILOR_API void PrepareDebugDrawCommandLists(WorldPtr world);
 
-		TOctree<RHIMeshProxy> m_stationaryOctree{ glm::ivec3(0,0,0), 16536 * 16, 4 };
-		TOctree<RHISceneViewProxy> m_staticOctree{ glm::ivec3(0,0,0), 16536 * 16, 4 };
+		// The snapshots of the StaticMeshRendererECS's octrees, that are not changed while the frame holds them
+		TSharedPtr<TOctree<RHIMeshProxy>> m_stationaryOctree;
+		TSharedPtr<TOctree<RHISceneViewProxy>> m_staticOctree;
 
 		uint32_t m_totalNumLights = 0;
 		RHI::RHIShaderBindingSetPtr m_rhiLightsData{};
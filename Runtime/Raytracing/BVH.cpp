@@ -1,54 +1,117 @@
 #include "BVH.h"
 #include "Tasks/Scheduler.h"
+#include "Tasks/ParallelFor.h"
 #include "Containers/Vector.h"
 #include "Core/LogMacros.h"
 #include "Core/Utils.h"
 #include "glm/glm/glm.hpp"
 #include "Math/Math.h"
 #include "Math/Bounds.h"
+#include <atomic>
+#include <fstream>
+#include <bit>
+#include <immintrin.h>
 
 using namespace Sailor;
 using namespace Sailor::Math;
 using namespace Sailor::Raytracing;
 
-float BVH::FindBestSplitPlane(const BVHNode& node, const TVector<Math::Triangle>& tris, int32_t& outAxis, float& outSplitPos) const
+float BVH::FindBestSplitPlane(const BVHNode& node, const TVector<Math::Triangle>& tris, int32_t& outAxis, float& outSplitPos, bool bParallel) const
 {
 	SAILOR_PROFILE_FUNCTION();
 
-	struct Bin { Math::AABB m_bounds{}; int m_triCount = 0; };
+	struct CentroidBounds
+	{
+		vec3 m_min = vec3(std::numeric_limits<float>::max());
+		vec3 m_max = vec3(-30000000.0f);
+	};
+
+	struct Bins
+	{
+		Bin m_bins[3][NumBins];
+	};
+
+	// Min/max and the counts are exact, so the result does not depend on how the range is split between the threads
+	auto calculateCentroidBounds = [&](size_t begin, size_t end)
+		{
+			CentroidBounds res{};
+			for (size_t i = begin; i < end; i++)
+			{
+				const vec3& centroid = tris[m_triIdx[node.m_leftFirst + i]].m_centroid;
+				res.m_min = glm::min(res.m_min, centroid);
+				res.m_max = glm::max(res.m_max, centroid);
+			}
+			return res;
+		};
+
+	auto mergeCentroidBounds = [](const CentroidBounds& lhs, const CentroidBounds& rhs)
+		{
+			return CentroidBounds{ glm::min(lhs.m_min, rhs.m_min), glm::max(lhs.m_max, rhs.m_max) };
+		};
+
+	const CentroidBounds centroidBounds = bParallel ?
+		Tasks::ParallelReduce("BVH Centroid Bounds", 0, node.m_triCount, 4096, CentroidBounds{}, calculateCentroidBounds, mergeCentroidBounds) :
+		calculateCentroidBounds(0, node.m_triCount);
+
+	auto binTriangles = [&](size_t begin, size_t end)
+		{
+			Bins res{};
+			for (uint32_t a = 0; a < 3; a++)
+			{
+				const float boundsMin = centroidBounds.m_min[a];
+				const float boundsMax = centroidBounds.m_max[a];
 
-	const uint32_t NumBins = 8;
+				if (boundsMin == boundsMax)
+				{
+					continue;
+				}
+
+				const float scale = NumBins / (boundsMax - boundsMin);
+				for (size_t i = begin; i < end; i++)
+				{
+					const Math::Triangle& triangle = tris[m_triIdx[node.m_leftFirst + i]];
+					const int32_t binIdx = std::min((int32_t)NumBins - 1, (int32_t)((triangle.m_centroid[a] - boundsMin) * scale));
+
+					Bin& bin = res.m_bins[a][binIdx];
+					bin.m_triCount++;
+					bin.m_bounds.Extend(triangle.m_vertices[0]);
+					bin.m_bounds.Extend(triangle.m_vertices[1]);
+					bin.m_bounds.Extend(triangle.m_vertices[2]);
+				}
+			}
+			return res;
+		};
+
+	auto mergeBins = [](const Bins& lhs, const Bins& rhs)
+		{
+			Bins res = lhs;
+			for (uint32_t a = 0; a < 3; a++)
+			{
+				for (uint32_t i = 0; i < NumBins; i++)
+				{
+					res.m_bins[a][i].m_triCount += rhs.m_bins[a][i].m_triCount;
+					res.m_bins[a][i].m_bounds.Extend(rhs.m_bins[a][i].m_bounds);
+				}
+			}
+			return res;
+		};
+
+	const Bins bins = bParallel ?
+		Tasks::ParallelReduce("BVH Binning", 0, node.m_triCount, 4096, Bins{}, binTriangles, mergeBins) :
+		binTriangles(0, node.m_triCount);
 
 	float bestCost = std::numeric_limits<float>::max();
 	for (uint32_t a = 0; a < 3; a++)
 	{
-		float boundsMin = std::numeric_limits<float>::max();
-		float boundsMax = -30000000.0f;
-
-		for (uint32_t i = 0; i < node.m_triCount; i++)
-		{
-			const Math::Triangle& triangle = tris[m_triIdx[node.m_leftFirst + i]];
-			boundsMin = std::min(boundsMin, triangle.m_centroid[a]);
-			boundsMax = std::max(boundsMax, triangle.m_centroid[a]);
-		}
+		const float boundsMin = centroidBounds.m_min[a];
+		const float boundsMax = centroidBounds.m_max[a];
 
 		if (boundsMin == boundsMax)
 		{
 			continue;
 		}
 
-		Bin bin[NumBins];
-		float scale = NumBins / (boundsMax - boundsMin);
-		for (uint i = 0; i < node.m_triCount; i++)
-		{
-			const Math::Triangle& triangle = tris[m_triIdx[node.m_leftFirst + i]];
-			int32_t binIdx = std::min((int32_t)NumBins - 1,
-				(int32_t)((triangle.m_centroid[a] - boundsMin) * scale));
-			bin[binIdx].m_triCount++;
-			bin[binIdx].m_bounds.Extend(triangle.m_vertices[0]);
-			bin[binIdx].m_bounds.Extend(triangle.m_vertices[1]);
-			bin[binIdx].m_bounds.Extend(triangle.m_vertices[2]);
-		}
+		const Bin* bin = bins.m_bins[a];
 
 		float leftArea[NumBins - 1];
 		float rightArea[NumBins - 1];
@@ -71,7 +134,7 @@ float BVH::FindBestSplitPlane(const BVHNode& node, const TVector<Math::Triangle>
 			rightArea[NumBins - 2 - i] = rightBox.Area();
 		}
 
-		scale = (boundsMax - boundsMin) / NumBins;
+		const float scale = (boundsMax - boundsMin) / NumBins;
 		for (int32_t i = 0; i < NumBins - 1; i++)
 		{
 			float planeCost = leftCount[i] * leftArea[i] + rightCount[i] * rightArea[i];
@@ -119,28 +182,51 @@ float BVH::EvaluateSAH(const BVHNode& node, const TVector<Math::Triangle>& tris,
 }
 
 bool BVH::IntersectBVH(const Math::Ray& ray, Math::RaycastHit& outResult, const uint nodeIdx, float maxRayLength, uint32_t ignoreTriangle) const
+{
+	if (nodeIdx == m_rootNodeIdx)
+	{
+		if (m_layout == EBVHLayout::BVH8)
+		{
+			return IntersectWide(m_nodes8, ray, outResult, maxRayLength, ignoreTriangle);
+		}
+		else if (m_layout == EBVHLayout::BVH4)
+		{
+			return IntersectWide(m_nodes4, ray, outResult, maxRayLength, ignoreTriangle);
+		}
+	}
+
+	return IntersectBinary(ray, outResult, nodeIdx, maxRayLength, ignoreTriangle);
+}
+
+void BVH::IntersectLeaf(const Math::Ray& ray, Math::RaycastHit& outResult, uint32_t first, uint32_t triCount, float& maxRayLength, uint32_t ignoreTriangle) const
+{
+	Math::RaycastHit res{};
+	for (uint32_t i = 0; i < triCount; i++)
+	{
+		const uint32_t triangleIndex = m_pTriIdxMapping[first + i];
+
+		if (ignoreTriangle != triangleIndex && Math::IntersectRayTriangle(ray, m_pTriangles[first + i], res, maxRayLength))
+		{
+			outResult = res;
+			outResult.m_triangleIndex = triangleIndex;
+
+			maxRayLength = std::min(maxRayLength, res.m_rayLenght);
+		}
+	}
+}
+
+bool BVH::IntersectBinary(const Math::Ray& ray, Math::RaycastHit& outResult, uint32_t nodeIdx, float maxRayLength, uint32_t ignoreTriangle) const
 {
 	SAILOR_PROFILE_FUNCTION();
 
-	const BVHNode* node = &m_nodes[m_rootNodeIdx], * stack[64];
+	const BVHNode* node = &m_pNodes[nodeIdx], * stack[64];
 	uint stackPtr = 0;
-	Math::RaycastHit res{};
 	while (1)
 	{
 		if (node->IsLeaf())
 		{
-			for (uint i = 0; i < node->m_triCount; i++)
-			{
-				const uint32_t triangleIndex = m_triIdxMapping[node->m_leftFirst + i];
+			IntersectLeaf(ray, outResult, node->m_leftFirst, node->m_triCount, maxRayLength, ignoreTriangle);
 
-				if (ignoreTriangle != triangleIndex && Math::IntersectRayTriangle(ray, m_triangles[node->m_leftFirst + i], res, maxRayLength))
-				{
-					outResult = res;
-					outResult.m_triangleIndex = triangleIndex;
-
-					maxRayLength = std::min(maxRayLength, res.m_rayLenght);
-				}
-			}
 			if (stackPtr == 0)
 			{
 				break;
@@ -153,8 +239,8 @@ bool BVH::IntersectBVH(const Math::Ray& ray, Math::RaycastHit& outResult, const
 			continue;
 		}
 
-		const BVH::BVHNode* child1 = &m_nodes[node->m_leftFirst];
-		const BVH::BVHNode* child2 = &m_nodes[node->m_leftFirst + 1];
+		const BVH::BVHNode* child1 = &m_pNodes[node->m_leftFirst];
+		const BVH::BVHNode* child2 = &m_pNodes[node->m_leftFirst + 1];
 
 		float dist1 = IntersectRayAABB(ray, child1->m_aabbMin, child1->m_aabbMax, maxRayLength);
 		float dist2 = IntersectRayAABB(ray, child2->m_aabbMin, child2->m_aabbMax, maxRayLength);
@@ -189,29 +275,550 @@ bool BVH::IntersectBVH(const Math::Ray& ray, Math::RaycastHit& outResult, const
 	return outResult.HasIntersection();
 }
 
-void BVH::UpdateNodeBounds(uint32_t nodeIdx, const TVector<Math::Triangle>& tris)
+namespace
+{
+	// The ray components are splatted from the Ray's origin and reciprocal direction once per traversal
+	struct RaySIMD
+	{
+		RaySIMD(const Math::Ray& ray)
+		{
+			const __m128 o = ray.GetOrigin4();
+			const __m128 rd = ray.GetReciprocalDirection4();
+
+			m_ox = _mm_shuffle_ps(o, o, _MM_SHUFFLE(0, 0, 0, 0));
+			m_oy = _mm_shuffle_ps(o, o, _MM_SHUFFLE(1, 1, 1, 1));
+			m_oz = _mm_shuffle_ps(o, o, _MM_SHUFFLE(2, 2, 2, 2));
+			m_rdx = _mm_shuffle_ps(rd, rd, _MM_SHUFFLE(0, 0, 0, 0));
+			m_rdy = _mm_shuffle_ps(rd, rd, _MM_SHUFFLE(1, 1, 1, 1));
+			m_rdz = _mm_shuffle_ps(rd, rd, _MM_SHUFFLE(2, 2, 2, 2));
+
+#if defined(__AVX__)
+			m_ox8 = _mm256_set_m128(m_ox, m_ox);
+			m_oy8 = _mm256_set_m128(m_oy, m_oy);
+			m_oz8 = _mm256_set_m128(m_oz, m_oz);
+			m_rdx8 = _mm256_set_m128(m_rdx, m_rdx);
+			m_rdy8 = _mm256_set_m128(m_rdy, m_rdy);
+			m_rdz8 = _mm256_set_m128(m_rdz, m_rdz);
+#endif
+		}
+
+		__m128 m_ox, m_oy, m_oz;
+		__m128 m_rdx, m_rdy, m_rdz;
+
+#if defined(__AVX__)
+		__m256 m_ox8, m_oy8, m_oz8;
+		__m256 m_rdx8, m_rdy8, m_rdz8;
+#endif
+	};
+
+	// The same test as IntersectRayAABB for 4 boxes, returns the mask of the hit boxes
+	__forceinline uint32_t IntersectRayAABB4(const RaySIMD& ray, const float* minX, const float* minY, const float* minZ,
+		const float* maxX, const float* maxY, const float* maxZ, float maxRayLength, float* outDistances)
+	{
+		const __m128 tx1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(minX), ray.m_ox), ray.m_rdx);
+		const __m128 tx2 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(maxX), ray.m_ox), ray.m_rdx);
+		const __m128 ty1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(minY), ray.m_oy), ray.m_rdy);
+		const __m128 ty2 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(maxY), ray.m_oy), ray.m_rdy);
+		const __m128 tz1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(minZ), ray.m_oz), ray.m_rdz);
+		const __m128 tz2 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(maxZ), ray.m_oz), ray.m_rdz);
+
+		const __m128 tmin = _mm_max_ps(_mm_max_ps(_mm_min_ps(tx1, tx2), _mm_min_ps(ty1, ty2)), _mm_min_ps(tz1, tz2));
+		const __m128 tmax = _mm_min_ps(_mm_min_ps(_mm_max_ps(tx1, tx2), _mm_max_ps(ty1, ty2)), _mm_max_ps(tz1, tz2));
+
+		const __m128 mask = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(tmax, tmin), _mm_cmplt_ps(tmin, _mm_set1_ps(maxRayLength))), _mm_cmpgt_ps(tmax, _mm_setzero_ps()));
+
+		_mm_storeu_ps(outDistances, tmin);
+		return (uint32_t)_mm_movemask_ps(mask);
+	}
+
+	template<uint32_t Width>
+	__forceinline uint32_t IntersectChildren(const RaySIMD& ray, const float* minX, const float* minY, const float* minZ,
+		const float* maxX, const float* maxY, const float* maxZ, float maxRayLength, float* outDistances);
+
+	template<>
+	__forceinline uint32_t IntersectChildren<4>(const RaySIMD& ray, const float* minX, const float* minY, const float* minZ,
+		const float* maxX, const float* maxY, const float* maxZ, float maxRayLength, float* outDistances)
+	{
+		return IntersectRayAABB4(ray, minX, minY, minZ, maxX, maxY, maxZ, maxRayLength, outDistances);
+	}
+
+	template<>
+	__forceinline uint32_t IntersectChildren<8>(const RaySIMD& ray, const float* minX, const float* minY, const float* minZ,
+		const float* maxX, const float* maxY, const float* maxZ, float maxRayLength, float* outDistances)
+	{
+#if defined(__AVX__)
+		const __m256 tx1 = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(minX), ray.m_ox8), ray.m_rdx8);
+		const __m256 tx2 = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(maxX), ray.m_ox8), ray.m_rdx8);
+		const __m256 ty1 = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(minY), ray.m_oy8), ray.m_rdy8);
+		const __m256 ty2 = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(maxY), ray.m_oy8), ray.m_rdy8);
+		const __m256 tz1 = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(minZ), ray.m_oz8), ray.m_rdz8);
+		const __m256 tz2 = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(maxZ), ray.m_oz8), ray.m_rdz8);
+
+		const __m256 tmin = _mm256_max_ps(_mm256_max_ps(_mm256_min_ps(tx1, tx2), _mm256_min_ps(ty1, ty2)), _mm256_min_ps(tz1, tz2));
+		const __m256 tmax = _mm256_min_ps(_mm256_min_ps(_mm256_max_ps(tx1, tx2), _mm256_max_ps(ty1, ty2)), _mm256_max_ps(tz1, tz2));
+
+		const __m256 mask = _mm256_and_ps(_mm256_and_ps(
+			_mm256_cmp_ps(tmax, tmin, _CMP_GE_OQ),
+			_mm256_cmp_ps(tmin, _mm256_set1_ps(maxRayLength), _CMP_LT_OQ)),
+			_mm256_cmp_ps(tmax, _mm256_setzero_ps(), _CMP_GT_OQ));
+
+		_mm256_storeu_ps(outDistances, tmin);
+		return (uint32_t)_mm256_movemask_ps(mask);
+#else
+		const uint32_t low = IntersectRayAABB4(ray, minX, minY, minZ, maxX, maxY, maxZ, maxRayLength, outDistances);
+		const uint32_t high = IntersectRayAABB4(ray, minX + 4, minY + 4, minZ + 4, maxX + 4, maxY + 4, maxZ + 4, maxRayLength, outDistances + 4);
+		return low | (high << 4);
+#endif
+	}
+}
+
+template<uint32_t Width>
+bool BVH::IntersectWide(const TVector<TWideBVHNode<Width>>& nodes, const Math::Ray& ray, Math::RaycastHit& outResult, float maxRayLength, uint32_t ignoreTriangle) const
 {
 	SAILOR_PROFILE_FUNCTION();
 
-	BVH::BVHNode& node = m_nodes[nodeIdx];
+	struct StackEntry
+	{
+		uint32_t m_child;
+		uint32_t m_triCount;
+		float m_distance;
+	};
+
+	// Each wide node replaces at least one binary level, that is enough for the depth 64 of the binary tree
+	StackEntry stack[64 * (Width - 1) + 1];
+	uint32_t stackPtr = 0;
+
+	const RaySIMD raySIMD(ray);
+
+	stack[stackPtr++] = { 0, 0, 0.0f };
+
+	while (stackPtr > 0)
+	{
+		const StackEntry entry = stack[--stackPtr];
+
+		// The closer hit could be found after the entry was pushed
+		if (entry.m_distance >= maxRayLength)
+		{
+			continue;
+		}
+
+		if (entry.m_triCount > 0)
+		{
+			IntersectLeaf(ray, outResult, entry.m_child, entry.m_triCount, maxRayLength, ignoreTriangle);
+			continue;
+		}
+
+		const TWideBVHNode<Width>& node = nodes[entry.m_child];
+
+		alignas(32) float distances[Width];
+		uint32_t mask = IntersectChildren<Width>(raySIMD, node.m_minX, node.m_minY, node.m_minZ,
+			node.m_maxX, node.m_maxY, node.m_maxZ, maxRayLength, distances);
+
+		mask &= (1u << node.m_numChildren) - 1;
+
+		// Sort the hit children by distance, the closest is pushed last to be visited first
+		uint32_t hits[Width];
+		uint32_t numHits = 0;
+		while (mask)
+		{
+			const uint32_t child = (uint32_t)std::countr_zero(mask);
+			mask &= mask - 1;
+
+			uint32_t j = numHits++;
+			while (j > 0 && distances[hits[j - 1]] < distances[child])
+			{
+				hits[j] = hits[j - 1];
+				j--;
+			}
+			hits[j] = child;
+		}
+
+		for (uint32_t i = 0; i < numHits; i++)
+		{
+			const uint32_t child = hits[i];
+			stack[stackPtr++] = { node.m_children[child], node.m_triCount[child], distances[child] };
+		}
+	}
+
+	return outResult.HasIntersection();
+}
+
+namespace
+{
+	// The rays of the packet are stored as SoA, the unused lanes are masked out by the active mask
+	struct RayPacketSIMD
+	{
+		static constexpr uint32_t Size = BVH::MaxPacketSize;
+
+		RayPacketSIMD(const Math::Ray* rays, uint32_t numRays, float maxRayLength) : m_maxRayLength(maxRayLength)
+		{
+			m_numGroups = (numRays + 3) / 4;
+
+			vec3 originMin = vec3(std::numeric_limits<float>::max());
+			vec3 originMax = vec3(std::numeric_limits<float>::lowest());
+			vec3 rdMin = vec3(std::numeric_limits<float>::infinity());
+			vec3 rdMax = vec3(-std::numeric_limits<float>::infinity());
+
+			for (uint32_t i = 0; i < Size; i++)
+			{
+				const Math::Ray& ray = rays[std::min(i, numRays - 1)];
+
+				alignas(16) float o[4];
+				alignas(16) float rd[4];
+				_mm_store_ps(o, ray.GetOrigin4());
+				_mm_store_ps(rd, ray.GetReciprocalDirection4());
+
+				m_ox[i] = o[0];
+				m_oy[i] = o[1];
+				m_oz[i] = o[2];
+				m_rdx[i] = rd[0];
+				m_rdy[i] = rd[1];
+				m_rdz[i] = rd[2];
+				m_tmax[i] = i < numRays ? maxRayLength : -std::numeric_limits<float>::infinity();
+
+				originMin = glm::min(originMin, vec3(o[0], o[1], o[2]));
+				originMax = glm::max(originMax, vec3(o[0], o[1], o[2]));
+				rdMin = glm::min(rdMin, vec3(rd[0], rd[1], rd[2]));
+				rdMax = glm::max(rdMax, vec3(rd[0], rd[1], rd[2]));
+			}
+
+			// The interval bounds are valid only if all the directions have the same signs
+			m_bHasFrustum = true;
+			for (uint32_t axis = 0; axis < 3; axis++)
+			{
+				m_bPositive[axis] = rdMin[axis] >= 0.0f;
+				m_bHasFrustum &= rdMin[axis] >= 0.0f || rdMax[axis] <= 0.0f;
+			}
+
+			m_originMin = originMin;
+			m_originMax = originMax;
+			m_rdMin = rdMin;
+			m_rdMax = rdMax;
+		}
+
+		/* Interval arithmetic: the lowest entry and the highest exit distances among all the rays of the packet,
+		*  if the box is missed by these bounds then it is missed by each ray.
+		*/
+		__forceinline bool IsCulled(const vec3& aabbMin, const vec3& aabbMax) const
+		{
+			if (!m_bHasFrustum)
+			{
+				return false;
+			}
+
+			float entry = std::numeric_limits<float>::lowest();
+			float exit = std::numeric_limits<float>::max();
+
+			for (uint32_t axis = 0; axis < 3; axis++)
+			{
+				const float nearPlane = m_bPositive[axis] ? aabbMin[axis] : aabbMax[axis];
+				const float farPlane = m_bPositive[axis] ? aabbMax[axis] : aabbMin[axis];
+
+				const float n0 = (nearPlane - m_originMax[axis]) * m_rdMin[axis];
+				const float n1 = (nearPlane - m_originMax[axis]) * m_rdMax[axis];
+				const float n2 = (nearPlane - m_originMin[axis]) * m_rdMin[axis];
+				const float n3 = (nearPlane - m_originMin[axis]) * m_rdMax[axis];
+
+				const float f0 = (farPlane - m_originMax[axis]) * m_rdMin[axis];
+				const float f1 = (farPlane - m_originMax[axis]) * m_rdMax[axis];
+				const float f2 = (farPlane - m_originMin[axis]) * m_rdMin[axis];
+				const float f3 = (farPlane - m_originMin[axis]) * m_rdMax[axis];
+
+				entry = std::max(entry, std::min(std::min(n0, n1), std::min(n2, n3)));
+				exit = std::min(exit, std::max(std::max(f0, f1), std::max(f2, f3)));
+			}
+
+			return entry > exit || exit <= 0.0f || entry >= m_maxRayLength;
+		}
+
+		// The same test as IntersectRayAABB for each ray of the packet, returns the mask of the rays that hit the box
+		__forceinline uint32_t IntersectAABB(const vec3& aabbMin, const vec3& aabbMax) const
+		{
+#if defined(__AVX__)
+			if (m_numGroups == 2)
+			{
+				const __m256 tx1 = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(aabbMin.x), _mm256_load_ps(m_ox)), _mm256_load_ps(m_rdx));
+				const __m256 tx2 = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(aabbMax.x), _mm256_load_ps(m_ox)), _mm256_load_ps(m_rdx));
+				const __m256 ty1 = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(aabbMin.y), _mm256_load_ps(m_oy)), _mm256_load_ps(m_rdy));
+				const __m256 ty2 = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(aabbMax.y), _mm256_load_ps(m_oy)), _mm256_load_ps(m_rdy));
+				const __m256 tz1 = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(aabbMin.z), _mm256_load_ps(m_oz)), _mm256_load_ps(m_rdz));
+				const __m256 tz2 = _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(aabbMax.z), _mm256_load_ps(m_oz)), _mm256_load_ps(m_rdz));
+
+				const __m256 tmin = _mm256_max_ps(_mm256_max_ps(_mm256_min_ps(tx1, tx2), _mm256_min_ps(ty1, ty2)), _mm256_min_ps(tz1, tz2));
+				const __m256 tmax = _mm256_min_ps(_mm256_min_ps(_mm256_max_ps(tx1, tx2), _mm256_max_ps(ty1, ty2)), _mm256_max_ps(tz1, tz2));
+
+				const __m256 mask = _mm256_and_ps(_mm256_and_ps(
+					_mm256_cmp_ps(tmax, tmin, _CMP_GE_OQ),
+					_mm256_cmp_ps(tmin, _mm256_load_ps(m_tmax), _CMP_LT_OQ)),
+					_mm256_cmp_ps(tmax, _mm256_setzero_ps(), _CMP_GT_OQ));
+
+				return (uint32_t)_mm256_movemask_ps(mask);
+			}
+#endif
+			uint32_t res = 0;
+			for (uint32_t group = 0; group < m_numGroups; group++)
+			{
+				const uint32_t i = group * 4;
+
+				const __m128 tx1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(aabbMin.x), _mm_load_ps(m_ox + i)), _mm_load_ps(m_rdx + i));
+				const __m128 tx2 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(aabbMax.x), _mm_load_ps(m_ox + i)), _mm_load_ps(m_rdx + i));
+				const __m128 ty1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(aabbMin.y), _mm_load_ps(m_oy + i)), _mm_load_ps(m_rdy + i));
+				const __m128 ty2 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(aabbMax.y), _mm_load_ps(m_oy + i)), _mm_load_ps(m_rdy + i));
+				const __m128 tz1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(aabbMin.z), _mm_load_ps(m_oz + i)), _mm_load_ps(m_rdz + i));
+				const __m128 tz2 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(aabbMax.z), _mm_load_ps(m_oz + i)), _mm_load_ps(m_rdz + i));
+
+				const __m128 tmin = _mm_max_ps(_mm_max_ps(_mm_min_ps(tx1, tx2), _mm_min_ps(ty1, ty2)), _mm_min_ps(tz1, tz2));
+				const __m128 tmax = _mm_min_ps(_mm_min_ps(_mm_max_ps(tx1, tx2), _mm_max_ps(ty1, ty2)), _mm_max_ps(tz1, tz2));
+
+				const __m128 mask = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(tmax, tmin), _mm_cmplt_ps(tmin, _mm_load_ps(m_tmax + i))), _mm_cmpgt_ps(tmax, _mm_setzero_ps()));
+
+				res |= (uint32_t)_mm_movemask_ps(mask) << i;
+			}
+
+			return res;
+		}
+
+		alignas(32) float m_ox[Size];
+		alignas(32) float m_oy[Size];
+		alignas(32) float m_oz[Size];
+		alignas(32) float m_rdx[Size];
+		alignas(32) float m_rdy[Size];
+		alignas(32) float m_rdz[Size];
+		alignas(32) float m_tmax[Size];
+
+		uint32_t m_numGroups = 0;
+		float m_maxRayLength = 0.0f;
+
+		vec3 m_originMin{};
+		vec3 m_originMax{};
+		vec3 m_rdMin{};
+		vec3 m_rdMax{};
+
+		bool m_bPositive[3]{};
+		bool m_bHasFrustum = false;
+	};
+}
+
+uint32_t BVH::IntersectPacket(const Math::Ray* rays, uint32_t numRays, Math::RaycastHit* outResults, const uint32_t* ignoreTriangles, float maxRayLength, bool bAnyHit) const
+{
+	SAILOR_PROFILE_FUNCTION();
+
+	check(numRays > 0 && numRays <= MaxPacketSize);
+
+	RayPacketSIMD packet(rays, numRays, maxRayLength);
+
+	uint32_t activeMask = (1u << numRays) - 1;
+	uint32_t hitMask = 0;
+
+	uint32_t stack[64];
+	uint32_t stackPtr = 0;
+	uint32_t nodeIdx = m_rootNodeIdx;
+
+	while (1)
+	{
+		const BVHNode& node = m_pNodes[nodeIdx];
+
+		uint32_t mask = packet.IsCulled(node.m_aabbMin, node.m_aabbMax) ? 0 : (packet.IntersectAABB(node.m_aabbMin, node.m_aabbMax) & activeMask);
+
+		if (mask != 0 && (uint32_t)std::popcount(mask) < MinCoherentRays)
+		{
+			// The packet is diverged, the rest of the subtree is traversed by each ray separately
+			while (mask)
+			{
+				const uint32_t i = (uint32_t)std::countr_zero(mask);
+				mask &= mask - 1;
+
+				if (IntersectBinary(rays[i], outResults[i], nodeIdx, packet.m_tmax[i], ignoreTriangles ? ignoreTriangles[i] : (uint32_t)(-1)))
+				{
+					packet.m_tmax[i] = outResults[i].m_rayLenght;
+					hitMask |= 1u << i;
+
+					if (bAnyHit)
+					{
+						activeMask &= ~(1u << i);
+					}
+				}
+			}
+		}
+		else if (mask != 0 && node.IsLeaf())
+		{
+			while (mask)
+			{
+				const uint32_t i = (uint32_t)std::countr_zero(mask);
+				mask &= mask - 1;
+
+				IntersectLeaf(rays[i], outResults[i], node.m_leftFirst, node.m_triCount, packet.m_tmax[i], ignoreTriangles ? ignoreTriangles[i] : (uint32_t)(-1));
+
+				if (outResults[i].HasIntersection())
+				{
+					hitMask |= 1u << i;
+
+					if (bAnyHit)
+					{
+						activeMask &= ~(1u << i);
+					}
+				}
+			}
+		}
+		else if (mask != 0)
+		{
+			// The closer child is the one that goes first along the rays, by the axis where the children are separated the most
+			const BVHNode& left = m_pNodes[node.m_leftFirst];
+			const BVHNode& right = m_pNodes[node.m_leftFirst + 1];
+
+			const vec3 separation = (right.m_aabbMin + right.m_aabbMax) - (left.m_aabbMin + left.m_aabbMax);
+			const vec3 absSeparation = glm::abs(separation);
+			const uint32_t axis = absSeparation.x > absSeparation.y ? (absSeparation.x > absSeparation.z ? 0 : 2) : (absSeparation.y > absSeparation.z ? 1 : 2);
+
+			const bool bRightFirst = (separation[axis] < 0.0f) == packet.m_bPositive[axis];
+
+			stack[stackPtr++] = bRightFirst ? node.m_leftFirst : node.m_leftFirst + 1;
+			nodeIdx = bRightFirst ? node.m_leftFirst + 1 : node.m_leftFirst;
+			continue;
+		}
+
+		if (stackPtr == 0 || activeMask == 0)
+		{
+			break;
+		}
+
+		nodeIdx = stack[--stackPtr];
+	}
+
+	return hitMask;
+}
+
+template<uint32_t Width>
+uint32_t BVH::CollapseNode(uint32_t nodeIdx, TVector<TWideBVHNode<Width>>& outNodes) const
+{
+	const uint32_t wideNodeIdx = (uint32_t)outNodes.Num();
+	outNodes.Add(TWideBVHNode<Width>{});
+
+	// Open the child with the largest area until the node is full, that keeps the SAH of the binary tree
+	uint32_t children[Width];
+	uint32_t numChildren = 0;
+
+	const BVHNode& node = m_pNodes[nodeIdx];
+	if (node.IsLeaf())
+	{
+		children[numChildren++] = nodeIdx;
+	}
+	else
+	{
+		children[numChildren++] = node.m_leftFirst;
+		children[numChildren++] = node.m_leftFirst + 1;
+	}
 
-	node.m_aabbMin = vec3(1e30f);
-	node.m_aabbMax = vec3(-1e30f);
+	while (numChildren < Width)
+	{
+		int32_t bestChild = -1;
+		float bestArea = -1.0f;
+		for (uint32_t i = 0; i < numChildren; i++)
+		{
+			const BVHNode& child = m_pNodes[children[i]];
+			if (!child.IsLeaf() && child.CalculateArea() > bestArea)
+			{
+				bestChild = (int32_t)i;
+				bestArea = child.CalculateArea();
+			}
+		}
 
-	for (uint first = node.m_leftFirst, i = 0; i < node.m_triCount; i++)
+		if (bestChild == -1)
+		{
+			break;
+		}
+
+		const uint32_t leftFirst = m_pNodes[children[bestChild]].m_leftFirst;
+		children[bestChild] = leftFirst;
+		children[numChildren++] = leftFirst + 1;
+	}
+
+	uint32_t wideChildren[Width];
+	for (uint32_t i = 0; i < numChildren; i++)
 	{
-		uint leafTriIdx = m_triIdx[first + i];
-		const Triangle& leafTri = tris[leafTriIdx];
-		node.m_aabbMin = glm::min(node.m_aabbMin, leafTri.m_vertices[0]);
-		node.m_aabbMin = glm::min(node.m_aabbMin, leafTri.m_vertices[1]);
-		node.m_aabbMin = glm::min(node.m_aabbMin, leafTri.m_vertices[2]);
-		node.m_aabbMax = glm::max(node.m_aabbMax, leafTri.m_vertices[0]);
-		node.m_aabbMax = glm::max(node.m_aabbMax, leafTri.m_vertices[1]);
-		node.m_aabbMax = glm::max(node.m_aabbMax, leafTri.m_vertices[2]);
+		const BVHNode& child = m_pNodes[children[i]];
+		wideChildren[i] = child.IsLeaf() ? child.m_leftFirst : CollapseNode(children[i], outNodes);
 	}
+
+	// The recursion reallocates outNodes
+	TWideBVHNode<Width>& wideNode = outNodes[wideNodeIdx];
+	wideNode.m_numChildren = numChildren;
+
+	for (uint32_t i = 0; i < Width; i++)
+	{
+		const bool bIsUsed = i < numChildren;
+		const BVHNode& child = m_pNodes[children[bIsUsed ? i : 0]];
+
+		// The unused slots are masked out by m_numChildren
+		wideNode.m_minX[i] = child.m_aabbMin.x;
+		wideNode.m_minY[i] = child.m_aabbMin.y;
+		wideNode.m_minZ[i] = child.m_aabbMin.z;
+		wideNode.m_maxX[i] = child.m_aabbMax.x;
+		wideNode.m_maxY[i] = child.m_aabbMax.y;
+		wideNode.m_maxZ[i] = child.m_aabbMax.z;
+		wideNode.m_children[i] = bIsUsed ? wideChildren[i] : 0;
+		wideNode.m_triCount[i] = bIsUsed ? child.m_triCount : 0;
+	}
+
+	return wideNodeIdx;
+}
+
+void BVH::Collapse(EBVHLayout layout)
+{
+	SAILOR_PROFILE_FUNCTION();
+
+	if (layout == EBVHLayout::BVH4 && m_nodes4.IsEmpty())
+	{
+		m_nodes4.Reserve(m_nodesUsed / 2 + 1);
+		CollapseNode<4>(m_rootNodeIdx, m_nodes4);
+	}
+	else if (layout == EBVHLayout::BVH8 && m_nodes8.IsEmpty())
+	{
+		m_nodes8.Reserve(m_nodesUsed / 4 + 1);
+		CollapseNode<8>(m_rootNodeIdx, m_nodes8);
+	}
+
+	m_layout = layout;
 }
 
-void BVH::Subdivide(uint32_t nodeIdx, const TVector<Math::Triangle>& tris)
+void BVH::UpdateNodeBounds(uint32_t nodeIdx, const TVector<Math::Triangle>& tris, bool bParallel)
+{
+	SAILOR_PROFILE_FUNCTION();
+
+	BVH::BVHNode& node = m_nodes[nodeIdx];
+
+	struct Bounds
+	{
+		vec3 m_min = vec3(1e30f);
+		vec3 m_max = vec3(-1e30f);
+	};
+
+	auto calculateBounds = [&](size_t begin, size_t end)
+		{
+			Bounds res{};
+			for (size_t i = begin; i < end; i++)
+			{
+				const Triangle& leafTri = tris[m_triIdx[node.m_leftFirst + i]];
+				res.m_min = glm::min(res.m_min, leafTri.m_vertices[0]);
+				res.m_min = glm::min(res.m_min, leafTri.m_vertices[1]);
+				res.m_min = glm::min(res.m_min, leafTri.m_vertices[2]);
+				res.m_max = glm::max(res.m_max, leafTri.m_vertices[0]);
+				res.m_max = glm::max(res.m_max, leafTri.m_vertices[1]);
+				res.m_max = glm::max(res.m_max, leafTri.m_vertices[2]);
+			}
+			return res;
+		};
+
+	const Bounds bounds = bParallel && node.m_triCount >= ParallelBinningThreshold ?
+		Tasks::ParallelReduce("BVH Node Bounds", 0, node.m_triCount, 4096, Bounds{}, calculateBounds,
+			[](const Bounds& lhs, const Bounds& rhs) { return Bounds{ glm::min(lhs.m_min, rhs.m_min), glm::max(lhs.m_max, rhs.m_max) }; }) :
+		calculateBounds(0, node.m_triCount);
+
+	node.m_aabbMin = bounds.m_min;
+	node.m_aabbMax = bounds.m_max;
+}
+
+void BVH::Subdivide(uint32_t nodeIdx, const TVector<Math::Triangle>& tris, bool bParallel)
 {
 	SAILOR_PROFILE_FUNCTION();
 
@@ -225,7 +832,7 @@ void BVH::Subdivide(uint32_t nodeIdx, const TVector<Math::Triangle>& tris)
 
 	int32_t axis{};
 	float splitPos{};
-	float splitCost = FindBestSplitPlane(node, tris, axis, splitPos);
+	float splitCost = FindBestSplitPlane(node, tris, axis, splitPos, bParallel && node.m_triCount >= ParallelBinningThreshold);
 
 	float nosplitCost = node.CalculateCost();
 	if (splitCost >= nosplitCost)
@@ -250,85 +857,421 @@ void BVH::Subdivide(uint32_t nodeIdx, const TVector<Math::Triangle>& tris)
 	}
 
 	// abort split if one of the sides is empty
-	uint32_t leftCount = i - node.m_leftFirst;
+	const uint32_t triCount = node.m_triCount;
+	const uint32_t leftCount = i - node.m_leftFirst;
 
-	if (leftCount == 0 || leftCount == node.m_triCount)
+	if (leftCount == 0 || leftCount == triCount)
 	{
 		return;
 	}
 
-	// create child nodes
-	uint32_t leftChildIdx = m_nodesUsed++;
-	uint32_t rightChildIdx = m_nodesUsed++;
+	// create child nodes, the nodes are preallocated so the references are stable
+	const uint32_t leftChildIdx = bParallel ? std::atomic_ref<uint32_t>(m_nodesUsed).fetch_add(2, std::memory_order_relaxed) : (m_nodesUsed += 2) - 2;
+	const uint32_t rightChildIdx = leftChildIdx + 1;
 
 	m_nodes[leftChildIdx].m_leftFirst = node.m_leftFirst;
 	m_nodes[leftChildIdx].m_triCount = leftCount;
 	m_nodes[rightChildIdx].m_leftFirst = i;
-	m_nodes[rightChildIdx].m_triCount = node.m_triCount - leftCount;
+	m_nodes[rightChildIdx].m_triCount = triCount - leftCount;
 
 	node.m_leftFirst = leftChildIdx;
 	node.m_triCount = 0;
 
-	UpdateNodeBounds(leftChildIdx, tris);
-	UpdateNodeBounds(rightChildIdx, tris);
+	UpdateNodeBounds(leftChildIdx, tris, bParallel);
+	UpdateNodeBounds(rightChildIdx, tris, bParallel);
 
-	Subdivide(leftChildIdx, tris);
-	Subdivide(rightChildIdx, tris);
+	if (bParallel && triCount - leftCount >= ParallelSubtreeThreshold && leftCount >= ParallelSubtreeThreshold)
+	{
+		// The waiting worker executes the other jobs, so the recursive waits don't block the pool
+		auto task = Tasks::CreateTask("BVH Subdivide",
+			[this, rightChildIdx, &tris]()
+			{
+				Subdivide(rightChildIdx, tris, true);
+			}, Tasks::EThreadType::Worker);
+
+		task->Run();
+		Subdivide(leftChildIdx, tris, true);
+		task->Wait();
+	}
+	else
+	{
+		Subdivide(leftChildIdx, tris, bParallel);
+		Subdivide(rightChildIdx, tris, bParallel);
+	}
 }
 
-void BVH::BuildBVH(const TVector<Math::Triangle>& tris)
+void BVH::CopyLeafTriangles(const TVector<Math::Triangle>& tris, bool bParallel)
+{
+	SAILOR_PROFILE_FUNCTION();
+
+	// Cache locality, the triangles of the leaf are stored together in the order of the nodes
+	TVector<uint32_t> leaves;
+	TVector<uint32_t> offsets;
+
+	uint32_t numTriangles = 0;
+	for (uint32_t i = 0; i < m_nodesUsed; i++)
+	{
+		if (m_nodes[i].IsLeaf())
+		{
+			leaves.Add(i);
+			offsets.Add(numTriangles);
+			numTriangles += m_nodes[i].m_triCount;
+		}
+	}
+
+	check(numTriangles == tris.Num());
+
+	m_triangles.Clear();
+	m_triangles.AddDefault(tris.Num());
+	m_triIdxMapping.Clear();
+	m_triIdxMapping.AddDefault(tris.Num());
+
+	auto copyLeaves = [&](size_t begin, size_t end)
+		{
+			TVector<uint32_t> sorted;
+			for (size_t leaf = begin; leaf < end; leaf++)
+			{
+				BVHNode& node = m_nodes[leaves[leaf]];
+				const uint32_t triIndex = node.m_leftFirst;
+				const uint32_t offset = offsets[leaf];
+
+				node.m_leftFirst = offset;
+
+				SAILOR_PROFILE_BLOCK("Sort Triangles by area");
+				sorted.Clear(false);
+				for (uint32_t j = 0; j < node.m_triCount; j++)
+				{
+					sorted.Add(m_triIdx[triIndex + j]);
+				}
+
+				sorted.Sort([&](const auto& lhs, const auto& rhs)
+					{
+						return tris[lhs].SquareArea() > tris[rhs].SquareArea();
+					});
+				SAILOR_PROFILE_END_BLOCK();
+
+				SAILOR_PROFILE_BLOCK("Copy data");
+				for (uint32_t j = 0; j < node.m_triCount; j++)
+				{
+					const uint32_t triId = sorted[j];
+					m_triIdxMapping[offset + j] = triId;
+					m_triangles[offset + j] = tris[triId];
+				}
+				SAILOR_PROFILE_END_BLOCK();
+			}
+		};
+
+	if (bParallel)
+	{
+		Tasks::ParallelFor("BVH Copy Leaf Triangles", 0, leaves.Num(), 256, copyLeaves);
+	}
+	else
+	{
+		copyLeaves(0, leaves.Num());
+	}
+}
+
+void BVH::Build(const TVector<Math::Triangle>& tris, bool bParallel)
 {
 	SAILOR_PROFILE_FUNCTION();
 
-	check(tris.Num() * 2 - 1 == m_nodes.Num());
+	check(tris.Num() > 0);
+
+	// The BVH that is created empty or loaded from the cache has no storage yet
+	if (m_nodes.Num() != tris.Num() * 2 - 1)
+	{
+		m_nodes.Clear();
+		m_nodes.AddDefault(tris.Num() * 2 - 1);
+		m_triIdx.Clear();
+		m_triIdx.AddDefault(tris.Num() * 2 - 1);
+	}
 
 	for (uint32_t i = 0; i < m_nodes.Num(); i++)
 	{
 		m_triIdx[i] = i;
 	}
 
+	m_cacheFile.Unmap();
+
+	m_nodesUsed = 1;
+	m_numTriangles = (uint32_t)tris.Num();
+	m_nodes4.Clear();
+	m_nodes8.Clear();
+	m_layout = EBVHLayout::Binary;
+
 	BVHNode& root = m_nodes[m_rootNodeIdx];
 	root.m_leftFirst = 0;
 	root.m_triCount = (uint32_t)tris.Num();
 
-	UpdateNodeBounds(m_rootNodeIdx, tris);
-	Subdivide(m_rootNodeIdx, tris);
+	UpdateNodeBounds(m_rootNodeIdx, tris, bParallel);
+	Subdivide(m_rootNodeIdx, tris, bParallel);
 
-	SAILOR_PROFILE_BLOCK("Copy/Locality triangle data");
-	// Cache locality
-	m_triangles.Reserve(tris.Num());
-	m_triIdxMapping.AddDefault(tris.Num());
+	CopyLeafTriangles(tris, bParallel);
+	BindTraversalData();
+}
 
-	// TODO: Parallelize
-	for (uint32_t i = 0; i < m_nodes.Num(); i++)
+void BVH::BindTraversalData()
+{
+	m_triIdxInverseMapping.Clear();
+	m_triIdxInverseMapping.AddDefault(m_numTriangles);
+
+	for (uint32_t i = 0; i < m_numTriangles; i++)
 	{
-		if (m_nodes[i].IsLeaf())
+		m_triIdxInverseMapping[m_triIdxMapping[i]] = i;
+	}
+
+	m_pNodes = m_nodes.GetData();
+	m_pTriangles = m_triangles.GetData();
+	m_pTriIdxMapping = m_triIdxMapping.GetData();
+	m_pTriIdxInverseMapping = m_triIdxInverseMapping.GetData();
+}
+
+void BVH::BuildBVH(const TVector<Math::Triangle>& tris)
+{
+	Build(tris, true);
+}
+
+void BVH::BuildBVH_SingleThreaded(const TVector<Math::Triangle>& tris)
+{
+	Build(tris, false);
+}
+
+float BVH::CalculateSAHCost() const
+{
+	const float rootArea = m_pNodes[m_rootNodeIdx].CalculateArea();
+	if (rootArea <= 0.0f)
+	{
+		return 0.0f;
+	}
+
+	float cost = 0.0f;
+	for (uint32_t i = 0; i < m_nodesUsed; i++)
+	{
+		const BVHNode& node = m_pNodes[i];
+
+		// Each triangle of the leaf is intersected, each child of the inner node is tested
+		cost += node.IsLeaf() ? node.CalculateCost() : node.CalculateArea();
+	}
+
+	return cost / rootArea;
+}
+
+namespace
+{
+	/* The sections follow the header and are aligned by CacheAlignment, so the mapped data could be used as is.
+	*  The sizes of the structures are stored to reject the file that is written with the other layout.
+	*/
+	struct BVHCacheHeader
+	{
+		static constexpr uint32_t Magic = 0x48564253; // 'SBVH'
+
+		uint32_t m_magic = Magic;
+		uint32_t m_version = 0;
+		uint64_t m_geometryHash = 0;
+
+		uint32_t m_sizeOfNode = 0;
+		uint32_t m_sizeOfTriangle = 0;
+		uint32_t m_numNodes = 0;
+		uint32_t m_numTriangles = 0;
+		uint32_t m_rootNodeIdx = 0;
+		uint32_t m_padding = 0;
+
+		uint64_t m_nodesOffset = 0;
+		uint64_t m_trianglesOffset = 0;
+		uint64_t m_triIdxMappingOffset = 0;
+		uint64_t m_triIdxInverseMappingOffset = 0;
+		uint64_t m_fileSize = 0;
+	};
+
+	constexpr uint64_t CacheAlignment = 64;
+
+	__forceinline uint64_t AlignCacheOffset(uint64_t offset)
+	{
+		return (offset + CacheAlignment - 1) & ~(CacheAlignment - 1);
+	}
+
+	void WriteCacheSection(std::ofstream& file, uint64_t offset, const void* pData, size_t size)
+	{
+		file.seekp((std::streamoff)offset);
+		file.write(reinterpret_cast<const char*>(pData), size);
+	}
+
+	// The section of numElements follows the header, is aligned and fits the file
+	bool IsValidCacheSection(uint64_t offset, uint64_t numElements, uint64_t sizeOfElement, uint64_t fileSize)
+	{
+		if (offset < sizeof(BVHCacheHeader) || offset % CacheAlignment != 0 || offset > fileSize)
 		{
-			const uint32_t triIndex = m_nodes[i].m_leftFirst;
-			m_nodes[i].m_leftFirst = (int32_t)m_triangles.Num();
+			return false;
+		}
 
-			SAILOR_PROFILE_BLOCK("Sort Triangles by area");
-			TVector<uint32_t> sorted(m_nodes[i].m_triCount);
-			for (uint32_t j = 0; j < m_nodes[i].m_triCount; j++)
-			{
-				sorted[j] = m_triIdx[triIndex + j];
-			}
+		// Divided to not overflow
+		return numElements <= (fileSize - offset) / sizeOfElement;
+	}
+}
 
-			sorted.Sort([&](const auto& lhs, const auto& rhs)
-				{
-					return tris[lhs].SquareArea() > tris[rhs].SquareArea();
-				});
-			SAILOR_PROFILE_END_BLOCK();
+std::filesystem::path BVH::GetCacheFilepath(size_t geometryHash)
+{
+	char filename[64];
+	snprintf(filename, sizeof(filename), "%016llx.bvh", (unsigned long long)geometryHash);
 
-			SAILOR_PROFILE_BLOCK("Copy data");
-			for (uint32_t j = 0; j < m_nodes[i].m_triCount; j++)
-			{
-				const uint32_t triId = sorted[j];// m_triIdx[triIndex + j];
-				m_triIdxMapping[m_triangles.Num()] = triId;
-				m_triangles.Add(tris[triId]);
-			}
-			SAILOR_PROFILE_END_BLOCK();
+	return std::filesystem::path(CacheFolder) / filename;
+}
+
+bool BVH::SaveCache(const std::filesystem::path& filepath, size_t geometryHash) const
+{
+	SAILOR_PROFILE_FUNCTION();
+
+	check(m_pNodes);
+
+	BVHCacheHeader header{};
+	header.m_version = CacheVersion;
+	header.m_geometryHash = geometryHash;
+	header.m_sizeOfNode = sizeof(BVHNode);
+	header.m_sizeOfTriangle = sizeof(Math::Triangle);
+	header.m_numNodes = m_nodesUsed;
+	header.m_numTriangles = m_numTriangles;
+	header.m_rootNodeIdx = m_rootNodeIdx;
+
+	header.m_nodesOffset = AlignCacheOffset(sizeof(BVHCacheHeader));
+	header.m_trianglesOffset = AlignCacheOffset(header.m_nodesOffset + sizeof(BVHNode) * m_nodesUsed);
+	header.m_triIdxMappingOffset = AlignCacheOffset(header.m_trianglesOffset + sizeof(Math::Triangle) * m_numTriangles);
+	header.m_triIdxInverseMappingOffset = AlignCacheOffset(header.m_triIdxMappingOffset + sizeof(uint32_t) * m_numTriangles);
+	header.m_fileSize = header.m_triIdxInverseMappingOffset + sizeof(uint32_t) * m_numTriangles;
+
+	std::error_code error;
+	std::filesystem::create_directories(filepath.parent_path(), error);
+
+	// The file is written under the temporary name, so the other process never maps the incomplete one
+	std::filesystem::path tempFilepath = filepath;
+	tempFilepath += ".tmp";
+
+	{
+		std::ofstream file(tempFilepath, std::ofstream::binary | std::ofstream::trunc);
+		if (!file.is_open())
+		{
+			SAILOR_LOG("Cannot write BVH cache %s", filepath.string().c_str());
+			return false;
+		}
+
+		WriteCacheSection(file, 0, &header, sizeof(header));
+		WriteCacheSection(file, header.m_nodesOffset, m_pNodes, sizeof(BVHNode) * m_nodesUsed);
+		WriteCacheSection(file, header.m_trianglesOffset, m_pTriangles, sizeof(Math::Triangle) * m_numTriangles);
+		WriteCacheSection(file, header.m_triIdxMappingOffset, m_pTriIdxMapping, sizeof(uint32_t) * m_numTriangles);
+		WriteCacheSection(file, header.m_triIdxInverseMappingOffset, m_pTriIdxInverseMapping, sizeof(uint32_t) * m_numTriangles);
+
+		if (!file.good())
+		{
+			file.close();
+			std::filesystem::remove(tempFilepath, error);
+			return false;
+		}
+	}
+
+	std::filesystem::rename(tempFilepath, filepath, error);
+	return !error;
+}
+
+bool BVH::LoadCache(const std::filesystem::path& filepath, size_t geometryHash)
+{
+	SAILOR_PROFILE_FUNCTION();
+
+	BVHCacheHeader header{};
+	{
+		std::ifstream file(filepath, std::ifstream::binary);
+		if (!file.is_open() || !file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+		{
+			return false;
+		}
+	}
+
+	std::error_code error;
+	const uint64_t fileSize = (uint64_t)std::filesystem::file_size(filepath, error);
+
+	if (error ||
+		header.m_magic != BVHCacheHeader::Magic ||
+		header.m_version != CacheVersion ||
+		header.m_geometryHash != (uint64_t)geometryHash ||
+		header.m_sizeOfNode != sizeof(BVHNode) ||
+		header.m_sizeOfTriangle != sizeof(Math::Triangle) ||
+		header.m_fileSize != fileSize ||
+		header.m_numTriangles == 0 ||
+		header.m_rootNodeIdx >= header.m_numNodes)
+	{
+		return false;
+	}
+
+	// The pointers are set right to the mapped data, so the corrupted offsets must not reach the traversal
+	if (!IsValidCacheSection(header.m_nodesOffset, header.m_numNodes, sizeof(BVHNode), fileSize) ||
+		!IsValidCacheSection(header.m_trianglesOffset, header.m_numTriangles, sizeof(Math::Triangle), fileSize) ||
+		!IsValidCacheSection(header.m_triIdxMappingOffset, header.m_numTriangles, sizeof(uint32_t), fileSize) ||
+		!IsValidCacheSection(header.m_triIdxInverseMappingOffset, header.m_numTriangles, sizeof(uint32_t), fileSize))
+	{
+		SAILOR_LOG("BVH cache %s is corrupted", filepath.string().c_str());
+		return false;
+	}
+
+	// The previously mapped file is unmapped anyway, so the traversal falls back to the built data if there is any
+	bool bIsValid = m_cacheFile.Map(filepath.string());
+
+	// The traversal doesn't check the indices, so each node is validated once and the caller rebuilds the BVH if any is broken
+	if (bIsValid)
+	{
+		const uint8_t* pData = m_cacheFile.GetData();
+		const BVHNode* pNodes = reinterpret_cast<const BVHNode*>(pData + header.m_nodesOffset);
+		const uint32_t* pTriIdxMapping = reinterpret_cast<const uint32_t*>(pData + header.m_triIdxMappingOffset);
+		const uint32_t* pTriIdxInverseMapping = reinterpret_cast<const uint32_t*>(pData + header.m_triIdxInverseMappingOffset);
+
+		for (uint64_t i = 0; bIsValid && i < header.m_numNodes; i++)
+		{
+			const BVHNode& node = pNodes[i];
+
+			// The children are allocated after the parent, so the traversal never loops
+			bIsValid = node.IsLeaf() ?
+				(uint64_t)node.m_leftFirst + node.m_triCount <= header.m_numTriangles :
+				node.m_leftFirst > i && (uint64_t)node.m_leftFirst + 1 < header.m_numNodes;
+		}
+
+		for (uint64_t i = 0; bIsValid && i < header.m_numTriangles; i++)
+		{
+			bIsValid = pTriIdxMapping[i] < header.m_numTriangles && pTriIdxInverseMapping[i] < header.m_numTriangles;
 		}
+
+		if (!bIsValid)
+		{
+			SAILOR_LOG("BVH cache %s is corrupted", filepath.string().c_str());
+			m_cacheFile.Unmap();
+		}
+	}
+
+	if (!bIsValid)
+	{
+		m_pNodes = m_nodes.GetData();
+		m_pTriangles = m_triangles.GetData();
+		m_pTriIdxMapping = m_triIdxMapping.GetData();
+		m_pTriIdxInverseMapping = m_triIdxInverseMapping.GetData();
+		m_numTriangles = (uint32_t)m_triangles.Num();
+		return false;
 	}
-	SAILOR_PROFILE_END_BLOCK();
-}
\ No newline at end of file
+
+	m_nodes.Clear();
+	m_triIdx.Clear();
+	m_triangles.Clear();
+	m_triIdxMapping.Clear();
+	m_triIdxInverseMapping.Clear();
+	m_nodes4.Clear();
+	m_nodes8.Clear();
+	m_layout = EBVHLayout::Binary;
+
+	const uint8_t* pData = m_cacheFile.GetData();
+
+	m_nodesUsed = header.m_numNodes;
+	m_numTriangles = header.m_numTriangles;
+	m_rootNodeIdx = header.m_rootNodeIdx;
+
+	m_pNodes = reinterpret_cast<const BVHNode*>(pData + header.m_nodesOffset);
+	m_pTriangles = reinterpret_cast<const Math::Triangle*>(pData + header.m_trianglesOffset);
+	m_pTriIdxMapping = reinterpret_cast<const uint32_t*>(pData + header.m_triIdxMappingOffset);
+	m_pTriIdxInverseMapping = reinterpret_cast<const uint32_t*>(pData + header.m_triIdxInverseMappingOffset);
+
+	return true;
+}
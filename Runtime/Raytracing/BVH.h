@@ -2,39 +2,78 @@
 #include "Core/Defines.h"
 #include "Math/Bounds.h"
 #include "Containers/Vector.h"
+#include "Platform/Platform.h"
+#include <filesystem>
 
 using namespace Sailor;
 
 namespace Sailor::Raytracing
 {
+	// The binary BVH could be collapsed to the wide one that is traversed with SIMD
+	enum class EBVHLayout : uint8_t
+	{
+		Binary = 0,
+		BVH4,
+		BVH8
+	};
+
 	//Inspired by https://jacco.ompf2.com/2022/04/13/how-to-build-a-bvh-part-1-basics/
 	class BVH
 	{
-		struct BVHNode //40 bytes
+		struct alignas(16) BVHNode //32 bytes
 		{
-			union
-			{
-				struct { vec3 m_aabbMin; uint m_leftFirst; };
-				__m128 m_aabbMin4;
-			};
-			union
-			{
-				struct { vec3 m_aabbMax; uint m_triCount; };
-				__m128 m_aabbMax4;
-			};
+			vec3 m_aabbMin;
+			uint m_leftFirst;
+			vec3 m_aabbMax;
+			uint m_triCount;
 
 			bool IsLeaf() const { return m_triCount > 0; }
 
-			float CalculateCost() const
+			float CalculateArea() const
 			{
 				const vec3 e = m_aabbMax - m_aabbMin;
-				float surfaceArea = 2.0f * (e.x * e.y + e.y * e.z + e.z * e.x);
-				return m_triCount * surfaceArea;
+				return 2.0f * (e.x * e.y + e.y * e.z + e.z * e.x);
 			}
+
+			float CalculateCost() const { return m_triCount * CalculateArea(); }
 		};
 
+		/* The children boxes are stored as SoA, so the ray is tested against all of them at once.
+		*  The child is the node index or the first triangle if m_triCount is not 0.
+		*/
+		template<uint32_t Width>
+		struct TWideBVHNode
+		{
+			float m_minX[Width];
+			float m_minY[Width];
+			float m_minZ[Width];
+			float m_maxX[Width];
+			float m_maxY[Width];
+			float m_maxZ[Width];
+
+			uint32_t m_children[Width];
+			uint32_t m_triCount[Width];
+			uint32_t m_numChildren;
+		};
+
+		struct Bin { Math::AABB m_bounds{}; int32_t m_triCount = 0; };
+
+		static constexpr uint32_t NumBins = 8;
+
+		// The centroid bounds and the binning of the larger nodes are calculated by ParallelReduce
+		static constexpr uint32_t ParallelBinningThreshold = 1 << 14;
+
+		// The larger subtrees are built by the separate tasks, the smaller ones are built on the same thread
+		static constexpr uint32_t ParallelSubtreeThreshold = 1 << 10;
+
 	public:
 
+		static constexpr const char* CacheFolder = "../Cache/BVH/";
+		static constexpr uint32_t CacheVersion = 1;
+
+		// The empty BVH that is built later or loaded by LoadCache
+		BVH() = default;
+
 		BVH(uint32_t numTriangles)
 		{
 			const uint32_t N = 2 * numTriangles - 1;
@@ -42,22 +81,100 @@ namespace Sailor::Raytracing
 			m_triIdx.AddDefault(N);
 		}
 
+		// Builds the subtrees and bins the top level nodes in parallel on the worker threads,
+		// the result has the same topology as BuildBVH_SingleThreaded, only the node indices differ
 		void BuildBVH(const TVector<Math::Triangle>& tris);
+		void BuildBVH_SingleThreaded(const TVector<Math::Triangle>& tris);
+
+		// SAH cost of the built tree normalized by the root area, the traversal and the intersection costs are 1
+		float CalculateSAHCost() const;
+		uint32_t GetNumNodes() const { return m_nodesUsed; }
+		uint32_t GetNumTriangles() const { return m_numTriangles; }
+
+		// The triangle by the index in the source array, i.e. RaycastHit::m_triangleIndex
+		const Math::Triangle& GetTriangle(uint32_t triangleIndex) const { return m_pTriangles[m_pTriIdxInverseMapping[triangleIndex]]; }
+
+		// The cache file is named by the hash of the geometry that the BVH is built from
+		static std::filesystem::path GetCacheFilepath(size_t geometryHash);
+
+		// Writes the nodes, the triangle indices and the reordered triangles to the versioned binary file
+		bool SaveCache(const std::filesystem::path& filepath, size_t geometryHash) const;
+
+		/* Maps the file and traverses the nodes and the triangles right in the mapped memory without copying.
+		*  Fails if the file is missed, has the other version or layout, or is built from the other geometry.
+		*/
+		bool LoadCache(const std::filesystem::path& filepath, size_t geometryHash);
+
+		// AVX is required to test 8 boxes at once, otherwise the 8-wide node is tested by two SSE halves
+#if defined(__AVX__)
+		static constexpr EBVHLayout DefaultWideLayout = EBVHLayout::BVH8;
+#else
+		static constexpr EBVHLayout DefaultWideLayout = EBVHLayout::BVH4;
+#endif
+
+		// Builds the wide nodes from the binary ones if needed and switches the traversal to the layout
+		void Collapse(EBVHLayout layout);
+		EBVHLayout GetLayout() const { return m_layout; }
+
+		// The wide layouts are traversed from the root only, other nodeIdx falls back to the binary traversal
 		bool IntersectBVH(const Math::Ray& ray, Math::RaycastHit& outResult, const uint nodeIdx, float maxRayLength = std::numeric_limits<float>::max(), uint32_t ignoreTriangle = (uint32_t)(-1)) const;
 
+		// The packet of coherent rays, i.e. the neighbour camera rays or the shadow rays to the same directional light
+		static constexpr uint32_t MaxPacketSize = 8;
+
+		// The packet is diverged when less rays hit the node, then the subtree is traversed by each ray separately
+		static constexpr uint32_t MinCoherentRays = 2;
+
+		/* Traverses the binary nodes with the whole packet, the node is culled by the packet's frustum first and then each ray is tested with SIMD.
+		*  The results should be empty (as for IntersectBVH), ignoreTriangles could be nullptr.
+		*  bAnyHit stops the ray at the first found hit, that is enough for the shadow rays.
+		*  Returns the mask of the rays that have hit.
+		*/
+		uint32_t IntersectPacket(const Math::Ray* rays, uint32_t numRays, Math::RaycastHit* outResults, const uint32_t* ignoreTriangles = nullptr,
+			float maxRayLength = std::numeric_limits<float>::max(), bool bAnyHit = false) const;
+
 	protected:
 
-		void UpdateNodeBounds(uint32_t nodeIdx, const TVector<Math::Triangle>& tris);
-		void Subdivide(uint32_t nodeIdx, const TVector<Math::Triangle>& tris);
+		void Build(const TVector<Math::Triangle>& tris, bool bParallel);
+		void UpdateNodeBounds(uint32_t nodeIdx, const TVector<Math::Triangle>& tris, bool bParallel = false);
+		void Subdivide(uint32_t nodeIdx, const TVector<Math::Triangle>& tris, bool bParallel = false);
+		void CopyLeafTriangles(const TVector<Math::Triangle>& tris, bool bParallel = false);
+		void BindTraversalData();
 		float EvaluateSAH(const BVHNode& node, const TVector<Math::Triangle>& tris, int32_t axis, float pos) const;
-		float FindBestSplitPlane(const BVHNode& node, const TVector<Math::Triangle>& tris, int32_t& outAxis, float& outSplitPos) const;
+		float FindBestSplitPlane(const BVHNode& node, const TVector<Math::Triangle>& tris, int32_t& outAxis, float& outSplitPos, bool bParallel = false) const;
+
+		template<uint32_t Width>
+		uint32_t CollapseNode(uint32_t nodeIdx, TVector<TWideBVHNode<Width>>& outNodes) const;
+
+		bool IntersectBinary(const Math::Ray& ray, Math::RaycastHit& outResult, uint32_t nodeIdx, float maxRayLength, uint32_t ignoreTriangle) const;
+
+		template<uint32_t Width>
+		bool IntersectWide(const TVector<TWideBVHNode<Width>>& nodes, const Math::Ray& ray, Math::RaycastHit& outResult, float maxRayLength, uint32_t ignoreTriangle) const;
+
+		__forceinline void IntersectLeaf(const Math::Ray& ray, Math::RaycastHit& outResult, uint32_t first, uint32_t triCount, float& maxRayLength, uint32_t ignoreTriangle) const;
 
 		TVector<BVHNode> m_nodes;
 		TVector<uint32_t> m_triIdx;
 		TVector<Math::Triangle> m_triangles;
 		TVector<uint32_t> m_triIdxMapping;
+		TVector<uint32_t> m_triIdxInverseMapping;
+
+		// The traversal reads the data by these pointers, that are either the built vectors or the mapped cache file
+		const BVHNode* m_pNodes = nullptr;
+		const Math::Triangle* m_pTriangles = nullptr;
+		const uint32_t* m_pTriIdxMapping = nullptr;
+		const uint32_t* m_pTriIdxInverseMapping = nullptr;
+		Platform::MappedFile m_cacheFile;
+
+		TVector<TWideBVHNode<4>> m_nodes4;
+		TVector<TWideBVHNode<8>> m_nodes8;
+		EBVHLayout m_layout = EBVHLayout::Binary;
 
 		uint32_t m_rootNodeIdx = 0;
+		// Is incremented by std::atomic_ref when the subtrees are built in parallel
 		uint32_t m_nodesUsed = 1;
+		uint32_t m_numTriangles = 0;
 	};
+
+	SAILOR_API void RunBVHBenchmark();
 }
\ No newline at end of file
@@ -0,0 +1,479 @@
+#include "BVH.h"
+#include "MaterialUtils.h"
+#include "Tasks/Scheduler.h"
+#include "Core/LogMacros.h"
+#include "Core/Utils.h"
+#include "glm/glm/glm.hpp"
+#include "glm/glm/gtc/constants.hpp"
+
+#include "assimp/scene.h"
+#include "assimp/postprocess.h"
+#include "assimp/Importer.hpp"
+
+#include <filesystem>
+#include <random>
+
+using namespace Sailor;
+using namespace Sailor::Raytracing;
+using Timer = Utils::Timer;
+
+namespace
+{
+	const aiScene* ImportScene(Assimp::Importer& importer, const std::filesystem::path& path)
+	{
+		if (!std::filesystem::exists(path))
+		{
+			return nullptr;
+		}
+
+		const auto scene = importer.ReadFile(path.string().c_str(), aiProcess_FlipUVs | aiProcess_GenNormals | aiProcess_GenUVCoords | aiProcess_Triangulate);
+		if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
+		{
+			SAILOR_LOG("%s", importer.GetErrorString());
+			return nullptr;
+		}
+
+		return scene;
+	}
+
+	void ProcessTriangles(const aiScene* scene, TVector<Math::Triangle>& outTriangles)
+	{
+		uint32_t expectedNumFaces = 0;
+		for (uint32_t i = 0; i < scene->mNumMeshes; i++)
+		{
+			expectedNumFaces += scene->mMeshes[i]->mNumFaces;
+		}
+
+		outTriangles.Reserve(expectedNumFaces);
+		ProcessNode_Assimp(outTriangles, scene->mRootNode, scene, glm::mat4(1.0f));
+	}
+
+	bool LoadTriangles(const std::filesystem::path& path, TVector<Math::Triangle>& outTriangles)
+	{
+		Assimp::Importer importer;
+
+		const aiScene* scene = ImportScene(importer, path);
+		if (!scene)
+		{
+			return false;
+		}
+
+		ProcessTriangles(scene, outTriangles);
+
+		return outTriangles.Num() > 0;
+	}
+
+	struct TraceResult
+	{
+		uint32_t m_triangleIndex = (uint32_t)-1;
+		float m_distance = 0.0f;
+	};
+
+	// Single threaded to measure the traversal itself
+	float TraceRays(const BVH& bvh, const TVector<Math::Ray>& rays, const TVector<uint32_t>& ignoreTriangles, TVector<TraceResult>& outResults, TVector<Math::RaycastHit>* pOutHits = nullptr)
+	{
+		outResults.Clear();
+		outResults.AddDefault(rays.Num());
+
+		if (pOutHits)
+		{
+			pOutHits->Clear();
+			pOutHits->AddDefault(rays.Num());
+		}
+
+		Timer timer;
+		timer.Start();
+
+		for (uint32_t i = 0; i < rays.Num(); i++)
+		{
+			Math::RaycastHit hit{};
+			if (bvh.IntersectBVH(rays[i], hit, 0, std::numeric_limits<float>::max(), ignoreTriangles[i]))
+			{
+				outResults[i].m_triangleIndex = hit.m_triangleIndex;
+				outResults[i].m_distance = hit.m_rayLenght;
+			}
+
+			if (pOutHits)
+			{
+				(*pOutHits)[i] = hit;
+			}
+		}
+
+		timer.Stop();
+
+		return (float)rays.Num() / (float)std::max((int64_t)1, timer.ResultMs()) * 0.001f;
+	}
+
+	// The distance should be identical, the triangle could differ only when two triangles are hit at the same distance
+	uint32_t CountMismatches(const TVector<TraceResult>& lhs, const TVector<TraceResult>& rhs)
+	{
+		uint32_t res = 0;
+		for (uint32_t i = 0; i < lhs.Num(); i++)
+		{
+			if (lhs[i].m_distance != rhs[i].m_distance)
+			{
+				res++;
+			}
+		}
+		return res;
+	}
+
+	// The rays go in the 4x2 tiles, so each MaxPacketSize rays are the packet of the neighbour pixels
+	const uint32_t PacketWidth = 4;
+	const uint32_t PacketHeight = BVH::MaxPacketSize / PacketWidth;
+
+	// The pinhole camera in front of the scene bounds, that works for the interiors and for the single objects
+	void GeneratePrimaryRays(const Math::AABB& bounds, uint32_t resolution, TVector<Math::Ray>& outRays)
+	{
+		const vec3 cameraPos = bounds.GetCenter() - vec3(0.0f, 0.0f, bounds.GetExtents().z * 1.5f);
+		const vec3 cameraForward = glm::normalize(bounds.GetCenter() - cameraPos);
+		const vec3 cameraRight = glm::normalize(glm::cross(cameraForward, vec3(0, 1, 0)));
+		const vec3 cameraUp = glm::cross(cameraRight, cameraForward);
+
+		outRays.Clear();
+		outRays.Reserve(resolution * resolution);
+
+		for (uint32_t y = 0; y < resolution; y += PacketHeight)
+		{
+			for (uint32_t x = 0; x < resolution; x += PacketWidth)
+			{
+				for (uint32_t v = 0; v < PacketHeight; v++)
+				{
+					for (uint32_t u = 0; u < PacketWidth; u++)
+					{
+						const float tu = ((float)(x + u) + 0.5f) / resolution * 2.0f - 1.0f;
+						const float tv = ((float)(y + v) + 0.5f) / resolution * 2.0f - 1.0f;
+
+						outRays.Add(Math::Ray(cameraPos, glm::normalize(cameraForward + tu * cameraRight + tv * cameraUp)));
+					}
+				}
+			}
+		}
+	}
+
+	float TracePackets(const BVH& bvh, const TVector<Math::Ray>& rays, const TVector<uint32_t>& ignoreTriangles, bool bAnyHit, TVector<Math::RaycastHit>& outHits)
+	{
+		outHits.Clear();
+		outHits.AddDefault(rays.Num());
+
+		Timer timer;
+		timer.Start();
+
+		for (uint32_t i = 0; i < rays.Num(); i += BVH::MaxPacketSize)
+		{
+			const uint32_t numRays = std::min(BVH::MaxPacketSize, (uint32_t)rays.Num() - i);
+			bvh.IntersectPacket(&rays[i], numRays, &outHits[i], &ignoreTriangles[i], std::numeric_limits<float>::max(), bAnyHit);
+		}
+
+		timer.Stop();
+
+		return (float)rays.Num() / (float)std::max((int64_t)1, timer.ResultMs()) * 0.001f;
+	}
+
+	// Camera rays and the shadow rays to the directional light, the packets against the single rays of the default layout
+	void RunPacketTests(BVH& bvh, const Math::AABB& bounds)
+	{
+		const vec3 toLight = glm::normalize(vec3(0.3f, 1.0f, 0.2f));
+
+		bvh.Collapse(BVH::DefaultWideLayout);
+
+		for (const uint32_t resolution : { 256u, 512u, 1024u })
+		{
+			TVector<Math::Ray> primaryRays;
+			GeneratePrimaryRays(bounds, resolution, primaryRays);
+
+			TVector<uint32_t> primaryIgnore;
+			primaryIgnore.AddDefault(primaryRays.Num());
+			for (auto& ignore : primaryIgnore)
+			{
+				ignore = (uint32_t)-1;
+			}
+
+			TVector<TraceResult> reference;
+			TVector<Math::RaycastHit> primaryHits;
+			const float singlePrimary = TraceRays(bvh, primaryRays, primaryIgnore, reference, &primaryHits);
+
+			TVector<Math::RaycastHit> packetHits;
+			const float packetPrimary = TracePackets(bvh, primaryRays, primaryIgnore, false, packetHits);
+
+			uint32_t mismatches = 0;
+			for (uint32_t i = 0; i < primaryRays.Num(); i++)
+			{
+				if (packetHits[i].m_rayLenght != reference[i].m_distance && (packetHits[i].HasIntersection() || reference[i].m_triangleIndex != (uint32_t)-1))
+				{
+					mismatches++;
+				}
+			}
+
+			// The missed rays are kept in the packets to keep them coherent, they start from the camera
+			TVector<Math::Ray> shadowRays;
+			TVector<uint32_t> shadowIgnore;
+			shadowRays.Reserve(primaryRays.Num());
+			shadowIgnore.Reserve(primaryRays.Num());
+
+			for (uint32_t i = 0; i < primaryRays.Num(); i++)
+			{
+				const bool bHit = primaryHits[i].HasIntersection();
+				shadowRays.Add(Math::Ray(bHit ? primaryHits[i].m_point : primaryRays[i].GetOrigin(), toLight));
+				shadowIgnore.Add(primaryHits[i].m_triangleIndex);
+			}
+
+			TVector<TraceResult> shadowReference;
+			const float singleShadow = TraceRays(bvh, shadowRays, shadowIgnore, shadowReference);
+
+			TVector<Math::RaycastHit> shadowHits;
+			const float packetShadow = TracePackets(bvh, shadowRays, shadowIgnore, true, shadowHits);
+
+			for (uint32_t i = 0; i < shadowRays.Num(); i++)
+			{
+				if (shadowHits[i].HasIntersection() != (shadowReference[i].m_triangleIndex != (uint32_t)-1))
+				{
+					mismatches++;
+				}
+			}
+
+			SAILOR_LOG("\t%ux%u packets: primary %.2f vs %.2f Mrays/s (x%.2f), shadow %.2f vs %.2f Mrays/s (x%.2f), mismatches %u",
+				resolution, resolution,
+				packetPrimary, singlePrimary, packetPrimary / std::max(0.001f, singlePrimary),
+				packetShadow, singleShadow, packetShadow / std::max(0.001f, singleShadow),
+				mismatches);
+		}
+
+		bvh.Collapse(EBVHLayout::Binary);
+	}
+
+	void RunTraversalTests(BVH& bvh, const TVector<Math::Triangle>& triangles)
+	{
+		const uint32_t Resolution = 512;
+
+		Math::AABB bounds;
+		for (const auto& tri : triangles)
+		{
+			bounds.Extend(tri.m_vertices[0]);
+			bounds.Extend(tri.m_vertices[1]);
+			bounds.Extend(tri.m_vertices[2]);
+		}
+
+		TVector<Math::Ray> primaryRays;
+		GeneratePrimaryRays(bounds, Resolution, primaryRays);
+
+		TVector<uint32_t> primaryIgnore;
+		primaryIgnore.AddDefault(primaryRays.Num());
+		for (auto& ignore : primaryIgnore)
+		{
+			ignore = (uint32_t)-1;
+		}
+
+		bvh.Collapse(EBVHLayout::Binary);
+
+		TVector<TraceResult> reference;
+		TVector<Math::RaycastHit> primaryHits;
+		const float binaryPrimary = TraceRays(bvh, primaryRays, primaryIgnore, reference, &primaryHits);
+
+		// Cosine weighted bounces from the primary hits, these rays are incoherent
+		std::mt19937 g(0);
+		std::uniform_real_distribution<float> random(0.0f, 1.0f);
+
+		TVector<Math::Ray> bounceRays;
+		TVector<uint32_t> bounceIgnore;
+		for (uint32_t i = 0; i < primaryHits.Num(); i++)
+		{
+			const Math::RaycastHit& hit = primaryHits[i];
+			if (!hit.HasIntersection())
+			{
+				continue;
+			}
+
+			vec3 normal = glm::normalize(hit.m_normal);
+			if (glm::dot(normal, primaryRays[i].GetDirection()) > 0.0f)
+			{
+				normal = -normal;
+			}
+
+			const vec3 tangent = glm::normalize(glm::cross(glm::abs(normal.x) > 0.9f ? vec3(0, 1, 0) : vec3(1, 0, 0), normal));
+			const vec3 bitangent = glm::cross(normal, tangent);
+
+			const float r = sqrt(random(g));
+			const float phi = 2.0f * glm::pi<float>() * random(g);
+			const vec3 dir = r * cos(phi) * tangent + r * sin(phi) * bitangent + sqrt(std::max(0.0f, 1.0f - r * r)) * normal;
+
+			bounceRays.Add(Math::Ray(hit.m_point, glm::normalize(dir)));
+			bounceIgnore.Add(hit.m_triangleIndex);
+		}
+
+		TVector<TraceResult> bounceReference;
+		const float binaryBounce = TraceRays(bvh, bounceRays, bounceIgnore, bounceReference);
+
+		SAILOR_LOG("	Binary traversal: primary %.2f Mrays/s, diffuse bounce %.2f Mrays/s", binaryPrimary, binaryBounce);
+
+		for (const EBVHLayout layout : { EBVHLayout::BVH4, EBVHLayout::BVH8 })
+		{
+			Timer collapse;
+			collapse.Start();
+			bvh.Collapse(layout);
+			collapse.Stop();
+
+			TVector<TraceResult> results;
+			const float primary = TraceRays(bvh, primaryRays, primaryIgnore, results);
+			const uint32_t primaryMismatches = CountMismatches(results, reference);
+
+			const float bounce = TraceRays(bvh, bounceRays, bounceIgnore, results);
+			const uint32_t bounceMismatches = CountMismatches(results, bounceReference);
+
+			SAILOR_LOG("	%s traversal (collapse %lldms): primary %.2f Mrays/s, diffuse bounce %.2f Mrays/s, mismatches %u",
+				layout == EBVHLayout::BVH4 ? "BVH4" : "BVH8", collapse.ResultMs(), primary, bounce, primaryMismatches + bounceMismatches);
+		}
+
+		RunPacketTests(bvh, bounds);
+	}
+
+	// The same steps as the path tracer's startup: the cold one processes the triangles and builds the BVH, the warm one maps the cache
+	void RunCacheTests(const std::filesystem::path& path, const TVector<Math::Triangle>& triangles)
+	{
+		Timer importTimer;
+		Timer coldTimer;
+		Timer warmTimer;
+
+		std::filesystem::path cacheFilepath;
+		size_t geometryHash = 0;
+
+		BVH cold;
+		{
+			coldTimer.Start();
+
+			Assimp::Importer importer;
+			importTimer.Start();
+			const aiScene* scene = ImportScene(importer, path);
+			importTimer.Stop();
+
+			geometryHash = CalculateGeometryHash_Assimp(scene);
+			cacheFilepath = BVH::GetCacheFilepath(geometryHash);
+
+			std::error_code error;
+			std::filesystem::remove(cacheFilepath, error);
+
+			TVector<Math::Triangle> processed;
+			ProcessTriangles(scene, processed);
+
+			cold.BuildBVH(processed);
+			cold.SaveCache(cacheFilepath, geometryHash);
+			cold.Collapse(BVH::DefaultWideLayout);
+
+			coldTimer.Stop();
+		}
+
+		BVH warm;
+		bool bIsLoaded = false;
+		{
+			warmTimer.Start();
+
+			Assimp::Importer importer;
+			const aiScene* scene = ImportScene(importer, path);
+
+			const size_t warmGeometryHash = CalculateGeometryHash_Assimp(scene);
+			bIsLoaded = warm.LoadCache(BVH::GetCacheFilepath(warmGeometryHash), warmGeometryHash);
+			warm.Collapse(BVH::DefaultWideLayout);
+
+			warmTimer.Stop();
+		}
+
+		if (!bIsLoaded)
+		{
+			SAILOR_LOG("\tBVH cache: cannot load %s", cacheFilepath.string().c_str());
+			return;
+		}
+
+		// The first traversal of the warm BVH also pays for the page faults of the mapped file
+		Math::AABB bounds;
+		for (const auto& tri : triangles)
+		{
+			bounds.Extend(tri.m_vertices[0]);
+			bounds.Extend(tri.m_vertices[1]);
+			bounds.Extend(tri.m_vertices[2]);
+		}
+
+		TVector<Math::Ray> rays;
+		GeneratePrimaryRays(bounds, 256, rays);
+
+		TVector<uint32_t> ignore;
+		ignore.AddDefault(rays.Num());
+		for (auto& i : ignore)
+		{
+			i = (uint32_t)-1;
+		}
+
+		TVector<TraceResult> coldResults;
+		TVector<TraceResult> warmResults;
+		TraceRays(cold, rays, ignore, coldResults);
+		TraceRays(warm, rays, ignore, warmResults);
+
+		SAILOR_LOG("\tBVH cache (%.2fMb): import %lldms, cold startup %lldms, warm startup %lldms, mismatches %u",
+			std::filesystem::file_size(cacheFilepath) / (1024.0f * 1024.0f),
+			importTimer.ResultMs(), coldTimer.ResultMs(), warmTimer.ResultMs(), CountMismatches(coldResults, warmResults));
+
+		std::error_code error;
+		std::filesystem::remove(cacheFilepath, error);
+	}
+
+	void RunTests(const std::filesystem::path& path)
+	{
+		TVector<Math::Triangle> triangles;
+		if (!LoadTriangles(path, triangles))
+		{
+			SAILOR_LOG("BVH benchmark: cannot load %s, skipped", path.string().c_str());
+			return;
+		}
+
+		const uint32_t numRuns = 3;
+
+		Timer singleThreaded;
+		Timer parallel;
+
+		float singleThreadedSAH = 0.0f;
+		float parallelSAH = 0.0f;
+		uint32_t singleThreadedNodes = 0;
+		uint32_t parallelNodes = 0;
+
+		for (uint32_t i = 0; i < numRuns; i++)
+		{
+			BVH bvh((uint32_t)triangles.Num());
+
+			singleThreaded.Start();
+			bvh.BuildBVH_SingleThreaded(triangles);
+			singleThreaded.Stop();
+
+			singleThreadedSAH = bvh.CalculateSAHCost();
+			singleThreadedNodes = bvh.GetNumNodes();
+		}
+
+		BVH bvh((uint32_t)triangles.Num());
+		for (uint32_t i = 0; i < numRuns; i++)
+		{
+			parallel.Start();
+			bvh.BuildBVH(triangles);
+			parallel.Stop();
+
+			parallelSAH = bvh.CalculateSAHCost();
+			parallelNodes = bvh.GetNumNodes();
+		}
+
+		SAILOR_LOG("%s, %llu triangles:", path.filename().string().c_str(), (uint64_t)triangles.Num());
+		SAILOR_LOG("\tSingle threaded build %.2fms, SAH cost %.3f, %u nodes", singleThreaded.ResultAccumulatedMs() / (float)numRuns, singleThreadedSAH, singleThreadedNodes);
+		SAILOR_LOG("\tParallel build %.2fms, SAH cost %.3f, %u nodes", parallel.ResultAccumulatedMs() / (float)numRuns, parallelSAH, parallelNodes);
+
+		// The parallel binning is exact, only the order of float additions in the cost could differ
+		const bool bMatched = parallelNodes == singleThreadedNodes && glm::abs(parallelSAH - singleThreadedSAH) <= 1e-3f * singleThreadedSAH;
+		SAILOR_LOG("\tSanity check passed: %d", bMatched);
+
+		RunTraversalTests(bvh, triangles);
+		RunCacheTests(path, triangles);
+	}
+}
+
+void Sailor::Raytracing::RunBVHBenchmark()
+{
+	printf("\nStarting BVH benchmark...\n");
+
+	RunTests("../Content/Models/Sponza/sponza.obj");
+	RunTests("../Content/Models/KnightArtorias/Artorias.fbx");
+}
@@ -0,0 +1,155 @@
+#include "Denoiser.h"
+#include "Tasks/ParallelFor.h"
+#include "Core/LogMacros.h"
+#include "glm/glm/glm.hpp"
+
+using namespace Sailor;
+using namespace Sailor::Raytracing;
+
+namespace
+{
+	const float Kernel[5] = { 1.0f / 16.0f, 1.0f / 4.0f, 3.0f / 8.0f, 1.0f / 4.0f, 1.0f / 16.0f };
+
+	// The black albedo would blow the irradiance up
+	const float MinAlbedo = 0.01f;
+
+	// The rows are claimed by the chunks of that size
+	const size_t RowsGrainSize = 4;
+
+	__forceinline vec3 Tonemap(const vec3& color) { return color / (vec3(1.0f) + color); }
+}
+
+void Denoiser::Denoise(const TVector<vec3>& image, const PathTracer::AOVs& aovs, uint32_t width, uint32_t height, const Params& params, TVector<vec3>& outImage)
+{
+	SAILOR_PROFILE_FUNCTION();
+
+	const uint32_t numPixels = width * height;
+	check(image.Num() == numPixels);
+
+	const vec3* pAlbedo = aovs.m_albedo.Num() == numPixels ? aovs.m_albedo.GetData() : nullptr;
+	const vec3* pNormal = aovs.m_normal.Num() == numPixels ? aovs.m_normal.GetData() : nullptr;
+	const float* pDepth = aovs.m_depth.Num() == numPixels ? aovs.m_depth.GetData() : nullptr;
+
+	// The irradiance is filtered, the albedo is the detail that is restored after
+	TVector<vec3> src(numPixels);
+	TVector<vec3> dst(numPixels);
+	TVector<vec3> tonemapped(numPixels);
+
+	Tasks::ParallelFor("Denoiser demodulate", 0, numPixels, 4096,
+		[&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				src[i] = pAlbedo ? image[i] / glm::max(pAlbedo[i], vec3(MinAlbedo)) : image[i];
+			}
+		});
+
+	for (uint32_t iteration = 0; iteration < params.m_numIterations; iteration++)
+	{
+		const int32_t step = 1 << iteration;
+		const float colorSigma = params.m_colorSigma / (float)step;
+		const float invColorSigmaSq = 1.0f / std::max(colorSigma * colorSigma, 1e-8f);
+		const float invAlbedoSigmaSq = 1.0f / std::max(params.m_albedoSigma * params.m_albedoSigma, 1e-8f);
+
+		Tasks::ParallelFor("Denoiser tonemap", 0, numPixels, 4096,
+			[&](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; i++)
+				{
+					tonemapped[i] = Tonemap(src[i]);
+				}
+			});
+
+		Tasks::ParallelFor("Denoiser iteration", 0, height, RowsGrainSize,
+			[&](size_t beginRow, size_t endRow)
+			{
+				for (int32_t y = (int32_t)beginRow; y < (int32_t)endRow; y++)
+				{
+					for (int32_t x = 0; x < (int32_t)width; x++)
+					{
+						const uint32_t p = y * width + x;
+
+						const vec3 colorP = tonemapped[p];
+						const vec3 normalP = pNormal ? pNormal[p] : vec3(0);
+						const bool bHasNormalP = pNormal && normalP != vec3(0);
+						const float depthP = pDepth ? pDepth[p] : 0.0f;
+						const float invDepthSigma = 1.0f / (params.m_depthSigma * std::max(depthP, 1e-3f) * step);
+
+						vec3 sum = vec3(0);
+						float weightSum = 0.0f;
+
+						for (int32_t dy = -2; dy <= 2; dy++)
+						{
+							const int32_t qy = y + dy * step;
+							if (qy < 0 || qy >= (int32_t)height)
+							{
+								continue;
+							}
+
+							for (int32_t dx = -2; dx <= 2; dx++)
+							{
+								const int32_t qx = x + dx * step;
+								if (qx < 0 || qx >= (int32_t)width)
+								{
+									continue;
+								}
+
+								const uint32_t q = qy * width + qx;
+								float weight = Kernel[dx + 2] * Kernel[dy + 2];
+
+								// The gaussian terms are summed, so there is the only exp per tap
+								const vec3 dColor = colorP - tonemapped[q];
+								float exponent = glm::dot(dColor, dColor) * invColorSigmaSq;
+
+								// The missed rays have no normal, so they are mixed with each other only
+								if (pNormal)
+								{
+									const bool bHasNormalQ = pNormal[q] != vec3(0);
+									if (bHasNormalP != bHasNormalQ)
+									{
+										continue;
+									}
+
+									if (bHasNormalP)
+									{
+										weight *= std::pow(std::max(0.0f, glm::dot(normalP, pNormal[q])), params.m_normalPower);
+									}
+								}
+
+								if (pDepth)
+								{
+									exponent += std::abs(depthP - pDepth[q]) * invDepthSigma;
+								}
+
+								if (pAlbedo)
+								{
+									const vec3 dAlbedo = pAlbedo[p] - pAlbedo[q];
+									exponent += glm::dot(dAlbedo, dAlbedo) * invAlbedoSigmaSq;
+								}
+
+								weight *= std::exp(-exponent);
+
+								sum += src[q] * weight;
+								weightSum += weight;
+							}
+						}
+
+						// The center pixel is always taken, its weight is not 0
+						dst[p] = sum / weightSum;
+					}
+				}
+			});
+
+		std::swap(src, dst);
+	}
+
+	outImage.Resize(numPixels);
+	Tasks::ParallelFor("Denoiser remodulate", 0, numPixels, 4096,
+		[&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				outImage[i] = pAlbedo ? src[i] * glm::max(pAlbedo[i], vec3(MinAlbedo)) : src[i];
+			}
+		});
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include "Core/Defines.h"
+#include "Containers/Vector.h"
+
+#include "PathTracer.h"
+
+using namespace Sailor;
+
+namespace Sailor::Raytracing
+{
+	/* Edge-avoiding a-trous wavelet filter (Dammertz et al. 2010) that is guided by the first hit AOVs.
+	*  The albedo is divided out before the filtering, so the textures stay sharp, and multiplied back after.
+	*  Each iteration blurs by the 5x5 B3-spline kernel with the holes of 2^i pixels,
+	*  the neighbours with the other normal, depth, albedo or (much) other color are not taken.
+	*/
+	class Denoiser
+	{
+	public:
+
+		struct Params
+		{
+			// The filter radius is 2 * 2^(iterations - 1) pixels
+			uint32_t m_numIterations = 5;
+
+			// The color distance is measured on c/(1+c), so the fireflies don't break the edges, the sigma is halved each iteration
+			float m_colorSigma = 0.6f;
+
+			// The exponent of the normals' cosine
+			float m_normalPower = 64.0f;
+
+			// The depth difference relative to the depth and the step
+			float m_depthSigma = 0.05f;
+
+			float m_albedoSigma = 0.1f;
+		};
+
+		/* The missed AOVs are not used, the image and each AOV have the size of width * height.
+		*  The rows are filtered in parallel by the worker threads, the image could be the same vector as the output.
+		*/
+		static void Denoise(const TVector<vec3>& image, const PathTracer::AOVs& aovs, uint32_t width, uint32_t height, const Params& params, TVector<vec3>& outImage);
+	};
+}
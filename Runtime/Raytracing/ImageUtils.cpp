@@ -0,0 +1,438 @@
+#include "ImageUtils.h"
+#include "Tasks/Scheduler.h"
+#include "Core/LogMacros.h"
+#include "Core/Utils.h"
+#include "glm/glm/glm.hpp"
+
+#include "stb/stb_image.h"
+
+#ifndef STB_IMAGE_WRITE_IMPLEMENTATION
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#if defined(_WIN32)
+#define __STDC_LIB_EXT1__
+#endif
+#include "stb/stb_image_write.h"
+#endif
+
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+
+using namespace Sailor;
+using namespace Sailor::Raytracing;
+
+namespace
+{
+	const uint32_t ExrMagic = 20000630;
+	const uint32_t ExrVersion = 2;
+	const int32_t ExrPixelTypeFloat = 2;
+	const uint32_t ExrZipScanlines = 16;
+
+	template<typename T>
+	__forceinline void Append(TVector<uint8_t>& out, const T& value)
+	{
+		out.AddRange(reinterpret_cast<const uint8_t*>(&value), sizeof(T));
+	}
+
+	__forceinline void AppendString(TVector<uint8_t>& out, const std::string& str)
+	{
+		out.AddRange(reinterpret_cast<const uint8_t*>(str.c_str()), str.length() + 1);
+	}
+
+	void AppendAttribute(TVector<uint8_t>& out, const char* name, const char* type, const void* pValue, uint32_t size)
+	{
+		AppendString(out, name);
+		AppendString(out, type);
+		Append(out, size);
+		out.AddRange(reinterpret_cast<const uint8_t*>(pValue), size);
+	}
+
+	/* The bytes of the block are split into the even and the odd ones and then delta encoded,
+	*  that is how OpenEXR prepares the data for zlib.
+	*/
+	void EncodeZipBlock(const uint8_t* pRaw, size_t size, TVector<uint8_t>& outTmp)
+	{
+		outTmp.Clear(false);
+		outTmp.AddDefault(size);
+
+		uint8_t* t1 = outTmp.GetData();
+		uint8_t* t2 = outTmp.GetData() + (size + 1) / 2;
+
+		for (size_t i = 0; i < size; i++)
+		{
+			if ((i & 1) == 0)
+			{
+				*t1++ = pRaw[i];
+			}
+			else
+			{
+				*t2++ = pRaw[i];
+			}
+		}
+
+		int32_t p = outTmp[0];
+		for (size_t i = 1; i < size; i++)
+		{
+			const int32_t d = int32_t(outTmp[i]) - p + (128 + 256);
+			p = outTmp[i];
+			outTmp[i] = (uint8_t)d;
+		}
+	}
+
+	void DecodeZipBlock(const uint8_t* pEncoded, size_t size, uint8_t* pOutRaw)
+	{
+		TVector<uint8_t> tmp;
+		tmp.AddRange(pEncoded, size);
+
+		for (size_t i = 1; i < size; i++)
+		{
+			tmp[i] = (uint8_t)(int32_t(tmp[i - 1]) + int32_t(tmp[i]) - 128);
+		}
+
+		const uint8_t* t1 = tmp.GetData();
+		const uint8_t* t2 = tmp.GetData() + (size + 1) / 2;
+
+		for (size_t i = 0; i < size; i++)
+		{
+			pOutRaw[i] = (i & 1) == 0 ? *t1++ : *t2++;
+		}
+	}
+
+	template<typename T>
+	bool Read(const TVector<uint8_t>& data, size_t& offset, T& outValue)
+	{
+		if (offset + sizeof(T) > data.Num())
+		{
+			return false;
+		}
+
+		memcpy(&outValue, data.GetData() + offset, sizeof(T));
+		offset += sizeof(T);
+		return true;
+	}
+
+	bool ReadString(const TVector<uint8_t>& data, size_t& offset, std::string& outStr)
+	{
+		const uint8_t* pBegin = data.GetData() + offset;
+		const uint8_t* pEnd = data.GetData() + data.Num();
+		const uint8_t* pZero = std::find(pBegin, pEnd, 0);
+
+		if (pZero == pEnd)
+		{
+			return false;
+		}
+
+		outStr.assign(reinterpret_cast<const char*>(pBegin), pZero - pBegin);
+		offset += outStr.length() + 1;
+		return true;
+	}
+}
+
+bool Raytracing::WritePNG(const std::filesystem::path& filepath, const TVector<vec3>& image, uint32_t width, uint32_t height)
+{
+	SAILOR_PROFILE_FUNCTION();
+
+	TVector<u8vec3> outSrgb(width * height);
+	for (uint32_t i = 0; i < width * height; i++)
+	{
+		outSrgb[i] = glm::clamp(Utils::LinearToSRGB(image[i]) * 255.0f, 0.0f, 255.0f);
+	}
+
+	const uint32_t Channels = 3;
+	if (!stbi_write_png(filepath.string().c_str(), width, height, Channels, &outSrgb[0], width * Channels))
+	{
+		SAILOR_LOG_ERROR("Cannot write the image %s", filepath.string().c_str());
+		return false;
+	}
+
+	return true;
+}
+
+bool Raytracing::WriteHDR(const std::filesystem::path& filepath, const float* pData, uint32_t numComponents, uint32_t width, uint32_t height)
+{
+	SAILOR_PROFILE_FUNCTION();
+
+	if (!stbi_write_hdr(filepath.string().c_str(), width, height, numComponents, pData))
+	{
+		SAILOR_LOG_ERROR("Cannot write the image %s", filepath.string().c_str());
+		return false;
+	}
+
+	return true;
+}
+
+bool Raytracing::WriteEXR(const std::filesystem::path& filepath, const TVector<ImageChannel>& channels, uint32_t width, uint32_t height, EExrCompression compression)
+{
+	SAILOR_PROFILE_FUNCTION();
+
+	check(width > 0 && height > 0 && channels.Num() > 0);
+
+	// The channels are stored in the alphabetical order
+	TVector<const ImageChannel*> sorted;
+	for (const auto& channel : channels)
+	{
+		sorted.Add(&channel);
+	}
+	std::sort(sorted.begin(), sorted.end(), [](const ImageChannel* lhs, const ImageChannel* rhs) { return lhs->m_name < rhs->m_name; });
+
+	TVector<uint8_t> header;
+	Append(header, ExrMagic);
+	Append(header, ExrVersion);
+
+	TVector<uint8_t> chlist;
+	for (const auto& pChannel : sorted)
+	{
+		AppendString(chlist, pChannel->m_name);
+		Append(chlist, ExrPixelTypeFloat);
+		Append(chlist, (uint32_t)0); // pLinear and the reserved bytes
+		Append(chlist, (int32_t)1);
+		Append(chlist, (int32_t)1);
+	}
+	chlist.Add(0);
+
+	const int32_t window[4] = { 0, 0, (int32_t)width - 1, (int32_t)height - 1 };
+	const uint8_t compressionValue = (uint8_t)compression;
+	const uint8_t lineOrder = 0;
+	const float pixelAspectRatio = 1.0f;
+	const float screenWindowCenter[2] = { 0.0f, 0.0f };
+	const float screenWindowWidth = 1.0f;
+
+	AppendAttribute(header, "channels", "chlist", chlist.GetData(), (uint32_t)chlist.Num());
+	AppendAttribute(header, "compression", "compression", &compressionValue, 1);
+	AppendAttribute(header, "dataWindow", "box2i", window, sizeof(window));
+	AppendAttribute(header, "displayWindow", "box2i", window, sizeof(window));
+	AppendAttribute(header, "lineOrder", "lineOrder", &lineOrder, 1);
+	AppendAttribute(header, "pixelAspectRatio", "float", &pixelAspectRatio, sizeof(float));
+	AppendAttribute(header, "screenWindowCenter", "v2f", screenWindowCenter, sizeof(screenWindowCenter));
+	AppendAttribute(header, "screenWindowWidth", "float", &screenWindowWidth, sizeof(float));
+	header.Add(0);
+
+	const uint32_t linesPerChunk = compression == EExrCompression::Zip ? ExrZipScanlines : 1;
+	const uint32_t numChunks = (height + linesPerChunk - 1) / linesPerChunk;
+
+	TVector<uint8_t> chunks;
+	TVector<uint64_t> offsets;
+	TVector<uint8_t> raw;
+	TVector<uint8_t> tmp;
+
+	offsets.Reserve(numChunks);
+
+	const uint64_t chunksOffset = header.Num() + numChunks * sizeof(uint64_t);
+
+	for (uint32_t chunk = 0; chunk < numChunks; chunk++)
+	{
+		const uint32_t y0 = chunk * linesPerChunk;
+		const uint32_t y1 = std::min(height, y0 + linesPerChunk);
+
+		// Each line contains all the channels one after another
+		raw.Clear(false);
+		for (uint32_t y = y0; y < y1; y++)
+		{
+			for (const auto& pChannel : sorted)
+			{
+				for (uint32_t x = 0; x < width; x++)
+				{
+					Append(raw, pChannel->m_data[(size_t)(y * width + x) * pChannel->m_stride]);
+				}
+			}
+		}
+
+		const uint8_t* pData = raw.GetData();
+		int32_t dataSize = (int32_t)raw.Num();
+		uint8_t* pCompressed = nullptr;
+
+		if (compression == EExrCompression::Zip)
+		{
+			EncodeZipBlock(raw.GetData(), raw.Num(), tmp);
+
+			int32_t compressedSize = 0;
+			pCompressed = stbi_zlib_compress(tmp.GetData(), (int32_t)tmp.Num(), &compressedSize, stbi_write_png_compression_level);
+
+			if (pCompressed && compressedSize < dataSize)
+			{
+				pData = pCompressed;
+				dataSize = compressedSize;
+			}
+		}
+
+		offsets.Add(chunksOffset + chunks.Num());
+		Append(chunks, (int32_t)y0);
+		Append(chunks, dataSize);
+		chunks.AddRange(pData, dataSize);
+
+		STBIW_FREE(pCompressed);
+	}
+
+	std::ofstream file(filepath, std::ios::binary | std::ios::trunc);
+	file.write(reinterpret_cast<const char*>(header.GetData()), header.Num());
+	file.write(reinterpret_cast<const char*>(offsets.GetData()), offsets.Num() * sizeof(uint64_t));
+	file.write(reinterpret_cast<const char*>(chunks.GetData()), chunks.Num());
+
+	if (!file)
+	{
+		SAILOR_LOG_ERROR("Cannot write the image %s", filepath.string().c_str());
+		return false;
+	}
+
+	return true;
+}
+
+bool Raytracing::ReadEXR(const std::filesystem::path& filepath, TVector<std::string>& outNames, TVector<TVector<float>>& outChannels, uint32_t& outWidth, uint32_t& outHeight)
+{
+	SAILOR_PROFILE_FUNCTION();
+
+	std::ifstream file(filepath, std::ios::binary | std::ios::ate);
+	if (!file)
+	{
+		return false;
+	}
+
+	TVector<uint8_t> data;
+	data.AddDefault((size_t)file.tellg());
+	file.seekg(0);
+	file.read(reinterpret_cast<char*>(data.GetData()), data.Num());
+
+	size_t offset = 0;
+	uint32_t magic = 0;
+	uint32_t version = 0;
+
+	if (!Read(data, offset, magic) || !Read(data, offset, version) || magic != ExrMagic || version != ExrVersion)
+	{
+		SAILOR_LOG_ERROR("%s is not the scanline OpenEXR", filepath.string().c_str());
+		return false;
+	}
+
+	outNames.Clear();
+	outChannels.Clear();
+
+	EExrCompression compression = EExrCompression::None;
+	int32_t window[4]{};
+
+	for (;;)
+	{
+		std::string name;
+		std::string type;
+		uint32_t size = 0;
+
+		if (!ReadString(data, offset, name))
+		{
+			return false;
+		}
+
+		if (name.empty())
+		{
+			break;
+		}
+
+		if (!ReadString(data, offset, type) || !Read(data, offset, size) || offset + size > data.Num())
+		{
+			return false;
+		}
+
+		const size_t valueOffset = offset;
+
+		if (name == "channels")
+		{
+			std::string channelName;
+			while (ReadString(data, offset, channelName) && !channelName.empty())
+			{
+				int32_t pixelType = 0;
+				Read(data, offset, pixelType);
+				offset += 12;
+
+				if (pixelType != ExrPixelTypeFloat)
+				{
+					SAILOR_LOG_ERROR("%s: only the float channels are supported", filepath.string().c_str());
+					return false;
+				}
+
+				outNames.Add(channelName);
+			}
+		}
+		else if (name == "compression")
+		{
+			compression = (EExrCompression)data[offset];
+		}
+		else if (name == "dataWindow")
+		{
+			memcpy(window, data.GetData() + offset, sizeof(window));
+		}
+
+		offset = valueOffset + size;
+	}
+
+	if (compression != EExrCompression::None && compression != EExrCompression::Zip)
+	{
+		SAILOR_LOG_ERROR("%s: only the uncompressed and ZIP files are supported", filepath.string().c_str());
+		return false;
+	}
+
+	outWidth = window[2] - window[0] + 1;
+	outHeight = window[3] - window[1] + 1;
+
+	const uint32_t numChannels = (uint32_t)outNames.Num();
+	outChannels.Resize(numChannels);
+	for (auto& channel : outChannels)
+	{
+		channel.Resize(outWidth * outHeight);
+	}
+
+	const uint32_t linesPerChunk = compression == EExrCompression::Zip ? ExrZipScanlines : 1;
+	const uint32_t numChunks = (outHeight + linesPerChunk - 1) / linesPerChunk;
+	const size_t lineSize = (size_t)outWidth * numChannels * sizeof(float);
+
+	TVector<uint8_t> raw;
+	for (uint32_t chunk = 0; chunk < numChunks; chunk++)
+	{
+		uint64_t chunkOffset = 0;
+		size_t tableOffset = offset + chunk * sizeof(uint64_t);
+		if (!Read(data, tableOffset, chunkOffset))
+		{
+			return false;
+		}
+
+		size_t pos = (size_t)chunkOffset;
+		int32_t y0 = 0;
+		int32_t dataSize = 0;
+		if (!Read(data, pos, y0) || !Read(data, pos, dataSize) || pos + dataSize > data.Num())
+		{
+			return false;
+		}
+
+		const uint32_t numLines = std::min(linesPerChunk, outHeight - (uint32_t)(y0 - window[1]));
+		const size_t rawSize = lineSize * numLines;
+
+		raw.Clear(false);
+		raw.AddDefault(rawSize);
+
+		if ((size_t)dataSize == rawSize)
+		{
+			memcpy(raw.GetData(), data.GetData() + pos, rawSize);
+		}
+		else
+		{
+			int32_t decodedSize = 0;
+			char* pDecoded = stbi_zlib_decode_malloc(reinterpret_cast<const char*>(data.GetData() + pos), dataSize, &decodedSize);
+
+			if (!pDecoded || (size_t)decodedSize != rawSize)
+			{
+				free(pDecoded);
+				return false;
+			}
+
+			DecodeZipBlock(reinterpret_cast<const uint8_t*>(pDecoded), rawSize, raw.GetData());
+			free(pDecoded);
+		}
+
+		for (uint32_t line = 0; line < numLines; line++)
+		{
+			const uint32_t y = (uint32_t)(y0 - window[1]) + line;
+			for (uint32_t c = 0; c < numChannels; c++)
+			{
+				memcpy(&outChannels[c][(size_t)y * outWidth], raw.GetData() + line * lineSize + c * outWidth * sizeof(float), outWidth * sizeof(float));
+			}
+		}
+	}
+
+	return true;
+}
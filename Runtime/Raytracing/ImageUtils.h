@@ -0,0 +1,40 @@
+#pragma once
+#include "Core/Defines.h"
+#include "Containers/Vector.h"
+
+#include <filesystem>
+#include <string>
+
+using namespace Sailor;
+
+namespace Sailor::Raytracing
+{
+	// The values of the OpenEXR compression attribute
+	enum class EExrCompression : uint8_t
+	{
+		None = 0,
+		Zip = 3
+	};
+
+	// The channel of the float image, m_data[i * m_stride] is the value of the pixel i
+	struct ImageChannel
+	{
+		std::string m_name;
+		const float* m_data = nullptr;
+		uint32_t m_stride = 1;
+	};
+
+	// 8-bit sRGB, the linear color is clamped
+	SAILOR_API bool WritePNG(const std::filesystem::path& filepath, const TVector<vec3>& image, uint32_t width, uint32_t height);
+
+	// Radiance RGBE, the shared exponent keeps 8 bits of the largest component
+	SAILOR_API bool WriteHDR(const std::filesystem::path& filepath, const float* pData, uint32_t numComponents, uint32_t width, uint32_t height);
+
+	/* Single part scanline OpenEXR with 32-bit float channels, the rows go from top to bottom.
+	*  ZIP compresses the blocks of 16 rows, the block that doesn't shrink is stored as is.
+	*/
+	SAILOR_API bool WriteEXR(const std::filesystem::path& filepath, const TVector<ImageChannel>& channels, uint32_t width, uint32_t height, EExrCompression compression);
+
+	// Reads the files that WriteEXR writes, the channels are returned in the file order, i.e. sorted by name
+	SAILOR_API bool ReadEXR(const std::filesystem::path& filepath, TVector<std::string>& outNames, TVector<TVector<float>>& outChannels, uint32_t& outWidth, uint32_t& outHeight);
+}
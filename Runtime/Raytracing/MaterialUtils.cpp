@@ -11,10 +11,146 @@
 
 #include "nlohmann_json/include/nlohmann/json.hpp"
 
+#include <string_view>
+
 using namespace Sailor;
 using namespace Sailor::Math;
 using namespace Sailor::Raytracing;
 
+namespace
+{
+	thread_local Sampler::State t_samplerState{};
+
+	__forceinline uint32_t PcgHash(uint32_t value)
+	{
+		const uint32_t state = value * 747796405u + 2891336453u;
+		const uint32_t word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+		return (word >> 22u) ^ word;
+	}
+
+	__forceinline uint32_t ReverseBits(uint32_t x)
+	{
+		x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+		x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+		x = ((x >> 4) & 0x0F0F0F0Fu) | ((x & 0x0F0F0F0Fu) << 4);
+		x = ((x >> 8) & 0x00FF00FFu) | ((x & 0x00FF00FFu) << 8);
+		return (x >> 16) | (x << 16);
+	}
+
+	/* Owen scrambling by the hash, each bit is flipped depending on the higher bits only.
+	*  Inspired by https://psychopath.io/post/2021_01_30_building_a_better_lk_hash
+	*/
+	__forceinline uint32_t NestedUniformScramble(uint32_t x, uint32_t seed)
+	{
+		x = ReverseBits(x);
+		x ^= x * 0x3d20adeau;
+		x += seed;
+		x *= (seed >> 16) | 1u;
+		x ^= x * 0x05526c56u;
+		x ^= x * 0x53a22864u;
+		return ReverseBits(x);
+	}
+
+	// The first two dimensions of Sobol, the bits of the result are the binary fraction
+	__forceinline uint32_t Sobol0(uint32_t index) { return ReverseBits(index); }
+
+	__forceinline uint32_t Sobol1(uint32_t index)
+	{
+		uint32_t res = 0;
+		for (uint32_t v = 1u << 31; index != 0; index >>= 1, v ^= v >> 1)
+		{
+			if (index & 1)
+			{
+				res ^= v;
+			}
+		}
+		return res;
+	}
+
+	__forceinline float ToFloat(uint32_t value)
+	{
+		// 24 bits are exactly representable
+		return (value >> 8) * (1.0f / 16777216.0f);
+	}
+}
+
+Sampler::State Raytracing::Sampler::MakeState(ESequence sequence, uint32_t seed, uint32_t pixelIndex, uint32_t sampleIndex)
+{
+	State res{};
+	res.m_scramble = PcgHash(seed + PcgHash(pixelIndex));
+	res.m_index = sampleIndex;
+	res.m_sequence = sequence;
+	return res;
+}
+
+Sampler::State Raytracing::Sampler::Split(const State& state, uint32_t subIndex, uint32_t numSubSamples)
+{
+	State res = state;
+
+	// The index doesn't fit 32 bits for the long renders, so the high bits pick the other scrambling of the same points
+	const uint64_t index = (uint64_t)state.m_index * numSubSamples + subIndex;
+	const uint32_t highBits = (uint32_t)(index >> 32);
+
+	res.m_index = (uint32_t)index;
+	if (highBits != 0)
+	{
+		res.m_scramble = PcgHash(state.m_scramble + PcgHash(highBits));
+	}
+
+	return res;
+}
+
+Sampler::State Raytracing::Sampler::Fork(const State& state, uint32_t stream)
+{
+	State res = state;
+	res.m_scramble = PcgHash(state.m_scramble + PcgHash(stream));
+	return res;
+}
+
+void Raytracing::Sampler::SetState(const State& state)
+{
+	t_samplerState = state;
+}
+
+const Sampler::State& Raytracing::Sampler::GetState()
+{
+	return t_samplerState;
+}
+
+float Raytracing::Sampler::Next1D()
+{
+	State& state = t_samplerState;
+	const uint32_t seed = PcgHash(state.m_scramble + PcgHash(state.m_dimension++));
+
+	if (state.m_sequence == ESequence::Random)
+	{
+		return ToFloat(PcgHash(seed + PcgHash(state.m_index)));
+	}
+
+	// The first dimension of Sobol only, that is the scrambled van der Corput sequence
+	const uint32_t index = NestedUniformScramble(state.m_index, seed);
+	return ToFloat(NestedUniformScramble(Sobol0(index), PcgHash(seed + 1)));
+}
+
+vec2 Raytracing::Sampler::Next2D()
+{
+	State& state = t_samplerState;
+	const uint32_t seed = PcgHash(state.m_scramble + PcgHash(state.m_dimension++));
+
+	if (state.m_sequence == ESequence::Random)
+	{
+		const uint32_t x = PcgHash(seed + PcgHash(state.m_index));
+		return vec2(ToFloat(x), ToFloat(PcgHash(x)));
+	}
+
+	// The index is shuffled too, so the pixels don't share the order of the points
+	const uint32_t index = NestedUniformScramble(state.m_index, seed);
+	const uint32_t x = NestedUniformScramble(Sobol0(index), PcgHash(seed + 1));
+	const uint32_t y = NestedUniformScramble(Sobol1(index), PcgHash(seed + 2));
+
+	return vec2(ToFloat(x), ToFloat(y));
+}
+
 uint Raytracing::PackVec3ToByte(vec3 v)
 {
 	vec3 clamped = clamp(v, 0.0f, 1.0f);
@@ -103,13 +239,13 @@ void Raytracing::ProcessMesh_Assimp(aiMesh* mesh, TVector<Triangle>& outScene, c
 		vec4 temp{};
 
 		temp = vec4(tri.m_vertices[0].x, tri.m_vertices[0].y, tri.m_vertices[0].z, 1.0f) * matrix;
-		tri.m_vertices[0] = vec3(temp.xyz) / temp.w;
+		tri.m_vertices[0] = vec3(temp) / temp.w;
 
 		temp = vec4(tri.m_vertices[1].x, tri.m_vertices[1].y, tri.m_vertices[1].z, 1.0f) * matrix;
-		tri.m_vertices[1] = vec3(temp.xyz) / temp.w;
+		tri.m_vertices[1] = vec3(temp) / temp.w;
 
 		temp = vec4(tri.m_vertices[2].x, tri.m_vertices[2].y, tri.m_vertices[2].z, 1.0f) * matrix;
-		tri.m_vertices[2] = vec3(temp.xyz) / temp.w;
+		tri.m_vertices[2] = vec3(temp) / temp.w;
 
 		tri.m_centroid = (tri.m_vertices[0] + tri.m_vertices[1] + tri.m_vertices[2]) * 0.333f;
 
@@ -184,6 +320,61 @@ SAILOR_API mat4 Raytracing::GetWorldTransformMatrix(const aiScene* scene, const
 	return matrix;
 }
 
+namespace
+{
+	template<typename T>
+	__forceinline void HashBytes(size_t& hash, const T* pData, size_t count)
+	{
+		if (pData && count > 0)
+		{
+			HashCombine(hash, std::hash<std::string_view>()(std::string_view(reinterpret_cast<const char*>(pData), sizeof(T) * count)));
+		}
+	}
+
+	void HashNode_Assimp(size_t& hash, const aiNode* node)
+	{
+		HashBytes(hash, &node->mTransformation, 1);
+		HashBytes(hash, node->mMeshes, node->mNumMeshes);
+		HashCombine(hash, node->mNumChildren);
+
+		for (uint32_t i = 0; i < node->mNumChildren; i++)
+		{
+			HashNode_Assimp(hash, node->mChildren[i]);
+		}
+	}
+}
+
+size_t Raytracing::CalculateGeometryHash_Assimp(const aiScene* scene)
+{
+	SAILOR_PROFILE_FUNCTION();
+
+	size_t hash = 0;
+	HashCombine(hash, scene->mNumMeshes);
+
+	for (uint32_t i = 0; i < scene->mNumMeshes; i++)
+	{
+		const aiMesh* mesh = scene->mMeshes[i];
+
+		HashCombine(hash, mesh->mNumVertices, mesh->mNumFaces, mesh->mMaterialIndex);
+
+		HashBytes(hash, mesh->mVertices, mesh->mNumVertices);
+		HashBytes(hash, mesh->mNormals, mesh->mNumVertices);
+		HashBytes(hash, mesh->mTangents, mesh->mNumVertices);
+		HashBytes(hash, mesh->mBitangents, mesh->mNumVertices);
+		HashBytes(hash, mesh->mTextureCoords[0], mesh->mNumVertices);
+		HashBytes(hash, mesh->mTextureCoords[1], mesh->mNumVertices);
+
+		for (uint32_t j = 0; j < mesh->mNumFaces; j++)
+		{
+			HashBytes(hash, mesh->mFaces[j].mIndices, mesh->mFaces[j].mNumIndices);
+		}
+	}
+
+	HashNode_Assimp(hash, scene->mRootNode);
+
+	return hash;
+}
+
 void Raytracing::ProcessNode_Assimp(TVector<Triangle>& outScene, aiNode* node, const aiScene* scene, const glm::mat4& parentMatrix)
 {
 	SAILOR_PROFILE_FUNCTION();
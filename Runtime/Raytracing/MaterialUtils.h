@@ -159,12 +159,56 @@ namespace Sailor::Raytracing
 		BlendMode m_blendMode = BlendMode::Opaque;
 	};
 
+	/* The random numbers of the path depend on the seed, the pixel and the sample only,
+	*  so the image doesn't depend on the threads that trace it and the render could be resumed.
+	*  Each call takes the next dimension of the pixel's sample, the sequence of each dimension is stratified over the samples
+	*  for Sobol and is white noise for Random. The state is thread local, it is set before each camera ray.
+	*/
+	namespace Sampler
+	{
+		enum class ESequence : uint8_t
+		{
+			Random = 0,
+			// Owen scrambled Sobol (0,2)-sequence, each pair of dimensions is scrambled by its own hash
+			Sobol
+		};
+
+		struct State
+		{
+			uint32_t m_scramble = 0;
+			uint32_t m_index = 0;
+			uint32_t m_dimension = 0;
+			ESequence m_sequence = ESequence::Sobol;
+		};
+
+		SAILOR_API State MakeState(ESequence sequence, uint32_t seed, uint32_t pixelIndex, uint32_t sampleIndex);
+
+		/* The loop of numSubSamples at the same path vertex, the sub sample takes the same dimensions
+		*  by the index sampleIndex * numSubSamples + subIndex, so the whole loop is stratified.
+		*  The index that overflows 32 bits changes the scrambling instead.
+		*/
+		SAILOR_API State Split(const State& state, uint32_t subIndex, uint32_t numSubSamples);
+
+		// The independent path from the same vertex, i.e. the ray through the alpha blended surface
+		SAILOR_API State Fork(const State& state, uint32_t stream);
+
+		SAILOR_API void SetState(const State& state);
+		SAILOR_API const State& GetState();
+
+		// In [0, 1), Next1D draws the single stratified dimension, Next2D draws the stratified pair
+		SAILOR_API float Next1D();
+		SAILOR_API vec2 Next2D();
+	}
+
 	SAILOR_API uint PackVec3ToByte(vec3 v);
 	SAILOR_API vec3 UnpackByteToVec3(uint byte);
 
 	SAILOR_API void ProcessNode_Assimp(TVector<Math::Triangle>& outScene, aiNode* node, const aiScene* scene, const glm::mat4& matrix);
 	SAILOR_API void ProcessMesh_Assimp(aiMesh* mesh, TVector<Math::Triangle>& outScene, const aiScene* scene, const glm::mat4& matrix);
 
+	// The hash of everything that ProcessNode_Assimp reads: the node transforms and the mesh data, that is the key of the BVH cache
+	SAILOR_API size_t CalculateGeometryHash_Assimp(const aiScene* scene);
+
 	SAILOR_API mat4 GetWorldTransformMatrix(const aiScene* scene, const char* name);
 
 	SAILOR_API void GenerateTangentBitangent(vec3& outTangent, vec3& outBitangent, const vec3* vert, const vec2* uv);
@@ -220,7 +264,7 @@ namespace Sailor::Raytracing
 				bool bIsHDR = false;
 				if (fileName[0] == '*')
 				{
-					const uint32 texIndex = atoi(&fileName[1]);
+					const uint32_t texIndex = atoi(&fileName[1]);
 					aiTexture* pAITexture = scene->mTextures[texIndex];
 					bIsHDR = LoadTextureData((stbi_uc*)pAITexture->pcData, pAITexture->mWidth);
 				}
@@ -235,11 +279,11 @@ namespace Sailor::Raytracing
 
 				if (bIsHDR)
 				{
-					pTexture->Initialize<T, vec4>((vec4*)pixels, bConvertToLinear, bNormalMap);
+					pTexture->template Initialize<T, vec4>((vec4*)pixels, bConvertToLinear, bNormalMap);
 				}
 				else
 				{
-					pTexture->Initialize<T, u8vec4>((u8vec4*)pixels, bConvertToLinear, bNormalMap);
+					pTexture->template Initialize<T, u8vec4>((u8vec4*)pixels, bConvertToLinear, bNormalMap);
 				}
 
 				if (pixels)
@@ -1,4 +1,5 @@
 ﻿#include "PathTracer.h"
+#include "Denoiser.h"
 #include "Tasks/Scheduler.h"
 #include "Core/LogMacros.h"
 #include "Core/Utils.h"
@@ -10,18 +11,15 @@
 
 #include "stb/stb_image.h"
 
-#ifndef STB_IMAGE_WRITE_IMPLEMENTATION
-#define STB_IMAGE_WRITE_IMPLEMENTATION
-#define __STDC_LIB_EXT1__
-#include "stb/stb_image_write.h"
-#endif 
-
 #include "assimp/scene.h"
 #include "assimp/postprocess.h"
 #include "assimp/Importer.hpp"
 #include "assimp/DefaultLogger.hpp"
 #include "assimp/LogStream.hpp"
 
+#include <fstream>
+#include <algorithm>
+
 using namespace Sailor;
 using namespace Sailor::Math;
 using namespace Sailor::Raytracing;
@@ -49,7 +47,7 @@ std::string GetArgValue(const char** args, int32_t& i, int32_t num)
 	return value;
 }
 
-void PathTracer::ParseParamsFromCommandLineArgs(PathTracer::Params& res, const char** args, int32_t num)
+bool PathTracer::ParseParamsFromCommandLineArgs(PathTracer::Params& res, const char** args, int32_t num)
 {
 	for (int32_t i = 1; i < num; i++)
 	{
@@ -74,10 +72,115 @@ void PathTracer::ParseParamsFromCommandLineArgs(PathTracer::Params& res, const c
 			res.m_msaa = samples <= 32 ? std::min(4u, samples) : 8u;
 			res.m_numSamples = std::max(1u, (uint32_t)std::lround(samples / (float)res.m_msaa));
 		}
+		else if (arg == "--msaa")
+		{
+			res.m_msaa = atoi(GetArgValue(args, i, num).c_str());
+		}
+		else if (arg == "--spp")
+		{
+			res.m_numSamples = atoi(GetArgValue(args, i, num).c_str());
+		}
 		else if (arg == "--bounces")
 		{
 			res.m_numBounces = atoi(GetArgValue(args, i, num).c_str());
 		}
+		else if (arg == "--threads")
+		{
+			res.m_numThreads = atoi(GetArgValue(args, i, num).c_str());
+		}
+		else if (arg == "--adaptive")
+		{
+			res.m_bAdaptiveSampling = true;
+			res.m_adaptiveThreshold = (float)atof(GetArgValue(args, i, num).c_str());
+
+			if (res.m_adaptiveThreshold <= 0.0f)
+			{
+				SAILOR_LOG_ERROR("PathTracer: --adaptive expects the relative error threshold greater than 0");
+				return false;
+			}
+		}
+		else if (arg == "--seed")
+		{
+			res.m_seed = (uint32_t)strtoul(GetArgValue(args, i, num).c_str(), nullptr, 10);
+		}
+		else if (arg == "--sampler")
+		{
+			const std::string sequence = GetArgValue(args, i, num);
+			if (sequence == "sobol")
+			{
+				res.m_sequence = Sampler::ESequence::Sobol;
+			}
+			else if (sequence == "random")
+			{
+				res.m_sequence = Sampler::ESequence::Random;
+			}
+			else
+			{
+				SAILOR_LOG_ERROR("PathTracer: --sampler expects sobol or random, but got '%s'", sequence.c_str());
+				return false;
+			}
+		}
+		else if (arg == "--checkpoint")
+		{
+			res.m_checkpoint = GetArgValue(args, i, num);
+		}
+		else if (arg == "--checkpoint-interval")
+		{
+			res.m_checkpointIntervalSec = atoi(GetArgValue(args, i, num).c_str());
+		}
+		else if (arg == "--preview-interval")
+		{
+			res.m_previewIntervalSec = atoi(GetArgValue(args, i, num).c_str());
+		}
+		else if (arg == "--max-passes")
+		{
+			res.m_maxPasses = atoi(GetArgValue(args, i, num).c_str());
+		}
+		else if (arg == "--denoise")
+		{
+			res.m_bDenoise = true;
+		}
+		else if (arg == "--aovs")
+		{
+			// The comma separated list, i.e. 'albedo,normal'
+			const std::string aovs = GetArgValue(args, i, num);
+			size_t begin = 0;
+			while (begin <= aovs.length())
+			{
+				const size_t end = std::min(aovs.find(',', begin), aovs.length());
+				const std::string aov = aovs.substr(begin, end - begin);
+
+				if (aov == "albedo") { res.m_aovs |= EAOV::Albedo; }
+				else if (aov == "normal") { res.m_aovs |= EAOV::Normal; }
+				else if (aov == "depth") { res.m_aovs |= EAOV::Depth; }
+				else if (aov == "samples") { res.m_aovs |= EAOV::SampleCount; }
+				else if (aov == "all") { res.m_aovs |= EAOV::All; }
+				else
+				{
+					SAILOR_LOG_ERROR("PathTracer: unknown AOV '%s', expected albedo, normal, depth, samples or all", aov.c_str());
+					return false;
+				}
+
+				begin = end + 1;
+			}
+		}
+		else if (arg == "--exr-compression")
+		{
+			const std::string compression = GetArgValue(args, i, num);
+			if (compression == "none")
+			{
+				res.m_exrCompression = EExrCompression::None;
+			}
+			else if (compression == "zip")
+			{
+				res.m_exrCompression = EExrCompression::Zip;
+			}
+			else
+			{
+				SAILOR_LOG_ERROR("PathTracer: --exr-compression expects none or zip, but got '%s'", compression.c_str());
+				return false;
+			}
+		}
 		else if (arg == "--camera")
 		{
 			res.m_camera = GetArgValue(args, i, num);
@@ -85,25 +188,76 @@ void PathTracer::ParseParamsFromCommandLineArgs(PathTracer::Params& res, const c
 		else if (arg == "--ambient")
 		{
 			const std::string& hexStr = GetArgValue(args, i, num);
+			if (hexStr.length() != 6 || hexStr.find_first_not_of("0123456789abcdefABCDEF") != std::string::npos)
+			{
+				SAILOR_LOG_ERROR("PathTracer: --ambient expects the hex color RRGGBB, but got '%s'", hexStr.c_str());
+				return false;
+			}
+
 			const int32_t r = std::stoi(hexStr.substr(0, 2), nullptr, 16);
 			const int32_t g = std::stoi(hexStr.substr(2, 2), nullptr, 16);
 			const int32_t b = std::stoi(hexStr.substr(4, 2), nullptr, 16);
 
 			res.m_ambient = glm::vec3(r / 255.0f, g / 255.0f, b / 255.0f);
 		}
+		else
+		{
+			SAILOR_LOG_ERROR("PathTracer: unknown argument '%s'", arg.c_str());
+			return false;
+		}
 	}
+
+	if (res.m_height == 0 || res.m_msaa == 0 || res.m_numSamples == 0)
+	{
+		SAILOR_LOG_ERROR("PathTracer: height, msaa and samples should be greater than 0");
+		return false;
+	}
+
+	return true;
 }
 
-void PathTracer::Run(const PathTracer::Params& params)
+void PathTracer::PrintUsage(const char* executableName)
+{
+	SAILOR_LOG("Usage: %s --in <scene.glb> [options]\n"
+		"  --out <image.png>   Output image, .hdr and .exr keep the linear color\n"
+		"  --aovs <list>       albedo,normal,depth,samples or all, written to .exr channels or <out>.<aov>.hdr\n"
+		"  --exr-compression <none|zip>  zip by default\n"
+		"  --denoise           Filter the image guided by the albedo, the normals and the depth, the previews are denoised too\n"
+		"  --camera <name>     Camera node, the first camera by default\n"
+		"  --height <pixels>   Image height, the width is calculated by the camera's aspect ratio\n"
+		"  --msaa <num>        Camera rays per pixel, the average if the sampling is adaptive\n"
+		"  --spp <num>         Secondary samples per hit\n"
+		"  --samples <num>     Total samples per pixel, that are split between msaa and spp\n"
+		"  --adaptive <error>  Stop the pixel at that relative error and trace the noisy tiles more, 0.02 is fine\n"
+		"  --bounces <num>     Max bounces\n"
+		"  --ambient <RRGGBB>  Ambient color in hex\n"
+		"  --seed <num>        Seed of the random sequences, the same seed renders the same image\n"
+		"  --sampler <sobol|random>  Owen scrambled Sobol by default, random is the white noise\n"
+		"  --checkpoint <file> Resume from the file if it is made with the same params and write it periodically\n"
+		"  --checkpoint-interval <sec>  300 by default\n"
+		"  --preview-interval <sec>     Write <out>.preview.png periodically\n"
+		"  --max-passes <num>  Stop after the passes and write the checkpoint\n"
+		"  --threads <num>     Worker threads, all cores by default", executableName);
+}
+
+bool PathTracer::Run(const PathTracer::Params& params)
 {
 	SAILOR_PROFILE_FUNCTION();
 
 	//EASY_PROFILER_ENABLE
 
+	m_stats = Stats{};
+
 	Utils::Timer raytracingTimer;
 	raytracingTimer.Start();
 
+	// The materials, the textures and the lights are loaded after the BVH, so the import time is accumulated
+	Utils::Timer importTimer;
+	importTimer.Start();
+
 	const uint32_t GroupSize = 32;
+	const uint32_t PacketWidth = 4;
+	const uint32_t PacketHeight = BVH::MaxPacketSize / PacketWidth;
 
 	Assimp::Importer importer;
 
@@ -136,8 +290,8 @@ void PathTracer::Run(const PathTracer::Params& params)
 
 	if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
 	{
-		SAILOR_LOG("%s", importer.GetErrorString());
-		return;
+		SAILOR_LOG_ERROR("PathTracer cannot import %s: %s", params.m_pathToModel.string().c_str(), importer.GetErrorString());
+		return false;
 	}
 
 	ensure(scene->HasCameras(), "Scene %s has no Cameras!", params.m_pathToModel.string().c_str());
@@ -156,8 +310,9 @@ void PathTracer::Run(const PathTracer::Params& params)
 
 	// View
 	int32_t cameraIndex = 0;
-	if (scene->HasCameras())
+	if (!params.m_camera.empty())
 	{
+		cameraIndex = -1;
 		for (uint32_t i = 0; i < scene->mNumCameras; i++)
 		{
 			if (std::strcmp(params.m_camera.c_str(), scene->mCameras[i]->mName.C_Str()) == 0)
@@ -167,6 +322,16 @@ void PathTracer::Run(const PathTracer::Params& params)
 			}
 		}
 
+		if (cameraIndex < 0)
+		{
+			SAILOR_LOG_ERROR("PathTracer: camera '%s' is not found in %s", params.m_camera.c_str(), params.m_pathToModel.string().c_str());
+			m_stats.m_bIsCameraMissed = true;
+			return false;
+		}
+	}
+
+	if (scene->HasCameras())
+	{
 		const auto& aiCamera = scene->mCameras[cameraIndex];
 
 		mat4 matrix = GetWorldTransformMatrix(scene, scene->mCameras[cameraIndex]->mName.C_Str());
@@ -175,7 +340,7 @@ void PathTracer::Run(const PathTracer::Params& params)
 		::memcpy(&cameraPos, &aiCamera->mPosition, sizeof(float) * 3);
 
 		const vec4 translation = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f) * matrix;
-		cameraPos = vec3(translation.xyz) / translation.w;
+		cameraPos = vec3(translation) / translation.w;
 		cameraUp = glm::normalize(glm::vec3(glm::vec4(cameraUp, 0.0f) * matrix));
 		cameraForward = glm::normalize(glm::vec3(glm::vec4(cameraForward, 0.0f) * matrix));
 	}
@@ -198,14 +363,37 @@ void PathTracer::Run(const PathTracer::Params& params)
 
 	const auto cameraRight = normalize(cross(cameraForward, cameraUp));
 
-	uint32_t expectedNumFaces = 0;
-	for (uint32_t i = 0; i < scene->mNumMeshes; i++)
+	importTimer.Stop();
+
+	// The triangles are processed and the BVH is built only if the geometry is changed, otherwise the cached BVH is mapped
+	Utils::Timer bvhTimer;
+	bvhTimer.Start();
+
+	const size_t geometryHash = CalculateGeometryHash_Assimp(scene);
+	const std::filesystem::path bvhCacheFilepath = BVH::GetCacheFilepath(geometryHash);
+
+	BVH bvh;
+	const bool bIsBVHCached = bvh.LoadCache(bvhCacheFilepath, geometryHash);
+	if (!bIsBVHCached)
 	{
-		expectedNumFaces += scene->mMeshes[i]->mNumFaces;
+		uint32_t expectedNumFaces = 0;
+		for (uint32_t i = 0; i < scene->mNumMeshes; i++)
+		{
+			expectedNumFaces += scene->mMeshes[i]->mNumFaces;
+		}
+
+		TVector<Math::Triangle> triangles;
+		triangles.Reserve(expectedNumFaces);
+		ProcessNode_Assimp(triangles, scene->mRootNode, scene, glm::mat4(1.0f));
+
+		bvh.BuildBVH(triangles);
+		bvh.SaveCache(bvhCacheFilepath, geometryHash);
 	}
 
-	m_triangles.Reserve(expectedNumFaces);
-	ProcessNode_Assimp(m_triangles, scene->mRootNode, scene, glm::mat4(1.0f));
+	bvh.Collapse(BVH::DefaultWideLayout);
+	bvhTimer.Stop();
+
+	importTimer.Start();
 
 	{
 		TVector<Tasks::ITaskPtr> loadTexturesTasks;
@@ -435,12 +623,25 @@ void PathTracer::Run(const PathTracer::Params& params)
 		m_directionalLights.Add(defaultLight);
 	}*/
 
-	BVH bvh((uint32_t)m_triangles.Num());
-	bvh.BuildBVH(m_triangles);
+	importTimer.Stop();
+
+	m_stats.m_importMs = importTimer.ResultAccumulatedMs();
+	m_stats.m_bvhMs = bvhTimer.ResultMs();
+
+	SAILOR_LOG("PathTracer startup: %lldms, BVH of %u triangles is %s in %lldms",
+		raytracingTimer.ResultMs(), bvh.GetNumTriangles(), bIsBVHCached ? "loaded from cache" : "built", bvhTimer.ResultMs());
+
+	Utils::Timer traceTimer;
+	traceTimer.Start();
 
 	SAILOR_PROFILE_BLOCK("Viewport Calcs");
 
-	TVector<vec3> output(width * height);
+	m_image = TVector<vec3>(width * height);
+	m_imageWidth = width;
+	m_imageHeight = height;
+	m_aovs = AOVs{};
+
+	TVector<vec3>& output = m_image;
 
 	float h = tan(vFov / 2);
 	const float ViewportHeight = 2.0f * h;
@@ -460,359 +661,1074 @@ void PathTracer::Run(const PathTracer::Params& params)
 	SAILOR_PROFILE_END_BLOCK();
 	// Raytracing
 	{
-		SAILOR_PROFILE_BLOCK("Prepare raytracing tasks");
+		const uint32_t numTilesX = (width + GroupSize - 1) / GroupSize;
+		const uint32_t numTilesY = (height + GroupSize - 1) / GroupSize;
 
-		TVector<Tasks::ITaskPtr> tasks;
-		TVector<Tasks::ITaskPtr> tasksThisThread;
+		const bool bAdaptive = params.m_bAdaptiveSampling;
+		const uint32_t maxPixelSamples = bAdaptive ? params.m_msaa * AdaptiveMaxSamplesFactor : params.m_msaa;
 
-		std::atomic<uint32_t> finishedTasks = 0;
-		const uint32_t numTasks = (height * width) / (GroupSize * GroupSize);
+		// The pixels are stored by the output index, each tile is traced by the only task at once
+		TVector<PixelAccumulator> pixels(width * height);
+		TVector<TileState> tiles(numTilesX * numTilesY);
 
-		tasks.Reserve(numTasks);
-		tasksThisThread.Reserve(numTasks / 32);
-
-		for (uint32_t y = 0; y < height; y += GroupSize)
-		{
-			for (uint32_t x = 0; x < width; x += GroupSize)
+		// Traces numSamples more camera rays to each unconverged pixel of the tile and updates the convergence
+		auto traceTile = [&](uint32_t x, uint32_t y, uint32_t numSamples)
 			{
-				auto task = Tasks::CreateTask("Calculate raytracing",
-					[=,
-					&finishedTasks,
-					&output,
-					&bvh,
-					this]() mutable
+#ifdef _DEBUG
+				uint32_t debugX = 500;
+				uint32_t debugY = height - 300 - 1;
+
+				if (!(x < debugX && (x + GroupSize) > debugX &&
+					y < debugY && (y + GroupSize) > debugY))
+				{
+					return;
+				}
+#endif
+				TileState& tile = tiles[(y / GroupSize) * numTilesX + x / GroupSize];
+				tile.m_numUnconvergedPixels = 0;
+
+				const uint32_t numLights = (uint32_t)m_directionalLights.Num();
+				TVector<bool> lightsVisibility(BVH::MaxPacketSize * numLights);
+
+				const bool bHasAOVs = params.m_aovs != EAOV::None || params.m_bDenoise;
+
+				// The neighbour pixels are traced by the packets of camera rays and the packets of shadow rays to the directional lights
+				for (uint32_t v = 0; (v < GroupSize) && (y + v) < height; v += PacketHeight)
+				{
+					for (uint32_t u = 0; u < GroupSize && (u + x) < width; u += PacketWidth)
 					{
-						Ray ray;
-						ray.SetOrigin(cameraPos);
+						SAILOR_PROFILE_BLOCK("Raycasting");
 
-#ifdef _DEBUG
-						uint32_t debugX = 500;
-						uint32_t debugY = height - 300 - 1;
+						uint32_t numPixels = 0;
+						uvec2 packetPixels[BVH::MaxPacketSize];
+						PixelAccumulator* accumulators[BVH::MaxPacketSize];
+						uint32_t samplesBefore[BVH::MaxPacketSize];
+						uint32_t pixelIndices[BVH::MaxPacketSize];
 
-						if (!(x < debugX && (x + GroupSize) > debugX &&
-							y < debugY && (y + GroupSize) > debugY))
+						// The converged pixels leave the packet
+						for (uint32_t pv = 0; pv < PacketHeight && (y + v + pv) < height; pv++)
 						{
-							return;
+							for (uint32_t pu = 0; pu < PacketWidth && (x + u + pu) < width; pu++)
+							{
+								const uvec2 pixel = uvec2(x + u + pu, y + v + pv);
+								const uint32_t pixelIndex = (height - pixel.y - 1) * width + pixel.x;
+								PixelAccumulator& accumulator = pixels[pixelIndex];
+								if (!accumulator.m_bIsConverged)
+								{
+									packetPixels[numPixels] = pixel;
+									pixelIndices[numPixels] = pixelIndex;
+									samplesBefore[numPixels] = accumulator.m_numSamples;
+									accumulators[numPixels++] = &accumulator;
+								}
+							}
 						}
-#endif
-						for (uint32_t v = 0; (v < GroupSize) && (y + v) < height; v++)
+#ifdef _DEBUG
+						for (uint32_t i = 0; i < numPixels; i++)
 						{
-							const float tv = (y + v) / (float)height;
-							for (uint32_t u = 0; u < GroupSize && (u + x) < width; u++)
+							if (packetPixels[i].x == debugX && packetPixels[i].y == debugY)
 							{
-								SAILOR_PROFILE_BLOCK("Raycasting");
+								volatile uint32_t a = 0;
+							}
+						}
+#endif
+						for (uint32_t sample = 0; sample < numSamples; sample++)
+						{
+							Ray rays[BVH::MaxPacketSize];
+							RaycastHit hits[BVH::MaxPacketSize]{};
+							uint32_t rayPixels[BVH::MaxPacketSize];
+							Sampler::State raySamplerStates[BVH::MaxPacketSize];
+							uint32_t numRays = 0;
 
-								const uint32_t index = (height - (y + v) - 1) * width + (x + u);
-								const float tu = (x + u) / (float)width;
-#ifdef _DEBUG
-								if ((x + u) == debugX && ((y + v) == debugY))
+							for (uint32_t i = 0; i < numPixels; i++)
+							{
+								const uint32_t pixelSample = samplesBefore[i] + sample;
+								if (pixelSample >= maxPixelSamples)
 								{
-									volatile uint32_t a = 0;
+									continue;
 								}
-#endif
-								vec3 accumulator = vec3(0);
-								for (uint32_t sample = 0; sample < params.m_msaa; sample++)
+
+								// The path continues the sequence that has jittered the camera ray
+								Sampler::SetState(Sampler::MakeState(params.m_sequence, params.m_seed, pixelIndices[i], pixelSample));
+
+								const vec2 offset = Sampler::Next2D();
+								const vec3 pixelDir = _pixel00Dir + ((float)packetPixels[i].x + offset.x) * _pixelDeltaU + ((float)packetPixels[i].y - offset.y) * _pixelDeltaV;
+
+								rayPixels[numRays] = i;
+								raySamplerStates[numRays] = Sampler::GetState();
+								rays[numRays++] = Ray(cameraPos, glm::normalize(pixelDir));
+							}
+
+							if (numRays == 0)
+							{
+								break;
+							}
+
+							const uint32_t hitMask = bvh.IntersectPacket(rays, numRays, hits);
+
+							if (numLights > 0)
+							{
+								TraceShadowPackets(rays, hits, hitMask, numRays, bvh, lightsVisibility.GetData());
+							}
+
+							for (uint32_t i = 0; i < numRays; i++)
+							{
+								Sampler::SetState(raySamplerStates[i]);
+
+								const bool bHasHit = (hitMask & (1u << i)) != 0;
+								const vec3 radiance = bHasHit ?
+									Shade(rays[i], hits[i], bvh, params.m_numBounces, params, 1.0f, numLights > 0 ? &lightsVisibility[i * numLights] : nullptr) :
+									params.m_ambient;
+
+								accumulators[rayPixels[i]]->Add(radiance);
+
+								// The missed ray sees the ambient and has no normal
+								if (bHasAOVs)
 								{
-									const vec2 offset = sample == 0 ? vec2(0.5f, 0.5f) : glm::linearRand(vec2(0, 0), vec2(1.0f, 1.0f));
-									const vec3 pixelDir = _pixel00Dir + ((float)(u + x) + offset.x) * _pixelDeltaU + ((float)(y + v) - offset.y) * _pixelDeltaV;
+									vec3 albedo = params.m_ambient;
+									vec3 normal = vec3(0);
+									float depth = std::numeric_limits<float>::max();
 
-									ray.SetDirection(glm::normalize(pixelDir));
+									if (bHasHit)
+									{
+										GetPrimaryAOVs(rays[i], hits[i], bvh, albedo, normal);
+										depth = hits[i].m_rayLenght;
+									}
 
-									accumulator += Raytrace(ray, bvh, params.m_numBounces, (uint32_t)(-1), params, 1.0f);
+									accumulators[rayPixels[i]]->AddAOVs(albedo, normal, depth);
 								}
-
-								output[index] = accumulator / (float)params.m_msaa;
-								SAILOR_PROFILE_END_BLOCK();
 							}
 						}
 
-						finishedTasks++;
+						for (uint32_t i = 0; i < numPixels; i++)
+						{
+							PixelAccumulator& accumulator = *accumulators[i];
+							accumulator.m_bIsConverged = accumulator.m_numSamples >= maxPixelSamples ||
+								(bAdaptive && accumulator.m_numSamples >= AdaptiveMinSamples && accumulator.GetRelativeError() < params.m_adaptiveThreshold);
+
+							tile.m_numUnconvergedPixels += accumulator.m_bIsConverged ? 0 : 1;
+							tile.m_numSamples += accumulator.m_numSamples - samplesBefore[i];
 
-					}, Tasks::EThreadType::Worker);
+							output[(height - packetPixels[i].y - 1) * width + packetPixels[i].x] = accumulator.GetMean();
+						}
 
-				if (((x + y) / GroupSize) % 32 == 0)
+						SAILOR_PROFILE_END_BLOCK();
+					}
+				}
+			};
+
+		// The unconverged tiles are traced by the worker tasks, each 32th task (or each one if the only thread is requested) is executed on the main thread
+		auto traceTiles = [&](const TVector<uvec2>& tilesToTrace, uint32_t numSamples)
+			{
+				SAILOR_PROFILE_BLOCK("Prepare raytracing tasks");
+
+				TVector<Tasks::ITaskPtr> tasks;
+				TVector<Tasks::ITaskPtr> tasksThisThread;
+
+				tasks.Reserve(tilesToTrace.Num());
+				tasksThisThread.Reserve(tilesToTrace.Num() / 32);
+
+				for (const auto& tile : tilesToTrace)
 				{
-					tasksThisThread.Emplace(task);
+					const uint32_t x = tile.x * GroupSize;
+					const uint32_t y = tile.y * GroupSize;
+
+					auto task = Tasks::CreateTask("Calculate raytracing",
+						[=, &traceTile]() mutable
+						{
+							traceTile(x, y, numSamples);
+
+						}, Tasks::EThreadType::Worker);
+
+					if (params.m_numThreads == 1 || ((x + y) / GroupSize) % 32 == 0)
+					{
+						tasksThisThread.Emplace(task);
+					}
+					else
+					{
+						task->Run();
+						tasks.Emplace(std::move(task));
+					}
 				}
-				else
+				SAILOR_PROFILE_END_BLOCK();
+
+				SAILOR_PROFILE_BLOCK("Calcs on Main thread");
+				for (auto& task : tasksThisThread)
 				{
-					task->Run();
-					tasks.Emplace(std::move(task));
+					task->Execute();
 				}
+				SAILOR_PROFILE_END_BLOCK();
+
+				SAILOR_PROFILE_BLOCK("Wait all calcs");
+				for (auto& task : tasks)
+				{
+					task->Wait();
+				}
+				SAILOR_PROFILE_END_BLOCK();
+			};
+
+		/* The budget is m_msaa per pixel, the uniform sampling spends it by the progressive passes.
+		*  The adaptive sampling splits the samples that the converged pixels don't take between the unconverged tiles pass by pass.
+		*/
+		const uint64_t budget = (uint64_t)width * height * params.m_msaa;
+		const size_t paramsHash = CalculateParamsHash(params, geometryHash);
+
+		uint32_t numPasses = 0;
+		if (!params.m_checkpoint.empty() && LoadCheckpoint(params.m_checkpoint, paramsHash, width, height, numPasses, pixels, tiles))
+		{
+			for (uint32_t i = 0; i < width * height; i++)
+			{
+				output[i] = pixels[i].GetMean();
 			}
+
+			SAILOR_LOG("PathTracer is resumed from %s after %u passes", params.m_checkpoint.string().c_str(), numPasses);
 		}
-		SAILOR_PROFILE_END_BLOCK();
 
-		SAILOR_PROFILE_BLOCK("Calcs on Main thread");
-		float lastPrg = 0.0f;
-		float eta = 0.0f;
-		for (auto& task : tasksThisThread)
+		Utils::Timer checkpointTimer;
+		Utils::Timer previewTimer;
+		checkpointTimer.Start();
+		previewTimer.Start();
+
+		TVector<uvec2> tilesToTrace;
+		tilesToTrace.Reserve(numTilesX * numTilesY);
+
+		float lastProgress = 0.0f;
+		bool bIsEtaLogged = false;
+
+		for (;;)
 		{
-			task->Execute();
+			uint64_t usedSamples = 0;
+			uint64_t numUnconvergedPixels = (uint64_t)width * height;
+
+			tilesToTrace.Clear(false);
+			if (numPasses == 0)
+			{
+				for (uint32_t y = 0; y < numTilesY; y++)
+				{
+					for (uint32_t x = 0; x < numTilesX; x++)
+					{
+						tilesToTrace.Emplace(uvec2(x, y));
+					}
+				}
+			}
+			else
+			{
+				numUnconvergedPixels = 0;
+				for (uint32_t i = 0; i < tiles.Num(); i++)
+				{
+					usedSamples += tiles[i].m_numSamples;
+					numUnconvergedPixels += tiles[i].m_numUnconvergedPixels;
+
+					if (tiles[i].m_numUnconvergedPixels > 0)
+					{
+						tilesToTrace.Emplace(uvec2(i % numTilesX, i / numTilesX));
+					}
+				}
+
+				const float progress = std::min(1.0f, usedSamples / (float)budget);
+				if (progress - lastProgress > 0.05f)
+				{
+					if (!bIsEtaLogged)
+					{
+						const float eta = traceTimer.ResultMs() * (1.0f / progress - 1.0f) * 0.001f;
+						SAILOR_LOG("PathTracer ETA: ~%.2fsec (%.2fmin)", eta, round(eta / 60.0f));
+						bIsEtaLogged = true;
+					}
 
-			const float progress = finishedTasks.load() / (float)numTasks;
+					SAILOR_LOG("PathTracer Progress: %.2f", progress);
+					lastProgress = progress;
+				}
+			}
 
-			if (progress - lastPrg > 0.05f)
+			if (numUnconvergedPixels == 0 || (bAdaptive && usedSamples >= budget))
 			{
-				if (eta == 0.0f)
+				if (bAdaptive)
 				{
-					eta = raytracingTimer.ResultAccumulatedMs() * 20.0f * 0.001f * 1.5f;
-					SAILOR_LOG("PathTracer ETA: ~%.2fsec (%.2fmin)", eta, round(eta / 60.0f));
+					SAILOR_LOG("PathTracer adaptive sampling: %u passes, %.2f samples per pixel, %.2f%% pixels unconverged",
+						numPasses, usedSamples / (float)(width * height), 100.0f * numUnconvergedPixels / (float)(width * height));
 				}
+				break;
+			}
 
-				SAILOR_LOG("PathTracer Progress: %.2f", progress);
-				lastPrg = progress;
+			if (params.m_maxPasses > 0 && numPasses >= params.m_maxPasses)
+			{
+				m_stats.m_bIsInterrupted = true;
+				break;
 			}
-		}
-		SAILOR_PROFILE_END_BLOCK();
 
-		SAILOR_PROFILE_BLOCK("Wait all calcs");
-		for (auto& task : tasks)
-		{
-			if (!task->IsFinished())
+			uint32_t numSamples = std::min(bAdaptive ? AdaptiveMinSamples : ProgressivePassSamples, params.m_msaa);
+			if (bAdaptive && numPasses > 0)
 			{
-				task->Wait();
+				numSamples = (uint32_t)std::clamp<uint64_t>((budget - usedSamples) / numUnconvergedPixels, 1, std::max(AdaptiveMinSamples, params.m_msaa));
+
+				SAILOR_LOG("PathTracer adaptive pass %u: %u tiles, %llu unconverged pixels, +%u samples",
+					numPasses, (uint32_t)tilesToTrace.Num(), numUnconvergedPixels, numSamples);
+			}
 
-				const float progress = finishedTasks.load() / (float)numTasks;
-				if (progress - lastPrg > 0.05f)
+			traceTiles(tilesToTrace, numSamples);
+			numPasses++;
+
+			if (!params.m_checkpoint.empty() && checkpointTimer.ResultMs() >= params.m_checkpointIntervalSec * 1000ll)
+			{
+				SaveCheckpoint(params.m_checkpoint, paramsHash, width, height, numPasses, pixels, tiles);
+				checkpointTimer.Start();
+			}
+
+			if (!params.m_output.empty() && params.m_previewIntervalSec > 0 && previewTimer.ResultMs() >= params.m_previewIntervalSec * 1000ll)
+			{
+				if (params.m_bDenoise)
 				{
-					SAILOR_LOG("PathTracer Progress: %.2f", progress);
-					lastPrg = progress;
+					AOVs features{};
+					TVector<vec3> denoised;
+					ResolveAOVs(pixels, DenoiserAOVs, features);
+					Denoiser::Denoise(output, features, width, height, Denoiser::Params{}, denoised);
+
+					WriteImage(GetPreviewFilepath(params.m_output), denoised, AOVs{}, width, height, params.m_exrCompression);
+				}
+				else
+				{
+					WriteImage(GetPreviewFilepath(params.m_output), output, AOVs{}, width, height, params.m_exrCompression);
 				}
+				previewTimer.Start();
 			}
 		}
-		SAILOR_PROFILE_END_BLOCK();
-	}
 
-	raytracingTimer.Stop();
-	//profiler::dumpBlocksToFile("test_profile.prof");
+		m_stats.m_numPasses = numPasses;
 
-	SAILOR_PROFILE_BLOCK("Write Image");
-	{
-		TVector<u8vec3> outSrgb(width * height);
-		for (uint32_t i = 0; i < width * height; i++)
+		ResolveAOVs(pixels, params.m_aovs, m_aovs);
+
+		if (params.m_bDenoise)
 		{
-			outSrgb[i] = glm::clamp(Utils::LinearToSRGB(output[i]) * 255.0f, 0.0f, 255.0f);
+			Utils::Timer denoiseTimer;
+			denoiseTimer.Start();
+
+			AOVs features{};
+			ResolveAOVs(pixels, DenoiserAOVs, features);
+			Denoiser::Denoise(output, features, width, height, Denoiser::Params{}, output);
+
+			denoiseTimer.Stop();
+			m_stats.m_denoiseMs = denoiseTimer.ResultMs();
 		}
 
-		const uint32_t Channels = 3;
-		if (!stbi_write_png(params.m_output.string().c_str(), width, height, Channels, &outSrgb[0], width * Channels))
+		// The interrupted render is continued by the next run with the same params
+		if (m_stats.m_bIsInterrupted && !params.m_checkpoint.empty())
 		{
-			SAILOR_LOG("Raytracing WriteImage error");
+			SaveCheckpoint(params.m_checkpoint, paramsHash, width, height, numPasses, pixels, tiles);
 		}
 	}
+
+	traceTimer.Stop();
+	m_stats.m_traceMs = traceTimer.ResultMs() - m_stats.m_denoiseMs;
+	//profiler::dumpBlocksToFile("test_profile.prof");
+
+	Utils::Timer writeTimer;
+	writeTimer.Start();
+
+	bool bIsImageWritten = true;
+
+	// The image is only kept in memory if the output is not set, the interrupted render is written as the preview
+	SAILOR_PROFILE_BLOCK("Write Image");
+	if (!params.m_output.empty())
+	{
+		bIsImageWritten = m_stats.m_bIsInterrupted ?
+			WriteImage(GetPreviewFilepath(params.m_output), output, AOVs{}, width, height, params.m_exrCompression) :
+			WriteImage(params.m_output, output, m_aovs, width, height, params.m_exrCompression);
+	}
+
+	if (bIsImageWritten && !m_stats.m_bIsInterrupted && !params.m_checkpoint.empty())
+	{
+		std::error_code error;
+		std::filesystem::remove(params.m_checkpoint, error);
+	}
 	SAILOR_PROFILE_END_BLOCK();
 
-	char msg[2048];
-	if (raytracingTimer.ResultMs() > 10000.0f)
+	writeTimer.Stop();
+	m_stats.m_writeMs = writeTimer.ResultMs();
+
+	raytracingTimer.Stop();
+
+	SAILOR_LOG("PathTracer %ux%u, msaa %u, spp %u, bounces %u: import %lldms, BVH %lldms, trace %lldms, denoise %lldms, write %lldms, total %lldms%s",
+		width, height, params.m_msaa, params.m_numSamples, params.m_numBounces,
+		m_stats.m_importMs, m_stats.m_bvhMs, m_stats.m_traceMs, m_stats.m_denoiseMs, m_stats.m_writeMs, raytracingTimer.ResultMs(),
+		m_stats.m_bIsInterrupted ? ", interrupted" : "");
+
+	return bIsImageWritten;
+}
+
+void PathTracer::ResolveAOVs(const TVector<PixelAccumulator>& pixels, uint32_t aovMask, AOVs& outAOVs)
+{
+	SAILOR_PROFILE_FUNCTION();
+
+	outAOVs = AOVs{};
+	if (aovMask == EAOV::None)
 	{
-		sprintf_s(msg, "Time in sec: %.2f", (float)raytracingTimer.ResultMs() * 0.001f);
-		MessageBoxA(0, msg, msg, 0);
+		return;
 	}
 
-	::system(params.m_output.string().c_str());
+	const size_t numPixels = pixels.Num();
+	if (aovMask & EAOV::Albedo) { outAOVs.m_albedo = TVector<vec3>(numPixels); }
+	if (aovMask & EAOV::Normal) { outAOVs.m_normal = TVector<vec3>(numPixels); }
+	if (aovMask & EAOV::Depth) { outAOVs.m_depth = TVector<float>(numPixels); }
+	if (aovMask & EAOV::SampleCount) { outAOVs.m_sampleCount = TVector<float>(numPixels); }
+
+	// The pixels that haven't been traced yet have no samples, so their AOVs stay zero
+	for (size_t i = 0; i < numPixels; i++)
+	{
+		const PixelAccumulator& pixel = pixels[i];
+		const float invNumSamples = pixel.m_numSamples > 0 ? 1.0f / pixel.m_numSamples : 0.0f;
+
+		if (outAOVs.m_albedo.Num()) { outAOVs.m_albedo[i] = pixel.m_albedoSum * invNumSamples; }
+		if (outAOVs.m_normal.Num())
+		{
+			const float length = glm::length(pixel.m_normalSum);
+			outAOVs.m_normal[i] = length > 0.0f ? pixel.m_normalSum / length : vec3(0);
+		}
+		if (outAOVs.m_depth.Num()) { outAOVs.m_depth[i] = pixel.m_depth < std::numeric_limits<float>::max() ? pixel.m_depth : 0.0f; }
+		if (outAOVs.m_sampleCount.Num()) { outAOVs.m_sampleCount[i] = (float)pixel.m_numSamples; }
+	}
 }
 
-vec3 PathTracer::Raytrace(const Math::Ray& ray, const BVH& bvh, uint32_t bounceLimit, uint32_t ignoreTriangle, const PathTracer::Params& params, float environmentIor) const
+std::filesystem::path PathTracer::GetPreviewFilepath(const std::filesystem::path& output)
+{
+	// The preview is always 8-bit, it is only to look at
+	std::filesystem::path res = output;
+	res.replace_extension(".preview.png");
+	return res;
+}
+
+bool PathTracer::WriteImage(const std::filesystem::path& filepath, const TVector<vec3>& image, const AOVs& aovs, uint32_t width, uint32_t height, EExrCompression exrCompression)
 {
 	SAILOR_PROFILE_FUNCTION();
 
-	uint32_t randSeedX = glm::linearRand(0, 680);
-	uint32_t randSeedY = glm::linearRand(0, 680);
+	std::string extension = filepath.extension().string();
+	std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
 
-	vec3 res = vec3(0);
-	RaycastHit hit;
+	const bool bHasAOVs = aovs.m_albedo.Num() || aovs.m_normal.Num() || aovs.m_depth.Num() || aovs.m_sampleCount.Num();
 
-	if (bvh.IntersectBVH(ray, hit, 0, std::numeric_limits<float>().max(), ignoreTriangle))
+	bool bIsWritten = true;
+	if (extension == ".exr")
 	{
-		SAILOR_PROFILE_BLOCK("Sampling");
+		// The channels are named as the layers of OpenEXR, so the viewers group them
+		TVector<ImageChannel> channels;
+		channels.Add({ "R", &image[0].x, 3 });
+		channels.Add({ "G", &image[0].y, 3 });
+		channels.Add({ "B", &image[0].z, 3 });
 
-		const bool bIsFirstIntersection = bounceLimit == params.m_numBounces;
+		if (aovs.m_albedo.Num())
+		{
+			channels.Add({ "albedo.R", &aovs.m_albedo[0].x, 3 });
+			channels.Add({ "albedo.G", &aovs.m_albedo[0].y, 3 });
+			channels.Add({ "albedo.B", &aovs.m_albedo[0].z, 3 });
+		}
 
-		const Math::Triangle& tri = m_triangles[hit.m_triangleIndex];
+		if (aovs.m_normal.Num())
+		{
+			channels.Add({ "normal.X", &aovs.m_normal[0].x, 3 });
+			channels.Add({ "normal.Y", &aovs.m_normal[0].y, 3 });
+			channels.Add({ "normal.Z", &aovs.m_normal[0].z, 3 });
+		}
 
-		vec3 faceNormal = vec3(hit.m_barycentricCoordinate.x * tri.m_normals[0] + hit.m_barycentricCoordinate.y * tri.m_normals[1] + hit.m_barycentricCoordinate.z * tri.m_normals[2]);
-		const vec3 tangent = vec3(hit.m_barycentricCoordinate.x * tri.m_tangent[0] + hit.m_barycentricCoordinate.y * tri.m_tangent[1] + hit.m_barycentricCoordinate.z * tri.m_tangent[2]);
-		const vec3 bitangent = vec3(hit.m_barycentricCoordinate.x * tri.m_bitangent[0] + hit.m_barycentricCoordinate.y * tri.m_bitangent[1] + hit.m_barycentricCoordinate.z * tri.m_bitangent[2]);
+		if (aovs.m_depth.Num())
+		{
+			channels.Add({ "Z", &aovs.m_depth[0], 1 });
+		}
 
-		const bool bIsOppositeRay = dot(faceNormal, ray.GetDirection()) < 0.0f;
-		if (!bIsOppositeRay)
+		if (aovs.m_sampleCount.Num())
 		{
-			faceNormal *= -1.0f;
+			channels.Add({ "samples", &aovs.m_sampleCount[0], 1 });
 		}
 
-		const mat3 tbn(tangent, bitangent, faceNormal);
+		bIsWritten = WriteEXR(filepath, channels, width, height, exrCompression);
+	}
+	else if (extension == ".hdr")
+	{
+		auto getAOVFilepath = [&](const char* aov)
+			{
+				std::filesystem::path res = filepath;
+				res.replace_extension(std::string(".") + aov + ".hdr");
+				return res;
+			};
 
-		const vec2 uv = hit.m_barycentricCoordinate.x * tri.m_uvs[0] +
-			hit.m_barycentricCoordinate.y * tri.m_uvs[1] +
-			hit.m_barycentricCoordinate.z * tri.m_uvs[2];
+		bIsWritten = WriteHDR(filepath, &image[0].x, 3, width, height);
 
-		const auto material = m_materials[tri.m_materialIndex];
-		const vec2 uvTransformed = (material.m_uvTransform * vec3(uv, 1));
+		if (aovs.m_albedo.Num()) { bIsWritten &= WriteHDR(getAOVFilepath("albedo"), &aovs.m_albedo[0].x, 3, width, height); }
+		if (aovs.m_normal.Num()) { bIsWritten &= WriteHDR(getAOVFilepath("normal"), &aovs.m_normal[0].x, 3, width, height); }
+		if (aovs.m_depth.Num()) { bIsWritten &= WriteHDR(getAOVFilepath("depth"), aovs.m_depth.GetData(), 1, width, height); }
+		if (aovs.m_sampleCount.Num()) { bIsWritten &= WriteHDR(getAOVFilepath("samples"), aovs.m_sampleCount.GetData(), 1, width, height); }
+	}
+	else
+	{
+		if (bHasAOVs)
+		{
+			SAILOR_LOG("PathTracer: the AOVs are skipped, %s is 8-bit, use .exr or .hdr to write them", filepath.string().c_str());
+		}
 
-		const LightingModel::SampledData sample = GetMaterialData(tri.m_materialIndex, uvTransformed);
-		const vec3 viewDirection = -normalize(ray.GetDirection());
-		const vec3 worldNormal = normalize(tbn * sample.m_normal);
+		bIsWritten = WritePNG(filepath, image, width, height);
+	}
 
-		const bool bHasAlphaBlending = !sample.m_bIsOpaque && sample.m_baseColor.a < 1.0f;
-		const uint32_t numSamples = bHasAlphaBlending ? std::max(1u, (uint32_t)round(sample.m_baseColor.a * (float)params.m_numSamples)) : params.m_numSamples;
+	if (!bIsWritten)
+	{
+		SAILOR_LOG_ERROR("PathTracer cannot write the image %s", filepath.string().c_str());
+	}
 
-		const vec3 offset = 0.000001f * faceNormal;
+	return bIsWritten;
+}
 
-		const bool bFullMetallic = sample.m_orm.z == 1.0f;
-		const bool bHasTransmission = !bFullMetallic && sample.m_transmission > 0.0f;
-		const bool bThickVolume = bHasTransmission && material.m_thicknessFactor > 0.0f;
+size_t PathTracer::CalculateParamsHash(const Params& params, size_t geometryHash)
+{
+	// Only the params that change the image, the output, the threads and the intervals could differ
+	size_t hash = geometryHash;
+	HashCombine(hash, params.m_pathToModel.string(), params.m_camera, params.m_height, params.m_msaa, params.m_numSamples,
+		params.m_numAmbientSamples, params.m_numBounces, params.m_ambient.x, params.m_ambient.y, params.m_ambient.z,
+		params.m_bAdaptiveSampling, params.m_adaptiveThreshold, params.m_seed, params.m_sequence, params.m_aovs != EAOV::None || params.m_bDenoise);
 
-		SAILOR_PROFILE_END_BLOCK();
+	return hash;
+}
 
-		// Direct lighting
+namespace
+{
+	struct CheckpointHeader
+	{
+		static constexpr uint32_t Magic = 0x43545053; // 'SPTC'
+		static constexpr uint32_t Version = 3;
+
+		uint32_t m_magic = Magic;
+		uint32_t m_version = Version;
+		uint64_t m_paramsHash = 0;
+
+		uint32_t m_sizeOfPixel = 0;
+		uint32_t m_sizeOfTile = 0;
+		uint32_t m_width = 0;
+		uint32_t m_height = 0;
+		uint32_t m_numTiles = 0;
+		uint32_t m_numPasses = 0;
+	};
+
+	/* The checkpoint is written field by field, so the padding of the structs doesn't get into the file
+	*  and the file doesn't depend on the layout of the structs. The sizes are the serialized ones.
+	*/
+	constexpr uint32_t SizeOfHeader = sizeof(uint32_t) * 8 + sizeof(uint64_t);
+	constexpr uint32_t SizeOfPixel = sizeof(float) * 12 + sizeof(uint32_t) + sizeof(uint8_t);
+	constexpr uint32_t SizeOfTile = sizeof(uint64_t) + sizeof(uint32_t);
+
+	// The elements are serialized by the chunks to not double the memory of the accumulated image
+	constexpr size_t NumElementsPerChunk = 64 * 1024;
+
+	template<typename T>
+	__forceinline void WriteField(TVector<uint8_t>& buffer, const T& value)
+	{
+		buffer.AddRange(reinterpret_cast<const uint8_t*>(&value), sizeof(T));
+	}
+
+	__forceinline void WriteField(TVector<uint8_t>& buffer, const vec3& value)
+	{
+		WriteField(buffer, value.x);
+		WriteField(buffer, value.y);
+		WriteField(buffer, value.z);
+	}
+
+	template<typename T>
+	__forceinline void ReadField(const uint8_t*& pData, T& outValue)
+	{
+		::memcpy(&outValue, pData, sizeof(T));
+		pData += sizeof(T);
+	}
+
+	__forceinline void ReadField(const uint8_t*& pData, vec3& outValue)
+	{
+		ReadField(pData, outValue.x);
+		ReadField(pData, outValue.y);
+		ReadField(pData, outValue.z);
+	}
+
+	// Serializes the elements by the chunks, writeElement appends the fields of the element to the buffer
+	template<typename TElement, typename TWriteElement>
+	bool WriteElements(std::ofstream& file, const TVector<TElement>& elements, uint32_t sizeOfElement, TWriteElement writeElement)
+	{
+		TVector<uint8_t> buffer;
+		buffer.Reserve(std::min(elements.Num(), NumElementsPerChunk) * sizeOfElement);
+
+		for (size_t i = 0; i < elements.Num(); i++)
 		{
-			RaycastHit hitLight{};
-			for (uint32_t i = 0; i < m_directionalLights.Num(); i++)
+			writeElement(buffer, elements[i]);
+
+			if (buffer.Num() >= NumElementsPerChunk * sizeOfElement || i + 1 == elements.Num())
 			{
-				SAILOR_PROFILE_BLOCK("Direct lighting");
-				const vec3 toLight = -m_directionalLights[i].m_direction;
-				Ray rayToLight(hit.m_point + offset, toLight);
-				if (!bvh.IntersectBVH(rayToLight, hitLight, 0, std::numeric_limits<float>().max(), hit.m_triangleIndex))
-				{
-					const float angle = max(0.0f, glm::dot(toLight, worldNormal));
-					res += LightingModel::CalculateBRDF(viewDirection, worldNormal, toLight, sample) * m_directionalLights[i].m_intensity * angle;
-				}
-				SAILOR_PROFILE_END_BLOCK();
+				file.write(reinterpret_cast<const char*>(buffer.GetData()), buffer.Num());
+				buffer.Clear(false);
 			}
 		}
 
-		// Ambient lighting
-		if (params.m_ambient.x + params.m_ambient.y + params.m_ambient.z > 0.0f)
-		{
-			// Random ray
-			vec3 ambient1 = vec3(0, 0, 0);
-			const float pdfHemisphere = 1.0f / (Pi * 2.0f);
+		return (bool)file;
+	}
 
-			const uint32_t ambientNumSamples = bIsFirstIntersection ? params.m_numAmbientSamples : 1u;
-			const uint32_t numExtraSamples = bIsFirstIntersection ? numSamples : 1;
+	// readElement reads the fields of the element from the data
+	template<typename TElement, typename TReadElement>
+	bool ReadElements(std::ifstream& file, TVector<TElement>& outElements, uint32_t sizeOfElement, TReadElement readElement)
+	{
+		TVector<uint8_t> buffer(std::min(outElements.Num(), NumElementsPerChunk) * sizeOfElement);
 
-			// Hemisphere sampling loop
-			for (uint32_t i = 0; i < ambientNumSamples; i++)
+		for (size_t i = 0; i < outElements.Num(); i += NumElementsPerChunk)
+		{
+			const size_t numElements = std::min(outElements.Num() - i, NumElementsPerChunk);
+			if (!file.read(reinterpret_cast<char*>(buffer.GetData()), numElements * sizeOfElement))
 			{
-				const vec2 randomSample = NextVec2_BlueNoise(randSeedX, randSeedY);
-				vec3 H = LightingModel::ImportanceSampleHemisphere(randomSample, worldNormal);
-				vec3 toLight = 2.0f * dot(viewDirection, H) * H - viewDirection;
+				return false;
+			}
 
-				RaycastHit hitLight{};
-				Ray rayToLight(hit.m_point + offset, toLight);
-				if (!bvh.IntersectBVH(rayToLight, hitLight, 0, std::numeric_limits<float>().max(), hit.m_triangleIndex))
-				{
-					const float angle = max(0.0f, glm::dot(toLight, worldNormal));
-					ambient1 += glm::clamp((LightingModel::CalculateBRDF(viewDirection, worldNormal, toLight, sample) * params.m_ambient * angle) / pdfHemisphere,
-						vec3(0, 0, 0), vec3(10, 10, 10));
-				}
+			const uint8_t* pData = buffer.GetData();
+			for (size_t j = 0; j < numElements; j++)
+			{
+				readElement(pData, outElements[i + j]);
 			}
-			ambient1 /= (float)ambientNumSamples;
+		}
 
-			// Importance sampling ray
-			vec3 ambient2 = vec3(0, 0, 0);
-			float avgPdfLambert = 0.0f;
+		return true;
+	}
+}
 
-			// Indirect lighting
-			vec3 indirect = vec3(0.0f, 0.0f, 0.0f);
-			float indirectContribution = 0.0f;
+bool PathTracer::SaveCheckpoint(const std::filesystem::path& filepath, size_t paramsHash, uint32_t width, uint32_t height, uint32_t numPasses,
+	const TVector<PixelAccumulator>& pixels, const TVector<TileState>& tiles) const
+{
+	SAILOR_PROFILE_FUNCTION();
 
-			const float toIor = bIsOppositeRay ? sample.m_ior : 1.0f;
+	CheckpointHeader header{};
+	header.m_paramsHash = paramsHash;
+	header.m_sizeOfPixel = SizeOfPixel;
+	header.m_sizeOfTile = SizeOfTile;
+	header.m_width = width;
+	header.m_height = height;
+	header.m_numTiles = (uint32_t)tiles.Num();
+	header.m_numPasses = numPasses;
 
-			// Importance sampling loop
-			for (uint32_t i = 0; i < numExtraSamples; i++)
-			{
-				vec3 term{};
-				float pdf = 0.0f;
-				bool bTransmissionRay = false;
-				vec3 direction = vec3(0);
+	// The previous checkpoint is replaced only when the new one is completely written
+	std::filesystem::path tmpFilepath = filepath;
+	tmpFilepath += ".tmp";
+
+	{
+		std::ofstream file(tmpFilepath, std::ios::binary | std::ios::trunc);
+		if (!file)
+		{
+			SAILOR_LOG_ERROR("PathTracer cannot write the checkpoint %s", tmpFilepath.string().c_str());
+			return false;
+		}
+
+		TVector<uint8_t> buffer;
+		buffer.Reserve(SizeOfHeader);
+
+		WriteField(buffer, header.m_magic);
+		WriteField(buffer, header.m_version);
+		WriteField(buffer, header.m_paramsHash);
+		WriteField(buffer, header.m_sizeOfPixel);
+		WriteField(buffer, header.m_sizeOfTile);
+		WriteField(buffer, header.m_width);
+		WriteField(buffer, header.m_height);
+		WriteField(buffer, header.m_numTiles);
+		WriteField(buffer, header.m_numPasses);
+		check(buffer.Num() == SizeOfHeader);
+
+		file.write(reinterpret_cast<const char*>(buffer.GetData()), buffer.Num());
 
-				const vec2 randomSample = NextVec2_BlueNoise(randSeedX, randSeedY);
-				if (LightingModel::Sample(sample, worldNormal, viewDirection, environmentIor, toIor, term, pdf, bTransmissionRay, direction, randomSample))
+		const bool bIsWritten = file &&
+			WriteElements(file, tiles, SizeOfTile, [](TVector<uint8_t>& outBuffer, const TileState& tile)
 				{
-					float newEnvironmentIor = environmentIor;
+					WriteField(outBuffer, tile.m_numSamples);
+					WriteField(outBuffer, tile.m_numUnconvergedPixels);
+				}) &&
+			WriteElements(file, pixels, SizeOfPixel, [](TVector<uint8_t>& outBuffer, const PixelAccumulator& pixel)
+				{
+					WriteField(outBuffer, pixel.m_sum);
+					WriteField(outBuffer, pixel.m_luminanceSum);
+					WriteField(outBuffer, pixel.m_luminanceSqSum);
+					WriteField(outBuffer, pixel.m_numSamples);
+					WriteField(outBuffer, (uint8_t)pixel.m_bIsConverged);
+					WriteField(outBuffer, pixel.m_albedoSum);
+					WriteField(outBuffer, pixel.m_normalSum);
+					WriteField(outBuffer, pixel.m_depth);
+				});
+
+		if (!bIsWritten)
+		{
+			SAILOR_LOG_ERROR("PathTracer cannot write the checkpoint %s", tmpFilepath.string().c_str());
+			return false;
+		}
+	}
 
-					if (bIsOppositeRay && bTransmissionRay && bThickVolume)
-					{
-						newEnvironmentIor = sample.m_ior;
-					}
-					else if (!bIsOppositeRay && bTransmissionRay && bThickVolume)
-					{
-						newEnvironmentIor = 1.0f;
-					}
+	std::error_code error;
+	std::filesystem::rename(tmpFilepath, filepath, error);
 
-					RaycastHit hitLight{};
-					Ray rayToLight(hit.m_point + ((bTransmissionRay && !bThickVolume) ? -offset : offset), direction);
+	return !error;
+}
 
-					//const bool bIntersected = bvh.IntersectBVH(rayToLight, hitLight, 0, std::numeric_limits<float>().max(), hit.m_triangleIndex);
+bool PathTracer::LoadCheckpoint(const std::filesystem::path& filepath, size_t paramsHash, uint32_t width, uint32_t height, uint32_t& outNumPasses,
+	TVector<PixelAccumulator>& outPixels, TVector<TileState>& outTiles) const
+{
+	SAILOR_PROFILE_FUNCTION();
 
-					if (!bvh.IntersectBVH(rayToLight, hitLight, 0, std::numeric_limits<float>().max(), hit.m_triangleIndex))
-					{
-						vec3 value = glm::clamp(term * params.m_ambient, vec3(0, 0, 0), vec3(10, 10, 10));
+	std::ifstream file(filepath, std::ios::binary);
+	if (!file)
+	{
+		return false;
+	}
 
-						// Ambient lighting
-						ambient2 += value;
-						avgPdfLambert += pdf;
+	uint8_t headerData[SizeOfHeader]{};
+	file.read(reinterpret_cast<char*>(headerData), SizeOfHeader);
+
+	CheckpointHeader header{};
+	const uint8_t* pHeaderData = headerData;
+	ReadField(pHeaderData, header.m_magic);
+	ReadField(pHeaderData, header.m_version);
+	ReadField(pHeaderData, header.m_paramsHash);
+	ReadField(pHeaderData, header.m_sizeOfPixel);
+	ReadField(pHeaderData, header.m_sizeOfTile);
+	ReadField(pHeaderData, header.m_width);
+	ReadField(pHeaderData, header.m_height);
+	ReadField(pHeaderData, header.m_numTiles);
+	ReadField(pHeaderData, header.m_numPasses);
+
+	if (!file ||
+		header.m_magic != CheckpointHeader::Magic ||
+		header.m_version != CheckpointHeader::Version ||
+		header.m_paramsHash != (uint64_t)paramsHash ||
+		header.m_sizeOfPixel != SizeOfPixel ||
+		header.m_sizeOfTile != SizeOfTile ||
+		header.m_width != width ||
+		header.m_height != height ||
+		header.m_numTiles != outTiles.Num())
+	{
+		SAILOR_LOG("PathTracer checkpoint %s is made with the other params, the render starts from scratch", filepath.string().c_str());
+		return false;
+	}
 
-						// Indirect lighting with the correct pdf in case of miss
-						indirect += value;
-					}
-					else if (bounceLimit > 0)
-					{
-						vec3 lightAttenuation = vec3(1, 1, 1);
-						if (bIsOppositeRay && bTransmissionRay && bThickVolume)
-						{
-							const float distance = glm::length(hitLight.m_point - hit.m_point);
-							vec3 attenuationCoefficient = material.m_attenuationDistance / material.m_attenuationColor;
-							lightAttenuation = glm::exp(-distance * attenuationCoefficient);
-						}
+	TVector<TileState> tiles(outTiles.Num());
+	TVector<PixelAccumulator> pixels(outPixels.Num());
 
-						// Indirect lighting with bounces in case of hit
-						indirect += glm::clamp(term * lightAttenuation * Raytrace(rayToLight, bvh, bounceLimit - 1, hit.m_triangleIndex, params, newEnvironmentIor), vec3(0, 0, 0), vec3(10, 10, 10));
-					}
+	const bool bIsRead =
+		ReadElements(file, tiles, SizeOfTile, [](const uint8_t*& pData, TileState& tile)
+			{
+				ReadField(pData, tile.m_numSamples);
+				ReadField(pData, tile.m_numUnconvergedPixels);
+			}) &&
+		ReadElements(file, pixels, SizeOfPixel, [](const uint8_t*& pData, PixelAccumulator& pixel)
+			{
+				uint8_t bIsConverged = 0;
 
-					indirectContribution += 1.0f;
-				}
+				ReadField(pData, pixel.m_sum);
+				ReadField(pData, pixel.m_luminanceSum);
+				ReadField(pData, pixel.m_luminanceSqSum);
+				ReadField(pData, pixel.m_numSamples);
+				ReadField(pData, bIsConverged);
+				ReadField(pData, pixel.m_albedoSum);
+				ReadField(pData, pixel.m_normalSum);
+				ReadField(pData, pixel.m_depth);
+
+				pixel.m_bIsConverged = bIsConverged != 0;
+			});
+
+	if (!bIsRead)
+	{
+		SAILOR_LOG_ERROR("PathTracer checkpoint %s is truncated", filepath.string().c_str());
+		return false;
+	}
+
+	outTiles = std::move(tiles);
+	outPixels = std::move(pixels);
+	outNumPasses = header.m_numPasses;
+
+	return true;
+}
+
+void PathTracer::GetPrimaryAOVs(const Math::Ray& ray, const Math::RaycastHit& hit, const BVH& bvh, vec3& outAlbedo, vec3& outNormal) const
+{
+	const Math::Triangle& tri = bvh.GetTriangle(hit.m_triangleIndex);
+
+	bool bIsOppositeRay = false;
+	const vec3 faceNormal = GetFaceNormal(ray, hit, bvh, bIsOppositeRay);
+	const vec3 tangent = vec3(hit.m_barycentricCoordinate.x * tri.m_tangent[0] + hit.m_barycentricCoordinate.y * tri.m_tangent[1] + hit.m_barycentricCoordinate.z * tri.m_tangent[2]);
+	const vec3 bitangent = vec3(hit.m_barycentricCoordinate.x * tri.m_bitangent[0] + hit.m_barycentricCoordinate.y * tri.m_bitangent[1] + hit.m_barycentricCoordinate.z * tri.m_bitangent[2]);
+
+	const vec2 uv = hit.m_barycentricCoordinate.x * tri.m_uvs[0] +
+		hit.m_barycentricCoordinate.y * tri.m_uvs[1] +
+		hit.m_barycentricCoordinate.z * tri.m_uvs[2];
+
+	const vec2 uvTransformed = (m_materials[tri.m_materialIndex].m_uvTransform * vec3(uv, 1));
+	const LightingModel::SampledData sample = GetMaterialData(tri.m_materialIndex, uvTransformed);
+
+	outAlbedo = vec3(sample.m_baseColor);
+	outNormal = normalize(mat3(tangent, bitangent, faceNormal) * sample.m_normal);
+}
+
+vec3 PathTracer::GetFaceNormal(const Math::Ray& ray, const Math::RaycastHit& hit, const BVH& bvh, bool& bOutIsOppositeRay) const
+{
+	const Math::Triangle& tri = bvh.GetTriangle(hit.m_triangleIndex);
+
+	const vec3 faceNormal = vec3(hit.m_barycentricCoordinate.x * tri.m_normals[0] + hit.m_barycentricCoordinate.y * tri.m_normals[1] + hit.m_barycentricCoordinate.z * tri.m_normals[2]);
+
+	bOutIsOppositeRay = dot(faceNormal, ray.GetDirection()) < 0.0f;
+	return bOutIsOppositeRay ? faceNormal : -faceNormal;
+}
+
+void PathTracer::TraceShadowPackets(const Math::Ray* rays, const Math::RaycastHit* hits, uint32_t hitMask, uint32_t numRays, const BVH& bvh, bool* outLightsVisibility) const
+{
+	SAILOR_PROFILE_FUNCTION();
+
+	const uint32_t numLights = (uint32_t)m_directionalLights.Num();
+
+	Ray shadowRays[BVH::MaxPacketSize];
+	uint32_t ignoreTriangles[BVH::MaxPacketSize];
+	uint32_t rayIndices[BVH::MaxPacketSize];
+
+	for (uint32_t light = 0; light < numLights; light++)
+	{
+		const vec3 toLight = -m_directionalLights[light].m_direction;
+
+		// Only the hit rays make the packet
+		uint32_t numShadowRays = 0;
+		for (uint32_t i = 0; i < numRays; i++)
+		{
+			if (hitMask & (1u << i))
+			{
+				bool bIsOppositeRay = false;
+				shadowRays[numShadowRays] = Ray(hits[i].m_point + 0.000001f * GetFaceNormal(rays[i], hits[i], bvh, bIsOppositeRay), toLight);
+				ignoreTriangles[numShadowRays] = hits[i].m_triangleIndex;
+				rayIndices[numShadowRays++] = i;
 			}
+		}
+
+		if (numShadowRays == 0)
+		{
+			return;
+		}
+
+		RaycastHit shadowHits[BVH::MaxPacketSize]{};
+		const uint32_t occludedMask = bvh.IntersectPacket(shadowRays, numShadowRays, shadowHits, ignoreTriangles, std::numeric_limits<float>().max(), true);
+
+		for (uint32_t i = 0; i < numShadowRays; i++)
+		{
+			outLightsVisibility[rayIndices[i] * numLights + light] = (occludedMask & (1u << i)) == 0;
+		}
+	}
+}
+
+vec3 PathTracer::Raytrace(const Math::Ray& ray, const BVH& bvh, uint32_t bounceLimit, uint32_t ignoreTriangle, const PathTracer::Params& params, float environmentIor) const
+{
+	SAILOR_PROFILE_FUNCTION();
+
+	RaycastHit hit;
+	if (bvh.IntersectBVH(ray, hit, 0, std::numeric_limits<float>().max(), ignoreTriangle))
+	{
+		return Shade(ray, hit, bvh, bounceLimit, params, environmentIor);
+	}
+
+	return params.m_ambient;
+}
+
+vec3 PathTracer::Shade(const Math::Ray& ray, const Math::RaycastHit& hit, const BVH& bvh, uint32_t bounceLimit, const PathTracer::Params& params, float environmentIor, const bool* pLightsVisibility) const
+{
+	SAILOR_PROFILE_FUNCTION();
+
+	// The loops take their own dimensions of the sample, the bounces continue from there
+	const Sampler::State samplerState = Sampler::GetState();
+
+	Sampler::State importanceSamplerState = samplerState;
+	importanceSamplerState.m_dimension++;
+
+	vec3 res = vec3(0);
+
+	SAILOR_PROFILE_BLOCK("Sampling");
+
+	const bool bIsFirstIntersection = bounceLimit == params.m_numBounces;
+
+	const Math::Triangle& tri = bvh.GetTriangle(hit.m_triangleIndex);
+
+	bool bIsOppositeRay = false;
+	const vec3 faceNormal = GetFaceNormal(ray, hit, bvh, bIsOppositeRay);
+	const vec3 tangent = vec3(hit.m_barycentricCoordinate.x * tri.m_tangent[0] + hit.m_barycentricCoordinate.y * tri.m_tangent[1] + hit.m_barycentricCoordinate.z * tri.m_tangent[2]);
+	const vec3 bitangent = vec3(hit.m_barycentricCoordinate.x * tri.m_bitangent[0] + hit.m_barycentricCoordinate.y * tri.m_bitangent[1] + hit.m_barycentricCoordinate.z * tri.m_bitangent[2]);
+
+	const mat3 tbn(tangent, bitangent, faceNormal);
 
-			ambient2 /= (float)numExtraSamples;
-			avgPdfLambert /= (float)numExtraSamples;
+	const vec2 uv = hit.m_barycentricCoordinate.x * tri.m_uvs[0] +
+		hit.m_barycentricCoordinate.y * tri.m_uvs[1] +
+		hit.m_barycentricCoordinate.z * tri.m_uvs[2];
+
+	const auto material = m_materials[tri.m_materialIndex];
+	const vec2 uvTransformed = (material.m_uvTransform * vec3(uv, 1));
+
+	const LightingModel::SampledData sample = GetMaterialData(tri.m_materialIndex, uvTransformed);
+	const vec3 viewDirection = -normalize(ray.GetDirection());
+	const vec3 worldNormal = normalize(tbn * sample.m_normal);
+
+	const bool bHasAlphaBlending = !sample.m_bIsOpaque && sample.m_baseColor.a < 1.0f;
+	const uint32_t numSamples = bHasAlphaBlending ? std::max(1u, (uint32_t)round(sample.m_baseColor.a * (float)params.m_numSamples)) : params.m_numSamples;
+
+	const vec3 offset = 0.000001f * faceNormal;
+
+	const bool bFullMetallic = sample.m_orm.z == 1.0f;
+	const bool bHasTransmission = !bFullMetallic && sample.m_transmission > 0.0f;
+	const bool bThickVolume = bHasTransmission && material.m_thicknessFactor > 0.0f;
+
+	SAILOR_PROFILE_END_BLOCK();
+
+	// Direct lighting
+	{
+		for (uint32_t i = 0; i < m_directionalLights.Num(); i++)
+		{
+			SAILOR_PROFILE_BLOCK("Direct lighting");
+			const vec3 toLight = -m_directionalLights[i].m_direction;
+
+			bool bIsVisible = false;
+			if (pLightsVisibility)
+			{
+				bIsVisible = pLightsVisibility[i];
+			}
+			else
+			{
+				RaycastHit hitLight{};
+				Ray rayToLight(hit.m_point + offset, toLight);
+				bIsVisible = !bvh.IntersectBVH(rayToLight, hitLight, 0, std::numeric_limits<float>().max(), hit.m_triangleIndex);
+			}
 
-			const vec3 ambient = ambient1 + ambient2;
-			if (ambient.x + ambient.y + ambient.z > 0.0f)
+			if (bIsVisible)
 			{
-				const vec3 combinedAmbient = ambient1 * LightingModel::PowerHeuristic(ambientNumSamples, pdfHemisphere, numExtraSamples, avgPdfLambert) +
-					ambient2 * LightingModel::PowerHeuristic(numExtraSamples, avgPdfLambert, ambientNumSamples, pdfHemisphere);
-				res += combinedAmbient;
+				const float angle = max(0.0f, glm::dot(toLight, worldNormal));
+				res += LightingModel::CalculateBRDF(viewDirection, worldNormal, toLight, sample) * m_directionalLights[i].m_intensity * angle;
 			}
+			SAILOR_PROFILE_END_BLOCK();
+		}
+	}
+
+	// Ambient lighting
+	if (params.m_ambient.x + params.m_ambient.y + params.m_ambient.z > 0.0f)
+	{
+		// Random ray
+		vec3 ambient1 = vec3(0, 0, 0);
+		const float pdfHemisphere = 1.0f / (Pi * 2.0f);
+
+		const uint32_t ambientNumSamples = bIsFirstIntersection ? params.m_numAmbientSamples : 1u;
+		const uint32_t numExtraSamples = bIsFirstIntersection ? numSamples : 1;
 
-			if (indirectContribution > 0.0f)
+		// Hemisphere sampling loop
+		for (uint32_t i = 0; i < ambientNumSamples; i++)
+		{
+			Sampler::SetState(Sampler::Split(samplerState, i, ambientNumSamples));
+
+			const vec2 randomSample = Sampler::Next2D();
+			vec3 H = LightingModel::ImportanceSampleHemisphere(randomSample, worldNormal);
+			vec3 toLight = 2.0f * dot(viewDirection, H) * H - viewDirection;
+
+			RaycastHit hitLight{};
+			Ray rayToLight(hit.m_point + offset, toLight);
+			if (!bvh.IntersectBVH(rayToLight, hitLight, 0, std::numeric_limits<float>().max(), hit.m_triangleIndex))
 			{
-				res += (indirect / indirectContribution);
+				const float angle = max(0.0f, glm::dot(toLight, worldNormal));
+				ambient1 += glm::clamp((LightingModel::CalculateBRDF(viewDirection, worldNormal, toLight, sample) * params.m_ambient * angle) / pdfHemisphere,
+					vec3(0, 0, 0), vec3(10, 10, 10));
 			}
 		}
+		ambient1 /= (float)ambientNumSamples;
 
-		res += sample.m_emissive;
+		// Importance sampling ray
+		vec3 ambient2 = vec3(0, 0, 0);
+		float avgPdfLambert = 0.0f;
 
-		// Alpha Blending
-		if (bounceLimit > 0 && bHasAlphaBlending)
+		// Indirect lighting
+		vec3 indirect = vec3(0.0f, 0.0f, 0.0f);
+		float indirectContribution = 0.0f;
+
+		const float toIor = bIsOppositeRay ? sample.m_ior : 1.0f;
+
+		// Importance sampling loop
+		for (uint32_t i = 0; i < numExtraSamples; i++)
 		{
-			Math::Ray newRay{};
-			newRay.SetDirection(ray.GetDirection());
-			newRay.SetOrigin(hit.m_point + ray.GetDirection() * 0.0001f);
+			vec3 term{};
+			float pdf = 0.0f;
+			bool bTransmissionRay = false;
+			vec3 direction = vec3(0);
+
+			Sampler::SetState(Sampler::Split(importanceSamplerState, i, numExtraSamples));
+
+			const vec2 randomSample = Sampler::Next2D();
+			if (LightingModel::Sample(sample, worldNormal, viewDirection, environmentIor, toIor, term, pdf, bTransmissionRay, direction, randomSample))
+			{
+				float newEnvironmentIor = environmentIor;
+
+				if (bIsOppositeRay && bTransmissionRay && bThickVolume)
+				{
+					newEnvironmentIor = sample.m_ior;
+				}
+				else if (!bIsOppositeRay && bTransmissionRay && bThickVolume)
+				{
+					newEnvironmentIor = 1.0f;
+				}
+
+				RaycastHit hitLight{};
+				Ray rayToLight(hit.m_point + ((bTransmissionRay && !bThickVolume) ? -offset : offset), direction);
+
+				//const bool bIntersected = bvh.IntersectBVH(rayToLight, hitLight, 0, std::numeric_limits<float>().max(), hit.m_triangleIndex);
+
+				if (!bvh.IntersectBVH(rayToLight, hitLight, 0, std::numeric_limits<float>().max(), hit.m_triangleIndex))
+				{
+					vec3 value = glm::clamp(term * params.m_ambient, vec3(0, 0, 0), vec3(10, 10, 10));
+
+					// Ambient lighting
+					ambient2 += value;
+					avgPdfLambert += pdf;
 
-			PathTracer::Params p = params;
-			p.m_numBounces = std::max(0u, params.m_numBounces - 1);
-			p.m_numSamples = std::max(1u, params.m_numSamples - numSamples);
+					// Indirect lighting with the correct pdf in case of miss
+					indirect += value;
+				}
+				else if (bounceLimit > 0)
+				{
+					vec3 lightAttenuation = vec3(1, 1, 1);
+					if (bIsOppositeRay && bTransmissionRay && bThickVolume)
+					{
+						const float distance = glm::length(hitLight.m_point - hit.m_point);
+						vec3 attenuationCoefficient = material.m_attenuationDistance / material.m_attenuationColor;
+						lightAttenuation = glm::exp(-distance * attenuationCoefficient);
+					}
+
+					// Indirect lighting with bounces in case of hit
+					indirect += glm::clamp(term * lightAttenuation * Raytrace(rayToLight, bvh, bounceLimit - 1, hit.m_triangleIndex, params, newEnvironmentIor), vec3(0, 0, 0), vec3(10, 10, 10));
+				}
 
-			res = res * sample.m_baseColor.a +
-				Raytrace(newRay, bvh, bounceLimit - 1, hit.m_triangleIndex, p, environmentIor) * (1.0f - sample.m_baseColor.a);
+				indirectContribution += 1.0f;
+			}
+		}
+
+		ambient2 /= (float)numExtraSamples;
+		avgPdfLambert /= (float)numExtraSamples;
+
+		const vec3 ambient = ambient1 + ambient2;
+		if (ambient.x + ambient.y + ambient.z > 0.0f)
+		{
+			const vec3 combinedAmbient = ambient1 * LightingModel::PowerHeuristic(ambientNumSamples, pdfHemisphere, numExtraSamples, avgPdfLambert) +
+				ambient2 * LightingModel::PowerHeuristic(numExtraSamples, avgPdfLambert, ambientNumSamples, pdfHemisphere);
+			res += combinedAmbient;
+		}
+
+		if (indirectContribution > 0.0f)
+		{
+			res += (indirect / indirectContribution);
 		}
 	}
-	else
+
+	res += sample.m_emissive;
+
+	// Alpha Blending
+	if (bounceLimit > 0 && bHasAlphaBlending)
 	{
-		res = params.m_ambient;
+		Math::Ray newRay{};
+		newRay.SetDirection(ray.GetDirection());
+		newRay.SetOrigin(hit.m_point + ray.GetDirection() * 0.0001f);
+
+		PathTracer::Params p = params;
+		p.m_numBounces = std::max(0u, params.m_numBounces - 1);
+		p.m_numSamples = std::max(1u, params.m_numSamples - numSamples);
+
+		Sampler::SetState(Sampler::Fork(samplerState, 1));
+
+		res = res * sample.m_baseColor.a +
+			Raytrace(newRay, bvh, bounceLimit - 1, hit.m_triangleIndex, p, environmentIor) * (1.0f - sample.m_baseColor.a);
 	}
 
 	return res;
@@ -865,153 +1781,3 @@ LightingModel::SampledData PathTracer::GetMaterialData(const size_t& materialInd
 
 	return res;
 }
-
-vec2 PathTracer::NextVec2_Linear()
-{
-	return vec2(glm::linearRand(0.0f, 1.0f), glm::linearRand(0.0f, 1.0f));
-}
-
-vec2 PathTracer::NextVec2_BlueNoise(uint32_t& randSeedX, uint32_t& randSeedY)
-{
-	/*
-	static const vec2 BlueNoiseInDisk[64] = {
-   vec2(0.478712, 0.875764),
-   vec2(-0.337956, -0.793959),
-   vec2(-0.955259, -0.028164),
-   vec2(0.864527, 0.325689),
-   vec2(0.209342, -0.395657),
-   vec2(-0.106779, 0.672585),
-   vec2(0.156213, 0.235113),
-   vec2(-0.413644, -0.082856),
-   vec2(-0.415667, 0.323909),
-   vec2(0.141896, -0.939980),
-   vec2(0.954932, -0.182516),
-   vec2(-0.766184, 0.410799),
-   vec2(-0.434912, -0.458845),
-   vec2(0.415242, -0.078724),
-   vec2(0.728335, -0.491777),
-   vec2(-0.058086, -0.066401),
-   vec2(0.202990, 0.686837),
-   vec2(-0.808362, -0.556402),
-   vec2(0.507386, -0.640839),
-   vec2(-0.723494, -0.229240),
-   vec2(0.489740, 0.317826),
-   vec2(-0.622663, 0.765301),
-   vec2(-0.010640, 0.929347),
-   vec2(0.663146, 0.647618),
-   vec2(-0.096674, -0.413835),
-   vec2(0.525945, -0.321063),
-   vec2(-0.122533, 0.366019),
-   vec2(0.195235, -0.687983),
-   vec2(-0.563203, 0.098748),
-   vec2(0.418563, 0.561335),
-   vec2(-0.378595, 0.800367),
-   vec2(0.826922, 0.001024),
-   vec2(-0.085372, -0.766651),
-   vec2(-0.921920, 0.183673),
-   vec2(-0.590008, -0.721799),
-   vec2(0.167751, -0.164393),
-   vec2(0.032961, -0.562530),
-   vec2(0.632900, -0.107059),
-   vec2(-0.464080, 0.569669),
-   vec2(-0.173676, -0.958758),
-   vec2(-0.242648, -0.234303),
-   vec2(-0.275362, 0.157163),
-   vec2(0.382295, -0.795131),
-   vec2(0.562955, 0.115562),
-   vec2(0.190586, 0.470121),
-   vec2(0.770764, -0.297576),
-   vec2(0.237281, 0.931050),
-   vec2(-0.666642, -0.455871),
-   vec2(-0.905649, -0.298379),
-   vec2(0.339520, 0.157829),
-   vec2(0.701438, -0.704100),
-   vec2(-0.062758, 0.160346),
-   vec2(-0.220674, 0.957141),
-   vec2(0.642692, 0.432706),
-   vec2(-0.773390, -0.015272),
-   vec2(-0.671467, 0.246880),
-   vec2(0.158051, 0.062859),
-   vec2(0.806009, 0.527232),
-   vec2(-0.057620, -0.247071),
-   vec2(0.333436, -0.516710),
-   vec2(-0.550658, -0.315773),
-   vec2(-0.652078, 0.589846),
-   vec2(0.008818, 0.530556),
-   vec2(-0.210004, 0.519896)
-	};*/
-
-	float BlueNoiseData[] = { 0.1025390625, 0.4072265625, 0.6240234375, 0.2763671875, 0.7021484375, 0.3701171875, 0.7666015625, 0.9755859375, 0.4619140625, 0.8173828125, 0.5048828125, 0.3427734375,
-		0.9677734375, 0.7431640625, 0.4287109375, 0.6875, 0.5458984375, 0.19140625, 0.47265625, 0.109375, 0.2578125, 0.509765625, 0.01171875, 0.3232421875, 0.158203125, 0.6904296875, 0.2236328125,
-		0.9375, 0.1396484375, 0.8095703125, 0.4375, 0.568359375, 0.318359375, 0.787109375, 0.8837890625, 0.5234375, 0.14453125, 0.6064453125, 0.2109375, 0.11328125, 0.6865234375, 0.1708984375, 0.8984375,
-		0.0341796875, 0.537109375, 0.1455078125, 0.2802734375, 0.919921875, 0.001953125, 0.3017578125, 0.9736328125, 0.58203125, 0.6943359375, 0.9306640625, 0.767578125, 0.65234375, 0.9091796875, 0.3916015625,
-		0.7568359375, 0.57421875, 0.3525390625, 0.6298828125, 0.1796875, 0.8623046875, 0.7080078125, 0.2080078125, 0.0302734375, 0.4453125, 0.9267578125, 0.79296875, 0.4833984375, 0.8759765625, 0.3759765625,
-		0.599609375, 0.2919921875, 0.7763671875, 0.6279296875, 0.3857421875, 0.7900390625, 0.498046875, 0.6328125, 0.8408203125, 0.7216796875, 0.4150390625, 0.0556640625, 0.208984375, 0.453125, 0.1123046875,
-		0.2509765625, 0.5146484375, 0.095703125, 0.8828125, 0.0400390625, 0.98046875, 0.27734375, 0.478515625, 0.95703125, 0.5771484375, 0.3349609375, 0.734375, 0.23828125, 0.05859375, 0.306640625, 0.5517578125,
-		0.01953125, 0.9609375, 0.4404296875, 0.193359375, 0.8603515625, 0.060546875, 0.9951171875, 0.2138671875, 0.1015625, 0.369140625, 0.142578125, 0.244140625, 0.853515625, 0.62109375, 0.361328125, 0.9814453125,
-		0.587890625, 0.8505859375, 0.310546875, 0.4501953125, 0.7158203125, 0.525390625, 0.662109375, 0.0517578125, 0.40234375, 0.125, 0.9130859375, 0.634765625, 0.3876953125, 0.9833984375, 0.6640625, 0.8193359375,
-		0.25390625, 0.751953125, 0.1171875, 0.673828125, 0.4873046875, 0.3330078125, 0.5634765625, 0.693359375, 0.44921875, 0.77734375, 0.5693359375, 0.91015625, 0.4794921875, 0.7939453125, 0.17578125, 0.74609375, 0.04296875,
-		0.681640625, 0.1484375, 0.80859375, 0.2294921875, 0.376953125, 0.15625, 0.8271484375, 0.2431640625, 0.46875, 0.8076171875, 0.1787109375, 0.5322265625, 0.1103515625, 0.427734375, 0.1640625, 0.6259765625, 0.5107421875,
-		0.3603515625, 0.943359375, 0.2490234375, 0.7548828125, 0.1513671875, 0.8662109375, 0.263671875, 0.958984375, 0.025390625, 0.6767578125, 0.3115234375, 0.0888671875, 0.5478515625, 0.28125, 0.4716796875, 0.3720703125, 0.966796875,
-		0.609375, 0.06640625, 0.923828125, 0.7392578125, 0.6044921875, 0.873046875, 0.6708984375, 0.0205078125, 0.298828125, 0.849609375, 0.7060546875, 0.8896484375, 0.326171875, 0.91796875, 0.0693359375, 0.822265625, 0.5498046875,
-		0.0126953125, 0.9052734375, 0.4130859375, 0.08203125, 0.650390625, 0.337890625, 0.529296875, 0.1611328125, 0.404296875, 0.9521484375, 0.6494140625, 0.89453125, 0.8203125, 0.2041015625, 0.5380859375, 0.2861328125, 0.76953125,
-		0.4990234375, 0.302734375, 0.07421875, 0.34375, 0.5224609375, 0.748046875, 0.435546875, 0.583984375, 0.2265625, 0.0439453125, 0.763671875, 0.45703125, 0.2373046875, 0.6552734375, 0.177734375, 0.703125, 0.3076171875, 0.591796875,
-		0.7978515625, 0.5029296875, 0.2001953125, 0.8876953125, 0.7109375, 0.8310546875, 0.236328125, 0.0078125, 0.4228515625, 0.1240234375, 0.720703125, 0.02734375, 0.869140625, 0.4111328125, 0.1884765625, 0.5673828125, 0.9921875, 0.134765625,
-		0.21484375, 0.90625, 0.0986328125, 0.9638671875, 0.3623046875, 0.5078125, 0.60546875, 0.123046875, 0.98828125, 0.341796875, 0.4345703125, 0.837890625, 0.4853515625, 0.189453125, 0.978515625, 0.046875, 0.7470703125, 0.43359375, 0.0625,
-		0.5966796875, 0.5068359375, 0.7333984375, 0.2880859375, 0.6162109375, 0.9482421875, 0.4541015625, 0.65625, 0.1162109375, 0.8359375, 0.689453125, 0.4326171875, 0.5986328125, 0.828125, 0.3828125, 0.640625, 0.181640625, 0.798828125,
-		0.6787109375, 0.279296875, 0.87109375, 0.53125, 0.71875, 0.041015625, 0.9453125, 0.103515625, 0.677734375, 0.283203125, 0.3740234375, 0.619140625, 0.9423828125, 0.2998046875, 0.365234375, 0.150390625, 0.9990234375, 0.7919921875,
-		0.3583984375, 0.5654296875, 0.224609375, 0.322265625, 0.9345703125, 0.275390625, 0.005859375, 0.7646484375, 0.2529296875, 0.0458984375, 0.7177734375, 0.2724609375, 0.4951171875, 0.015625, 0.9326171875, 0.1591796875, 0.3994140625,
-		0.076171875, 0.7998046875, 0.2958984375, 0.6025390625, 0.38671875, 0.900390625, 0.5302734375, 0.8544921875, 0.130859375, 0.228515625, 0.779296875, 0.865234375, 0.6650390625, 0.072265625, 0.4736328125, 0.1748046875, 0.05078125,
-		0.888671875, 0.7314453125, 0.5830078125, 0.50390625, 0.3642578125, 0.9462890625, 0.53515625, 0.455078125, 0.9716796875, 0.5732421875, 0.876953125, 0.3369140625, 0.4423828125, 0.7353515625, 0.8369140625, 0.6220703125, 0.19921875,
-		0.505859375, 0.1474609375, 0.775390625, 0.216796875, 0.0048828125, 0.705078125, 0.462890625, 0.572265625, 0.0869140625, 0.439453125, 0.5537109375, 0.248046875, 0.8779296875, 0.7001953125, 0.810546875, 0.3798828125, 0.0927734375,
-		0.1826171875, 0.806640625, 0.1083984375, 0.642578125, 0.896484375, 0.33984375, 0.1630859375, 0.0712890625, 0.7587890625, 0.658203125, 0.1044921875, 0.5712890625, 0.24609375, 0.357421875, 0.9501953125, 0.69921875, 0.87890625, 0.4462890625,
-		0.6513671875, 0.3408203125, 0.8125, 0.26953125, 0.9765625, 0.73046875, 0.197265625, 0.931640625, 0.3935546875, 0.6181640625, 0.296875, 0.54296875, 0.4638671875, 0.982421875, 0.7041015625, 0.4267578125, 0.8642578125, 0.1982421875, 0.0849609375,
-		0.6982421875, 0.8154296875, 0.423828125, 0.2099609375, 0.2978515625, 0.9853515625, 0.482421875, 0.037109375, 0.8583984375, 0.419921875, 0.056640625, 0.3134765625, 0.0966796875, 0.5439453125, 0.927734375, 0.111328125, 0.4013671875, 0.6396484375,
-		0.0244140625, 0.3291015625, 0.7861328125, 0.1357421875, 0.0615234375, 0.9560546875, 0.2158203125, 0.013671875, 0.6484375, 0.2568359375, 0.5595703125, 0.3095703125, 0.7529296875, 0.501953125, 0.2666015625, 0.626953125, 0.9365234375, 0.5283203125,
-		0.8525390625, 0.146484375, 0.6103515625, 0.744140625, 0.171875, 0.66015625, 0.578125, 0.7841796875, 0.9970703125, 0.251953125, 0.7373046875, 0.4970703125, 0.185546875, 0.8427734375, 0.513671875, 0.6669921875, 0.4560546875, 0.8486328125, 0.708984375,
-		0.4169921875, 0.5927734375, 0.8251953125, 0.35546875, 0.12890625, 0.9296875, 0.0263671875, 0.4052734375, 0.998046875, 0.564453125, 0.1259765625, 0.3505859375, 0.0009765625, 0.6630859375, 0.390625, 0.8232421875, 0.3193359375, 0.9619140625, 0.265625,
-		0.484375, 0.1494140625, 0.384765625, 0.630859375, 0.033203125, 0.890625, 0.5869140625, 0.2841796875, 0.9189453125, 0.099609375, 0.255859375, 0.5205078125, 0.3173828125, 0.880859375, 0.16015625, 0.73828125, 0.9013671875, 0.517578125, 0.724609375,
-		0.623046875, 0.8349609375, 0.0576171875, 0.220703125, 0.8935546875, 0.7509765625, 0.466796875, 0.7822265625, 0.2412109375, 0.064453125, 0.4580078125, 0.55078125, 0.0224609375, 0.9072265625, 0.69140625, 0.83203125, 0.2021484375, 0.44140625,
-		0.333984375, 0.796875, 0.13671875, 0.373046875, 0.75390625, 0.9541015625, 0.1845703125, 0.646484375, 0.048828125, 0.494140625, 0.2744140625, 0.0771484375, 0.41796875, 0.2333984375, 0.15234375, 0.3544921875, 0.6845703125, 0.4521484375,
-		0.638671875, 0.2822265625, 0.09375, 0.9697265625, 0.5810546875, 0.904296875, 0.71484375, 0.205078125, 0.8017578125, 0.41015625, 0.30078125, 0.08984375, 0.5625, 0.9228515625, 0.6689453125, 0.0498046875, 0.712890625, 0.4599609375, 0.6005859375,
-		0.00390625, 0.5615234375, 0.8037109375, 0.994140625, 0.37890625, 0.5703125, 0.6748046875, 0.791015625, 0.9658203125, 0.4892578125, 0.7734375, 0.9443359375, 0.1650390625, 0.8115234375, 0.3984375, 0.541015625, 0.1923828125, 0.3310546875,
-		0.1298828125, 0.380859375, 0.8798828125, 0.603515625, 0.140625, 0.5126953125, 0.962890625, 0.7197265625, 0.2548828125, 0.1552734375, 0.5390625, 0.974609375, 0.2119140625, 0.86328125, 0.3251953125, 0.412109375, 0.234375, 0.1279296875, 0.7578125,
-		0.921875, 0.18359375, 0.33203125, 0.044921875, 0.59765625, 0.2626953125, 0.52734375, 0.359375, 0.0234375, 0.88671875, 0.732421875, 0.6474609375, 0.8330078125, 0.490234375, 0.6826171875, 0.078125, 0.31640625, 0.7724609375, 0.64453125, 0.0068359375,
-		0.3681640625, 0.4765625, 0.8701171875, 0.4091796875, 0.28515625, 0.6455078125, 0.10546875, 0.7880859375, 0.908203125, 0.7099609375, 0.4609375, 0.30859375, 0.0146484375, 0.6337890625, 0.83984375, 0.4384765625, 0.8720703125, 0.1005859375,
-		0.7412109375, 0.9150390625, 0.5947265625, 0.25, 0.12109375, 0.4248046875, 0.0361328125, 0.939453125, 0.2646484375, 0.5263671875, 0.955078125, 0.4365234375, 0.2392578125, 0.884765625, 0.755859375, 0.107421875, 0.625, 0.8212890625, 0.0751953125,
-		0.76171875, 0.49609375, 0.173828125, 0.5341796875, 0.083984375, 0.611328125, 0.8681640625, 0.5009765625, 0.240234375, 0.544921875, 0.1435546875, 0.669921875, 0.3154296875, 0.431640625, 0.0908203125, 0.68359375, 0.4697265625, 0.9892578125,
-		0.314453125, 0.759765625, 0.595703125, 0.1533203125, 0.7275390625, 0.0478515625, 0.8291015625, 0.1669921875, 0.55859375, 0.3046875, 0.990234375, 0.201171875, 0.3466796875, 0.56640625, 0.953125, 0.39453125, 0.3037109375, 0.671875, 0.97265625,
-		0.3662109375, 0.1953125, 0.6884765625, 0.951171875, 0.771484375, 0.3779296875, 0.986328125, 0.1904296875, 0.560546875, 0.8466796875, 0.29296875, 0.1572265625, 0.814453125, 0.5546875, 0.22265625, 0.400390625, 0.8447265625, 0.32421875,
-		0.615234375, 0.3896484375, 0.6962890625, 0.4658203125, 0.0546875, 0.66796875, 0.5087890625, 0.736328125, 0.0322265625, 0.2314453125, 0.6201171875, 0.875, 0.021484375, 0.2607421875, 0.82421875, 0.0654296875, 0.421875, 0.119140625, 0.294921875,
-		0.029296875, 0.61328125, 0.794921875, 0.0537109375, 0.388671875, 0.947265625, 0.5166015625, 0.0087890625, 0.70703125, 0.9248046875, 0.0830078125, 0.4814453125, 0.9775390625, 0.1943359375, 0.8916015625, 0.1201171875, 0.7802734375, 0.9140625,
-		0.3837890625, 0.1318359375, 0.93359375, 0.4482421875, 0.8388671875, 0.1142578125, 0.7421875, 0.40625, 0.4931640625, 0.5751953125, 0.7607421875, 0.916015625, 0.5244140625, 0.7255859375, 0.8564453125, 0.4921875, 0.2685546875, 0.716796875,
-		0.2177734375, 0.7490234375, 0.62890625, 0.3388671875, 0.447265625, 0.1767578125, 0.7958984375, 0.6533203125, 0.017578125, 0.533203125, 0.267578125, 0.5859375, 0.349609375, 0.212890625, 0.576171875, 0.84765625, 0.2705078125, 0.6806640625,
-		0.3212890625, 0.5185546875, 0.1962890625, 0.90234375, 0.701171875, 0.1328125, 0.232421875, 0.6376953125, 0.34765625, 0.1806640625, 0.4140625, 0.126953125, 0.8974609375, 0.59375, 0.474609375, 0.1064453125, 0.8671875, 0.2470703125, 0.8994140625,
-		0.6015625, 0.3671875, 0.2783203125, 0.7626953125, 0.4189453125, 0.7265625, 0.9599609375, 0.0419921875, 0.81640625, 0.443359375, 0.0673828125, 0.6142578125, 0.169921875, 0.7890625, 0.9873046875, 0.5849609375, 0.0810546875, 0.3125, 0.96875,
-		0.46484375, 0.0029296875, 0.833984375, 0.556640625, 0.9580078125, 0.654296875, 0.3515625, 0.9794921875, 0.1728515625, 0.8056640625, 0.4208984375, 0.0595703125, 0.6953125, 0.09765625, 0.5400390625, 0.94140625, 0.138671875, 0.8515625, 0.091796875,
-		0.4755859375, 0.6416015625, 0.291015625, 0.7236328125, 0.9033203125, 0.3564453125, 0.5, 0.009765625, 0.416015625, 0.26171875, 0.6591796875, 0.841796875, 0.3818359375, 0.78125, 0.287109375, 0.6796875, 0.0791015625, 0.23046875, 0.783203125, 0.0185546875,
-		0.271484375, 0.6728515625, 0.330078125, 0.552734375, 0.970703125, 0.4912109375, 0.818359375, 0.21875, 0.67578125, 0.3447265625, 0.607421875, 0.2216796875, 0.375, 0.92578125, 0.154296875, 0.5361328125, 0.203125, 0.8046875, 0.9287109375, 0.6923828125,
-		0.1416015625, 0.7744140625, 0.4775390625, 0.0380859375, 0.6123046875, 0.1689453125, 0.9404296875, 0.48828125, 0.8955078125, 0.3203125, 0.458984375, 0.546875, 0.4033203125, 0.9169921875, 0.03515625, 0.7294921875, 0.1865234375, 0.3056640625,
-		0.3974609375, 0.8818359375, 0.0283203125, 0.470703125, 0.9912109375, 0.7119140625, 0.548828125, 0.826171875, 0.0166015625, 0.6611328125, 0.392578125, 0.0947265625, 0.2939453125, 0.5791015625, 0.859375, 0.345703125, 0.9384765625, 0.20703125,
-		0.5419921875, 0.7138671875, 0.115234375, 0.396484375, 0.58984375, 0.740234375, 0.1337890625, 0.8740234375, 0.080078125, 0.5908203125, 0.2275390625, 0.85546875, 0.63671875, 0.1181640625, 0.75, 0.521484375, 0.162109375, 0.78515625, 0.2890625,
-		0.052734375, 0.1875, 0.328125, 0.765625, 0.4677734375, 0.984375, 0.7451171875, 0.4443359375, 0.2197265625, 0.515625, 0.0703125, 0.728515625, 0.4306640625, 0.857421875, 0.353515625, 0.2421875, 0.845703125, 0.0634765625, 0.2060546875, 0.6318359375,
-		0.802734375, 0.486328125, 0.7705078125, 0.3486328125, 0.51171875, 0.4296875, 0.935546875, 0.2451171875, 0.6572265625, 0.912109375, 0.408203125, 0.5888671875, 0.861328125, 0.451171875, 0.9111328125, 0.580078125, 0.259765625, 0.1376953125,
-		0.6083984375, 0.0390625, 0.666015625, 0.96484375, 0.166015625, 0.6357421875, 0.2734375, 0.087890625, 0.9931640625, 0.6171875, 0.7685546875, 0.51953125, 0.9208984375, 0.37109375, 0.2587890625, 0.685546875, 0.16796875, 0.99609375, 0.0859375,
-		0.830078125, 0.0, 0.5556640625, 0.3271484375, 0.068359375, 0.2353515625, 0.72265625, 0.1220703125, 0.6435546875, 0.2255859375, 0.0732421875, 0.84375, 0.36328125, 0.892578125, 0.7783203125, 0.3359375, 0.8134765625, 0.3955078125, 0.8857421875,
-		0.5576171875, 0.80078125, 0.48046875, 0.03125, 0.42578125, 0.2900390625, 0.697265625, 0.0107421875, 0.94921875 };
-
-
-	if (randSeedX >= 688)
-	{
-		randSeedX = glm::linearRand(0u, 680u);
-	}
-
-	if (randSeedY >= 688)
-	{
-		randSeedY = glm::linearRand(0u, 680u);
-	}
-
-	vec2 res = vec2(BlueNoiseData[randSeedX++], BlueNoiseData[randSeedY++]);
-
-	return res;
-}
\ No newline at end of file
@@ -7,6 +7,7 @@
 #include "BVH.h"
 #include "MaterialUtils.h"
 #include "LightingModel.h"
+#include "ImageUtils.h"
 
 #include <filesystem>
 
@@ -18,6 +19,17 @@ namespace Sailor::Raytracing
 	{
 	public:
 
+		// The auxiliary buffers of the camera rays' first hits, the denoiser takes them with the color
+		enum EAOV : uint32_t
+		{
+			None = 0,
+			Albedo = 1,
+			Normal = 2,
+			Depth = 4,
+			SampleCount = 8,
+			All = Albedo | Normal | Depth | SampleCount
+		};
+
 		struct Params
 		{
 			std::filesystem::path m_pathToModel;
@@ -29,25 +41,201 @@ namespace Sailor::Raytracing
 			uint32_t m_numBounces;
 			uint32_t m_msaa;
 			vec3 m_ambient;
+
+			// 0 means all worker threads, the value is applied by the scheduler on startup, 1 traces the image on the calling thread only
+			uint32_t m_numThreads = 0;
+
+			/* m_msaa is the average number of camera rays per pixel then, the pixel stops when
+			*  the relative standard error of its luminance is less than the threshold,
+			*  and the saved samples are traced by the unconverged tiles.
+			*/
+			bool m_bAdaptiveSampling = false;
+			float m_adaptiveThreshold = 0.02f;
+
+			// The random sequence of each path depends on the seed, the pixel and the sample only
+			uint32_t m_seed = 0;
+			Sampler::ESequence m_sequence = Sampler::ESequence::Sobol;
+
+			/* The accumulated samples are written to the checkpoint after the pass once the interval is passed,
+			*  the render with the same params resumes from it, the checkpoint is removed when the image is written.
+			*/
+			std::filesystem::path m_checkpoint;
+			uint32_t m_checkpointIntervalSec = 300;
+
+			// The image is written to '<output>.preview.png' after the pass once the interval is passed, 0 means no previews
+			uint32_t m_previewIntervalSec = 0;
+
+			// The render is interrupted after that number of passes in total, 0 means no limit
+			uint32_t m_maxPasses = 0;
+
+			/* The mask of EAOV, the output's extension selects the format:
+			*  .png is 8-bit sRGB without AOVs, .hdr writes each AOV to '<output>.<aov>.hdr', .exr stores them as the channels of the image.
+			*/
+			uint32_t m_aovs = EAOV::None;
+			EExrCompression m_exrCompression = EExrCompression::Zip;
+
+			// The image and the previews are filtered by Denoiser, the AOVs that guide it are accumulated even if they are not written
+			bool m_bDenoise = false;
 		};
 
-		static void ParseParamsFromCommandLineArgs(Params& params, const char** args, int32_t num);
+		// The averages over the camera rays of each pixel, the rows go from top to bottom as in the image
+		struct AOVs
+		{
+			TVector<vec3> m_albedo;
+			// World space shading normal
+			TVector<vec3> m_normal;
+			// The distance to the nearest first hit, 0 if all camera rays have missed
+			TVector<float> m_depth;
+			TVector<float> m_sampleCount;
+		};
 
-		void Run(const Params& params);
+		// The time of each phase of the last Run
+		struct Stats
+		{
+			int64_t m_importMs = 0;
+			int64_t m_bvhMs = 0;
+			int64_t m_traceMs = 0;
+			int64_t m_denoiseMs = 0;
+			int64_t m_writeMs = 0;
+
+			uint32_t m_numPasses = 0;
+
+			// The render has reached m_maxPasses, the checkpoint and the preview are written instead of the image
+			bool m_bIsInterrupted = false;
+
+			// Run has failed since the scene has no camera named Params::m_camera
+			bool m_bIsCameraMissed = false;
+		};
+
+		// Returns false if the argument is unknown or its value is not valid
+		static bool ParseParamsFromCommandLineArgs(Params& params, const char** args, int32_t num);
+		static void PrintUsage(const char* executableName);
+
+		// Returns false if the scene cannot be imported, has no requested camera or the image cannot be written
+		bool Run(const Params& params);
+
+		const Stats& GetStats() const { return m_stats; }
+
+		// The linear color of the last Run, the rows go from top to bottom
+		const TVector<vec3>& GetImage() const { return m_image; }
+		uint32_t GetImageWidth() const { return m_imageWidth; }
+		uint32_t GetImageHeight() const { return m_imageHeight; }
+
+		// Only the buffers that are requested by Params::m_aovs are filled
+		const AOVs& GetAOVs() const { return m_aovs; }
+
+		// The format is selected by the extension, the unknown extension is written as .png
+		static bool WriteImage(const std::filesystem::path& filepath, const TVector<vec3>& image, const AOVs& aovs, uint32_t width, uint32_t height, EExrCompression exrCompression);
 
 	protected:
 
-		static vec2 NextVec2_BlueNoise(uint32_t& randSeedX, uint32_t& randSeedY);
-		__forceinline static vec2 NextVec2_Linear();
+		// The uniform sampling adds that number of samples per pixel each pass
+		static constexpr uint32_t ProgressivePassSamples = 4;
+
+		// The variance is not estimated with less samples
+		static constexpr uint32_t AdaptiveMinSamples = 4;
+
+		// The noisiest pixels take not more than that times m_msaa
+		static constexpr uint32_t AdaptiveMaxSamplesFactor = 8;
+
+		// The dark pixels are compared with that instead of their mean
+		static constexpr float AdaptiveMinLuminance = 0.01f;
+
+		static constexpr uint32_t DenoiserAOVs = EAOV::Albedo | EAOV::Normal | EAOV::Depth;
+
+		struct PixelAccumulator
+		{
+			vec3 m_sum{};
+			float m_luminanceSum = 0.0f;
+			float m_luminanceSqSum = 0.0f;
+			uint32_t m_numSamples = 0;
+			bool m_bIsConverged = false;
+
+			// Are accumulated only if the AOVs are requested
+			vec3 m_albedoSum{};
+			vec3 m_normalSum{};
+			float m_depth = std::numeric_limits<float>::max();
+
+			__forceinline void AddAOVs(const vec3& albedo, const vec3& normal, float depth)
+			{
+				m_albedoSum += albedo;
+				m_normalSum += normal;
+				m_depth = std::min(m_depth, depth);
+			}
+
+			__forceinline void Add(const vec3& radiance)
+			{
+				const float luminance = glm::dot(radiance, vec3(0.2126f, 0.7152f, 0.0722f));
+
+				m_sum += radiance;
+				m_luminanceSum += luminance;
+				m_luminanceSqSum += luminance * luminance;
+				m_numSamples++;
+			}
+
+			__forceinline vec3 GetMean() const { return m_numSamples > 0 ? m_sum / (float)m_numSamples : vec3(0); }
+
+			// The standard error of the mean luminance relative to the mean
+			__forceinline float GetRelativeError() const
+			{
+				const float n = (float)m_numSamples;
+				const float mean = m_luminanceSum / n;
+				const float variance = std::max(0.0f, (m_luminanceSqSum - m_luminanceSum * mean) / (n - 1.0f));
+
+				return sqrt(variance / n) / std::max(mean, AdaptiveMinLuminance);
+			}
+		};
+
+		struct TileState
+		{
+			uint64_t m_numSamples = 0;
+			uint32_t m_numUnconvergedPixels = 0;
+		};
+
+		// Averages the accumulated AOVs of the mask
+		static void ResolveAOVs(const TVector<PixelAccumulator>& pixels, uint32_t aovMask, AOVs& outAOVs);
+
+		static std::filesystem::path GetPreviewFilepath(const std::filesystem::path& output);
+
+		// The checkpoint is valid only for the same scene and the params that change the image
+		static size_t CalculateParamsHash(const Params& params, size_t geometryHash);
+
+		// The sample counts and the seed are the state of the random sequences, so the pixels and the tiles are enough to resume
+		bool SaveCheckpoint(const std::filesystem::path& filepath, size_t paramsHash, uint32_t width, uint32_t height, uint32_t numPasses,
+			const TVector<PixelAccumulator>& pixels, const TVector<TileState>& tiles) const;
+
+		bool LoadCheckpoint(const std::filesystem::path& filepath, size_t paramsHash, uint32_t width, uint32_t height, uint32_t& outNumPasses,
+			TVector<PixelAccumulator>& outPixels, TVector<TileState>& outTiles) const;
 
 		__forceinline LightingModel::SampledData GetMaterialData(const size_t& materialIndex, glm::vec2 uv) const;
 
 		vec3 Raytrace(const Math::Ray& r, const BVH& bvh, uint32_t bounceLimit, uint32_t ignoreTriangle, const Params& params, float environmentIor = 1.0f) const;
 
+		// pLightsVisibility is the visibility of the directional lights that is already traced by the packet of shadow rays, or nullptr
+		vec3 Shade(const Math::Ray& r, const Math::RaycastHit& hit, const BVH& bvh, uint32_t bounceLimit, const Params& params, float environmentIor = 1.0f, const bool* pLightsVisibility = nullptr) const;
+
+		// The base color and the world shading normal of the camera ray's hit
+		void GetPrimaryAOVs(const Math::Ray& r, const Math::RaycastHit& hit, const BVH& bvh, vec3& outAlbedo, vec3& outNormal) const;
+
+		// The interpolated normal that faces the ray
+		__forceinline vec3 GetFaceNormal(const Math::Ray& r, const Math::RaycastHit& hit, const BVH& bvh, bool& bOutIsOppositeRay) const;
+
+		// The primary hits that share the packet trace the shadow rays to each directional light as the packet too
+		void TraceShadowPackets(const Math::Ray* rays, const Math::RaycastHit* hits, uint32_t hitMask, uint32_t numRays, const BVH& bvh, bool* outLightsVisibility) const;
+
 		TVector<DirectionalLight> m_directionalLights{};
-		TVector<Math::Triangle> m_triangles{};
 		TVector<Material> m_materials{};
 		TVector<TSharedPtr<CombinedSampler2D>> m_textures{};
 		TMap<std::string, uint32_t> m_textureMapping{};
+
+		Stats m_stats{};
+
+		TVector<vec3> m_image{};
+		uint32_t m_imageWidth = 0;
+		uint32_t m_imageHeight = 0;
+
+		AOVs m_aovs{};
 	};
+
+	SAILOR_API void RunPathTracerBenchmark();
 }
\ No newline at end of file
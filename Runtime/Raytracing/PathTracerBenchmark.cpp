@@ -0,0 +1,422 @@
+#include "PathTracer.h"
+#include "Denoiser.h"
+#include "Core/LogMacros.h"
+#include "Core/Utils.h"
+#include "glm/glm/glm.hpp"
+#include "stb/stb_image.h"
+
+#include <filesystem>
+
+using namespace Sailor;
+using namespace Sailor::Raytracing;
+
+namespace
+{
+	const uint32_t ReferenceMsaa = 512;
+	const uint32_t Msaa = 16;
+
+	struct RenderResult
+	{
+		TVector<vec3> m_image;
+		PathTracer::AOVs m_aovs;
+		uint32_t m_width = 0;
+		uint32_t m_height = 0;
+		int64_t m_traceMs = 0;
+		bool m_bIsRendered = false;
+		bool m_bIsInterrupted = false;
+	};
+
+	RenderResult Render(const PathTracer::Params& params)
+	{
+		RenderResult res;
+
+		// The path tracer collects the lights and the materials, so each render needs its own
+		PathTracer pathTracer;
+		res.m_bIsRendered = pathTracer.Run(params);
+		res.m_image = pathTracer.GetImage();
+		res.m_aovs = pathTracer.GetAOVs();
+		res.m_width = pathTracer.GetImageWidth();
+		res.m_height = pathTracer.GetImageHeight();
+		res.m_traceMs = pathTracer.GetStats().m_traceMs;
+		res.m_bIsInterrupted = pathTracer.GetStats().m_bIsInterrupted;
+
+		return res;
+	}
+
+	// The error is calculated on the displayed values, i.e. in sRGB and clamped to [0,1]
+	float CalculateMSE(const TVector<vec3>& image, const TVector<vec3>& reference)
+	{
+		check(image.Num() == reference.Num());
+
+		double sum = 0.0;
+		for (size_t i = 0; i < image.Num(); i++)
+		{
+			const vec3 d = glm::clamp(Utils::LinearToSRGB(image[i]), 0.0f, 1.0f) - glm::clamp(Utils::LinearToSRGB(reference[i]), 0.0f, 1.0f);
+			sum += glm::dot(d, d) / 3.0f;
+		}
+
+		return (float)(sum / (double)std::max<size_t>(1, image.Num()));
+	}
+
+	float CalculatePSNR(const TVector<vec3>& image, const TVector<vec3>& reference)
+	{
+		return 10.0f * log10(1.0f / std::max(CalculateMSE(image, reference), 1e-12f));
+	}
+
+	// The mean SSIM of the luminance over the 8x8 windows with the step of 4 pixels
+	float CalculateSSIM(const TVector<vec3>& image, const TVector<vec3>& reference, uint32_t width, uint32_t height)
+	{
+		const uint32_t Window = 8;
+		const uint32_t Step = 4;
+		const float C1 = 0.01f * 0.01f;
+		const float C2 = 0.03f * 0.03f;
+
+		auto luminance = [](const vec3& color) { return glm::dot(glm::clamp(Utils::LinearToSRGB(color), 0.0f, 1.0f), vec3(0.2126f, 0.7152f, 0.0722f)); };
+
+		double sum = 0.0;
+		uint32_t numWindows = 0;
+
+		for (uint32_t y = 0; y + Window <= height; y += Step)
+		{
+			for (uint32_t x = 0; x + Window <= width; x += Step)
+			{
+				float meanA = 0.0f, meanB = 0.0f, sqA = 0.0f, sqB = 0.0f, ab = 0.0f;
+				for (uint32_t v = 0; v < Window; v++)
+				{
+					for (uint32_t u = 0; u < Window; u++)
+					{
+						const uint32_t i = (y + v) * width + x + u;
+						const float a = luminance(image[i]);
+						const float b = luminance(reference[i]);
+
+						meanA += a;
+						meanB += b;
+						sqA += a * a;
+						sqB += b * b;
+						ab += a * b;
+					}
+				}
+
+				const float n = (float)(Window * Window);
+				meanA /= n;
+				meanB /= n;
+
+				const float varA = sqA / n - meanA * meanA;
+				const float varB = sqB / n - meanB * meanB;
+				const float covariance = ab / n - meanA * meanB;
+
+				sum += ((2.0f * meanA * meanB + C1) * (2.0f * covariance + C2)) / ((meanA * meanA + meanB * meanB + C1) * (varA + varB + C2));
+				numWindows++;
+			}
+		}
+
+		return (float)(sum / std::max(1u, numWindows));
+	}
+
+	bool IsBitwiseEqual(const TVector<vec3>& lhs, const TVector<vec3>& rhs)
+	{
+		return lhs.Num() == rhs.Num() && memcmp(lhs.GetData(), rhs.GetData(), lhs.Num() * sizeof(vec3)) == 0;
+	}
+
+	/* The error of the white noise falls as 1/N, the stratified sequence converges faster while the integrand is smooth,
+	*  the slope is measured between the lowest and the highest sample counts. The image should not depend on the threads.
+	*/
+	void RunSamplerTests(PathTracer::Params params, const RenderResult& reference)
+	{
+		const uint32_t SampleCounts[] = { 4, 16, 64 };
+
+		for (const auto sequence : { Sampler::ESequence::Random, Sampler::ESequence::Sobol })
+		{
+			params.m_sequence = sequence;
+
+			float mse[3]{};
+			for (uint32_t i = 0; i < 3; i++)
+			{
+				params.m_msaa = SampleCounts[i];
+				mse[i] = CalculateMSE(Render(params).m_image, reference.m_image);
+			}
+
+			const float slope = log(mse[2] / std::max(mse[0], 1e-12f)) / log((float)SampleCounts[2] / SampleCounts[0]);
+
+			params.m_msaa = Msaa;
+			params.m_numThreads = 1;
+			const RenderResult singleThreaded = Render(params);
+
+			params.m_numThreads = 0;
+			const RenderResult multiThreaded = Render(params);
+
+			SAILOR_LOG("\t%s sampler: MSE %.3e/%.3e/%.3e at %u/%u/%u spp, convergence N^%.2f, 1 and N threads match %d",
+				sequence == Sampler::ESequence::Sobol ? "Sobol" : "Random", mse[0], mse[1], mse[2], SampleCounts[0], SampleCounts[1], SampleCounts[2],
+				slope, IsBitwiseEqual(singleThreaded.m_image, multiThreaded.m_image));
+		}
+	}
+
+	// The denoiser is the most useful for the low sample counts, so it is compared at several of them
+	void RunDenoiserTests(PathTracer::Params params, const RenderResult& reference)
+	{
+		const uint32_t width = reference.m_width;
+		const uint32_t height = reference.m_height;
+
+		params.m_aovs = PathTracer::EAOV::Albedo | PathTracer::EAOV::Normal | PathTracer::EAOV::Depth;
+
+		for (const uint32_t msaa : { 4u, 16u, 64u })
+		{
+			params.m_msaa = msaa;
+			const RenderResult noisy = Render(params);
+
+			Utils::Timer timer;
+			timer.Start();
+
+			TVector<vec3> denoised;
+			Denoiser::Denoise(noisy.m_image, noisy.m_aovs, width, height, Denoiser::Params{}, denoised);
+
+			timer.Stop();
+
+			SAILOR_LOG("\tDenoiser %u spp: trace %lldms, denoise %lldms, PSNR %.2fdB -> %.2fdB, SSIM %.4f -> %.4f", msaa, (long long)noisy.m_traceMs, (long long)timer.ResultMs(),
+				CalculatePSNR(noisy.m_image, reference.m_image), CalculatePSNR(denoised, reference.m_image),
+				CalculateSSIM(noisy.m_image, reference.m_image, width, height), CalculateSSIM(denoised, reference.m_image, width, height));
+		}
+	}
+
+	// The render that is interrupted and resumed from the checkpoint should be the same as the uninterrupted one
+	void RunCheckpointTests(PathTracer::Params params)
+	{
+		params.m_seed = 1234;
+
+		const std::filesystem::path checkpoint = std::filesystem::temp_directory_path() / "PathTracerBenchmark.checkpoint";
+
+		for (const bool bAdaptive : { false, true })
+		{
+			params.m_bAdaptiveSampling = bAdaptive;
+			params.m_checkpoint.clear();
+			params.m_maxPasses = 0;
+
+			const RenderResult uninterrupted = Render(params);
+
+			params.m_checkpoint = checkpoint;
+			params.m_maxPasses = 2;
+			const RenderResult interrupted = Render(params);
+
+			params.m_maxPasses = 0;
+			const RenderResult resumed = Render(params);
+
+			const bool bIsCheckpointRemoved = !std::filesystem::exists(checkpoint);
+
+			SAILOR_LOG("\tCheckpoint (%s sampling): interrupted %d, resumed image matches %d, checkpoint removed %d",
+				bAdaptive ? "adaptive" : "uniform", interrupted.m_bIsInterrupted, IsBitwiseEqual(uninterrupted.m_image, resumed.m_image), bIsCheckpointRemoved);
+
+			std::error_code error;
+			std::filesystem::remove(checkpoint, error);
+		}
+	}
+
+	/* Writes the synthetic HDR image with all AOVs in each format, compares the sizes and the times
+	*  and checks that EXR is read back exactly and RGBE keeps the relative precision of 8 bits.
+	*/
+	void RunImageTests()
+	{
+		const uint32_t Width = 1920;
+		const uint32_t Height = 1080;
+		const uint32_t NumPixels = Width * Height;
+
+		// The smooth gradients with the bright highlights, as the render has
+		TVector<vec3> image(NumPixels);
+		PathTracer::AOVs aovs{};
+		aovs.m_albedo = TVector<vec3>(NumPixels);
+		aovs.m_normal = TVector<vec3>(NumPixels);
+		aovs.m_depth = TVector<float>(NumPixels);
+		aovs.m_sampleCount = TVector<float>(NumPixels);
+
+		for (uint32_t y = 0; y < Height; y++)
+		{
+			for (uint32_t x = 0; x < Width; x++)
+			{
+				const uint32_t i = y * Width + x;
+				const float u = x / (float)Width;
+				const float v = y / (float)Height;
+
+				image[i] = vec3(u, v, 0.5f) * (((x / 64 + y / 64) % 7 == 0) ? 40.0f : 1.0f) + vec3(0.001f * (i % 17));
+				aovs.m_albedo[i] = vec3(0.2f + 0.6f * u, 0.5f, 0.8f - 0.6f * v);
+				aovs.m_normal[i] = glm::normalize(vec3(u - 0.5f, v - 0.5f, 1.0f));
+				aovs.m_depth[i] = 1.0f + 100.0f * v;
+				aovs.m_sampleCount[i] = (float)(4 + (i % 5) * 4);
+			}
+		}
+
+		const std::filesystem::path folder = std::filesystem::temp_directory_path();
+
+		struct Output
+		{
+			const char* m_name;
+			std::filesystem::path m_filepath;
+			EExrCompression m_compression;
+		};
+
+		const Output outputs[] =
+		{
+			{ "PNG", folder / "PathTracerBenchmark.png", EExrCompression::None },
+			{ "HDR", folder / "PathTracerBenchmark.hdr", EExrCompression::None },
+			{ "EXR none", folder / "PathTracerBenchmark.none.exr", EExrCompression::None },
+			{ "EXR zip", folder / "PathTracerBenchmark.zip.exr", EExrCompression::Zip }
+		};
+
+		SAILOR_LOG("Image outputs %ux%u with all AOVs:", Width, Height);
+
+		for (const auto& output : outputs)
+		{
+			Utils::Timer timer;
+			timer.Start();
+			const bool bIsWritten = PathTracer::WriteImage(output.m_filepath, image, aovs, Width, Height, output.m_compression);
+			timer.Stop();
+
+			// .hdr writes the AOVs to the separate files
+			std::error_code error;
+			uintmax_t size = std::filesystem::file_size(output.m_filepath, error);
+			if (output.m_filepath.extension() == ".hdr")
+			{
+				for (const char* aov : { ".albedo.hdr", ".normal.hdr", ".depth.hdr", ".samples.hdr" })
+				{
+					std::filesystem::path aovFilepath = output.m_filepath;
+					size += std::filesystem::file_size(aovFilepath.replace_extension(aov), error);
+				}
+			}
+
+			SAILOR_LOG("\t%s: written %d, %lldms, %.2fMb", output.m_name, bIsWritten, (long long)timer.ResultMs(), size / (1024.0f * 1024.0f));
+		}
+
+		// EXR stores the floats as is
+		for (const auto& output : { outputs[2], outputs[3] })
+		{
+			TVector<std::string> names;
+			TVector<TVector<float>> channels;
+			uint32_t width = 0;
+			uint32_t height = 0;
+
+			bool bIsEqual = ReadEXR(output.m_filepath, names, channels, width, height) && width == Width && height == Height;
+			for (uint32_t c = 0; bIsEqual && c < names.Num(); c++)
+			{
+				const float* pExpected = nullptr;
+				uint32_t stride = 3;
+
+				if (names[c] == "R" || names[c] == "G" || names[c] == "B") { pExpected = &image[0].x + (names[c] == "R" ? 0 : names[c] == "G" ? 1 : 2); }
+				else if (names[c] == "albedo.R") { pExpected = &aovs.m_albedo[0].x; }
+				else if (names[c] == "albedo.G") { pExpected = &aovs.m_albedo[0].y; }
+				else if (names[c] == "albedo.B") { pExpected = &aovs.m_albedo[0].z; }
+				else if (names[c] == "normal.X") { pExpected = &aovs.m_normal[0].x; }
+				else if (names[c] == "normal.Y") { pExpected = &aovs.m_normal[0].y; }
+				else if (names[c] == "normal.Z") { pExpected = &aovs.m_normal[0].z; }
+				else if (names[c] == "Z") { pExpected = aovs.m_depth.GetData(); stride = 1; }
+				else if (names[c] == "samples") { pExpected = aovs.m_sampleCount.GetData(); stride = 1; }
+
+				bIsEqual = pExpected != nullptr;
+				for (uint32_t i = 0; bIsEqual && i < NumPixels; i++)
+				{
+					bIsEqual = channels[c][i] == pExpected[i * stride];
+				}
+			}
+
+			SAILOR_LOG("\t%s round trip: %u channels, equal %d", output.m_name, (uint32_t)names.Num(), bIsEqual);
+		}
+
+		// RGBE shares the exponent, so each component is within 1/128 of the largest one
+		{
+			int32_t width = 0;
+			int32_t height = 0;
+			int32_t numComponents = 0;
+			float* pData = stbi_loadf(outputs[1].m_filepath.string().c_str(), &width, &height, &numComponents, 3);
+
+			float maxError = std::numeric_limits<float>::max();
+			if (pData && (uint32_t)width == Width && (uint32_t)height == Height)
+			{
+				maxError = 0.0f;
+				for (uint32_t i = 0; i < NumPixels; i++)
+				{
+					const vec3 loaded = vec3(pData[i * 3], pData[i * 3 + 1], pData[i * 3 + 2]);
+					const float maxComponent = std::max(image[i].x, std::max(image[i].y, image[i].z));
+
+					maxError = std::max(maxError, glm::length(loaded - image[i]) / maxComponent);
+				}
+			}
+			stbi_image_free(pData);
+
+			SAILOR_LOG("\tHDR round trip: max relative error %.4f, within RGBE precision %d", maxError, maxError < 1.0f / 64.0f);
+		}
+
+		for (const auto& output : outputs)
+		{
+			std::error_code error;
+			std::filesystem::remove(output.m_filepath, error);
+		}
+
+		for (const char* aov : { ".albedo.hdr", ".normal.hdr", ".depth.hdr", ".samples.hdr" })
+		{
+			std::error_code error;
+			std::filesystem::path aovFilepath = outputs[1].m_filepath;
+			std::filesystem::remove(aovFilepath.replace_extension(aov), error);
+		}
+	}
+
+	void RunTests(const std::filesystem::path& path)
+	{
+		if (!std::filesystem::exists(path))
+		{
+			SAILOR_LOG("PathTracer benchmark: cannot load %s, skipped", path.string().c_str());
+			return;
+		}
+
+		PathTracer::Params params{};
+		params.m_pathToModel = path;
+		params.m_height = 128;
+		params.m_numSamples = 1;
+		params.m_numAmbientSamples = 1;
+		params.m_numBounces = 2;
+		params.m_ambient = vec3(1.0f);
+
+		params.m_msaa = ReferenceMsaa;
+		const RenderResult reference = Render(params);
+		if (!reference.m_bIsRendered)
+		{
+			return;
+		}
+
+		params.m_msaa = Msaa;
+		const RenderResult uniform = Render(params);
+
+		params.m_bAdaptiveSampling = true;
+		const RenderResult adaptive = Render(params);
+
+		/* The adaptive sampling spends the same number of samples but the time differs,
+		*  since the noisy pixels are more expensive, so the budget is scaled to the time of the uniform render.
+		*/
+		params.m_msaa = std::max(1u, (uint32_t)std::lround(Msaa * uniform.m_traceMs / (float)std::max<int64_t>(1, adaptive.m_traceMs)));
+		const RenderResult equalTime = Render(params);
+
+		const float uniformMSE = CalculateMSE(uniform.m_image, reference.m_image);
+		const float adaptiveMSE = CalculateMSE(adaptive.m_image, reference.m_image);
+		const float equalTimeMSE = CalculateMSE(equalTime.m_image, reference.m_image);
+
+		SAILOR_LOG("%s, reference %u spp in %lldms:", path.filename().string().c_str(), ReferenceMsaa, (long long)reference.m_traceMs);
+		SAILOR_LOG("\tUniform %u spp: %lldms, MSE %.3e", Msaa, (long long)uniform.m_traceMs, uniformMSE);
+		SAILOR_LOG("\tAdaptive %u spp: %lldms, MSE %.3e", Msaa, (long long)adaptive.m_traceMs, adaptiveMSE);
+		SAILOR_LOG("\tAdaptive equal time %u spp: %lldms, MSE %.3e, %.2fx lower error",
+			params.m_msaa, (long long)equalTime.m_traceMs, equalTimeMSE, uniformMSE / std::max(equalTimeMSE, 1e-12f));
+
+		params.m_msaa = Msaa;
+		RunCheckpointTests(params);
+
+		params.m_bAdaptiveSampling = false;
+		RunSamplerTests(params, reference);
+		RunDenoiserTests(params, reference);
+	}
+}
+
+void Sailor::Raytracing::RunPathTracerBenchmark()
+{
+	printf("\nStarting PathTracer benchmark...\n");
+
+	RunImageTests();
+
+	RunTests("../Content/Models/Sponza/sponza.obj");
+	RunTests("../Content/Models/KnightArtorias/Artorias.fbx");
+	RunTests("../Content/Models/Cerberus/cerberus.fbx");
+}
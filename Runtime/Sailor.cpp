@@ -9,6 +9,7 @@
 #include "Platform/Win32/Input.h"
 #include "GraphicsDriver/Vulkan/VulkanApi.h"
 #include "Tasks/Scheduler.h"
+#include "Tasks/ParallelFor.h"
 #include "RHI/Renderer.h"
 #include "Core/Submodule.h"
 #include "Containers/Vector.h"
@@ -16,6 +17,7 @@
 #include "Containers/Map.h"
 #include "Containers/List.h"
 #include "Containers/Octree.h"
+#include "Containers/OctreeSnapshots.h"
 #include "Engine/EngineLoop.h"
 #include "Memory/MemoryBlockAllocator.hpp"
 #include "ECS/ECS.h"
@@ -26,6 +28,7 @@
 #include "timeApi.h"
 #include "Submodules/ImGuiApi.h"
 #include "Raytracing/PathTracer.h"
+#include "Engine/Scene.h"
 
 using namespace Sailor;
 using namespace Sailor::RHI;
@@ -114,7 +117,10 @@ void App::Start(const char** commandLineArgs, int32_t num)
 		//Raytracing::PathTracer::ParseParamsFromCommandLineArgs(params, commandLineArgs, num);
 		//Raytracing::PathTracer r;
 		//
-		//r.Run(params);
+		//if (r.Run(params))
+		//{
+		//	::system(params.m_output.string().c_str());
+		//}
 		//return;
 	}
 
@@ -135,7 +141,18 @@ void App::Start(const char** commandLineArgs, int32_t num)
 	consoleVars["set.benchmark"] = &Sailor::RunSetBenchmark;
 	consoleVars["map.benchmark"] = &Sailor::RunMapBenchmark;
 	consoleVars["list.benchmark"] = &Sailor::RunListBenchmark;
+	consoleVars["spinlock.benchmark"] = &Sailor::RunSpinLockBenchmark;
+	consoleVars["spinlock.stats"] = &Sailor::DumpSpinLockStats;
 	consoleVars["octree.benchmark"] = &Sailor::RunOctreeBenchmark;
+	consoleVars["octree.snapshots.benchmark"] = &Sailor::RunOctreeSnapshotsBenchmark;
+	consoleVars["scheduler.benchmark"] = &Sailor::Tasks::RunSchedulerBenchmark;
+	consoleVars["parallelfor.benchmark"] = &Sailor::Tasks::RunParallelForBenchmark;
+	consoleVars["bvh.benchmark"] = &Sailor::Raytracing::RunBVHBenchmark;
+	consoleVars["pathtracer.benchmark"] = &Sailor::Raytracing::RunPathTracerBenchmark;
+	consoleVars["ecs.benchmark"] = &Sailor::ECS::RunECSBenchmark;
+	consoleVars["ecs.graph.benchmark"] = &Sailor::ECS::RunSystemsGraphBenchmark;
+	consoleVars["ecs.transform.benchmark"] = &Sailor::ECS::RunTransformPropagationBenchmark;
+	consoleVars["scene.benchmark"] = &Sailor::RunSceneBenchmark;
 	consoleVars["stats.memory"] = &Sailor::RHI::Renderer::MemoryStats;
 
 #ifdef SAILOR_EDITOR
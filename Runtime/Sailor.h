@@ -6,7 +6,9 @@
 #include "Memory/SharedPtr.hpp"
 #include "Memory/WeakPtr.hpp"
 #include "Memory/UniquePtr.hpp"
+#if defined(_WIN32)
 #include "Platform/Win32/Window.h"
+#endif
 #include "Containers/Containers.h"
 #include <glm/glm/glm.hpp>
 
@@ -28,7 +30,9 @@ namespace Sailor
 		static void Stop();
 		static void Shutdown();
 
+#if defined(_WIN32)
 		static TUniquePtr<Win32::Window>& GetViewportWindow();
+#endif
 
 		static SubmoduleBase* GetSubmodule(uint32_t index)
 		{
@@ -68,7 +72,9 @@ namespace Sailor
 
 	protected:
 
+#if defined(_WIN32)
 		TUniquePtr<Win32::Window> m_pViewportWindow;
+#endif
 
 	private:
 
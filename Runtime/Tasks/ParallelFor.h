@@ -0,0 +1,242 @@
+#pragma once
+#include <atomic>
+#include <thread>
+#include <algorithm>
+#include <memory>
+#include "Sailor.h"
+#include "Memory/SharedPtr.hpp"
+#include "Containers/Vector.h"
+#include "Tasks/Tasks.h"
+#include "Tasks/Scheduler.h"
+
+namespace Sailor
+{
+	namespace Tasks
+	{
+		/* ParallelFor/ParallelReduce split the range [begin, end) between the calling thread and the helper tasks.
+		*  The chunks are claimed dynamically and shrink when the range is running out (guided scheduling),
+		*  so the participants that started later or got cheaper chunks take more work.
+		*  The calling thread processes the chunks as well and returns when the whole range is processed,
+		*  the helpers that start after that find nothing to do and finish immediately.
+		*  The body is called as body(chunkBegin, chunkEnd) and should not call Wait on the tasks that are not started yet.
+		*/
+		namespace Internal
+		{
+			class ParallelRange
+			{
+			public:
+
+				ParallelRange(size_t begin, size_t end, size_t grainSize, uint32_t numParticipants) :
+					m_next(begin),
+					m_end(end),
+					m_grainSize(std::max(grainSize, (size_t)1)),
+					m_numParticipants(numParticipants)
+				{}
+
+				__forceinline bool TryClaim(size_t& outBegin, size_t& outEnd)
+				{
+					size_t current = m_next.load(std::memory_order_relaxed);
+					while (current < m_end)
+					{
+						const size_t remaining = m_end - current;
+						const size_t chunkSize = std::min(remaining, std::max(m_grainSize, remaining / (2 * (size_t)m_numParticipants)));
+
+						if (m_next.compare_exchange_weak(current, current + chunkSize, std::memory_order_relaxed))
+						{
+							outBegin = current;
+							outEnd = current + chunkSize;
+							return true;
+						}
+					}
+
+					return false;
+				}
+
+				__forceinline void OnChunkProcessed(size_t chunkSize) { m_numProcessed.fetch_add(chunkSize, std::memory_order_release); }
+
+				__forceinline bool IsProcessed(size_t num) const { return m_numProcessed.load(std::memory_order_acquire) >= num; }
+
+				/* The worker executes the helpers that are not started yet and the other jobs while the claimed chunks are being processed,
+				*  the other threads just wait for the claimed chunks, since the rest of the range is processed by them.
+				*/
+				void WaitProcessed(size_t num, const TVector<ITaskPtr>& helpers) const
+				{
+					if (WorkerThread* pWorker = App::GetSubmodule<Scheduler>()->GetCurrentWorkerThread())
+					{
+						for (const auto& helper : helpers)
+						{
+							if (IsProcessed(num))
+							{
+								break;
+							}
+
+							pWorker->WaitWhileHelping(*helper);
+						}
+					}
+
+					while (!IsProcessed(num))
+					{
+						std::this_thread::yield();
+					}
+				}
+
+			protected:
+
+				alignas(64) std::atomic<size_t> m_next;
+				alignas(64) std::atomic<size_t> m_numProcessed = 0;
+
+				size_t m_end;
+				size_t m_grainSize;
+				uint32_t m_numParticipants;
+			};
+
+			// The caller is one of the participants, so we need less helpers than threads
+			SAILOR_API __forceinline uint32_t GetNumParticipants(size_t num, size_t grainSize, uint32_t maxThreads)
+			{
+				const uint32_t numWorkers = App::GetSubmodule<Scheduler>()->GetNumWorkerThreads(EThreadType::Worker);
+				const uint32_t numThreads = maxThreads ? std::min(maxThreads, numWorkers + 1) : numWorkers + 1;
+				const size_t numChunks = (num + std::max(grainSize, (size_t)1) - 1) / std::max(grainSize, (size_t)1);
+
+				return (uint32_t)std::max((size_t)1, std::min((size_t)numThreads, numChunks));
+			}
+
+			// The padding keeps each partial result on its own cache line
+			template<typename TValue>
+			struct alignas(64) TPartialResult
+			{
+				TValue m_value;
+			};
+
+			template<typename TValue>
+			std::unique_ptr<TPartialResult<TValue>[]> AllocatePartialResults(uint32_t num, const TValue& identity)
+			{
+				static_assert(alignof(TPartialResult<TValue>) == 64 && sizeof(TPartialResult<TValue>) % 64 == 0);
+
+				// The array new takes the over-alignment into account, unlike the default allocators of the containers
+				std::unique_ptr<TPartialResult<TValue>[]> res(new TPartialResult<TValue>[num]);
+				for (uint32_t i = 0; i < num; i++)
+				{
+					res[i].m_value = identity;
+				}
+
+				return res;
+			}
+		}
+
+		// maxThreads limits the number of participants including the calling thread, 0 means all workers
+		template<typename TBody>
+		void ParallelFor(const std::string& name, size_t begin, size_t end, size_t grainSize, TBody body, uint32_t maxThreads = 0)
+		{
+			SAILOR_PROFILE_FUNCTION();
+
+			if (begin >= end)
+			{
+				return;
+			}
+
+			const uint32_t numParticipants = Internal::GetNumParticipants(end - begin, grainSize, maxThreads);
+			if (numParticipants == 1)
+			{
+				body(begin, end);
+				return;
+			}
+
+			TSharedPtr<Internal::ParallelRange> pRange = TSharedPtr<Internal::ParallelRange>::Make(begin, end, grainSize, numParticipants);
+			TBody* pBody = &body;
+
+			auto process = [](Internal::ParallelRange& range, TBody& body)
+				{
+					size_t chunkBegin = 0;
+					size_t chunkEnd = 0;
+					while (range.TryClaim(chunkBegin, chunkEnd))
+					{
+						body(chunkBegin, chunkEnd);
+						range.OnChunkProcessed(chunkEnd - chunkBegin);
+					}
+				};
+
+			auto scheduler = App::GetSubmodule<Scheduler>();
+
+			TVector<ITaskPtr> helpers;
+			helpers.Reserve(numParticipants - 1);
+
+			for (uint32_t i = 1; i < numParticipants; i++)
+			{
+				// The helper touches the body only if it claims the chunk, that is impossible after the caller returns
+				ITaskPtr helper = CreateTask(name, [pRange, pBody, process]() mutable { process(*pRange, *pBody); }, EThreadType::Worker, EPriority::High);
+				scheduler->Run(helper);
+				helpers.Add(std::move(helper));
+			}
+
+			process(*pRange, body);
+			pRange->WaitProcessed(end - begin, helpers);
+		}
+
+		// The reduce should be associative and commutative, the order of the partial results is not defined
+		template<typename TValue, typename TBody, typename TReduce>
+		TValue ParallelReduce(const std::string& name, size_t begin, size_t end, size_t grainSize, const TValue& identity, TBody body, TReduce reduce, uint32_t maxThreads = 0)
+		{
+			SAILOR_PROFILE_FUNCTION();
+
+			if (begin >= end)
+			{
+				return identity;
+			}
+
+			const uint32_t numParticipants = Internal::GetNumParticipants(end - begin, grainSize, maxThreads);
+			if (numParticipants == 1)
+			{
+				return reduce(identity, body(begin, end));
+			}
+
+			TSharedPtr<Internal::ParallelRange> pRange = TSharedPtr<Internal::ParallelRange>::Make(begin, end, grainSize, numParticipants);
+
+			// Each participant accumulates to its own cache line
+			auto partialResults = Internal::AllocatePartialResults(numParticipants, identity);
+
+			TBody* pBody = &body;
+			TReduce* pReduce = &reduce;
+			Internal::TPartialResult<TValue>* pPartialResults = partialResults.get();
+
+			auto process = [](Internal::ParallelRange& range, TBody& body, TReduce& reduce, TValue& partialResult)
+				{
+					size_t chunkBegin = 0;
+					size_t chunkEnd = 0;
+					while (range.TryClaim(chunkBegin, chunkEnd))
+					{
+						partialResult = reduce(partialResult, body(chunkBegin, chunkEnd));
+						range.OnChunkProcessed(chunkEnd - chunkBegin);
+					}
+				};
+
+			auto scheduler = App::GetSubmodule<Scheduler>();
+
+			TVector<ITaskPtr> helpers;
+			helpers.Reserve(numParticipants - 1);
+
+			for (uint32_t i = 1; i < numParticipants; i++)
+			{
+				ITaskPtr helper = CreateTask(name, [pRange, pBody, pReduce, pPartialResults, i, process]() mutable
+					{
+						process(*pRange, *pBody, *pReduce, pPartialResults[i].m_value);
+					}, EThreadType::Worker, EPriority::High);
+
+				scheduler->Run(helper);
+				helpers.Add(std::move(helper));
+			}
+
+			process(*pRange, body, reduce, pPartialResults[0].m_value);
+			pRange->WaitProcessed(end - begin, helpers);
+
+			TValue res = identity;
+			for (uint32_t i = 0; i < numParticipants; i++)
+			{
+				res = reduce(res, pPartialResults[i].m_value);
+			}
+
+			return res;
+		}
+
+		SAILOR_API void RunParallelForBenchmark();
+	}
+}
@@ -0,0 +1,155 @@
+#include <random>
+#include "Tasks/ParallelFor.h"
+#include "Tasks/Scheduler.h"
+#include "Math/Transform.h"
+#include "Math/Bounds.h"
+#include "Core/Utils.h"
+
+using namespace Sailor;
+using namespace Sailor::Tasks;
+using Timer = Utils::Timer;
+
+namespace
+{
+	// Local to world transforms, the same kind of work that TransformECS does each frame
+	class TestCase_TransformPerfromance
+	{
+	public:
+
+		TestCase_TransformPerfromance(uint32_t count) : m_locals(count), m_parents(count), m_worldMatrices(count)
+		{
+			std::mt19937 random(1);
+			std::uniform_real_distribution<float> dist(-100.0f, 100.0f);
+
+			for (uint32_t i = 0; i < count; i++)
+			{
+				m_locals[i] = Math::Transform(glm::vec4(dist(random), dist(random), dist(random), 1.0f),
+					glm::angleAxis(dist(random), glm::normalize(glm::vec3(dist(random), dist(random), dist(random)) + 0.01f)));
+
+				m_parents[i] = Math::Transform(glm::vec4(dist(random), dist(random), dist(random), 1.0f));
+			}
+		}
+
+		int64_t Run(uint32_t numThreads)
+		{
+			Timer timer;
+			timer.Start();
+
+			ParallelFor("Benchmark transforms", 0, m_locals.Num(), 1024, [this](size_t begin, size_t end)
+				{
+					for (size_t i = begin; i < end; i++)
+					{
+						m_worldMatrices[i] = (m_locals[i] * m_parents[i]).Matrix();
+					}
+				}, numThreads);
+
+			timer.Stop();
+			return timer.ResultMs();
+		}
+
+	protected:
+
+		TVector<Math::Transform> m_locals;
+		TVector<Math::Transform> m_parents;
+		TVector<glm::mat4> m_worldMatrices;
+	};
+
+	// The number of visible bounds, reduced from the chunks
+	class TestCase_CullingPerfromance
+	{
+	public:
+
+		TestCase_CullingPerfromance(uint32_t count) : m_bounds(count)
+		{
+			std::mt19937 random(1);
+			std::uniform_real_distribution<float> dist(-1000.0f, 1000.0f);
+
+			for (uint32_t i = 0; i < count; i++)
+			{
+				m_bounds[i] = Math::AABB(glm::vec3(dist(random), dist(random), dist(random)), glm::vec3(5.0f, 5.0f, 5.0f));
+			}
+
+			const glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+			const glm::mat4 projection = glm::perspective(glm::radians(90.0f), 16.0f / 9.0f, 0.1f, 1000.0f);
+			m_frustum.ExtractFrustumPlanes(projection * view);
+		}
+
+		int64_t Run(uint32_t numThreads, size_t& outNumVisible)
+		{
+			Timer timer;
+			timer.Start();
+
+			outNumVisible = ParallelReduce("Benchmark culling", 0, m_bounds.Num(), 4096, (size_t)0,
+				[this](size_t begin, size_t end)
+				{
+					size_t numVisible = 0;
+					for (size_t i = begin; i < end; i++)
+					{
+						numVisible += m_frustum.OverlapsAABB(m_bounds[i]) ? 1 : 0;
+					}
+					return numVisible;
+				},
+				[](size_t lhs, size_t rhs) { return lhs + rhs; }, numThreads);
+
+			timer.Stop();
+			return timer.ResultMs();
+		}
+
+	protected:
+
+		TVector<Math::AABB> m_bounds;
+		Math::Frustum m_frustum;
+	};
+}
+
+void Sailor::Tasks::RunParallelForBenchmark()
+{
+	const uint32_t numTransforms = 1000000;
+	const uint32_t numBounds = 4000000;
+	const uint32_t numRepeats = 8;
+
+	printf("\nStarting parallel for benchmark...\n");
+
+	TestCase_TransformPerfromance transforms(numTransforms);
+	TestCase_CullingPerfromance culling(numBounds);
+
+	const uint32_t maxThreads = App::GetSubmodule<Scheduler>()->GetNumWorkerThreads(EThreadType::Worker) + 1;
+
+	int64_t transformsSingleThreadMs = 0;
+	int64_t cullingSingleThreadMs = 0;
+	[[maybe_unused]] size_t numVisibleSingleThread = 0;
+
+	TVector<uint32_t> threadCounts;
+	for (uint32_t numThreads = 1; numThreads < maxThreads; numThreads *= 2)
+	{
+		threadCounts.Add(numThreads);
+	}
+	threadCounts.Add(maxThreads);
+
+	for (uint32_t numThreads : threadCounts)
+	{
+		int64_t transformsMs = 0;
+		int64_t cullingMs = 0;
+		size_t numVisible = 0;
+
+		for (uint32_t i = 0; i < numRepeats; i++)
+		{
+			transformsMs += transforms.Run(numThreads);
+			cullingMs += culling.Run(numThreads, numVisible);
+		}
+
+		if (numThreads == 1)
+		{
+			transformsSingleThreadMs = transformsMs;
+			cullingSingleThreadMs = cullingMs;
+			numVisibleSingleThread = numVisible;
+		}
+
+		check(numVisible == numVisibleSingleThread);
+
+		SAILOR_LOG("ParallelFor, %u threads:\n\ttransforms (%u) %lldms, speedup %.2f\n\tParallelReduce, AABB culling (%u, %zu visible) %lldms, speedup %.2f",
+			numThreads,
+			numTransforms, (long long)(transformsMs / numRepeats), transformsMs ? (float)transformsSingleThreadMs / transformsMs : 1.0f,
+			numBounds, numVisible, (long long)(cullingMs / numRepeats), cullingMs ? (float)cullingSingleThreadMs / cullingMs : 1.0f);
+	}
+}
@@ -1,28 +1,47 @@
 #include "Scheduler.h"
-#include <windows.h>
-#include <fcntl.h>
-#include <conio.h>
 #include <algorithm>
 #include <mutex>
 #include <set>
 #include <string>
 #include "Core/Utils.h"
+#include "Platform/Platform.h"
 
 using namespace std;
 using namespace Sailor;
 using namespace Sailor::Tasks;
 
-WorkerThread::WorkerThread(
-	std::string threadName,
-	EThreadType threadType,
-	std::condition_variable& refresh,
-	std::mutex& mutex,
-	TVector<ITaskPtr>& pJobsQueue) :
+namespace
+{
+	// The worker that runs on the current thread, nullptr for the main thread
+	thread_local WorkerThread* t_pCurrentWorker = nullptr;
+}
+
+WorkerThread::WorkerThread(std::string threadName, EThreadType threadType, uint32_t randomSeed) :
 	m_threadName(std::move(threadName)),
 	m_threadType(threadType),
-	m_refresh(refresh),
-	m_commonQueueMutex(mutex),
-	m_pCommonJobsQueue(pJobsQueue)
+	m_randomState(randomSeed ? randomSeed : 1u)
+{
+}
+
+WorkerThread::~WorkerThread()
+{
+	// The thread is joined, so we can pop the jobs that were not processed
+	for (auto& deque : m_jobsDeque)
+	{
+		ITask* pJob = nullptr;
+		while (deque.Pop(pJob))
+		{
+			Scheduler::AcquireDispatchedJob(pJob);
+		}
+	}
+
+	for (auto& pJob : m_pJobsQueue)
+	{
+		Scheduler::AcquireDispatchedJob(pJob.GetRawPtr());
+	}
+}
+
+void WorkerThread::Start()
 {
 	m_pThread = TUniquePtr<std::thread>::Make(&WorkerThread::Process, this);
 }
@@ -33,10 +52,40 @@ void WorkerThread::Join()
 	m_pThread->join();
 }
 
-void WorkerThread::WaitIdle()
+void WorkerThread::ExecuteJob(ITaskPtr& pJob)
+{
+	SAILOR_PROFILE_BLOCK(pJob->GetName());
+
+	pJob->Execute();
+	pJob.Clear();
+
+	SAILOR_PROFILE_END_BLOCK();
+
+	App::GetSubmodule<Tasks::Scheduler>()->OnJobFinished(m_threadType);
+}
+
+void WorkerThread::WaitWhileHelping(const ITask& task)
 {
 	SAILOR_PROFILE_FUNCTION();
-	while (m_bIsBusy);
+
+	Scheduler* scheduler = App::GetSubmodule<Tasks::Scheduler>();
+	auto& syncBlock = scheduler->GetTaskSyncBlock(task);
+
+	ITaskPtr pJob;
+	while (!task.IsFinished())
+	{
+		if (m_nestedWaitDepth < scheduler->MaxNestedWaitDepth && TryFetchJob(pJob))
+		{
+			m_nestedWaitDepth++;
+			ExecuteJob(pJob);
+			m_nestedWaitDepth--;
+			continue;
+		}
+
+		// The task is executing on the other thread or is waiting for its dependencies
+		std::unique_lock<std::mutex> lk(syncBlock.m_mutex);
+		syncBlock.m_onComplete.wait_for(lk, std::chrono::milliseconds(scheduler->HelpWhileWaitPeriodMs), [&task]() { return task.IsFinished(); });
+	}
 }
 
 void WorkerThread::ForcelyPushJob(const ITaskPtr& pJob)
@@ -47,120 +96,152 @@ void WorkerThread::ForcelyPushJob(const ITaskPtr& pJob)
 		m_pJobsQueue.Add(pJob);
 	}
 
-	if (!m_bIsBusy)
-	{
-		m_refresh.notify_all();
-	}
+	// We don't know which thread would be awaken, so notify all of them
+	App::GetSubmodule<Tasks::Scheduler>()->NotifyWorkerThread(m_threadType, true);
+}
+
+uint32_t WorkerThread::NextRandom()
+{
+	// xorshift32
+	m_randomState ^= m_randomState << 13;
+	m_randomState ^= m_randomState >> 17;
+	m_randomState ^= m_randomState << 5;
+	return m_randomState;
 }
 
 bool WorkerThread::TryFetchJob(ITaskPtr& pOutJob)
 {
 	SAILOR_PROFILE_FUNCTION();
 
-	const std::lock_guard<std::mutex> lock(m_queueMutex);
-	if (m_pJobsQueue.Num() > 0)
 	{
-		pOutJob = m_pJobsQueue[m_pJobsQueue.Num() - 1];
-		m_pJobsQueue.RemoveLast();
+		const std::lock_guard<std::mutex> lock(m_queueMutex);
+		if (m_pJobsQueue.Num() > 0)
+		{
+			// The queue holds the task as well, the scheduler's reference is released when the task is fetched
+			pOutJob = Scheduler::AcquireDispatchedJob(m_pJobsQueue[m_pJobsQueue.Num() - 1].GetRawPtr());
+			m_pJobsQueue.RemoveLast();
+			return true;
+		}
+	}
+
+	Scheduler* scheduler = App::GetSubmodule<Tasks::Scheduler>();
+
+	if (scheduler->TryFetchDeadlineJob(pOutJob, m_threadType, true))
+	{
 		return true;
 	}
-	return false;
+
+	const bool bStarvationGuard = (++m_numFetches % scheduler->StarvationGuardPeriod) == 0;
+
+	for (uint32_t i = 0; i < NumPriorities; i++)
+	{
+		const EPriority priority = (EPriority)(bStarvationGuard ? (NumPriorities - i - 1) : i);
+
+		ITask* pJob = nullptr;
+		if (m_jobsDeque[(uint32_t)priority].Pop(pJob))
+		{
+			scheduler->OnJobFetched(m_threadType);
+			pOutJob = Scheduler::AcquireDispatchedJob(pJob);
+			return true;
+		}
+
+		if (scheduler->TryFetchNextAvailiableJob(pOutJob, m_threadType, priority) ||
+			scheduler->TryStealJob(pOutJob, this, priority))
+		{
+			return true;
+		}
+	}
+
+	// Nothing else to do, so we could start the job before its deadline
+	return scheduler->TryFetchDeadlineJob(pOutJob, m_threadType, false);
 }
 
 void WorkerThread::Process()
 {
-	Sailor::Utils::SetThreadName(m_threadName);
+	Platform::SetThreadName(m_threadName);
 
 #if defined(BUILD_WITH_EASY_PROFILER)
 	EASY_THREAD_SCOPE(m_threadName.c_str());
 #endif
 
-	m_threadId = GetCurrentThreadId();
+	m_threadId = Platform::GetCurrentThreadId();
+	t_pCurrentWorker = this;
 
 	if (m_threadType == EThreadType::Render || m_threadType == EThreadType::RHI)
 	{
-		SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_HIGHEST);
+		Platform::SetThreadHighPriority();
 	}
 
 	Scheduler* scheduler = App::GetSubmodule<Tasks::Scheduler>();
 
+	const uint32_t threadTypeIndex = (uint32_t)m_threadType;
 	ITaskPtr pCurrentJob;
 
-	std::mutex threadExecutionMutex;
 	while (!scheduler->m_bIsTerminating)
 	{
-		std::unique_lock<std::mutex> lk(threadExecutionMutex);
-		m_refresh.wait(lk, [this, &pCurrentJob, scheduler]
-			{
-				return TryFetchJob(pCurrentJob) ||
-					scheduler->TryFetchNextAvailiableJob(pCurrentJob, m_threadType) ||
-					(bool)scheduler->m_bIsTerminating;
-			});
+		if (!TryFetchJob(pCurrentJob))
+		{
+			std::unique_lock<std::mutex> lk(scheduler->m_refreshMutex[threadTypeIndex]);
+
+			// Producers check the counter after pushing the job, so the job cannot be missed
+			scheduler->m_numSleepingThreads[threadTypeIndex]++;
+			scheduler->m_refreshCondVar[threadTypeIndex].wait(lk, [this, &pCurrentJob, scheduler]
+				{
+					return TryFetchJob(pCurrentJob) || (bool)scheduler->m_bIsTerminating;
+				});
+			scheduler->m_numSleepingThreads[threadTypeIndex]--;
+		}
 
 		if (pCurrentJob)
 		{
-			m_bIsBusy = true;
-			SAILOR_PROFILE_BLOCK(pCurrentJob->GetName());
-
-			pCurrentJob->Execute();
-			pCurrentJob.Clear();
-
-			scheduler->NotifyWorkerThread(m_threadType);
-
-			SAILOR_PROFILE_END_BLOCK();
-			m_bIsBusy = false;
+			ExecuteJob(pCurrentJob);
 		}
-
-		lk.unlock();
 	}
+
+	t_pCurrentWorker = nullptr;
 }
 
-void Scheduler::Initialize()
+void Scheduler::Initialize(uint32_t numWorkerThreads)
 {
 	m_tasksPool.AddDefault(MaxTasksInPool);
 
 	for (uint32_t i = 0; i < MaxTasksInPool; i++)
 	{
-		m_freeList.push((uint16_t)(MaxTasksInPool - i - 1));
+		m_freeList.Push((uint16_t)(MaxTasksInPool - i - 1));
 	}
 
-	m_mainThreadId = GetCurrentThreadId();
+	m_mainThreadId = Platform::GetCurrentThreadId();
 
-	SetPriorityClass(GetCurrentProcess(), HIGH_PRIORITY_CLASS);
+	Platform::SetProcessHighPriority();
 
 	const unsigned coresCount = std::thread::hardware_concurrency();
 	const unsigned numRHIThreads = RHIThreadsNum;
-	const unsigned numThreads = std::max(1u, coresCount - 2u - numRHIThreads);
+	// The main, the render and the RHI threads take the cores as well, the difference is unsigned
+	const unsigned numThreads = numWorkerThreads > 0 ? numWorkerThreads : (coresCount > 2u + numRHIThreads ? coresCount - 2u - numRHIThreads : 1u);
 
-	WorkerThread* newRenderingThread = new WorkerThread(
-		"Render Thread",
-		EThreadType::Render,
-		m_refreshCondVar[(uint32_t)EThreadType::Render],
-		m_queueMutex[(uint32_t)EThreadType::Render],
-		m_pCommonJobsQueue[(uint32_t)EThreadType::Render]);
-
-	m_workerThreads.Emplace(newRenderingThread);
+	m_workerThreads.Emplace(new WorkerThread("Render Thread", EThreadType::Render, 1u));
 
 	for (uint32_t i = 0; i < numThreads; i++)
 	{
 		const std::string threadName = std::string("Worker Thread ") + std::to_string(i);
-		WorkerThread* newThread = new WorkerThread(threadName, EThreadType::Worker,
-			m_refreshCondVar[(uint32_t)EThreadType::Worker],
-			m_queueMutex[(uint32_t)EThreadType::Worker],
-			m_pCommonJobsQueue[(uint32_t)EThreadType::Worker]);
-
-		m_workerThreads.Emplace(newThread);
+		m_workerThreads.Emplace(new WorkerThread(threadName, EThreadType::Worker, 0x9E3779B9u * (i + 2)));
 	}
 
 	for (uint32_t i = 0; i < numRHIThreads; i++)
 	{
 		const std::string threadName = std::string("RHI Thread ") + std::to_string(i);
-		WorkerThread* newThread = new WorkerThread(threadName, EThreadType::RHI,
-			m_refreshCondVar[(uint32_t)EThreadType::RHI],
-			m_queueMutex[(uint32_t)EThreadType::RHI],
-			m_pCommonJobsQueue[(uint32_t)EThreadType::RHI]);
+		m_workerThreads.Emplace(new WorkerThread(threadName, EThreadType::RHI, 0x85EBCA6Bu * (i + 2)));
+	}
+
+	// Workers steal from each other, so all of them should be registered before the start
+	for (auto& worker : m_workerThreads)
+	{
+		m_workerThreadsByType[(uint32_t)worker->GetThreadType()].Add(worker);
+	}
 
-		m_workerThreads.Emplace(newThread);
+	for (auto& worker : m_workerThreads)
+	{
+		worker->Start();
 	}
 
 	SAILOR_LOG("Initialize JobSystem. Cores count: %d, Worker threads count: %zd", coresCount, m_workerThreads.Num());
@@ -192,6 +273,27 @@ Scheduler::~Scheduler()
 	}
 
 	m_workerThreads.Clear();
+
+	for (auto& queues : m_pCommonJobsQueue)
+	{
+		for (auto& queue : queues)
+		{
+			ITask* pJob = nullptr;
+			while (queue.TryPop(pJob))
+			{
+				AcquireDispatchedJob(pJob);
+			}
+		}
+	}
+
+	for (auto& deadlineJobs : m_deadlineJobs)
+	{
+		for (auto& pJob : deadlineJobs)
+		{
+			AcquireDispatchedJob(pJob);
+		}
+		deadlineJobs.Clear();
+	}
 }
 
 uint32_t Scheduler::GetNumWorkerThreads() const
@@ -213,6 +315,8 @@ void Scheduler::ProcessJobsOnMainThread()
 			pCurrentJob.Clear();
 
 			SAILOR_PROFILE_END_BLOCK();
+
+			OnJobFinished(EThreadType::Main);
 		}
 	}
 }
@@ -268,20 +372,14 @@ void Scheduler::Run(const ITaskPtr& pJob, bool bAutoRunChainedTasks)
 		RunChainedTasks(pJob);
 	}
 
-	pJob.GetRawPtr()->OnEnqueue();
-
-	{
-		std::mutex* pOutMutex;
-		TVector<ITaskPtr>* pOutQueue;
-		std::condition_variable* pOutCondVar;
-
-		GetThreadSyncVarsByThreadType(pJob->GetThreadType(), pOutMutex, pOutQueue, pOutCondVar);
+	m_numQueuedJobs[(uint32_t)pJob->GetThreadType()]++;
+	m_numUnfinishedJobs[(uint32_t)pJob->GetThreadType()]++;
 
-		const std::lock_guard<std::mutex> lock(*pOutMutex);
-		pOutQueue->Add(pJob);
-	}
+	// The task that is blocked by its dependencies is owned by the scheduler too, the caller could drop its handle
+	pJob.GetRawPtr()->m_selfWhileDispatched = pJob;
+	pJob.GetRawPtr()->OnEnqueue();
 
-	NotifyWorkerThread(pJob->GetThreadType());
+	TryDispatch(pJob);
 }
 
 void Scheduler::Run(const ITaskPtr& pJob, DWORD threadId, bool bAutoRunChainedTasks)
@@ -295,71 +393,224 @@ void Scheduler::Run(const ITaskPtr& pJob, DWORD threadId, bool bAutoRunChainedTa
 		RunChainedTasks(pJob);
 	}
 
+	pJob.GetRawPtr()->m_pinnedThreadId = threadId;
+
+	if (threadId == m_mainThreadId)
+	{
+		m_numQueuedJobs[(uint32_t)EThreadType::Main]++;
+	}
+
+	m_numUnfinishedJobs[(uint32_t)GetThreadType(threadId)]++;
+
+	pJob.GetRawPtr()->m_selfWhileDispatched = pJob;
 	pJob.GetRawPtr()->OnEnqueue();
 
-	auto result = m_workerThreads.FindIf(
-		[&](const auto& worker)
-		{
-			return worker->GetThreadId() == threadId;
-		});
+	TryDispatch(pJob);
+}
+
+void Scheduler::TryDispatch(const ITaskPtr& pJob)
+{
+	SAILOR_PROFILE_FUNCTION();
 
-	if (result != -1)
+	if (!pJob.GetRawPtr()->TryMarkDispatched())
 	{
-		m_workerThreads[result]->ForcelyPushJob(pJob);
 		return;
 	}
-	check(m_mainThreadId == threadId);
-	// Add to Main thread if cannot find the thread in workers
+
+	if (const DWORD threadId = pJob->m_pinnedThreadId)
 	{
-		std::mutex* pOutMutex;
-		TVector<ITaskPtr>* pOutQueue;
-		std::condition_variable* pOutCondVar;
+		auto result = m_workerThreads.FindIf(
+			[&](const auto& worker)
+			{
+				return worker->GetThreadId() == threadId;
+			});
+
+		if (result != -1)
+		{
+			m_workerThreads[result]->ForcelyPushJob(pJob);
+			return;
+		}
+
+		check(m_mainThreadId == threadId);
+
+		// Add to Main thread if cannot find the thread in workers
+		m_pCommonJobsQueue[(uint32_t)EThreadType::Main][(uint32_t)pJob->GetPriority()].Push(pJob.GetRawPtr());
+		return;
+	}
+
+	const EThreadType threadType = pJob->GetThreadType();
+
+	if (pJob->HasDeadline())
+	{
+		PushDeadlineJob(pJob.GetRawPtr());
+	}
+	else if (t_pCurrentWorker && t_pCurrentWorker->GetThreadType() == threadType)
+	{
+		t_pCurrentWorker->PushJob(pJob.GetRawPtr());
+	}
+	else
+	{
+		m_pCommonJobsQueue[(uint32_t)threadType][(uint32_t)pJob->GetPriority()].Push(pJob.GetRawPtr());
+	}
+
+	NotifyWorkerThread(threadType);
+}
+
+void Scheduler::PushDeadlineJob(ITask* pJob)
+{
+	const uint32_t threadTypeIndex = (uint32_t)pJob->GetThreadType();
+	const int64_t deadline = pJob->GetDeadline();
 
-		GetThreadSyncVarsByThreadType(EThreadType::Main, pOutMutex, pOutQueue, pOutCondVar);
+	const std::lock_guard<std::mutex> lock(m_deadlineJobsMutex[threadTypeIndex]);
+	auto& jobs = m_deadlineJobs[threadTypeIndex];
 
-		const std::lock_guard<std::mutex> lock(*pOutMutex);
-		pOutQueue->Add(pJob);
+	// Keep the earliest deadline at the end, the number of such jobs is expected to be small
+	size_t index = jobs.Num();
+	while (index > 0 && jobs[index - 1]->GetDeadline() < deadline)
+	{
+		index--;
 	}
+
+	jobs.Insert(pJob, index);
+	m_earliestDeadline[threadTypeIndex] = (*jobs.Last())->GetDeadline();
 }
 
-void Scheduler::GetThreadSyncVarsByThreadType(
-	EThreadType threadType,
-	std::mutex*& pOutMutex,
-	TVector<ITaskPtr>*& pOutQueue,
-	std::condition_variable*& pOutCondVar)
+bool Scheduler::TryFetchDeadlineJob(ITaskPtr& pOutJob, EThreadType threadType, bool bOnlyDue)
 {
 	SAILOR_PROFILE_FUNCTION();
 
-	pOutMutex = &m_queueMutex[(uint32_t)threadType];
-	pOutQueue = &m_pCommonJobsQueue[(uint32_t)threadType];
-	pOutCondVar = &m_refreshCondVar[(uint32_t)threadType];
+	const uint32_t threadTypeIndex = (uint32_t)threadType;
+	const int64_t earliestDeadline = m_earliestDeadline[threadTypeIndex];
+
+	if (earliestDeadline == NoDeadline ||
+		(bOnlyDue && earliestDeadline > Utils::GetCurrentTimeMs() + DeadlineSlackMs))
+	{
+		return false;
+	}
+
+	ITask* pJob = nullptr;
+	{
+		const std::lock_guard<std::mutex> lock(m_deadlineJobsMutex[threadTypeIndex]);
+		auto& jobs = m_deadlineJobs[threadTypeIndex];
+
+		if (jobs.IsEmpty())
+		{
+			return false;
+		}
+
+		pJob = *jobs.Last();
+		jobs.RemoveLast();
+
+		m_earliestDeadline[threadTypeIndex] = jobs.IsEmpty() ? NoDeadline : (*jobs.Last())->GetDeadline();
+	}
+
+	OnJobFetched(threadType);
+	pOutJob = AcquireDispatchedJob(pJob);
+	return true;
+}
+
+ITaskPtr Scheduler::AcquireDispatchedJob(ITask* pJob)
+{
+	return std::move(pJob->m_selfWhileDispatched);
+}
+
+void Scheduler::OnJobFetched(EThreadType threadType)
+{
+	m_numQueuedJobs[(uint32_t)threadType]--;
+}
+
+void Scheduler::OnJobFinished(EThreadType threadType)
+{
+	const uint32_t threadTypeIndex = (uint32_t)threadType;
+
+	// Pairs with the increment of m_numIdleWaiters in WaitIdle
+	if (--m_numUnfinishedJobs[threadTypeIndex] == 0 && m_numIdleWaiters[threadTypeIndex] > 0)
+	{
+		m_numUnfinishedJobs[threadTypeIndex].notify_all();
+	}
+}
+
+EThreadType Scheduler::GetThreadType(DWORD threadId) const
+{
+	if (threadId == m_mainThreadId)
+	{
+		return EThreadType::Main;
+	}
+
+	auto result = m_workerThreads.FindIf([&](const auto& worker) { return worker->GetThreadId() == threadId; });
+	check(result != -1);
+
+	return m_workerThreads[result]->GetThreadType();
+}
+
+WorkerThread* Scheduler::GetCurrentWorkerThread() const
+{
+	return t_pCurrentWorker;
 }
 
 bool Scheduler::TryFetchNextAvailiableJob(ITaskPtr& pOutJob, EThreadType threadType)
 {
 	SAILOR_PROFILE_FUNCTION();
 
-	std::mutex* pOutMutex;
-	TVector<ITaskPtr>* pOutQueue;
-	std::condition_variable* pOutCondVar;
+	if (TryFetchDeadlineJob(pOutJob, threadType, true))
+	{
+		return true;
+	}
 
-	GetThreadSyncVarsByThreadType(threadType, pOutMutex, pOutQueue, pOutCondVar);
+	for (uint32_t i = 0; i < NumPriorities; i++)
+	{
+		if (TryFetchNextAvailiableJob(pOutJob, threadType, (EPriority)i))
+		{
+			return true;
+		}
+	}
 
-	const std::lock_guard<std::mutex> lock(*pOutMutex);
+	return TryFetchDeadlineJob(pOutJob, threadType, false);
+}
 
-	if (!(*pOutQueue).IsEmpty())
+bool Scheduler::TryFetchNextAvailiableJob(ITaskPtr& pOutJob, EThreadType threadType, EPriority priority)
+{
+	SAILOR_PROFILE_FUNCTION();
+
+	ITask* pJob = nullptr;
+	if (m_pCommonJobsQueue[(uint32_t)threadType][(uint32_t)priority].TryPop(pJob))
 	{
-		const auto result = (*pOutQueue).FindIf(
-			[&](const ITaskPtr& job)
-			{
-				return job->IsReadyToStart();
-			});
+		OnJobFetched(threadType);
+		pOutJob = AcquireDispatchedJob(pJob);
+		return true;
+	}
 
-		if (result != -1)
+	return false;
+}
+
+bool Scheduler::TryStealJob(ITaskPtr& pOutJob, WorkerThread* pThief, EPriority priority)
+{
+	SAILOR_PROFILE_FUNCTION();
+
+	const uint32_t threadTypeIndex = (uint32_t)pThief->GetThreadType();
+	const auto& victims = m_workerThreadsByType[threadTypeIndex];
+	const size_t numVictims = victims.Num();
+
+	if (numVictims < 2)
+	{
+		return false;
+	}
+
+	// Start from the random victim to spread the contention between the workers
+	const size_t start = pThief->NextRandom() % numVictims;
+	for (size_t i = 0; i < numVictims; i++)
+	{
+		WorkerThread* pVictim = victims[(start + i) % numVictims];
+		if (pVictim == pThief)
 		{
-			pOutJob = (*pOutQueue)[result];
-			(*pOutQueue).RemoveAt(result);
+			continue;
+		}
 
+		ITask* pJob = nullptr;
+		if (pVictim->TryStealJob(pJob, priority))
+		{
+			OnJobFetched(pThief->GetThreadType());
+			pOutJob = AcquireDispatchedJob(pJob);
 			return true;
 		}
 	}
@@ -371,80 +622,68 @@ void Scheduler::NotifyWorkerThread(EThreadType threadType, bool bNotifyAllThread
 {
 	SAILOR_PROFILE_FUNCTION();
 
-	std::mutex* pOutMutex;
-	TVector<ITaskPtr>* pOutQueue;
-	std::condition_variable* pOutCondVar;
+	const uint32_t threadTypeIndex = (uint32_t)threadType;
 
-	GetThreadSyncVarsByThreadType(threadType, pOutMutex, pOutQueue, pOutCondVar);
+	// Pairs with the increment of m_numSleepingThreads in WorkerThread::Process
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (m_numSleepingThreads[threadTypeIndex] == 0 && !m_bIsTerminating)
+	{
+		return;
+	}
+
+	{
+		// The worker could be between the check of the predicate and the wait
+		const std::lock_guard<std::mutex> lock(m_refreshMutex[threadTypeIndex]);
+	}
 
 	if (bNotifyAllThreads)
 	{
-		pOutCondVar->notify_all();
+		m_refreshCondVar[threadTypeIndex].notify_all();
 	}
 	else
 	{
-		pOutCondVar->notify_one();
+		m_refreshCondVar[threadTypeIndex].notify_one();
 	}
 }
 
 uint32_t Scheduler::GetNumRenderingJobs() const
 {
-	return (uint32_t)m_pCommonJobsQueue[(uint32_t)EThreadType::Render].Num();
+	return m_numQueuedJobs[(uint32_t)EThreadType::Render];
 }
 
 void Scheduler::WaitIdle(EThreadType type)
 {
 	SAILOR_PROFILE_FUNCTION();
 
-	std::mutex* pOutMutex;
-	TVector<ITaskPtr>* pOutQueue;
-	std::condition_variable* pOutCondVar;
-	TVector<ITaskPtr> waitFor;
+	const uint32_t threadTypeIndex = (uint32_t)type;
+	auto& numUnfinishedJobs = m_numUnfinishedJobs[threadTypeIndex];
 
-	GetThreadSyncVarsByThreadType(type, pOutMutex, pOutQueue, pOutCondVar);
+	m_numIdleWaiters[threadTypeIndex]++;
 
+	uint32_t num = 0;
+	while ((num = numUnfinishedJobs.load()) > 0)
 	{
-		const std::unique_lock<std::mutex> lock(m_queueMutex[(uint8_t)type]);
-		waitFor = *pOutQueue;
+		// Woken up by OnJobFinished when the counter reaches zero
+		numUnfinishedJobs.wait(num);
 	}
 
-	do
-	{
-		for (auto& wait : waitFor)
-		{
-			wait->Wait();
-		}
-
-		{
-			const std::unique_lock<std::mutex> lock(m_queueMutex[(uint8_t)type]);
-			waitFor = *pOutQueue;
-		}
-
-	} while (waitFor.Num() != 0);
-
-	for (auto& worker : m_workerThreads)
-	{
-		if (worker->GetThreadType() == type)
-		{
-			worker->WaitIdle();
-		}
-	}
+	m_numIdleWaiters[threadTypeIndex]--;
 }
 
 bool Scheduler::IsMainThread() const
 {
-	return m_mainThreadId == GetCurrentThreadId();
+	return m_mainThreadId == Platform::GetCurrentThreadId();
 }
 
 bool Scheduler::IsRendererThread() const
 {
-	return m_renderingThreadId == GetCurrentThreadId();
+	return m_renderingThreadId == Platform::GetCurrentThreadId();
 }
 
 uint16_t Scheduler::AcquireTaskSyncBlock()
 {
 	uint16_t last = 0;
-	if (m_freeList.try_pop(last))
+	if (m_freeList.TryPop(last))
 	{
 		return last;
 	}
@@ -456,5 +695,5 @@ uint16_t Scheduler::AcquireTaskSyncBlock()
 
 void Scheduler::ReleaseTaskSyncBlock(const ITask& task)
 {
-	m_freeList.push(task.m_taskSyncBlockHandle);
+	m_freeList.Push(task.m_taskSyncBlockHandle);
 }
\ No newline at end of file
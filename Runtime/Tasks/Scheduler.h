@@ -4,13 +4,13 @@
 #include <mutex>
 #include <atomic>
 #include <thread>
+#include <condition_variable>
 #include "Sailor.h"
 #include "Core/Submodule.h"
 #include "Memory/UniquePtr.hpp"
 #include "Tasks/Tasks.h"
-
-// TODO: Implement ConcurrentList
-#include <concurrent_queue.h>
+#include "Containers/WorkStealingDeque.h"
+#include "Containers/ConcurrentQueue.h"
 
 #define SAILOR_ENQUEUE_TASK(Name, Lambda) Sailor::App::GetSubmodule<Tasks::Scheduler>()->Run(Sailor::Tasks::CreateTask(Name, Lambda))
 #define SAILOR_ENQUEUE_TASK_RENDER_THREAD(Name, Lambda) Sailor::App::GetSubmodule<Tasks::Scheduler>()->Run(Sailor::Tasks::CreateTask(Name, Lambda, Sailor::Tasks::EThreadType::Render))
@@ -27,14 +27,9 @@ namespace Sailor
 		{
 		public:
 
-			SAILOR_API WorkerThread(
-				std::string threadName,
-				EThreadType threadType,
-				std::condition_variable& refresh,
-				std::mutex& mutex,
-				TVector<ITaskPtr>& pJobsQueue);
+			SAILOR_API WorkerThread(std::string threadName, EThreadType threadType, uint32_t randomSeed);
 
-			SAILOR_API virtual ~WorkerThread() = default;
+			SAILOR_API virtual ~WorkerThread();
 
 			SAILOR_API WorkerThread(WorkerThread&& move) = delete;
 			SAILOR_API WorkerThread(WorkerThread& copy) = delete;
@@ -43,32 +38,45 @@ namespace Sailor
 			SAILOR_API DWORD GetThreadId() const { return m_threadId; }
 			SAILOR_API EThreadType GetThreadType() const { return m_threadType; }
 
+			// Push the job that should be executed only on this thread
 			SAILOR_API void ForcelyPushJob(const ITaskPtr& pJob);
 
+			// Should be called only from this thread
+			SAILOR_API void PushJob(ITask* pJob) { m_jobsDeque[(uint32_t)pJob->GetPriority()].Push(pJob); }
+
+			// Could be called from any thread
+			SAILOR_API bool TryStealJob(ITask*& pOutJob, EPriority priority) { return m_jobsDeque[(uint32_t)priority].Steal(pOutJob); }
+
+			SAILOR_API void Start();
 			SAILOR_API void Process();
 			SAILOR_API void Join();
-			SAILOR_API void WaitIdle();
+
+			// Should be called only from this thread, executes the other jobs until the task is finished
+			SAILOR_API void WaitWhileHelping(const ITask& task);
 
 		protected:
 
 			SAILOR_API bool TryFetchJob(ITaskPtr& pOutJob);
+			SAILOR_API void ExecuteJob(ITaskPtr& pJob);
+			SAILOR_API uint32_t NextRandom();
 
 			std::string m_threadName;
 			TUniquePtr<std::thread> m_pThread;
 
 			EThreadType m_threadType;
 			DWORD m_threadId;
-
-			std::atomic<bool> m_bIsBusy;
+			uint32_t m_randomState;
+			uint32_t m_numFetches = 0;
+			uint32_t m_nestedWaitDepth = 0;
 
 			// Specific jobs for this thread
 			std::mutex m_queueMutex;
 			TVector<ITaskPtr> m_pJobsQueue;
 
-			// Assigned from scheduler
-			std::condition_variable& m_refresh;
-			std::mutex& m_commonQueueMutex;
-			TVector<ITaskPtr>& m_pCommonJobsQueue;
+			// Ready to start jobs per priority, the other workers with the same thread type could steal them
+			TWorkStealingDeque<ITask*> m_jobsDeque[NumPriorities];
+
+			friend class Scheduler;
 		};
 
 		class Scheduler final : public TSubmodule<Scheduler>
@@ -76,16 +84,31 @@ namespace Sailor
 			const uint8_t RHIThreadsNum = 2u;
 			const size_t MaxTasksInPool = 16384;
 
+			// Each Nth fetch starts from the lowest priority, so the background jobs cannot starve
+			const uint32_t StarvationGuardPeriod = 16u;
+
+			// The jobs with deadline are fetched before the others when the deadline is closer than that
+			const int64_t DeadlineSlackMs = 2;
+
+			// The worker that waits for the task stops to execute the other jobs after that depth to not overflow the stack
+			const uint32_t MaxNestedWaitDepth = 64u;
+
+			// The waiting worker that has nothing to execute rechecks the queues with that period
+			const uint32_t HelpWhileWaitPeriodMs = 1u;
+
 		public:
 
-			SAILOR_API void Initialize();
+			// 0 means the number of cores except the render and RHI threads
+			SAILOR_API void Initialize(uint32_t numWorkerThreads = 0);
 
 			SAILOR_API virtual ~Scheduler() override;
 
 			// Lock thit thread until all jobs on thread type would be finished
+			// The thread sleeps on the atomic counter of unfinished jobs, so it doesn't consume CPU
 			SAILOR_API void WaitIdle(EThreadType type);
 
 			SAILOR_API uint32_t GetNumWorkerThreads() const;
+			SAILOR_API uint32_t GetNumWorkerThreads(EThreadType threadType) const { return (uint32_t)m_workerThreadsByType[(uint32_t)threadType].Num(); }
 			SAILOR_API uint32_t GetNumRenderingJobs() const;
 			SAILOR_API uint32_t GetNumRHIThreads() const { return RHIThreadsNum; }
 
@@ -94,6 +117,12 @@ namespace Sailor
 			SAILOR_API void ProcessJobsOnMainThread();
 
 			SAILOR_API bool TryFetchNextAvailiableJob(ITaskPtr& pOutJob, EThreadType threadType);
+			SAILOR_API bool TryFetchNextAvailiableJob(ITaskPtr& pOutJob, EThreadType threadType, EPriority priority);
+			SAILOR_API bool TryFetchDeadlineJob(ITaskPtr& pOutJob, EThreadType threadType, bool bOnlyDue);
+			SAILOR_API bool TryStealJob(ITaskPtr& pOutJob, WorkerThread* pThief, EPriority priority);
+
+			// Push the job to the worker's deque or to the common queue if it is ready to start
+			SAILOR_API void TryDispatch(const ITaskPtr& pJob);
 
 			SAILOR_API void NotifyWorkerThread(EThreadType threadType, bool bNotifyAllThreads = false);
 
@@ -103,6 +132,9 @@ namespace Sailor
 			SAILOR_API DWORD GetMainThreadId() const { return m_mainThreadId; }
 			SAILOR_API DWORD GetRendererThreadId() const;
 
+			// nullptr if the current thread is not the worker thread
+			SAILOR_API WorkerThread* GetCurrentWorkerThread() const;
+
 			SAILOR_API Scheduler() = default;
 
 			SAILOR_API void RunChainedTasks(const ITaskPtr& pJob);
@@ -115,31 +147,50 @@ namespace Sailor
 
 			SAILOR_API void RunChainedTasks_Internal(const ITaskPtr& pJob, const ITaskPtr& pJobToIgnore);
 
-			SAILOR_API void GetThreadSyncVarsByThreadType(
-				EThreadType threadType,
-				std::mutex*& pOutMutex,
-				TVector<ITaskPtr>*& pOutQueue,
-				std::condition_variable*& pOutCondVar);
+			// Take the ownership back from the dispatched job
+			SAILOR_API static ITaskPtr AcquireDispatchedJob(ITask* pJob);
+			SAILOR_API void OnJobFetched(EThreadType threadType);
+			SAILOR_API void OnJobFinished(EThreadType threadType);
+			SAILOR_API EThreadType GetThreadType(DWORD threadId) const;
+
+			SAILOR_API void PushDeadlineJob(ITask* pJob);
+
+			// Ready to start jobs that were dispatched outside of the workers with the same thread type
+			TConcurrentQueue<ITask*> m_pCommonJobsQueue[4][NumPriorities];
 
-			std::mutex m_queueMutex[4];
+			// Ready to start jobs with deadline, sorted by descending deadline
+			std::mutex m_deadlineJobsMutex[4];
+			TVector<ITask*> m_deadlineJobs[4];
+			std::atomic<int64_t> m_earliestDeadline[4]{ NoDeadline, NoDeadline, NoDeadline, NoDeadline };
+
+			// Enqueued but not fetched yet jobs, including the jobs that are waiting for their dependencies
+			std::atomic<uint32_t> m_numQueuedJobs[4]{};
+
+			// Enqueued but not finished yet jobs, grouped by the thread type that executes them
+			std::atomic<uint32_t> m_numUnfinishedJobs[4]{};
+			std::atomic<uint32_t> m_numIdleWaiters[4]{};
+
+			std::mutex m_refreshMutex[4];
 			std::condition_variable m_refreshCondVar[4];
-			TVector<ITaskPtr> m_pCommonJobsQueue[4];
+			std::atomic<uint32_t> m_numSleepingThreads[4]{};
 
-			std::atomic<uint32_t> m_numBusyThreads;
 			TVector<WorkerThread*> m_workerThreads;
+			TVector<WorkerThread*> m_workerThreadsByType[4];
 			std::atomic_bool m_bIsTerminating;
 
 			DWORD m_mainThreadId = -1;
 			DWORD m_renderingThreadId = -1;
 
 			// Task Synchronization primitives pool
-			concurrency::concurrent_queue<uint16_t> m_freeList{};
+			TConcurrentQueue<uint16_t> m_freeList{};
 			TVector<TaskSyncBlock> m_tasksPool{};
 
 			friend class WorkerThread;
 
 			template<typename TResult, typename TArgs>
-			friend TaskPtr<TResult, TArgs> CreateTask(const std::string& name, typename TFunction<TResult, TArgs>::type lambda, EThreadType thread);
+			friend TaskPtr<TResult, TArgs> CreateTask(const std::string& name, typename TFunction<TResult, TArgs>::type lambda, EThreadType thread, EPriority priority);
 		};
+
+		SAILOR_API void RunSchedulerBenchmark();
 	}
 }
\ No newline at end of file
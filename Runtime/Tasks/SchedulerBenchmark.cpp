@@ -0,0 +1,474 @@
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include "Tasks/Scheduler.h"
+#include "Tasks/Tasks.h"
+#include "Containers/WorkStealingDeque.h"
+#include "Containers/ConcurrentQueue.h"
+#include "Core/Utils.h"
+#include "Platform/Platform.h"
+
+using namespace Sailor;
+using namespace Sailor::Tasks;
+using Timer = Utils::Timer;
+
+namespace
+{
+	struct BenchmarkJob
+	{
+		uint32_t m_chainLeft = 0;
+		bool m_bIsReady = true;
+	};
+
+	__forceinline void DoTinyWork(std::atomic<uint32_t>& numFinished)
+	{
+		numFinished.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	// The model of the previous scheduler: one mutex-guarded queue, linear search of the ready job
+	class GlobalQueuePolicy
+	{
+	public:
+
+		GlobalQueuePolicy(uint32_t) {}
+
+		void Push(uint32_t, BenchmarkJob* pJob)
+		{
+			const std::lock_guard<std::mutex> lock(m_mutex);
+			m_queue.Add(pJob);
+		}
+
+		void Inject(BenchmarkJob* pJob) { Push(0, pJob); }
+
+		bool TryFetch(uint32_t, BenchmarkJob*& pOutJob)
+		{
+			const std::lock_guard<std::mutex> lock(m_mutex);
+
+			const auto result = m_queue.FindIf([](BenchmarkJob* const& job) { return job->m_bIsReady; });
+			if (result != -1)
+			{
+				pOutJob = m_queue[result];
+				m_queue.RemoveAt(result);
+				return true;
+			}
+
+			return false;
+		}
+
+		static const char* GetName() { return "Global queue"; }
+
+	protected:
+
+		std::mutex m_mutex;
+		TVector<BenchmarkJob*> m_queue;
+	};
+
+	class WorkStealingPolicy
+	{
+	public:
+
+		WorkStealingPolicy(uint32_t numThreads) : m_numThreads(numThreads)
+		{
+			for (uint32_t i = 0; i < numThreads; i++)
+			{
+				m_deques.Add(TUniquePtr<TWorkStealingDeque<BenchmarkJob*>>::Make());
+				m_randomStates.Add(i + 1);
+			}
+		}
+
+		void Push(uint32_t threadIndex, BenchmarkJob* pJob) { m_deques[threadIndex]->Push(pJob); }
+		void Inject(BenchmarkJob* pJob) { m_common.Push(pJob); }
+
+		bool TryFetch(uint32_t threadIndex, BenchmarkJob*& pOutJob)
+		{
+			if (m_deques[threadIndex]->Pop(pOutJob) || m_common.TryPop(pOutJob))
+			{
+				return true;
+			}
+
+			uint32_t& state = m_randomStates[threadIndex];
+			state ^= state << 13;
+			state ^= state >> 17;
+			state ^= state << 5;
+
+			const uint32_t start = state % m_numThreads;
+			for (uint32_t i = 0; i < m_numThreads; i++)
+			{
+				const uint32_t victim = (start + i) % m_numThreads;
+				if (victim != threadIndex && m_deques[victim]->Steal(pOutJob))
+				{
+					return true;
+				}
+			}
+
+			return false;
+		}
+
+		static const char* GetName() { return "Work stealing"; }
+
+	protected:
+
+		uint32_t m_numThreads;
+		TVector<TUniquePtr<TWorkStealingDeque<BenchmarkJob*>>> m_deques;
+		TVector<uint32_t> m_randomStates;
+		TConcurrentQueue<BenchmarkJob*> m_common;
+	};
+
+	template<typename TPolicy>
+	class TestCase_SchedulerPerformance
+	{
+	public:
+
+		static void RunTests(uint32_t numJobs)
+		{
+			for (uint32_t numThreads : { 2u, 4u, 8u, 16u })
+			{
+				const int64_t fanOutMs = RunFanOut(numThreads, numJobs);
+				const int64_t chainsMs = RunChains(numThreads, numJobs, 64);
+
+				SAILOR_LOG("%s, %u workers:\n\tfan-out of %u jobs %lldms\n\tchained continuations (64 chains) %lldms",
+					TPolicy::GetName(), numThreads, numJobs, (long long)fanOutMs, (long long)chainsMs);
+			}
+		}
+
+	protected:
+
+		// The first worker spawns all the jobs, the others have to fetch them from it
+		static int64_t RunFanOut(uint32_t numThreads, uint32_t numJobs)
+		{
+			TVector<BenchmarkJob> jobs(numJobs);
+			TPolicy policy(numThreads);
+			std::atomic<uint32_t> numFinished = 0;
+
+			Timer timer;
+			timer.Start();
+
+			Run(policy, numThreads, numJobs, numFinished, [&](uint32_t threadIndex)
+				{
+					if (threadIndex == 0)
+					{
+						for (auto& job : jobs)
+						{
+							policy.Push(threadIndex, &job);
+						}
+					}
+				});
+
+			timer.Stop();
+			return timer.ResultMs();
+		}
+
+		// Each job enqueues its continuation on completion
+		static int64_t RunChains(uint32_t numThreads, uint32_t numJobs, uint32_t numChains)
+		{
+			TVector<BenchmarkJob> chains(numChains);
+			TPolicy policy(numThreads);
+			std::atomic<uint32_t> numFinished = 0;
+
+			for (auto& chain : chains)
+			{
+				chain.m_chainLeft = numJobs / numChains;
+				policy.Inject(&chain);
+			}
+
+			Timer timer;
+			timer.Start();
+
+			Run(policy, numThreads, (numJobs / numChains) * numChains, numFinished, [](uint32_t) {});
+
+			timer.Stop();
+			return timer.ResultMs();
+		}
+
+		template<typename TOnStart>
+		static void Run(TPolicy& policy, uint32_t numThreads, uint32_t numJobs, std::atomic<uint32_t>& numFinished, TOnStart onStart)
+		{
+			TVector<std::thread> threads;
+			threads.Reserve(numThreads);
+
+			for (uint32_t i = 0; i < numThreads; i++)
+			{
+				threads.Emplace([&, i]()
+					{
+						onStart(i);
+
+						BenchmarkJob* pJob = nullptr;
+						while (numFinished.load(std::memory_order_relaxed) < numJobs)
+						{
+							if (!policy.TryFetch(i, pJob))
+							{
+								std::this_thread::yield();
+								continue;
+							}
+
+							DoTinyWork(numFinished);
+
+							if (pJob->m_chainLeft > 1)
+							{
+								pJob->m_chainLeft--;
+								policy.Push(i, pJob);
+							}
+						}
+					});
+			}
+
+			for (auto& thread : threads)
+			{
+				thread.join();
+			}
+		}
+	};
+
+	// The real scheduler with its own number of workers
+	void RunEngineSchedulerTests(uint32_t numJobs)
+	{
+		auto scheduler = App::GetSubmodule<Scheduler>();
+
+		// The pool of the sync blocks is limited, so we run the jobs by batches
+		const uint32_t batchSize = 8192;
+
+		Timer fanOut;
+		std::atomic<uint32_t> numFinished = 0;
+
+		fanOut.Start();
+		for (uint32_t i = 0; i < numJobs; i += batchSize)
+		{
+			const uint32_t num = std::min(batchSize, numJobs - i);
+			for (uint32_t j = 0; j < num; j++)
+			{
+				SAILOR_ENQUEUE_TASK("Benchmark fan-out", ([&numFinished]() { DoTinyWork(numFinished); }));
+			}
+			scheduler->WaitIdle(EThreadType::Worker);
+		}
+		fanOut.Stop();
+
+		Timer chains;
+		std::atomic<uint32_t> numFinishedChained = 0;
+		uint32_t numChained = 0;
+		const uint32_t numChains = 64;
+		const uint32_t chainLength = batchSize / numChains;
+
+		chains.Start();
+		for (uint32_t i = 0; i < numJobs; i += numChains * chainLength)
+		{
+			for (uint32_t j = 0; j < numChains; j++)
+			{
+				TaskPtr<void> pLast = CreateTask("Benchmark chain", [&numFinishedChained]() { DoTinyWork(numFinishedChained); });
+
+				for (uint32_t k = 1; k < chainLength; k++)
+				{
+					pLast = pLast->Then<void>([&numFinishedChained]() { DoTinyWork(numFinishedChained); });
+				}
+
+				// Runs the whole chain, the handles are dropped before the tasks are executed
+				pLast->Run();
+				numChained += chainLength;
+			}
+			scheduler->WaitIdle(EThreadType::Worker);
+		}
+		chains.Stop();
+
+		SAILOR_LOG("Tasks::Scheduler, %u workers:\n\tfan-out of %u jobs %lldms\n\tchained continuations (%u chains) %lldms",
+			scheduler->GetNumWorkerThreads(), numJobs, (long long)fanOut.ResultMs(), numChains, (long long)chains.ResultMs());
+
+		printf("Sanity check passed: %d\n", numFinished == numJobs && numFinishedChained == numChained);
+	}
+
+	__forceinline void SpinFor(int64_t durationMicro)
+	{
+		const int64_t end = Utils::GetCurrentTimeMicro() + durationMicro;
+		while (Utils::GetCurrentTimeMicro() < end);
+	}
+
+	// The workers are saturated by the background jobs, we measure the time between the enqueue and the start of the probes
+	void RunEngineSchedulerLatencyTests(EPriority probePriority, bool bWithDeadline)
+	{
+		auto scheduler = App::GetSubmodule<Scheduler>();
+
+		const uint32_t numBackgroundJobs = scheduler->GetNumWorkerThreads() * 64;
+		const uint32_t numProbes = 64;
+		constexpr int64_t backgroundJobMicro = 1000;
+
+		for (uint32_t i = 0; i < numBackgroundJobs; i++)
+		{
+			scheduler->Run(CreateTask("Benchmark background", []() { SpinFor(backgroundJobMicro); }, EThreadType::Worker, EPriority::Background));
+		}
+
+		TVector<int64_t> latencies(numProbes);
+		for (uint32_t i = 0; i < numProbes; i++)
+		{
+			const int64_t enqueueTime = Utils::GetCurrentTimeMicro();
+			auto pProbe = CreateTask("Benchmark probe", [&latencies, i, enqueueTime]()
+				{
+					latencies[i] = Utils::GetCurrentTimeMicro() - enqueueTime;
+				}, EThreadType::Worker, probePriority);
+
+			if (bWithDeadline)
+			{
+				pProbe->SetDeadline(Utils::GetCurrentTimeMs() + 1);
+			}
+
+			scheduler->Run(pProbe);
+			SpinFor(backgroundJobMicro / 2);
+		}
+
+		scheduler->WaitIdle(EThreadType::Worker);
+
+		int64_t sum = 0;
+		int64_t max = 0;
+		for (const auto& latency : latencies)
+		{
+			sum += latency;
+			max = std::max(max, latency);
+		}
+
+		const char* priorityNames[] = { "Critical", "High", "Normal", "Background" };
+		SAILOR_LOG("Tasks::Scheduler, %s%s probes under %u background jobs of %lldus:\n\tavg latency %lldus, max latency %lldus",
+			priorityNames[(uint32_t)probePriority], bWithDeadline ? " with deadline" : "", numBackgroundJobs, (long long)backgroundJobMicro,
+			(long long)(sum / (int64_t)numProbes), (long long)max);
+	}
+
+	// Each task spawns the children and waits for them, so all the workers are waiting at the same time
+	uint32_t RunNestedTree(uint32_t depth)
+	{
+		if (depth == 0)
+		{
+			return 1;
+		}
+
+		std::atomic<uint32_t> numLeft = 0;
+		std::atomic<uint32_t> numRight = 0;
+
+		auto pLeft = CreateTask("Benchmark nested wait", [&numLeft, depth]() { numLeft = RunNestedTree(depth - 1); })->Run();
+		auto pRight = CreateTask("Benchmark nested wait", [&numRight, depth]() { numRight = RunNestedTree(depth - 1); })->Run();
+
+		pLeft->Wait();
+		pRight->Wait();
+
+		return numLeft + numRight;
+	}
+
+	uint32_t RunNestedChain(uint32_t depth)
+	{
+		if (depth == 0)
+		{
+			return 1;
+		}
+
+		std::atomic<uint32_t> num = 0;
+		CreateTask("Benchmark nested wait", [&num, depth]() { num = RunNestedChain(depth - 1); })->Run()->Wait();
+
+		return num + 1;
+	}
+
+	void RunNestedWaitTests()
+	{
+		auto scheduler = App::GetSubmodule<Scheduler>();
+
+		const uint32_t treeDepth = 11;
+		const uint32_t chainDepth = 16;
+		const uint32_t numChains = scheduler->GetNumWorkerThreads(EThreadType::Worker) * 2;
+
+		Timer tree;
+		std::atomic<uint32_t> numLeaves = 0;
+
+		tree.Start();
+		CreateTask("Benchmark nested wait", [&numLeaves, treeDepth]() { numLeaves = RunNestedTree(treeDepth); })->Run()->Wait();
+		tree.Stop();
+
+		check(numLeaves == (1u << treeDepth));
+
+		Timer chains;
+		std::atomic<uint32_t> numLinks = 0;
+		TVector<ITaskPtr> tasks;
+
+		chains.Start();
+		for (uint32_t i = 0; i < numChains; i++)
+		{
+			tasks.Add(CreateTask("Benchmark nested wait", [&numLinks, chainDepth]() { numLinks += RunNestedChain(chainDepth); })->Run());
+		}
+
+		for (auto& task : tasks)
+		{
+			task->Wait();
+		}
+		chains.Stop();
+
+		check(numLinks == numChains * (chainDepth + 1));
+
+		SAILOR_LOG("Tasks::Scheduler, nested waits:\n\tbinary tree of depth %u (%u leaves) %lldms\n\t%u chains of depth %u %lldms",
+			treeDepth, numLeaves.load(), (long long)tree.ResultMs(), numChains, chainDepth, (long long)chains.ResultMs());
+	}
+
+	// The scheduler owns the enqueued tasks, so the chain runs to the end when the caller drops all its handles
+	bool RunDroppedHandlesTests()
+	{
+		auto scheduler = App::GetSubmodule<Scheduler>();
+
+		const uint32_t numChains = 64;
+		const uint32_t chainLength = 3;
+		std::atomic<uint32_t> numFinished = 0;
+
+		for (uint32_t i = 0; i < numChains; i++)
+		{
+			CreateTask("Benchmark dropped chain", [&numFinished]() { numFinished++; })->
+				Then<void>([&numFinished]() { numFinished++; })->
+				Then<void>([&numFinished]() { numFinished++; })->
+				Run();
+		}
+
+		scheduler->WaitIdle(EThreadType::Worker);
+
+		return numFinished == numChains * chainLength;
+	}
+
+	// The engine threads should not consume CPU while there is nothing to do
+	void RunIdleCpuUsageTests()
+	{
+		auto scheduler = App::GetSubmodule<Scheduler>();
+
+		scheduler->WaitIdle(EThreadType::Worker);
+
+		const int64_t idlePeriodMs = 1000;
+		const int64_t processCpuTime = Platform::GetProcessCpuTimeMicro();
+		std::this_thread::sleep_for(std::chrono::milliseconds(idlePeriodMs));
+		const int64_t idleCpuTime = Platform::GetProcessCpuTimeMicro() - processCpuTime;
+
+		// The thread that calls WaitIdle should sleep as well
+		const uint32_t numSleepingJobs = scheduler->GetNumWorkerThreads(EThreadType::Worker);
+		const uint32_t sleepingJobMs = 200;
+
+		for (uint32_t i = 0; i < numSleepingJobs; i++)
+		{
+			SAILOR_ENQUEUE_TASK("Benchmark sleeping job", ([sleepingJobMs]() { std::this_thread::sleep_for(std::chrono::milliseconds(sleepingJobMs)); }));
+		}
+
+		const int64_t threadCpuTime = Platform::GetThreadCpuTimeMicro();
+		scheduler->WaitIdle(EThreadType::Worker);
+		const int64_t waitIdleCpuTime = Platform::GetThreadCpuTimeMicro() - threadCpuTime;
+
+		SAILOR_LOG("Tasks::Scheduler, CPU usage:\n\tidle process %.2f%% of one core\n\tWaitIdle for %ums jobs %lldus of CPU time",
+			(float)idleCpuTime / (idlePeriodMs * 10), sleepingJobMs, (long long)waitIdleCpuTime);
+	}
+}
+
+void Sailor::Tasks::RunSchedulerBenchmark()
+{
+	const uint32_t numJobs = 100000;
+
+	printf("\nStarting scheduler benchmark...\n");
+
+	TestCase_SchedulerPerformance<GlobalQueuePolicy>::RunTests(numJobs);
+	TestCase_SchedulerPerformance<WorkStealingPolicy>::RunTests(numJobs);
+
+	printf("Sanity check passed: %d\n", RunDroppedHandlesTests());
+
+	RunEngineSchedulerTests(numJobs);
+
+	RunEngineSchedulerLatencyTests(EPriority::Normal, false);
+	RunEngineSchedulerLatencyTests(EPriority::Critical, false);
+	RunEngineSchedulerLatencyTests(EPriority::Normal, true);
+
+	RunNestedWaitTests();
+	RunIdleCpuUsageTests();
+}
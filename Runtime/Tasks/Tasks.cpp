@@ -1,7 +1,4 @@
 #include "Scheduler.h"
-#include <windows.h>
-#include <fcntl.h>
-#include <conio.h>
 #include <algorithm>
 #include <mutex>
 #include <set>
@@ -9,7 +6,6 @@
 #include "Core/Utils.h"
 #include "Core/Submodule.h"
 #include "Tasks/Tasks.h"
-#include "Containers/Map.h"
 
 using namespace std;
 using namespace Sailor;
@@ -41,6 +37,17 @@ bool ITask::AddDependency(TSharedPtr<ITask> dependentJob)
 	return true;
 }
 
+bool ITask::TryMarkDispatched()
+{
+	if (!IsInQueue() || m_numBlockers > 0)
+	{
+		return false;
+	}
+
+	// Both Scheduler::Run and ITask::Complete could observe the task as ready at the same time
+	return !(m_state.fetch_or(StateMask::IsDispatchedBit) & StateMask::IsDispatchedBit);
+}
+
 void ITask::SetChainedTaskPrev(TWeakPtr<ITask>& job)
 {
 	check(!m_chainedTaskPrev);
@@ -59,6 +66,21 @@ void ITask::Join(const TVector<TWeakPtr<ITask>>& jobs)
 	}
 }
 
+TaskSyncBlock& ITask::GetTaskSyncBlock() const
+{
+	return App::GetSubmodule<Scheduler>()->GetTaskSyncBlock(*this);
+}
+
+void ITask::AcquireTaskSyncBlock()
+{
+	m_taskSyncBlockHandle = App::GetSubmodule<Scheduler>()->AcquireTaskSyncBlock();
+}
+
+void ITask::ReleaseTaskSyncBlock() const
+{
+	App::GetSubmodule<Scheduler>()->ReleaseTaskSyncBlock(*this);
+}
+
 TSharedPtr<ITask> ITask::Run()
 {
 	TSharedPtr<ITask> res = m_self.Lock();
@@ -76,7 +98,7 @@ void ITask::Complete()
 
 	std::unique_lock<std::mutex> lk(syncBlock.m_mutex);
 
-	TMap<EThreadType, uint32_t> threadTypesToRefresh;
+	auto scheduler = App::GetSubmodule<Tasks::Scheduler>();
 
 	for (auto& job : m_dependencies)
 	{
@@ -84,18 +106,14 @@ void ITask::Complete()
 		{
 			if (--pJob->m_numBlockers == 0)
 			{
-				threadTypesToRefresh[pJob->GetThreadType()]++;
+				// The dependent task could be already enqueued, so we're responsible to dispatch it
+				scheduler->TryDispatch(pJob);
 			}
 		}
 	}
 
 	m_dependencies.Clear();
 
-	for (const auto& threadType : threadTypesToRefresh)
-	{
-		App::GetSubmodule<Tasks::Scheduler>()->NotifyWorkerThread(threadType.m_first, *threadType.m_second > 1);
-	}
-
 	m_state |= StateMask::IsFinishedBit;
 	syncBlock.m_onComplete.notify_all();
 }
@@ -103,13 +121,19 @@ void ITask::Complete()
 void ITask::Wait()
 {
 	SAILOR_PROFILE_FUNCTION();
-	
-	auto& syncBlock = App::GetSubmodule<Scheduler>()->GetTaskSyncBlock(*this);
 
-	std::unique_lock<std::mutex> lk(syncBlock.m_mutex);
+	auto scheduler = App::GetSubmodule<Scheduler>();
 
-	if (!IsFinished())
+	// The worker executes the other jobs while waiting,
+	// otherwise all workers could be blocked by the jobs that nobody would run
+	if (WorkerThread* pWorker = scheduler->GetCurrentWorkerThread())
 	{
-		syncBlock.m_onComplete.wait(lk);
+		pWorker->WaitWhileHelping(*this);
+		return;
 	}
+
+	auto& syncBlock = scheduler->GetTaskSyncBlock(*this);
+
+	std::unique_lock<std::mutex> lk(syncBlock.m_mutex);
+	syncBlock.m_onComplete.wait(lk, [this]() { return IsFinished(); });
 }
@@ -2,6 +2,7 @@
 #include <cstdio>
 #include <functional>
 #include <mutex>
+#include <condition_variable>
 #include <atomic>
 #include <thread>
 #include "Sailor.h"
@@ -26,6 +27,19 @@ namespace Sailor
 			RHI = 3
 		};
 
+		// Workers fetch the jobs with higher priority first,
+		// but periodically look from the lowest priority to avoid the starvation
+		enum class EPriority : uint8_t
+		{
+			Critical = 0,
+			High = 1,
+			Normal = 2,
+			Background = 3
+		};
+
+		constexpr uint32_t NumPriorities = 4;
+		constexpr int64_t NoDeadline = INT64_MAX;
+
 		/* The tasks are using JobSystem::Scheduler to run the activities on other threads.
 		*  The main point to use tasks is to handle/get results of long term tasks without blocking the current thread.
 		*  The chaining is implemented via linked list and there is no need to explicitely run the added(by calling ->Then) tasks.
@@ -46,24 +60,25 @@ namespace Sailor
 		};
 
 		template<typename TResult = void, typename TArgs = void>
-		SAILOR_API TaskPtr<TResult, TArgs> CreateTask(const std::string& name, typename TFunction<TResult, TArgs>::type lambda, EThreadType thread = EThreadType::Worker)
+		SAILOR_API TaskPtr<TResult, TArgs> CreateTask(const std::string& name, typename TFunction<TResult, TArgs>::type lambda, EThreadType thread = EThreadType::Worker, EPriority priority = EPriority::Normal)
 		{
 			auto task = TaskPtr<TResult, TArgs>::Make(name, std::move(lambda), thread);
 			task->m_self = task;
-			task->m_taskSyncBlockHandle = App::GetSubmodule<Scheduler>()->AcquireTaskSyncBlock();
+			task->m_priority = priority;
+			task->AcquireTaskSyncBlock();
 			return task;
 		}
 
 		template<typename TArgs>
-		SAILOR_API TaskPtr<void, TArgs> CreateTaskWithArgs(const std::string& name, typename TFunction<void, TArgs>::type lambda, EThreadType thread = EThreadType::Worker)
+		SAILOR_API TaskPtr<void, TArgs> CreateTaskWithArgs(const std::string& name, typename TFunction<void, TArgs>::type lambda, EThreadType thread = EThreadType::Worker, EPriority priority = EPriority::Normal)
 		{
-			return CreateTask<void, TArgs>(name, lambda, thread);
+			return CreateTask<void, TArgs>(name, lambda, thread, priority);
 		}
 
 		template<typename TResult>
-		SAILOR_API TaskPtr<TResult, void> CreateTaskWithResult(const std::string& name, typename TFunction<TResult, void>::type lambda, EThreadType thread = EThreadType::Worker)
+		SAILOR_API TaskPtr<TResult, void> CreateTaskWithResult(const std::string& name, typename TFunction<TResult, void>::type lambda, EThreadType thread = EThreadType::Worker, EPriority priority = EPriority::Normal)
 		{
-			return CreateTask<TResult, void>(name, lambda, thread);
+			return CreateTask<TResult, void>(name, lambda, thread, priority);
 		}
 
 		class ITask
@@ -74,7 +89,10 @@ namespace Sailor
 			{
 				IsInQueueBit = (uint8_t)(1),
 				IsStartedBit = (uint8_t)(1 << 1),
-				IsFinishedBit = (uint8_t)(1 << 2)
+				IsFinishedBit = (uint8_t)(1 << 2),
+
+				// The task is ready to start and has been pushed to a worker's deque
+				IsDispatchedBit = (uint8_t)(1 << 3)
 			};
 
 		public:
@@ -109,6 +127,14 @@ namespace Sailor
 
 			SAILOR_API EThreadType GetThreadType() const { return m_threadType; }
 
+			SAILOR_API EPriority GetPriority() const { return m_priority; }
+			SAILOR_API void SetPriority(EPriority priority) { check(!IsInQueue()); m_priority = priority; }
+
+			// Absolute time in ms (Utils::GetCurrentTimeMs), the task is fetched before the others when the deadline is close
+			SAILOR_API int64_t GetDeadline() const { return m_deadlineMs; }
+			SAILOR_API bool HasDeadline() const { return m_deadlineMs != NoDeadline; }
+			SAILOR_API void SetDeadline(int64_t deadlineMs) { check(!IsInQueue()); m_deadlineMs = deadlineMs; }
+
 			SAILOR_API const TVector<TWeakPtr<ITask>>& GetChainedTasksNext() const { return m_chainedTasksNext; }
 			SAILOR_API const TSharedPtr<ITask>& GetChainedTaskPrev() const { return m_chainedTaskPrev; }
 
@@ -124,12 +150,28 @@ namespace Sailor
 			{
 			}
 
+			// Returns true if the caller should dispatch the task
+			SAILOR_API bool TryMarkDispatched();
+
+			// The Scheduler is incomplete in this header, so the templates reach the sync block through ITask
+			SAILOR_API TaskSyncBlock& GetTaskSyncBlock() const;
+			SAILOR_API void AcquireTaskSyncBlock();
+			SAILOR_API void ReleaseTaskSyncBlock() const;
+
 			EThreadType m_threadType;
+			EPriority m_priority = EPriority::Normal;
 			std::atomic<uint8_t> m_state = 0;
 			std::atomic<uint16_t> m_numBlockers;
 			uint16_t m_taskSyncBlockHandle = 0;
 
+			// The task should be executed only on the specific thread
+			DWORD m_pinnedThreadId = 0;
+			int64_t m_deadlineMs = NoDeadline;
+
 			TWeakPtr<ITask> m_self;
+
+			// The scheduler owns the task from Run until it is fetched: the deques store raw pointers and the task blocked by its dependencies could have no other owner
+			TSharedPtr<ITask> m_selfWhileDispatched;
 			TVector<TWeakPtr<ITask>> m_chainedTasksNext;
 			TSharedPtr<ITask> m_chainedTaskPrev;
 
@@ -140,7 +182,7 @@ namespace Sailor
 			friend class Scheduler;
 
 			template<typename TResult, typename TArgs>
-			friend TaskPtr<TResult, TArgs> CreateTask(const std::string& name, typename TFunction<TResult, TArgs>::type lambda, EThreadType thread);
+			friend TaskPtr<TResult, TArgs> CreateTask(const std::string& name, typename TFunction<TResult, TArgs>::type lambda, EThreadType thread, EPriority priority);
 		};
 
 		template<typename TResult>
@@ -189,7 +231,7 @@ namespace Sailor
 
 			SAILOR_API virtual ~Task()
 			{
-				App::GetSubmodule<Scheduler>()->ReleaseTaskSyncBlock(*this);
+				ITask::ReleaseTaskSyncBlock();
 			}
 
 			SAILOR_API void Execute() override
@@ -258,6 +300,9 @@ namespace Sailor
 
 				res->SetChainedTaskPrev(ITask::m_self);
 
+				// Continuations inherit the priority, otherwise the chain would be delayed by its slowest part
+				res->SetPriority(ITask::m_priority);
+
 				if constexpr (NotVoid<TResult>)
 				{
 					res->SetArgs(ResultBase::m_result);
@@ -266,7 +311,7 @@ namespace Sailor
 				res->Join(ITask::m_self);
 
 				{
-					auto& taskSyncBlock = App::GetSubmodule<Scheduler>()->GetTaskSyncBlock(*this);
+					auto& taskSyncBlock = ITask::GetTaskSyncBlock();
 
 					std::unique_lock<std::mutex> lk(taskSyncBlock.m_mutex);
 					ITask::m_chainedTasksNext.Add(res);
@@ -274,7 +319,7 @@ namespace Sailor
 
 				if (ITask::IsStarted() || ITask::IsInQueue() || ITask::IsFinished())
 				{
-					App::GetSubmodule<Scheduler>()->Run(res);
+					res->Run();
 				}
 
 				return res;
@@ -283,10 +328,10 @@ namespace Sailor
 			SAILOR_API TaskPtr<TResult, void> ToTaskWithResult()
 			{
 				auto res = Tasks::CreateTaskWithResult<TResult>("Get result task",
-					std::move([=]()
+					std::move([this]()
 						{
 							return ITask::m_self.Lock().DynamicCast<ITaskWithResult<TResult>>()->GetResult();
-						}), ITask::m_threadType);
+						}), ITask::m_threadType, ITask::m_priority);
 
 				res->SetChainedTaskPrev(ITask::m_self);
 				ITask::m_chainedTasksNext.Add(res);
@@ -294,7 +339,7 @@ namespace Sailor
 
 				if (ITask::IsStarted() || ITask::IsInQueue())
 				{
-					App::GetSubmodule<Scheduler>()->Run(res);
+					res->Run();
 				}
 				return res;
 			}
@@ -303,7 +348,8 @@ namespace Sailor
 
 			Function m_function;
 
-			friend TaskPtr<TResult, TArgs> CreateTask(const std::string& name, typename TFunction<TResult, TArgs>::type lambda, EThreadType thread);
+			template<typename TCreateResult, typename TCreateArgs>
+			friend TaskPtr<TCreateResult, TCreateArgs> CreateTask(const std::string& name, typename TFunction<TCreateResult, TCreateArgs>::type lambda, EThreadType thread, EPriority priority);
 		};
 	}
 }
\ No newline at end of file